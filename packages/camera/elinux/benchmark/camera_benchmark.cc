@@ -0,0 +1,393 @@
+// Copyright 2022 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures the preview frame rate, the cost of copying a preview frame to the
+// texture buffer and the throughput of the image stream at several
+// resolutions. Then records a video from a video file source, zooming in the
+// middle of it, and checks that the recorded file can be decoded.
+//
+// Usage:
+// $ camera_benchmark [--source=<description>] [--duration=<seconds>]
+//                    [--resolutions=<width>x<height>,...]
+//                    [--record-source=<file>] [--record-duration=<seconds>]
+//
+// <description> is a source description of GstCameraSource. The caps of each
+// resolution are appended to it. The default is a live videotestsrc, so no
+// camera is needed. When --record-source isn't given, a short test video is
+// generated for the recording check. --record-duration=0 skips it.
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "camera_stream_handler.h"
+#include "gst_camera.h"
+
+namespace {
+constexpr char kDefaultSource[] = "videotestsrc pattern=smpte";
+constexpr char kDefaultResolutions[] = "320x240,640x480,1280x720,1920x1080";
+constexpr int kDefaultDurationSeconds = 5;
+constexpr auto kWarmUpDuration = std::chrono::seconds(1);
+constexpr auto kFrameTimeout = std::chrono::seconds(1);
+constexpr int kDefaultRecordDurationSeconds = 3;
+constexpr auto kFinalizeTimeout = std::chrono::seconds(10);
+constexpr GstClockTime kVerifyTimeout = 10 * GST_SECOND;
+
+using Clock = std::chrono::steady_clock;
+
+struct Resolution {
+  int32_t width;
+  int32_t height;
+};
+
+struct RecordingResult {
+  std::string file_path;
+  GstVideoRecorder::Stats stats;
+  // The time StopVideoRecording() blocks the caller.
+  double stop_call_ms = 0;
+  // The time until the recorded file is finalized.
+  double finalize_ms = 0;
+};
+
+struct BenchmarkResult {
+  double fps = 0;
+  double copy_avg_us = 0;
+  double copy_p95_us = 0;
+  double stream_avg_us = 0;
+  double stream_mb_per_sec = 0;
+  int64_t frames = 0;
+};
+
+class BenchmarkStreamHandler : public CameraStreamHandler {
+ public:
+  BenchmarkStreamHandler() = default;
+  virtual ~BenchmarkStreamHandler() = default;
+
+  int64_t GetFrameCount() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return frame_count_;
+  }
+
+  // Waits until a frame newer than |frame_count| arrives.
+  bool WaitForFrame(int64_t frame_count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cv_.wait_for(lock, kFrameTimeout,
+                        [&] { return frame_count_ > frame_count; });
+  }
+
+ protected:
+  // |CameraStreamHandler|
+  void OnNotifyFrameDecodedInternal() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      frame_count_++;
+    }
+    cv_.notify_all();
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  int64_t frame_count_ = 0;
+};
+
+double ElapsedMicroseconds(Clock::time_point start, Clock::time_point end) {
+  return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+double Average(const std::vector<double>& values) {
+  if (values.empty()) {
+    return 0;
+  }
+  double sum = 0;
+  for (auto value : values) {
+    sum += value;
+  }
+  return sum / values.size();
+}
+
+double Percentile(std::vector<double> values, double percentile) {
+  if (values.empty()) {
+    return 0;
+  }
+  std::sort(values.begin(), values.end());
+  auto index = static_cast<size_t>(percentile / 100 * (values.size() - 1));
+  return values[index];
+}
+
+std::vector<Resolution> ParseResolutions(const std::string& str) {
+  std::vector<Resolution> resolutions;
+  std::stringstream stream(str);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    Resolution resolution;
+    if (std::sscanf(item.c_str(), "%dx%d", &resolution.width,
+                    &resolution.height) == 2) {
+      resolutions.push_back(resolution);
+    } else {
+      std::cerr << "Invalid resolution: " << item << std::endl;
+    }
+  }
+  return resolutions;
+}
+
+bool Run(const std::string& source, const Resolution& resolution,
+         int duration_seconds, BenchmarkResult& result) {
+  auto description = source + " ! video/x-raw,width=" +
+                     std::to_string(resolution.width) +
+                     ",height=" + std::to_string(resolution.height);
+  auto handler = std::make_unique<BenchmarkStreamHandler>();
+  auto* stream_handler = handler.get();
+  GstCamera camera(std::move(handler), description);
+  if (!camera.Play()) {
+    return false;
+  }
+
+  auto warm_up_end = Clock::now() + kWarmUpDuration;
+  while (Clock::now() < warm_up_end) {
+    if (!stream_handler->WaitForFrame(stream_handler->GetFrameCount())) {
+      std::cerr << "No frames from " << description << std::endl;
+      return false;
+    }
+  }
+
+  std::vector<double> copy_us;
+  std::vector<double> stream_us;
+  int64_t stream_bytes = 0;
+  std::vector<uint8_t> pixels;
+  auto first_frame = stream_handler->GetFrameCount();
+  auto start = Clock::now();
+  auto end = start + std::chrono::seconds(duration_seconds);
+  auto last_frame = first_frame;
+  while (Clock::now() < end) {
+    if (!stream_handler->WaitForFrame(last_frame)) {
+      break;
+    }
+    last_frame = stream_handler->GetFrameCount();
+
+    // The same work as the texture callback of the plugin.
+    auto copy_start = Clock::now();
+    int32_t width;
+    int32_t height;
+    auto copied = camera.CopyPreviewFrame(pixels, width, height);
+    auto copy_end = Clock::now();
+    if (!copied) {
+      continue;
+    }
+    copy_us.push_back(ElapsedMicroseconds(copy_start, copy_end));
+
+    // The same work as EventChannelImageStream::Send before encoding.
+    auto stream_start = Clock::now();
+    std::vector<uint8_t> bytes(pixels.begin(), pixels.end());
+    auto stream_end = Clock::now();
+    stream_us.push_back(ElapsedMicroseconds(stream_start, stream_end));
+    stream_bytes += bytes.size();
+  }
+  auto elapsed_seconds =
+      std::chrono::duration<double>(Clock::now() - start).count();
+  camera.Stop();
+
+  result.frames = stream_handler->GetFrameCount() - first_frame;
+  result.fps = result.frames / elapsed_seconds;
+  result.copy_avg_us = Average(copy_us);
+  result.copy_p95_us = Percentile(copy_us, 95);
+  result.stream_avg_us = Average(stream_us);
+  auto stream_seconds = Average(stream_us) * stream_us.size() / 1e6;
+  if (stream_seconds > 0) {
+    result.stream_mb_per_sec = stream_bytes / stream_seconds / (1024 * 1024);
+  }
+  return true;
+}
+
+bool RunPipeline(const std::string& description) {
+  GError* error = nullptr;
+  auto* pipeline = gst_parse_launch(description.c_str(), &error);
+  if (!pipeline) {
+    std::cerr << "Failed to create " << description << ": " << error->message
+              << std::endl;
+    g_error_free(error);
+    return false;
+  }
+
+  gst_element_set_state(pipeline, GST_STATE_PLAYING);
+  auto* bus = gst_element_get_bus(pipeline);
+  auto* message = gst_bus_timed_pop_filtered(
+      bus, kVerifyTimeout,
+      static_cast<GstMessageType>(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+  auto result = message && GST_MESSAGE_TYPE(message) == GST_MESSAGE_EOS;
+  if (message) {
+    gst_message_unref(message);
+  }
+  gst_object_unref(bus);
+  gst_element_set_state(pipeline, GST_STATE_NULL);
+  gst_object_unref(pipeline);
+  return result;
+}
+
+// Writes a short test video to be used as the source of the recording check.
+std::string GenerateSourceFile() {
+  auto* path = g_build_filename(g_get_tmp_dir(), "camera_benchmark_source.mkv",
+                                NULL);
+  std::string file_path = path;
+  g_free(path);
+  if (!RunPipeline("videotestsrc num-buffers=300 pattern=ball ! "
+                   "video/x-raw,width=640,height=480,framerate=30/1 ! "
+                   "matroskamux ! filesink location=" +
+                   file_path)) {
+    std::cerr << "Failed to generate " << file_path << std::endl;
+    return "";
+  }
+  return file_path;
+}
+
+bool RunRecording(const std::string& source, int duration_seconds,
+                  RecordingResult& result) {
+  // Declared before the camera, which joins the finalizing thread when it's
+  // destroyed.
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool is_stopped = false;
+  Clock::time_point stop_end;
+
+  auto handler = std::make_unique<BenchmarkStreamHandler>();
+  auto* stream_handler = handler.get();
+  GstCamera camera(std::move(handler), source);
+  if (!camera.Play() || !stream_handler->WaitForFrame(0)) {
+    std::cerr << "No frames from " << source << std::endl;
+    return false;
+  }
+
+  GstVideoRecorder::Options options;
+  options.container = "mkv";
+  if (!camera.StartVideoRecording(options)) {
+    return false;
+  }
+  // Zooms in the middle of the recording. The recorded frames are cropped
+  // and scaled back to the same size, so the muxer doesn't see a caps change.
+  auto half_duration = std::chrono::milliseconds(duration_seconds * 500);
+  std::this_thread::sleep_for(half_duration);
+  if (!camera.SetZoomLevel(std::min(2.0f, camera.GetMaxZoomLevel()))) {
+    std::cerr << "Failed to zoom while recording" << std::endl;
+  }
+  std::this_thread::sleep_for(half_duration);
+  result.stats = camera.GetVideoRecordingStats();
+
+  auto stop_start = Clock::now();
+  camera.StopVideoRecording([&](const std::string& file_path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    result.file_path = file_path;
+    stop_end = Clock::now();
+    is_stopped = true;
+    cv.notify_all();
+  });
+  result.stop_call_ms = ElapsedMicroseconds(stop_start, Clock::now()) / 1000;
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!cv.wait_for(lock, kFinalizeTimeout, [&] { return is_stopped; })) {
+      std::cerr << "Timed out stopping the recording" << std::endl;
+      return false;
+    }
+  }
+  result.finalize_ms = ElapsedMicroseconds(stop_start, stop_end) / 1000;
+  camera.Stop();
+
+  if (result.file_path.empty()) {
+    return false;
+  }
+  // The file is playable only if the muxer has finalized it.
+  if (!RunPipeline("filesrc location=" + result.file_path +
+                   " ! decodebin ! fakesink")) {
+    std::cerr << "Failed to decode " << result.file_path << std::endl;
+    return false;
+  }
+  return true;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string source = kDefaultSource;
+  std::string resolutions_str = kDefaultResolutions;
+  int duration_seconds = kDefaultDurationSeconds;
+  std::string record_source;
+  int record_duration_seconds = kDefaultRecordDurationSeconds;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg.rfind("--source=", 0) == 0) {
+      source = arg.substr(sizeof("--source=") - 1);
+    } else if (arg.rfind("--duration=", 0) == 0) {
+      duration_seconds =
+          std::atoi(arg.substr(sizeof("--duration=") - 1).c_str());
+    } else if (arg.rfind("--resolutions=", 0) == 0) {
+      resolutions_str = arg.substr(sizeof("--resolutions=") - 1);
+    } else if (arg.rfind("--record-source=", 0) == 0) {
+      record_source = arg.substr(sizeof("--record-source=") - 1);
+    } else if (arg.rfind("--record-duration=", 0) == 0) {
+      record_duration_seconds =
+          std::atoi(arg.substr(sizeof("--record-duration=") - 1).c_str());
+    } else {
+      std::cerr << "Usage: " << argv[0]
+                << " [--source=<description>] [--duration=<seconds>]"
+                   " [--resolutions=<width>x<height>,...]"
+                   " [--record-source=<file>] [--record-duration=<seconds>]"
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  GstCamera::GstLibraryLoad();
+  std::printf("source: %s, duration: %d s\n", source.c_str(),
+              duration_seconds);
+  std::printf("%-11s %8s %8s %14s %14s %15s %12s\n", "resolution", "frames",
+              "fps", "copy avg(us)", "copy p95(us)", "stream avg(us)",
+              "stream MB/s");
+
+  auto exit_code = EXIT_SUCCESS;
+  for (const auto& resolution : ParseResolutions(resolutions_str)) {
+    BenchmarkResult result;
+    auto label = std::to_string(resolution.width) + "x" +
+                 std::to_string(resolution.height);
+    if (!Run(source, resolution, duration_seconds, result)) {
+      std::printf("%-11s failed\n", label.c_str());
+      exit_code = EXIT_FAILURE;
+      continue;
+    }
+    std::printf("%-11s %8lld %8.2f %14.1f %14.1f %15.1f %12.1f\n",
+                label.c_str(), static_cast<long long>(result.frames),
+                result.fps, result.copy_avg_us, result.copy_p95_us,
+                result.stream_avg_us, result.stream_mb_per_sec);
+  }
+
+  if (record_duration_seconds > 0) {
+    if (record_source.empty()) {
+      record_source = GenerateSourceFile();
+    }
+    RecordingResult result;
+    if (record_source.empty() ||
+        !RunRecording(record_source, record_duration_seconds, result)) {
+      std::printf("recording failed\n");
+      exit_code = EXIT_FAILURE;
+    } else {
+      std::printf(
+          "recording: %s, %llu bytes, %llu frames encoded, %llu dropped, "
+          "stop call %.1f ms, finalized in %.1f ms\n",
+          result.file_path.c_str(),
+          static_cast<unsigned long long>(result.stats.bytes_written),
+          static_cast<unsigned long long>(result.stats.frames_encoded),
+          static_cast<unsigned long long>(result.stats.frames_dropped),
+          result.stop_call_ms, result.finalize_ms);
+    }
+  }
+  GstCamera::GstLibraryUnload();
+
+  return exit_code;
+}
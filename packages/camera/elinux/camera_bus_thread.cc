@@ -0,0 +1,80 @@
+// Copyright 2023 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "camera_bus_thread.h"
+
+#include <future>
+#include <iostream>
+
+// static
+CameraBusThread& CameraBusThread::GetInstance() {
+  static CameraBusThread instance;
+  return instance;
+}
+
+CameraBusThread::CameraBusThread() {
+  context_ = g_main_context_new();
+  loop_ = g_main_loop_new(context_, FALSE);
+  thread_ = std::thread([this]() {
+    g_main_context_push_thread_default(context_);
+    g_main_loop_run(loop_);
+    g_main_context_pop_thread_default(context_);
+  });
+}
+
+CameraBusThread::~CameraBusThread() {
+  // g_main_loop_quit() is ignored if it's called before g_main_loop_run(), so
+  // it's called on the bus thread.
+  Invoke(
+      [](gpointer user_data) -> gboolean {
+        g_main_loop_quit(reinterpret_cast<GMainLoop*>(user_data));
+        return G_SOURCE_REMOVE;
+      },
+      loop_);
+  thread_.join();
+  g_main_loop_unref(loop_);
+  g_main_context_unref(context_);
+}
+
+GSource* CameraBusThread::AddWatch(GstBus* bus, GstBusFunc func,
+                                gpointer user_data) {
+  auto* watch = gst_bus_create_watch(bus);
+  if (!watch) {
+    std::cerr << "Failed to create a bus watch" << std::endl;
+    return nullptr;
+  }
+  g_source_set_callback(watch, reinterpret_cast<GSourceFunc>(func), user_data,
+                        NULL);
+  g_source_attach(watch, context_);
+  return watch;
+}
+
+void CameraBusThread::RemoveWatch(GSource* watch) {
+  g_source_destroy(watch);
+  g_source_unref(watch);
+
+  // The watch is removed from its own callback.
+  if (g_main_context_is_owner(context_)) {
+    return;
+  }
+
+  // The callback might be running now. The sources are dispatched one at a
+  // time, so it has returned once a source attached after this has run.
+  std::promise<void> dispatched;
+  Invoke(
+      [](gpointer user_data) -> gboolean {
+        reinterpret_cast<std::promise<void>*>(user_data)->set_value();
+        return G_SOURCE_REMOVE;
+      },
+      &dispatched);
+  dispatched.get_future().wait();
+}
+
+void CameraBusThread::Invoke(GSourceFunc func, gpointer user_data) {
+  auto* source = g_idle_source_new();
+  g_source_set_priority(source, G_PRIORITY_HIGH);
+  g_source_set_callback(source, func, user_data, NULL);
+  g_source_attach(source, context_);
+  g_source_unref(source);
+}
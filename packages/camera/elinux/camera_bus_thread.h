@@ -0,0 +1,46 @@
+// Copyright 2023 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PACKAGES_CAMERA_CAMERA_ELINUX_CAMERA_BUS_THREAD_H_
+#define PACKAGES_CAMERA_CAMERA_ELINUX_CAMERA_BUS_THREAD_H_
+
+#include <gst/gst.h>
+
+#include <thread>
+
+// Runs one GMainContext on a worker thread shared by all the cameras of the
+// plugin, and dispatches the messages posted to their buses there instead of
+// on the streaming threads which post them.
+//
+// The video_player plugin has its own GstBusThread. The plugins are separate
+// libraries, so each of them runs its own thread.
+class CameraBusThread {
+ public:
+  static CameraBusThread& GetInstance();
+
+  // Prevent copying.
+  CameraBusThread(CameraBusThread const&) = delete;
+  CameraBusThread& operator=(CameraBusThread const&) = delete;
+
+  // Calls |func| with |user_data| on the bus thread for each message posted
+  // to |bus| until RemoveWatch() is called. Returns nullptr on failure.
+  GSource* AddWatch(GstBus* bus, GstBusFunc func, gpointer user_data);
+
+  // Removes |watch|. Once this returns, |func| of |watch| is neither running
+  // nor called anymore, so its |user_data| can be destroyed.
+  void RemoveWatch(GSource* watch);
+
+ private:
+  CameraBusThread();
+  ~CameraBusThread();
+
+  // Calls |func| with |user_data| once on the bus thread.
+  void Invoke(GSourceFunc func, gpointer user_data);
+
+  GMainContext* context_;
+  GMainLoop* loop_;
+  std::thread thread_;
+};
+
+#endif  // PACKAGES_CAMERA_CAMERA_ELINUX_CAMERA_BUS_THREAD_H_
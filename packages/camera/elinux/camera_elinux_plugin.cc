@@ -8,14 +8,23 @@
 #include <flutter/plugin_registrar.h>
 #include <flutter/standard_method_codec.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 #include "camera_stream_handler_impl.h"
 #include "channels/event_channel_image_stream.h"
 #include "channels/method_channel_camera.h"
 #include "channels/method_channel_device.h"
+#include "dart_api_dl.h"
 #include "events/camera_initialized_event.h"
 #include "gst_camera.h"
+#include "gst_camera_source.h"
 #include "messages/messages.h"
 
 namespace {
@@ -31,6 +40,8 @@ constexpr char kCameraChannelApiStartVideoRecording[] = "startVideoRecording";
 constexpr char kCameraChannelApiStopVideoRecording[] = "stopVideoRecording";
 constexpr char kCameraChannelApiPauseVideoRecording[] = "pauseVideoRecording";
 constexpr char kCameraChannelApiResumeVideoRecording[] = "resumeVideoRecording";
+constexpr char kCameraChannelApiGetVideoRecordingStats[] =
+    "getVideoRecordingStats";
 constexpr char kCameraChannelApiSetFlashMode[] = "setFlashMode";
 constexpr char kCameraChannelApiSetExposureMode[] = "setExposureMode";
 constexpr char kCameraChannelApiSetExposurePoint[] = "setExposurePoint";
@@ -51,6 +62,29 @@ constexpr char kCameraChannelApiLockCaptureOrientation[] =
 constexpr char kCameraChannelApiUnlockCaptureOrientation[] =
     "unlockCaptureOrientation";
 constexpr char kCameraChannelApiDispose[] = "dispose";
+// Called by CameraElinux in lib/camera_elinux.dart when the plugin wakes it
+// up. The platform thread tasks run before any method call is handled.
+constexpr char kCameraChannelApiRunPlatformThreadTasks[] =
+    "runPlatformThreadTasks";
+
+// The environment variable to specify how long a disposed camera keeps the
+// camera device open in milliseconds. 0 releases the camera immediately.
+constexpr char kIdleTimeoutEnvironmentVariable[] =
+    "FLUTTER_ELINUX_CAMERA_IDLE_TIMEOUT_MS";
+constexpr int kDefaultIdleTimeoutMs = 10000;
+
+std::chrono::milliseconds GetIdleTimeout() {
+  const auto* value = std::getenv(kIdleTimeoutEnvironmentVariable);
+  if (!value) {
+    return std::chrono::milliseconds(kDefaultIdleTimeoutMs);
+  }
+  return std::chrono::milliseconds(std::max(0, std::atoi(value)));
+}
+
+// The native port which CameraElinux in Dart listens to, to be woken up when
+// tasks are posted to the platform thread. Set by
+// camera_elinux_set_wakeup_port().
+std::atomic<Dart_Port> platform_thread_wakeup_port(ILLEGAL_PORT);
 
 class CameraPlugin : public flutter::Plugin {
  public:
@@ -86,6 +120,15 @@ class CameraPlugin : public flutter::Plugin {
   void HandleTakePictureCall(
       const flutter::EncodableValue* message,
       std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+  void HandleStartVideoRecordingCall(
+      const flutter::EncodableValue* message,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+  void HandleStopVideoRecordingCall(
+      const flutter::EncodableValue* message,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+  void HandleGetVideoRecordingStatsCall(
+      const flutter::EncodableValue* message,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
   void HandleStartImageStreamCall(
       const flutter::EncodableValue* message,
       std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
@@ -108,10 +151,33 @@ class CameraPlugin : public flutter::Plugin {
       const flutter::EncodableValue* message,
       std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
 
+  // Queues |task| to run on the platform thread. It can be called from any
+  // thread.
+  //
+  // flutter-elinux doesn't let plugins post tasks to the platform thread, but
+  // the messages from Dart are handled there. So the first task queued wakes
+  // up CameraElinux in Dart through its native port, which calls
+  // runPlatformThreadTasks back, and the queued tasks run when it's handled.
+  // Until Dart has set the port, the tasks run when the next method call is
+  // handled.
+  //
+  // The results of the method calls are only sent on the platform thread, so
+  // the callbacks of the capture and the recording threads post them with
+  // this.
+  void PostPlatformThreadTask(std::function<void()> task);
+  void RunPlatformThreadTasks();
+
   flutter::PluginRegistrar* plugin_registrar_;
   flutter::TextureRegistrar* texture_registrar_;
+  std::mutex mutex_platform_thread_tasks_;
+  std::vector<std::function<void()>> platform_thread_tasks_;
 
   std::unique_ptr<FlutterDesktopPixelBuffer> buffer_;
+  // The preview frames are copied to them in turn on the raster thread, so
+  // that the one handed to the engine last is neither written nor freed
+  // while the next frame is copied, even if the size of the frames changes.
+  std::vector<uint8_t> preview_pixels_[2];
+  int preview_pixels_index_ = 0;
   std::unique_ptr<flutter::TextureVariant> texture_;
   std::unique_ptr<GstCamera> camera_ = nullptr;
   int64_t texture_id_;
@@ -144,7 +210,10 @@ void CameraPlugin::HandleMethodCall(
     std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
   const std::string& method_name = method_call.method_name();
 
-  if (!method_name.compare(kCameraChannelApiAvailableCameras)) {
+  RunPlatformThreadTasks();
+  if (!method_name.compare(kCameraChannelApiRunPlatformThreadTasks)) {
+    result->Success();
+  } else if (!method_name.compare(kCameraChannelApiAvailableCameras)) {
     HandleAvailableCamerasCall(std::move(result));
   } else if (!method_name.compare(kCameraChannelApiCreate)) {
     HandleCreateCall(method_call.arguments(), std::move(result));
@@ -153,11 +222,14 @@ void CameraPlugin::HandleMethodCall(
   } else if (!method_name.compare(kCameraChannelApiTakePicture)) {
     HandleTakePictureCall(method_call.arguments(), std::move(result));
   } else if (!method_name.compare(kCameraChannelApiPrepareForVideoRecording)) {
-    result->NotImplemented();
+    result->Success();
   } else if (!method_name.compare(kCameraChannelApiStartVideoRecording)) {
-    result->NotImplemented();
+    HandleStartVideoRecordingCall(method_call.arguments(), std::move(result));
   } else if (!method_name.compare(kCameraChannelApiStopVideoRecording)) {
-    result->NotImplemented();
+    HandleStopVideoRecordingCall(method_call.arguments(), std::move(result));
+  } else if (!method_name.compare(kCameraChannelApiGetVideoRecordingStats)) {
+    HandleGetVideoRecordingStatsCall(method_call.arguments(),
+                                     std::move(result));
   } else if (!method_name.compare(kCameraChannelApiPauseVideoRecording)) {
     result->NotImplemented();
   } else if (!method_name.compare(kCameraChannelApiResumeVideoRecording)) {
@@ -226,9 +298,19 @@ void CameraPlugin::HandleCreateCall(
       std::make_unique<flutter::TextureVariant>(flutter::PixelBufferTexture(
           [this](size_t width,
                  size_t height) -> const FlutterDesktopPixelBuffer* {
-            buffer_->width = camera_->GetPreviewWidth();
-            buffer_->height = camera_->GetPreviewHeight();
-            buffer_->buffer = camera_->GetPreviewFrameBuffer();
+            // The engine may still read the buffer which it got last, so
+            // the frame is copied to the other one.
+            preview_pixels_index_ ^= 1;
+            auto& pixels = preview_pixels_[preview_pixels_index_];
+            int32_t frame_width;
+            int32_t frame_height;
+            if (!camera_->CopyPreviewFrame(pixels, frame_width,
+                                           frame_height)) {
+              return nullptr;
+            }
+            buffer_->width = frame_width;
+            buffer_->height = frame_height;
+            buffer_->buffer = pixels.data();
 
             // TODO: We need to handle this code (event_channel_image_stream_)
             // in the proper place, but the Camera plugin doesn't have a main
@@ -246,7 +328,20 @@ void CameraPlugin::HandleCreateCall(
         texture_registrar_->MarkTextureFrameAvailable(texture_id);
       });
 
-  camera_ = std::make_unique<GstCamera>(std::move(stream_handler));
+  auto meta = CreateMessage::FromMap(*message);
+  auto source_description = meta.GetSource();
+  if (source_description.empty()) {
+    source_description = GstCameraSource::GetDescriptionFromEnvironment();
+  }
+  // Reuses the pipeline of the disposed camera if it has the same source.
+  if (camera_ && camera_->IsSuspended() &&
+      camera_->GetSourceDescription() == source_description) {
+    camera_->Resume(std::move(stream_handler));
+  } else {
+    camera_ = nullptr;
+    camera_ = std::make_unique<GstCamera>(std::move(stream_handler),
+                                          source_description);
+  }
   texture_id_ = texture_id;
 
   flutter::EncodableMap reply;
@@ -296,16 +391,120 @@ void CameraPlugin::HandleTakePictureCall(
                   "Check for creating a camera device");
     return;
   }
-  camera_->TakePicture([p_result = result.release()](
-                           const std::string& captured_file_path) {
-    if (!captured_file_path.empty()) {
-      flutter::EncodableValue value(captured_file_path);
-      p_result->Success(value);
-    } else {
-      p_result->Error("Failed to capture", "Failed to capture a camera image");
-    }
-    delete p_result;
-  });
+
+  auto meta = TakePictureMessage::FromMap(*message);
+  GstCamera::CaptureOptions options;
+  options.output_directory = meta.GetOutputDirectory();
+  options.in_memory = meta.GetReturnBytes();
+  options.use_next_frame = meta.GetUseNextFrame();
+  options.burst_count = meta.GetBurstCount();
+  options.quality = meta.GetQuality();
+
+  // Returns a single value for the default single shot to keep compatibility
+  // with the camera platform interface, and a list for burst captures.
+  const bool is_burst = options.burst_count > 1;
+  std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>>
+      shared_result = std::move(result);
+  camera_->TakePicture(
+      options, [this, shared_result, is_burst](
+                   const std::vector<GstCamera::CapturedImage>& images) {
+        flutter::EncodableList values;
+        for (const auto& image : images) {
+          if (image.file_path.empty()) {
+            values.push_back(flutter::EncodableValue(image.data));
+          } else {
+            values.push_back(flutter::EncodableValue(image.file_path));
+          }
+        }
+
+        PostPlatformThreadTask([shared_result, is_burst,
+                                values = std::move(values)]() {
+          if (values.empty()) {
+            shared_result->Error("Failed to capture",
+                                 "Failed to capture a camera image");
+          } else if (is_burst) {
+            shared_result->Success(flutter::EncodableValue(values));
+          } else {
+            shared_result->Success(values[0]);
+          }
+        });
+      });
+}
+
+void CameraPlugin::HandleStartVideoRecordingCall(
+    const flutter::EncodableValue* message,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+  if (!camera_) {
+    result->Error("Not found an active camera",
+                  "Check for creating a camera device");
+    return;
+  }
+
+  auto meta = VideoRecordingMessage::FromMap(*message);
+  GstVideoRecorder::Options options;
+  options.output_directory = meta.GetOutputDirectory();
+  options.encoder = meta.GetEncoder();
+  options.speed_preset = meta.GetSpeedPreset();
+  options.container = meta.GetContainer();
+  options.bitrate = meta.GetBitrate();
+  if (camera_->StartVideoRecording(options)) {
+    result->Success();
+  } else {
+    result->Error("Failed to start video recording",
+                  "Check the encoder and the container");
+  }
+}
+
+void CameraPlugin::HandleStopVideoRecordingCall(
+    const flutter::EncodableValue* message,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+  if (!camera_) {
+    result->Error("Not found an active camera",
+                  "Check for creating a camera device");
+    return;
+  }
+
+  // The file is finalized on a worker thread, and the result is posted back
+  // to the platform thread, the same as the pictures.
+  std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>>
+      shared_result = std::move(result);
+  camera_->StopVideoRecording(
+      [this, shared_result](const std::string& recorded_file_path) {
+        PostPlatformThreadTask([shared_result, recorded_file_path]() {
+          if (!recorded_file_path.empty()) {
+            shared_result->Success(
+                flutter::EncodableValue(recorded_file_path));
+          } else {
+            shared_result->Error("Failed to stop video recording",
+                                 "Check whether video recording has started");
+          }
+        });
+      });
+}
+
+void CameraPlugin::HandleGetVideoRecordingStatsCall(
+    const flutter::EncodableValue* message,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+  if (!camera_) {
+    result->Error("Not found an active camera",
+                  "Check for creating a camera device");
+    return;
+  }
+
+  auto stats = camera_->GetVideoRecordingStats();
+  flutter::EncodableMap reply = {
+      {flutter::EncodableValue("durationMs"),
+       flutter::EncodableValue(stats.duration_ms)},
+      {flutter::EncodableValue("bytesWritten"),
+       flutter::EncodableValue(static_cast<int64_t>(stats.bytes_written))},
+      {flutter::EncodableValue("bitrate"),
+       flutter::EncodableValue(stats.bitrate)},
+      {flutter::EncodableValue("framesEncoded"),
+       flutter::EncodableValue(static_cast<int64_t>(stats.frames_encoded))},
+      {flutter::EncodableValue("framesDropped"),
+       flutter::EncodableValue(static_cast<int64_t>(stats.frames_dropped))},
+  };
+  result->Success(flutter::EncodableValue(reply));
 }
 
 void CameraPlugin::HandleStartImageStreamCall(
@@ -373,15 +572,64 @@ void CameraPlugin::HandleDisposeCall(
     std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
   // TODO: add multi camera support.
   if (camera_) {
-    camera_->Stop();
-    camera_ = nullptr;
+    // Keeps the pipeline for a while so that re-creating the camera (e.g. when
+    // switching screens) doesn't have to rebuild it.
+    auto idle_timeout = GetIdleTimeout();
+    // A camera which is recording a video isn't suspended. Its destructor
+    // finalizes the recorded file before stopping the pipeline.
+    if (idle_timeout.count() == 0 || !camera_->Suspend(idle_timeout)) {
+      camera_ = nullptr;
+    }
     texture_registrar_->UnregisterTexture(texture_id_);
   }
   result->Success();
 }
 
+void CameraPlugin::PostPlatformThreadTask(std::function<void()> task) {
+  bool wakes_up;
+  {
+    std::lock_guard<std::mutex> lock(mutex_platform_thread_tasks_);
+    // The queue is drained as a whole, so only the first task needs to wake
+    // up the platform thread.
+    wakes_up = platform_thread_tasks_.empty();
+    platform_thread_tasks_.push_back(std::move(task));
+  }
+
+  auto port = platform_thread_wakeup_port.load();
+  if (wakes_up && port != ILLEGAL_PORT && Dart_PostCObject_DL) {
+    Dart_CObject message;
+    message.type = Dart_CObject_kNull;
+    Dart_PostCObject_DL(port, &message);
+  }
+}
+
+void CameraPlugin::RunPlatformThreadTasks() {
+  std::vector<std::function<void()>> tasks;
+  {
+    std::lock_guard<std::mutex> lock(mutex_platform_thread_tasks_);
+    tasks.swap(platform_thread_tasks_);
+  }
+  for (const auto& task : tasks) {
+    task();
+  }
+}
+
 }  // namespace
 
+// Initializes the Dart API used to post to native ports. |data| is
+// NativeApi.initializeApiDLData.
+extern "C" __attribute__((visibility("default"))) intptr_t
+camera_elinux_initialize_dart_api(void* data) {
+  return Dart_InitializeApiDL(data);
+}
+
+// Sets the native port which is posted a null when tasks are posted to the
+// platform thread, or ILLEGAL_PORT to stop posting.
+extern "C" __attribute__((visibility("default"))) void
+camera_elinux_set_wakeup_port(int64_t port) {
+  platform_thread_wakeup_port = port;
+}
+
 void CameraElinuxPluginRegisterWithRegistrar(
     FlutterDesktopPluginRegistrarRef registrar) {
   CameraPlugin::RegisterWithRegistrar(
@@ -4,18 +4,38 @@
 
 #include "gst_camera.h"
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 
-GstCamera::GstCamera(std::unique_ptr<CameraStreamHandler> handler)
-    : stream_handler_(std::move(handler)) {
+#include "camera_bus_thread.h"
+#include "gst_camera_source.h"
+#include "millicast_frame_forwarder.h"
+
+namespace {
+// How long a capture waits for a new viewfinder frame before falling back to
+// the latest one.
+constexpr auto kFrameWaitTimeout = std::chrono::milliseconds(500);
+}  // namespace
+
+GstCamera::GstCamera(std::unique_ptr<CameraStreamHandler> handler,
+                     const std::string& source_description)
+    : source_description_(source_description),
+      stream_handler_(std::move(handler)) {
   gst_.pipeline = nullptr;
   gst_.camerabin = nullptr;
+  gst_.tee = nullptr;
+  gst_.preview_queue = nullptr;
+  gst_.video_crop = nullptr;
   gst_.video_convert = nullptr;
   gst_.video_sink = nullptr;
   gst_.output = nullptr;
   gst_.bus = nullptr;
+  gst_.bus_watch = nullptr;
   gst_.buffer = nullptr;
 
+  capture_thread_ = std::thread(&GstCamera::CaptureThreadMain, this);
+
   if (!CreatePipeline()) {
     std::cerr << "Failed to create a pipeline" << std::endl;
     DestroyPipeline();
@@ -29,6 +49,20 @@ GstCamera::GstCamera(std::unique_ptr<CameraStreamHandler> handler)
 }
 
 GstCamera::~GstCamera() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_capture_);
+    capture_thread_exit_ = true;
+  }
+  cv_capture_.notify_all();
+  cv_frame_.notify_all();
+  if (capture_thread_.joinable()) {
+    capture_thread_.join();
+  }
+
+  CancelIdleTimer();
+
+  // Finalizes the recording file while the pipeline is still running.
+  video_recorder_ = nullptr;
   Stop();
   DestroyPipeline();
 }
@@ -77,17 +111,133 @@ bool GstCamera::Stop() {
   return true;
 }
 
-void GstCamera::TakePicture(OnNotifyCaptured on_notify_captured) {
-  if (!gst_.camerabin) {
+void GstCamera::TakePicture(const CaptureOptions& options,
+                            OnNotifyCaptured on_notify_captured) {
+  if (!gst_.pipeline || options.burst_count < 1) {
     std::cerr << "Failed to take a picture" << std::endl;
+    on_notify_captured({});
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_capture_);
+    capture_requests_.push_back({options, std::move(on_notify_captured)});
+  }
+  cv_capture_.notify_one();
+}
+
+bool GstCamera::Suspend(std::chrono::milliseconds idle_timeout) {
+  if (!gst_.pipeline) {
+    return false;
+  }
+
+  if (video_recorder_ && video_recorder_->IsRecording()) {
+    std::cerr << "Can't suspend the camera while recording a video"
+              << std::endl;
+    return false;
+  }
+
+  CancelIdleTimer();
+  {
+    std::lock_guard<std::mutex> lock(mutex_stream_handler_);
+    stream_handler_ = nullptr;
+  }
+  if (!Pause()) {
+    return false;
+  }
+
+  is_suspended_ = true;
+  is_idle_timer_cancelled_ = false;
+  is_device_released_ = false;
+  idle_timer_thread_ = std::thread([this, idle_timeout]() {
+    std::unique_lock<std::mutex> lock(mutex_idle_timer_);
+    if (cv_idle_timer_.wait_for(lock, idle_timeout,
+                                [this] { return is_idle_timer_cancelled_; })) {
+      return;
+    }
+
+    // Closes the device. The pipeline is kept, so resuming only has to open
+    // the device again.
+    std::cout << "Releasing the camera device after " << idle_timeout.count()
+              << " ms of inactivity" << std::endl;
+    if (gst_element_set_state(gst_.pipeline, GST_STATE_NULL) ==
+        GST_STATE_CHANGE_FAILURE) {
+      std::cerr << "Failed to change the state to NULL" << std::endl;
+    }
+    is_device_released_ = true;
+  });
+  return true;
+}
+
+void GstCamera::Resume(std::unique_ptr<CameraStreamHandler> handler) {
+  CancelIdleTimer();
+  {
+    std::lock_guard<std::mutex> lock(mutex_stream_handler_);
+    stream_handler_ = std::move(handler);
+  }
+
+  // The device may have been replaced while it was released, so the
+  // information from the pipeline is read again, the same as a new camera.
+  bool is_device_released;
+  {
+    std::lock_guard<std::mutex> lock(mutex_idle_timer_);
+    is_device_released = is_device_released_;
+    is_device_released_ = false;
+  }
+  if (is_device_released) {
+    Preroll();
+    GetZoomMaxMinSize(max_zoom_level_, min_zoom_level_);
+    if (zoom_level_ > max_zoom_level_) {
+      zoom_level_ = 1.0f;
+      if (gst_.video_crop) {
+        SetCrop(zoom_level_);
+      } else {
+        g_object_set(gst_.camerabin, "zoom", zoom_level_, NULL);
+      }
+    }
+  }
+  is_suspended_ = false;
+}
+
+void GstCamera::CancelIdleTimer() {
+  if (!idle_timer_thread_.joinable()) {
     return;
   }
+  {
+    std::lock_guard<std::mutex> lock(mutex_idle_timer_);
+    is_idle_timer_cancelled_ = true;
+  }
+  cv_idle_timer_.notify_all();
+  idle_timer_thread_.join();
+}
 
-  on_notify_captured_ = on_notify_captured;
-  std::string filename =
-      g_strdup_printf("captured_%04u.jpg", captured_count_++);
-  g_object_set(gst_.camerabin, "location", filename.c_str(), NULL);
-  g_signal_emit_by_name(gst_.camerabin, "start-capture", NULL);
+bool GstCamera::StartVideoRecording(
+    const GstVideoRecorder::Options& options) {
+  if (!video_recorder_) {
+    std::cerr << "Failed to start video recording" << std::endl;
+    return false;
+  }
+  // Records at the size of the uncropped frames, so the recording keeps its
+  // size when zooming, the same as camerabin's zoom.
+  auto recorder_options = options;
+  if (gst_.video_crop && (options.width <= 0 || options.height <= 0)) {
+    GetViewfinderSize(recorder_options.width, recorder_options.height);
+  }
+  return video_recorder_->Start(recorder_options);
+}
+
+void GstCamera::StopVideoRecording(GstVideoRecorder::OnStopped on_stopped) {
+  if (!video_recorder_ || !video_recorder_->Stop(on_stopped)) {
+    std::cerr << "Failed to stop video recording" << std::endl;
+    on_stopped("");
+  }
+}
+
+GstVideoRecorder::Stats GstCamera::GetVideoRecordingStats() {
+  if (!video_recorder_) {
+    return GstVideoRecorder::Stats();
+  }
+  return video_recorder_->GetStats();
 }
 
 bool GstCamera::SetZoomLevel(float zoom) {
@@ -105,25 +255,199 @@ bool GstCamera::SetZoomLevel(float zoom) {
     return false;
   }
 
-  g_object_set(gst_.camerabin, "zoom", zoom, NULL);
+  if (gst_.video_crop) {
+    if (!SetCrop(zoom)) {
+      return false;
+    }
+  } else {
+    g_object_set(gst_.camerabin, "zoom", zoom, NULL);
+  }
   zoom_level_ = zoom;
   return true;
 }
 
-const uint8_t* GstCamera::GetPreviewFrameBuffer() {
+// Zooms by cropping the center of the viewfinder frames before the color
+// conversion. Unlike camerabin's zoom, which scales the cropped area up to the
+// full resolution, the preview frames get smaller as the zoom level increases,
+// so fewer pixels are converted and copied to the texture. The texture is
+// scaled up by Flutter when it's drawn.
+//
+// The crop is in front of the tee, so the recorded videos are zoomed too.
+bool GstCamera::SetCrop(float zoom) {
+  int width = 0;
+  int height = 0;
+  if (!GetViewfinderSize(width, height)) {
+    return false;
+  }
+
+  // Keeps the offsets even not to break the chroma subsampling of YUV
+  // formats.
+  auto crop_width = static_cast<int>(width / zoom) & ~1;
+  auto crop_height = static_cast<int>(height / zoom) & ~1;
+  auto left = ((width - crop_width) / 2) & ~1;
+  auto top = ((height - crop_height) / 2) & ~1;
+  g_object_set(G_OBJECT(gst_.video_crop), "left", left, "right",
+               width - crop_width - left, "top", top, "bottom",
+               height - crop_height - top, NULL);
+  return true;
+}
+
+// Returns the size of the viewfinder frames before they are cropped.
+bool GstCamera::GetViewfinderSize(int& width, int& height) {
+  auto* pad = gst_element_get_static_pad(gst_.video_crop, "sink");
+  auto* caps = gst_pad_get_current_caps(pad);
+  gst_object_unref(pad);
+  if (!caps) {
+    std::cerr << "Failed to get the viewfinder size. The pipeline hasn't "
+                 "negotiated yet."
+              << std::endl;
+    return false;
+  }
+
+  auto* structure = gst_caps_get_structure(caps, 0);
+  gst_structure_get_int(structure, "width", &width);
+  gst_structure_get_int(structure, "height", &height);
+  gst_caps_unref(caps);
+  return true;
+}
+
+bool GstCamera::CopyPreviewFrame(std::vector<uint8_t>& pixels,
+                                 int32_t& width, int32_t& height) {
   std::shared_lock<std::shared_mutex> lock(mutex_buffer_);
   if (!gst_.buffer) {
-    return nullptr;
+    return false;
   }
 
-  const uint32_t pixel_bytes = width_ * height_ * 4;
-  gst_buffer_extract(gst_.buffer, 0, pixels_.get(), pixel_bytes);
-  return reinterpret_cast<const uint8_t*>(pixels_.get());
+  width = width_;
+  height = height_;
+  pixels.resize(static_cast<size_t>(width) * height * 4);
+  gst_buffer_extract(gst_.buffer, 0, pixels.data(), pixels.size());
+  return true;
+}
+
+int32_t GstCamera::GetPreviewWidth() {
+  std::shared_lock<std::shared_mutex> lock(mutex_buffer_);
+  return width_;
+}
+
+int32_t GstCamera::GetPreviewHeight() {
+  std::shared_lock<std::shared_mutex> lock(mutex_buffer_);
+  return height_;
+}
+
+void GstCamera::CaptureThreadMain() {
+  while (true) {
+    CaptureRequest request;
+    {
+      std::unique_lock<std::mutex> lock(mutex_capture_);
+      cv_capture_.wait(lock, [this] {
+        return capture_thread_exit_ || !capture_requests_.empty();
+      });
+      if (capture_thread_exit_) {
+        break;
+      }
+      request = std::move(capture_requests_.front());
+      capture_requests_.pop_front();
+    }
+
+    uint64_t frame_number;
+    {
+      std::shared_lock<std::shared_mutex> lock(mutex_buffer_);
+      frame_number = frame_number_;
+    }
+    auto min_frame_number = request.options.use_next_frame
+                                ? frame_number + 1
+                                : std::max<uint64_t>(frame_number, 1);
+
+    std::vector<CapturedImage> images;
+    for (int32_t i = 0; i < request.options.burst_count; i++) {
+      CapturedImage image;
+      if (!CaptureImage(request.options, min_frame_number, image,
+                        frame_number)) {
+        std::cerr << "Failed to capture an image (" << i + 1 << "/"
+                  << request.options.burst_count << ")" << std::endl;
+        break;
+      }
+      if (!request.options.in_memory &&
+          !WriteCapturedImage(request.options.output_directory, image)) {
+        break;
+      }
+      images.push_back(std::move(image));
+      min_frame_number = frame_number + 1;
+    }
+    request.on_notify_captured(images);
+  }
+
+  // Notifies the failure to the pending requests.
+  std::deque<CaptureRequest> requests;
+  {
+    std::lock_guard<std::mutex> lock(mutex_capture_);
+    requests.swap(capture_requests_);
+  }
+  for (auto& request : requests) {
+    request.on_notify_captured({});
+  }
+}
+
+bool GstCamera::CaptureImage(const CaptureOptions& options,
+                             uint64_t min_frame_number, CapturedImage& image,
+                             uint64_t& frame_number) {
+  GstBuffer* buffer;
+  int32_t width;
+  int32_t height;
+  {
+    std::shared_lock<std::shared_mutex> lock(mutex_buffer_);
+    if (!cv_frame_.wait_for(lock, kFrameWaitTimeout, [&] {
+          return capture_thread_exit_ || frame_number_ >= min_frame_number;
+        })) {
+      std::cerr << "Timed out waiting for a viewfinder frame" << std::endl;
+    }
+    if (!gst_.buffer) {
+      return false;
+    }
+    buffer = gst_buffer_ref(gst_.buffer);
+    width = width_;
+    height = height_;
+    frame_number = frame_number_;
+  }
+
+  auto result = jpeg_encoder_.Encode(buffer, width, height, options.quality,
+                                     image.data);
+  gst_buffer_unref(buffer);
+  return result;
+}
+
+bool GstCamera::WriteCapturedImage(const std::string& directory,
+                                   CapturedImage& image) {
+  const std::string dir = directory.empty() ? g_get_tmp_dir() : directory;
+  if (g_mkdir_with_parents(dir.c_str(), 0755) != 0) {
+    std::cerr << "Failed to create " << dir << std::endl;
+    return false;
+  }
+
+  std::string filename = "CAP_" + std::to_string(g_get_real_time()) + "_" +
+                         std::to_string(captured_count_++) + ".jpg";
+  auto* path = g_build_filename(dir.c_str(), filename.c_str(), NULL);
+  GError* error = nullptr;
+  if (!g_file_set_contents(path, reinterpret_cast<gchar*>(image.data.data()),
+                           image.data.size(), &error)) {
+    std::cerr << "Failed to write " << path << ": " << error->message
+              << std::endl;
+    g_error_free(error);
+    g_free(path);
+    return false;
+  }
+
+  image.file_path = path;
+  image.data.clear();
+  g_free(path);
+  return true;
 }
 
 // Creats a camra pipeline using camerabin.
-// $ gst-launch-1.0 camerabin viewfinder-sink="videoconvert !
-// video/x-raw,format=RGBA ! fakesink"
+// $ gst-launch-1.0 camerabin viewfinder-sink="videocrop ! tee ! queue !
+// videoconvert ! video/x-raw,format=RGBA ! fakesink"
+// A recording branch is attached to the tee while recording a video.
 bool GstCamera::CreatePipeline() {
   gst_.pipeline = gst_pipeline_new("pipeline");
   if (!gst_.pipeline) {
@@ -135,6 +459,38 @@ bool GstCamera::CreatePipeline() {
     std::cerr << "Failed to create a source" << std::endl;
     return false;
   }
+  if (!source_description_.empty()) {
+    auto* video_source = GstCameraSource::Create(source_description_);
+    if (!video_source) {
+      std::cerr << "Failed to create a video source" << std::endl;
+      return false;
+    }
+    auto* camera_source =
+        gst_element_factory_make("wrappercamerabinsrc", "camera_source");
+    if (!camera_source) {
+      std::cerr << "Failed to create a camera source" << std::endl;
+      gst_object_unref(video_source);
+      return false;
+    }
+    g_object_set(camera_source, "video-source", video_source, NULL);
+    g_object_set(gst_.camerabin, "camera-source", camera_source, NULL);
+  }
+  gst_.tee = gst_element_factory_make("tee", "tee");
+  if (!gst_.tee) {
+    std::cerr << "Failed to create a tee" << std::endl;
+    return false;
+  }
+  gst_.preview_queue = gst_element_factory_make("queue", "preview_queue");
+  if (!gst_.preview_queue) {
+    std::cerr << "Failed to create a queue" << std::endl;
+    return false;
+  }
+  // videocrop is optional. camerabin's digital zoom is used without it.
+  gst_.video_crop = gst_element_factory_make("videocrop", "videocrop");
+  if (!gst_.video_crop) {
+    std::cerr << "Failed to create a videocrop. Fall back to camerabin's zoom"
+              << std::endl;
+  }
   gst_.video_convert = gst_element_factory_make("videoconvert", "videoconvert");
   if (!gst_.video_convert) {
     std::cerr << "Failed to create a videoconvert" << std::endl;
@@ -155,20 +511,32 @@ bool GstCamera::CreatePipeline() {
     std::cerr << "Failed to create a bus" << std::endl;
     return false;
   }
-  gst_bus_set_sync_handler(gst_.bus, (GstBusSyncHandler)HandleGstMessage, this,
-                           NULL);
+  gst_.bus_watch =
+      CameraBusThread::GetInstance().AddWatch(gst_.bus, HandleGstMessage, this);
+  if (!gst_.bus_watch) {
+    return false;
+  }
 
   // Sets properties to fakesink to get the callback of a decoded frame.
   g_object_set(G_OBJECT(gst_.video_sink), "sync", TRUE, "qos", FALSE, NULL);
   g_object_set(G_OBJECT(gst_.video_sink), "signal-handoffs", TRUE, NULL);
   g_signal_connect(G_OBJECT(gst_.video_sink), "handoff",
                    G_CALLBACK(HandoffHandler), this);
-  gst_bin_add_many(GST_BIN(gst_.output), gst_.video_convert, gst_.video_sink,
-                   NULL);
+  // Keeps the preview latency low by dropping old frames.
+  g_object_set(G_OBJECT(gst_.preview_queue), "leaky", 2 /* downstream */,
+               "max-size-buffers", 2, NULL);
+  gst_bin_add_many(GST_BIN(gst_.output), gst_.tee, gst_.preview_queue,
+                   gst_.video_convert, gst_.video_sink, NULL);
+  if (gst_.video_crop) {
+    gst_bin_add(GST_BIN(gst_.output), gst_.video_crop);
+  }
 
   // Adds caps to the converter to convert the color format to RGBA.
   auto* caps = gst_caps_from_string("video/x-raw,format=RGBA");
   auto link_ok =
+      (!gst_.video_crop || gst_element_link(gst_.video_crop, gst_.tee)) &&
+      gst_element_link_many(gst_.tee, gst_.preview_queue, gst_.video_convert,
+                            NULL) &&
       gst_element_link_filtered(gst_.video_convert, gst_.video_sink, caps);
   gst_caps_unref(caps);
   if (!link_ok) {
@@ -176,15 +544,19 @@ bool GstCamera::CreatePipeline() {
     return false;
   }
 
-  auto* sinkpad = gst_element_get_static_pad(gst_.video_convert, "sink");
+  auto* sinkpad = gst_element_get_static_pad(
+      gst_.video_crop ? gst_.video_crop : gst_.tee, "sink");
   auto* ghost_sinkpad = gst_ghost_pad_new("sink", sinkpad);
   gst_pad_set_active(ghost_sinkpad, TRUE);
   gst_element_add_pad(gst_.output, ghost_sinkpad);
+  gst_object_unref(sinkpad);
 
   // Sets properties to camerabin.
   g_object_set(gst_.camerabin, "viewfinder-sink", gst_.output, NULL);
   gst_bin_add_many(GST_BIN(gst_.pipeline), gst_.camerabin, NULL);
 
+  video_recorder_ = std::make_unique<GstVideoRecorder>(gst_.output, gst_.tee);
+
   return true;
 }
 
@@ -211,6 +583,13 @@ void GstCamera::Preroll() {
 }
 
 void GstCamera::DestroyPipeline() {
+  video_recorder_ = nullptr;
+
+  if (gst_.bus_watch) {
+    CameraBusThread::GetInstance().RemoveWatch(gst_.bus_watch);
+    gst_.bus_watch = nullptr;
+  }
+
   if (gst_.video_sink) {
     g_object_set(G_OBJECT(gst_.video_sink), "signal-handoffs", FALSE, NULL);
   }
@@ -249,6 +628,18 @@ void GstCamera::DestroyPipeline() {
   if (gst_.video_convert) {
     gst_.video_convert = nullptr;
   }
+
+  if (gst_.video_crop) {
+    gst_.video_crop = nullptr;
+  }
+
+  if (gst_.preview_queue) {
+    gst_.preview_queue = nullptr;
+  }
+
+  if (gst_.tee) {
+    gst_.tee = nullptr;
+  }
 }
 
 void GstCamera::GetZoomMaxMinSize(float& max, float& min) {
@@ -272,39 +663,50 @@ void GstCamera::HandoffHandler(GstElement* fakesink, GstBuffer* buf,
   int height;
   gst_structure_get_int(structure, "width", &width);
   gst_structure_get_int(structure, "height", &height);
-  if (width != self->width_ || height != self->height_) {
-    self->width_ = width;
-    self->height_ = height;
-    self->pixels_.reset(new uint32_t[width * height]);
-    std::cout << "Pixel buffer size: width = " << width
-              << ", height = " << height << std::endl;
+  gst_caps_unref(caps);
+
+  {
+    std::lock_guard<std::shared_mutex> lock(self->mutex_buffer_);
+    if (width != self->width_ || height != self->height_) {
+      self->width_ = width;
+      self->height_ = height;
+      std::cout << "Pixel buffer size: width = " << width
+                << ", height = " << height << std::endl;
+    }
+
+    if (self->gst_.buffer) {
+      gst_buffer_unref(self->gst_.buffer);
+      self->gst_.buffer = nullptr;
+    }
+    self->gst_.buffer = gst_buffer_ref(buf);
+    self->frame_number_++;
+  }
+  self->cv_frame_.notify_all();
+
+  // The frames are converted to RGBA for the preview, so they can be pushed
+  // as they are. The rows of RGBA are always 4-byte aligned, so they're
+  // packed.
+  if (MillicastFrameForwarder::IsActive()) {
+    GstMapInfo map;
+    if (gst_buffer_map(buf, &map, GST_MAP_READ)) {
+      if (map.size >= static_cast<gsize>(width) * height * 4) {
+        MillicastFrameForwarder::PushRgbaFrame(map.data, width, height,
+                                               width * 4);
+      }
+      gst_buffer_unmap(buf, &map);
+    }
   }
 
-  std::lock_guard<std::shared_mutex> lock(self->mutex_buffer_);
-  if (self->gst_.buffer) {
-    gst_buffer_unref(self->gst_.buffer);
-    self->gst_.buffer = nullptr;
+  std::lock_guard<std::mutex> lock(self->mutex_stream_handler_);
+  if (self->stream_handler_) {
+    self->stream_handler_->OnNotifyFrameDecoded();
   }
-  self->gst_.buffer = gst_buffer_ref(buf);
-  self->stream_handler_->OnNotifyFrameDecoded();
 }
 
 // static
 gboolean GstCamera::HandleGstMessage(GstBus* bus, GstMessage* message,
                                      gpointer user_data) {
   switch (GST_MESSAGE_TYPE(message)) {
-    case GST_MESSAGE_ELEMENT: {
-      auto const* st = gst_message_get_structure(message);
-      if (st) {
-        auto* self = reinterpret_cast<GstCamera*>(user_data);
-        if (gst_structure_has_name(st, "image-done") &&
-            self->on_notify_captured_) {
-          auto const* filename = gst_structure_get_string(st, "filename");
-          self->on_notify_captured_(filename);
-        }
-      }
-      break;
-    }
     case GST_MESSAGE_WARNING: {
       gchar* debug;
       GError* error;
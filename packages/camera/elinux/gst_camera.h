@@ -7,19 +7,55 @@
 
 #include <gst/gst.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <shared_mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "camera_stream_handler.h"
+#include "gst_jpeg_encoder.h"
+#include "gst_video_recorder.h"
 
 class GstCamera {
  public:
+  struct CaptureOptions {
+    // The directory where captured images are written. When it's empty, the
+    // system temporary directory is used.
+    std::string output_directory;
+    // Keeps captured images in memory only instead of writing them to files.
+    bool in_memory = false;
+    // Waits for the next viewfinder frame instead of using the latest one.
+    bool use_next_frame = false;
+    // The number of images to capture. Each image of a burst is encoded from a
+    // different viewfinder frame.
+    int32_t burst_count = 1;
+    // The jpeg quality (0 - 100).
+    int32_t quality = 85;
+  };
+
+  struct CapturedImage {
+    // The path of the captured file. Empty for in-memory captures.
+    std::string file_path;
+    // The encoded jpeg image. Empty for file captures.
+    std::vector<uint8_t> data;
+  };
+
+  // Called on the capture worker thread. |images| is empty on failure.
   using OnNotifyCaptured =
-      std::function<void(const std::string& captured_file_path)>;
+      std::function<void(const std::vector<CapturedImage>& images)>;
 
-  GstCamera(std::unique_ptr<CameraStreamHandler> handler);
+  // |source_description| selects the video source of camerabin. See
+  // GstCameraSource for the format. camerabin's default source is used when
+  // it's empty.
+  GstCamera(std::unique_ptr<CameraStreamHandler> handler,
+            const std::string& source_description);
   ~GstCamera();
 
   static void GstLibraryLoad();
@@ -29,49 +65,115 @@ class GstCamera {
   bool Pause();
   bool Stop();
 
-  void TakePicture(OnNotifyCaptured on_notify_captured);
+  void TakePicture(const CaptureOptions& options,
+                   OnNotifyCaptured on_notify_captured);
+
+  // Pauses the pipeline keeping the camera device open so that the camera can
+  // be reused by Resume() without rebuilding the pipeline. The device is
+  // released after |idle_timeout| unless the camera is resumed. Returns false
+  // while recording a video, which would be cut off by the suspension.
+  bool Suspend(std::chrono::milliseconds idle_timeout);
+  // Resumes the suspended camera with a stream handler of a new texture. The
+  // pipeline is prerolled again if the device has been released. Play() needs
+  // to be called to start the preview.
+  void Resume(std::unique_ptr<CameraStreamHandler> handler);
+  bool IsSuspended() const { return is_suspended_; }
+  const std::string& GetSourceDescription() const {
+    return source_description_;
+  }
+
+  bool StartVideoRecording(const GstVideoRecorder::Options& options);
+  // Returns immediately. |on_stopped| is called on another thread with the
+  // path of the recorded file, or an empty string on failure.
+  void StopVideoRecording(GstVideoRecorder::OnStopped on_stopped);
+  GstVideoRecorder::Stats GetVideoRecordingStats();
 
   bool SetZoomLevel(float zoom);
   float GetMaxZoomLevel() const { return max_zoom_level_; };
   float GetMinZoomLevel() const { return min_zoom_level_; };
 
-  const uint8_t* GetPreviewFrameBuffer();
-  int32_t GetPreviewWidth() const { return width_; };
-  int32_t GetPreviewHeight() const { return height_; };
+  // Copies the latest preview frame in RGBA to |pixels|, resizing it to the
+  // size of the frame, which is returned with |width| and |height|. The size
+  // can change while the camera is running, e.g. with the zoom. Returns false
+  // if there's no frame yet.
+  bool CopyPreviewFrame(std::vector<uint8_t>& pixels, int32_t& width,
+                        int32_t& height);
+  int32_t GetPreviewWidth();
+  int32_t GetPreviewHeight();
 
  private:
   struct GstCameraElements {
     GstElement* pipeline;
     GstElement* camerabin;
+    GstElement* tee;
+    GstElement* preview_queue;
+    GstElement* video_crop;
     GstElement* video_convert;
     GstElement* video_sink;
     GstElement* output;
     GstBus* bus;
+    GSource* bus_watch;
     GstBuffer* buffer;
   };
 
   static void HandoffHandler(GstElement* fakesink, GstBuffer* buf,
                              GstPad* new_pad, gpointer user_data);
+  // Called on the thread of CameraBusThread.
   static gboolean HandleGstMessage(GstBus* bus, GstMessage* message,
                                    gpointer user_data);
 
+  struct CaptureRequest {
+    CaptureOptions options;
+    OnNotifyCaptured on_notify_captured;
+  };
+
   bool CreatePipeline();
   void DestroyPipeline();
   void Preroll();
   void GetZoomMaxMinSize(float& max, float& min);
+  bool GetViewfinderSize(int& width, int& height);
+  bool SetCrop(float zoom);
+  void CancelIdleTimer();
+  void CaptureThreadMain();
+  bool CaptureImage(const CaptureOptions& options, uint64_t min_frame_number,
+                    CapturedImage& image, uint64_t& frame_number);
+  bool WriteCapturedImage(const std::string& directory, CapturedImage& image);
 
   GstCameraElements gst_;
-  std::unique_ptr<uint32_t> pixels_;
+  std::string source_description_;
+  // The size of |gst_.buffer|. Guarded by |mutex_buffer_|.
   int32_t width_ = -1;
   int32_t height_ = -1;
   std::shared_mutex mutex_buffer_;
+  std::mutex mutex_stream_handler_;
   std::unique_ptr<CameraStreamHandler> stream_handler_ = nullptr;
   float max_zoom_level_;
   float min_zoom_level_;
   float zoom_level_ = 1.0f;
   int captured_count_ = 0;
 
-  OnNotifyCaptured on_notify_captured_ = nullptr;
+  // The number of viewfinder frames received so far. Guarded by
+  // |mutex_buffer_|.
+  uint64_t frame_number_ = 0;
+  std::condition_variable_any cv_frame_;
+
+  GstJpegEncoder jpeg_encoder_;
+  std::thread capture_thread_;
+  std::mutex mutex_capture_;
+  std::condition_variable cv_capture_;
+  std::deque<CaptureRequest> capture_requests_;
+  std::atomic<bool> capture_thread_exit_{false};
+
+  std::unique_ptr<GstVideoRecorder> video_recorder_;
+
+  bool is_suspended_ = false;
+  std::thread idle_timer_thread_;
+  std::mutex mutex_idle_timer_;
+  std::condition_variable cv_idle_timer_;
+  bool is_idle_timer_cancelled_ = false;
+  // Whether the idle timer has released the device. Guarded by
+  // |mutex_idle_timer_|.
+  bool is_device_released_ = false;
 };
 
 #endif  // PACKAGES_CAMERA_CAMERA_ELINUX_GST_CAMERA_H_
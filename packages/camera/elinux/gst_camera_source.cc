@@ -0,0 +1,185 @@
+// Copyright 2022 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "gst_camera_source.h"
+
+#include <cstdlib>
+#include <iostream>
+
+namespace {
+constexpr char kLoopContextKey[] = "camera-source-loop-context";
+constexpr char kLoopConvertName[] = "loop_convert";
+
+// The state of a looped file source. Each iteration of the file is shifted by
+// the total duration of the previous iterations so that the running time
+// keeps increasing.
+struct LoopContext {
+  GstPad* pad;
+  GstSegment segment;
+  GstClockTime iteration_end = 0;
+  GstClockTime offset = 0;
+  bool seeking = false;
+};
+
+void DestroyLoopContext(gpointer data) {
+  auto* context = reinterpret_cast<LoopContext*>(data);
+  gst_object_unref(context->pad);
+  delete context;
+}
+
+bool StartsWith(const std::string& str, const std::string& prefix) {
+  return str.compare(0, prefix.size(), prefix) == 0;
+}
+}  // namespace
+
+// static
+std::string GstCameraSource::GetDescriptionFromEnvironment() {
+  const auto* description = std::getenv(kEnvironmentVariable);
+  return description ? description : "";
+}
+
+// static
+GstElement* GstCameraSource::Create(const std::string& description) {
+  if (description.empty()) {
+    return nullptr;
+  }
+
+  if (StartsWith(description, "file://")) {
+    return CreateLoopedFileSource(description);
+  }
+  if (StartsWith(description, "/dev/video")) {
+    return Create("v4l2src device=" + description);
+  }
+  if (g_file_test(description.c_str(), G_FILE_TEST_IS_REGULAR)) {
+    auto* uri = gst_filename_to_uri(description.c_str(), NULL);
+    if (!uri) {
+      std::cerr << "Failed to open " << description << std::endl;
+      return nullptr;
+    }
+    auto* source = CreateLoopedFileSource(uri);
+    g_free(uri);
+    return source;
+  }
+
+  std::string pipeline_description = description;
+  // Behaves like a camera by default.
+  if (StartsWith(description, "videotestsrc") &&
+      description.find("is-live") == std::string::npos) {
+    pipeline_description.insert(sizeof("videotestsrc") - 1, " is-live=true");
+  }
+
+  GError* error = nullptr;
+  auto* source = gst_parse_bin_from_description(pipeline_description.c_str(),
+                                                TRUE, &error);
+  if (!source) {
+    std::cerr << "Failed to create a camera source from \""
+              << pipeline_description << "\": " << error->message
+              << std::endl;
+    g_error_free(error);
+    return nullptr;
+  }
+  std::cout << "Camera source: " << pipeline_description << std::endl;
+  return source;
+}
+
+// Creates a source which decodes a video file in a loop.
+// $ uridecodebin uri=<uri> caps=video/x-raw ! videoconvert
+// When the file reaches the end, the EOS is dropped and a seek to the start
+// is performed instead. The flush events of the seek are dropped too so that
+// they don't reach camerabin.
+// static
+GstElement* GstCameraSource::CreateLoopedFileSource(const std::string& uri) {
+  std::string pipeline_description =
+      "uridecodebin uri=\"" + uri +
+      "\" caps=video/x-raw expose-all-streams=false ! videoconvert name=" +
+      kLoopConvertName;
+
+  GError* error = nullptr;
+  auto* source = gst_parse_bin_from_description(pipeline_description.c_str(),
+                                                TRUE, &error);
+  if (!source) {
+    std::cerr << "Failed to create a camera source from " << uri << ": "
+              << error->message << std::endl;
+    g_error_free(error);
+    return nullptr;
+  }
+
+  auto* convert = gst_bin_get_by_name(GST_BIN(source), kLoopConvertName);
+  auto* context = new LoopContext();
+  context->pad = gst_element_get_static_pad(convert, "src");
+  gst_segment_init(&context->segment, GST_FORMAT_TIME);
+  gst_object_unref(convert);
+  g_object_set_data_full(G_OBJECT(source), kLoopContextKey, context,
+                         DestroyLoopContext);
+
+  gst_pad_add_probe(
+      context->pad,
+      static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER |
+                                   GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM |
+                                   GST_PAD_PROBE_TYPE_EVENT_FLUSH),
+      LoopProbe, context, NULL);
+
+  std::cout << "Camera source: " << uri << " (looped)" << std::endl;
+  return source;
+}
+
+// static
+GstPadProbeReturn GstCameraSource::LoopProbe(GstPad* pad,
+                                             GstPadProbeInfo* info,
+                                             gpointer user_data) {
+  auto* context = reinterpret_cast<LoopContext*>(user_data);
+
+  if (GST_PAD_PROBE_INFO_TYPE(info) & GST_PAD_PROBE_TYPE_BUFFER) {
+    auto* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    // Uses the time from the segment start rather than the running time
+    // because the latter already contains the pad offset.
+    if (GST_BUFFER_PTS_IS_VALID(buffer) &&
+        GST_BUFFER_PTS(buffer) >= context->segment.start) {
+      auto end = GST_BUFFER_PTS(buffer) - context->segment.start;
+      if (GST_BUFFER_DURATION_IS_VALID(buffer)) {
+        end += GST_BUFFER_DURATION(buffer);
+      }
+      context->iteration_end = MAX(context->iteration_end, end);
+    }
+    return GST_PAD_PROBE_OK;
+  }
+
+  auto* event = GST_PAD_PROBE_INFO_EVENT(info);
+  switch (GST_EVENT_TYPE(event)) {
+    case GST_EVENT_SEGMENT:
+      gst_event_copy_segment(event, &context->segment);
+      context->seeking = false;
+      return GST_PAD_PROBE_OK;
+    case GST_EVENT_FLUSH_START:
+    case GST_EVENT_FLUSH_STOP:
+      return context->seeking ? GST_PAD_PROBE_DROP : GST_PAD_PROBE_OK;
+    case GST_EVENT_EOS: {
+      context->offset += context->iteration_end;
+      context->iteration_end = 0;
+      context->seeking = true;
+      gst_pad_set_offset(pad, context->offset);
+
+      // Seeking from the streaming thread deadlocks, so it's done on another
+      // thread.
+      auto* element = gst_pad_get_parent_element(pad);
+      gst_element_call_async(element, SeekToStart, context, NULL);
+      gst_object_unref(element);
+      return GST_PAD_PROBE_DROP;
+    }
+    default:
+      return GST_PAD_PROBE_OK;
+  }
+}
+
+// static
+void GstCameraSource::SeekToStart(GstElement* element, gpointer user_data) {
+  auto* context = reinterpret_cast<LoopContext*>(user_data);
+  auto* seek = gst_event_new_seek(
+      1.0, GST_FORMAT_TIME,
+      static_cast<GstSeekFlags>(GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_KEY_UNIT),
+      GST_SEEK_TYPE_SET, 0, GST_SEEK_TYPE_NONE, GST_CLOCK_TIME_NONE);
+  if (!gst_pad_send_event(context->pad, seek)) {
+    std::cerr << "Failed to loop the camera source" << std::endl;
+  }
+}
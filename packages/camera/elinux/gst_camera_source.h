@@ -0,0 +1,45 @@
+// Copyright 2022 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PACKAGES_CAMERA_CAMERA_ELINUX_GST_CAMERA_SOURCE_H_
+#define PACKAGES_CAMERA_CAMERA_ELINUX_GST_CAMERA_SOURCE_H_
+
+#include <gst/gst.h>
+
+#include <string>
+
+// Creates the video source of camerabin from a source description so that the
+// camera can be driven without camera hardware (e.g. on CI or for
+// benchmarking).
+//
+// Supported descriptions:
+// - "" : camerabin's default source.
+// - "videotestsrc ..." : a test pattern. It's live unless "is-live" is given.
+// - "file:///path/to/video.mp4" or "/path/to/video.mp4" : a video file which is
+//   decoded and played in a loop.
+// - "/dev/videoN" : v4l2src with the device.
+// - any other pipeline description (e.g. "v4l2src device=/dev/video1 !
+//   image/jpeg ! jpegdec").
+class GstCameraSource {
+ public:
+  // The environment variable to specify the source description. The source
+  // specified by the create API has priority over this.
+  static constexpr char kEnvironmentVariable[] = "FLUTTER_ELINUX_CAMERA_SOURCE";
+
+  // Returns the source description from the environment variable, or an empty
+  // string when it's not set.
+  static std::string GetDescriptionFromEnvironment();
+
+  // Returns a new video source element, or nullptr when |description| is
+  // empty or invalid.
+  static GstElement* Create(const std::string& description);
+
+ private:
+  static GstElement* CreateLoopedFileSource(const std::string& uri);
+  static GstPadProbeReturn LoopProbe(GstPad* pad, GstPadProbeInfo* info,
+                                     gpointer user_data);
+  static void SeekToStart(GstElement* element, gpointer user_data);
+};
+
+#endif  // PACKAGES_CAMERA_CAMERA_ELINUX_GST_CAMERA_SOURCE_H_
@@ -0,0 +1,145 @@
+// Copyright 2022 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "gst_jpeg_encoder.h"
+
+#include <gst/app/gstappsink.h>
+#include <gst/app/gstappsrc.h>
+
+#include <iostream>
+#include <string>
+
+namespace {
+constexpr GstClockTime kEncodeTimeout = 2 * GST_SECOND;
+}  // namespace
+
+GstJpegEncoder::~GstJpegEncoder() { DestroyPipeline(); }
+
+bool GstJpegEncoder::Encode(GstBuffer* buffer, int32_t width, int32_t height,
+                            int32_t quality, std::vector<uint8_t>& jpeg) {
+  if (!gst_.pipeline && !CreatePipeline()) {
+    std::cerr << "Failed to create a jpeg encoder pipeline" << std::endl;
+    DestroyPipeline();
+    return false;
+  }
+  if (!SetInputSize(width, height)) {
+    return false;
+  }
+  g_object_set(G_OBJECT(gst_.jpeg_encoder), "quality", quality, NULL);
+
+  // Shares the memory of the viewfinder frame instead of copying pixels. The
+  // timestamps are dropped because they belong to the camera pipeline.
+  auto* input = gst_buffer_copy_region(buffer, GST_BUFFER_COPY_MEMORY, 0, -1);
+  GST_BUFFER_PTS(input) = GST_CLOCK_TIME_NONE;
+  GST_BUFFER_DTS(input) = GST_CLOCK_TIME_NONE;
+  GST_BUFFER_DURATION(input) = GST_CLOCK_TIME_NONE;
+  if (gst_app_src_push_buffer(GST_APP_SRC(gst_.app_src), input) !=
+      GST_FLOW_OK) {
+    std::cerr << "Failed to push a frame to the jpeg encoder" << std::endl;
+    return false;
+  }
+
+  auto* sample =
+      gst_app_sink_try_pull_sample(GST_APP_SINK(gst_.app_sink), kEncodeTimeout);
+  if (!sample) {
+    std::cerr << "Failed to get an encoded jpeg image" << std::endl;
+    return false;
+  }
+
+  auto* encoded = gst_sample_get_buffer(sample);
+  GstMapInfo map;
+  if (!encoded || !gst_buffer_map(encoded, &map, GST_MAP_READ)) {
+    std::cerr << "Failed to map an encoded jpeg image" << std::endl;
+    gst_sample_unref(sample);
+    return false;
+  }
+  jpeg.assign(map.data, map.data + map.size);
+  gst_buffer_unmap(encoded, &map);
+  gst_sample_unref(sample);
+
+  return true;
+}
+
+// Creates a jpeg encoder pipeline.
+// $ appsrc ! jpegenc ! appsink
+bool GstJpegEncoder::CreatePipeline() {
+  gst_.pipeline = gst_pipeline_new("jpeg_encoder_pipeline");
+  if (!gst_.pipeline) {
+    std::cerr << "Failed to create a pipeline" << std::endl;
+    return false;
+  }
+  gst_.app_src = gst_element_factory_make("appsrc", "jpeg_src");
+  if (!gst_.app_src) {
+    std::cerr << "Failed to create an appsrc" << std::endl;
+    return false;
+  }
+  gst_.jpeg_encoder = gst_element_factory_make("jpegenc", "jpeg_encoder");
+  if (!gst_.jpeg_encoder) {
+    std::cerr << "Failed to create a jpegenc" << std::endl;
+    return false;
+  }
+  gst_.app_sink = gst_element_factory_make("appsink", "jpeg_sink");
+  if (!gst_.app_sink) {
+    std::cerr << "Failed to create an appsink" << std::endl;
+    return false;
+  }
+
+  g_object_set(G_OBJECT(gst_.app_src), "format", GST_FORMAT_TIME, "is-live",
+               FALSE, NULL);
+  g_object_set(G_OBJECT(gst_.app_sink), "sync", FALSE, "max-buffers", 1,
+               NULL);
+
+  gst_bin_add_many(GST_BIN(gst_.pipeline), gst_.app_src, gst_.jpeg_encoder,
+                   gst_.app_sink, NULL);
+  if (!gst_element_link_many(gst_.app_src, gst_.jpeg_encoder, gst_.app_sink,
+                             NULL)) {
+    std::cerr << "Failed to link elements" << std::endl;
+    return false;
+  }
+
+  if (gst_element_set_state(gst_.pipeline, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE) {
+    std::cerr << "Failed to change the state to PLAYING" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void GstJpegEncoder::DestroyPipeline() {
+  if (gst_.pipeline) {
+    gst_element_set_state(gst_.pipeline, GST_STATE_NULL);
+    gst_object_unref(gst_.pipeline);
+    gst_.pipeline = nullptr;
+  }
+  gst_.app_src = nullptr;
+  gst_.jpeg_encoder = nullptr;
+  gst_.app_sink = nullptr;
+  width_ = -1;
+  height_ = -1;
+}
+
+bool GstJpegEncoder::SetInputSize(int32_t width, int32_t height) {
+  if (width <= 0 || height <= 0) {
+    std::cerr << "Invalid frame size: width = " << width
+              << ", height = " << height << std::endl;
+    return false;
+  }
+  if (width == width_ && height == height_) {
+    return true;
+  }
+
+  // jpegenc doesn't accept RGBA, but the memory layout of RGBx is the same and
+  // the alpha channel is dropped by the encoder anyway, so this avoids a
+  // videoconvert pass before encoding.
+  std::string caps_str = "video/x-raw,format=RGBx,framerate=0/1";
+  caps_str += ",width=" + std::to_string(width);
+  caps_str += ",height=" + std::to_string(height);
+  auto* caps = gst_caps_from_string(caps_str.c_str());
+  gst_app_src_set_caps(GST_APP_SRC(gst_.app_src), caps);
+  gst_caps_unref(caps);
+
+  width_ = width;
+  height_ = height;
+  return true;
+}
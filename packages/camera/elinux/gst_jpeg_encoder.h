@@ -0,0 +1,49 @@
+// Copyright 2022 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PACKAGES_CAMERA_CAMERA_ELINUX_GST_JPEG_ENCODER_H_
+#define PACKAGES_CAMERA_CAMERA_ELINUX_GST_JPEG_ENCODER_H_
+
+#include <gst/gst.h>
+
+#include <cstdint>
+#include <vector>
+
+// Encodes RGBA viewfinder frames to JPEG in memory.
+//
+// The encoder pipeline is created on the first call and is kept in the
+// PLAYING state so that consecutive captures (e.g. burst shots) don't pay the
+// cost of the pipeline construction and the state changes. This class is not
+// thread-safe and is supposed to be used from a single worker thread.
+class GstJpegEncoder {
+ public:
+  GstJpegEncoder() = default;
+  ~GstJpegEncoder();
+
+  // Prevent copying.
+  GstJpegEncoder(GstJpegEncoder const&) = delete;
+  GstJpegEncoder& operator=(GstJpegEncoder const&) = delete;
+
+  // Encodes |buffer| which contains a RGBA frame of |width| x |height| pixels.
+  bool Encode(GstBuffer* buffer, int32_t width, int32_t height,
+              int32_t quality, std::vector<uint8_t>& jpeg);
+
+ private:
+  struct GstJpegEncoderElements {
+    GstElement* pipeline;
+    GstElement* app_src;
+    GstElement* jpeg_encoder;
+    GstElement* app_sink;
+  };
+
+  bool CreatePipeline();
+  void DestroyPipeline();
+  bool SetInputSize(int32_t width, int32_t height);
+
+  GstJpegEncoderElements gst_ = {nullptr, nullptr, nullptr, nullptr};
+  int32_t width_ = -1;
+  int32_t height_ = -1;
+};
+
+#endif  // PACKAGES_CAMERA_CAMERA_ELINUX_GST_JPEG_ENCODER_H_
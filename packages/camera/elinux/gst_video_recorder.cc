@@ -0,0 +1,425 @@
+// Copyright 2022 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "gst_video_recorder.h"
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+namespace {
+constexpr char kEncoderX264[] = "x264enc";
+constexpr char kEncoderOpenH264[] = "openh264enc";
+
+// How long the finalizing thread waits for the muxer to finalize the file.
+constexpr auto kFinalizeTimeout = std::chrono::seconds(5);
+
+// The number of frames buffered in front of the encoder. Older frames are
+// dropped when the encoder can't keep up so that the preview isn't blocked.
+constexpr guint kMaxQueuedFrames = 30;
+
+bool GetMuxer(const std::string& container, std::string& muxer,
+              std::string& extension) {
+  if (container.empty() || container == "mp4") {
+    muxer = "mp4mux";
+    extension = "mp4";
+  } else if (container == "mkv" || container == "matroska") {
+    muxer = "matroskamux";
+    extension = "mkv";
+  } else if (container == "ts") {
+    muxer = "mpegtsmux";
+    extension = "ts";
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Maps x264enc speed presets to openh264enc complexities.
+const char* GetOpenH264Complexity(const std::string& speed_preset) {
+  if (speed_preset == "ultrafast" || speed_preset == "superfast" ||
+      speed_preset == "veryfast") {
+    return "low";
+  }
+  if (speed_preset == "faster" || speed_preset == "fast" ||
+      speed_preset == "medium") {
+    return "medium";
+  }
+  return "high";
+}
+}  // namespace
+
+GstVideoRecorder::GstVideoRecorder(GstElement* bin, GstElement* tee)
+    : bin_(bin), tee_(tee) {}
+
+GstVideoRecorder::~GstVideoRecorder() {
+  if (IsRecording()) {
+    Stop(nullptr);
+  }
+  JoinFinalizeThread();
+}
+
+bool GstVideoRecorder::Start(const Options& options) {
+  if (IsRecording()) {
+    std::cerr << "Video recording has already started" << std::endl;
+    return false;
+  }
+  JoinFinalizeThread();
+
+  std::string muxer;
+  std::string extension;
+  if (!GetMuxer(options.container, muxer, extension)) {
+    std::cerr << options.container << " is not a supported container"
+              << std::endl;
+    return false;
+  }
+
+  const std::string dir = options.output_directory.empty()
+                              ? g_get_tmp_dir()
+                              : options.output_directory;
+  if (g_mkdir_with_parents(dir.c_str(), 0755) != 0) {
+    std::cerr << "Failed to create " << dir << std::endl;
+    return false;
+  }
+  std::string filename =
+      "REC_" + std::to_string(g_get_real_time()) + "." + extension;
+  auto* location = g_build_filename(dir.c_str(), filename.c_str(), NULL);
+  location_ = location;
+  g_free(location);
+
+  frames_in_ = 0;
+  frames_encoded_ = 0;
+  bytes_written_ = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_eos_);
+    is_eos_ = false;
+  }
+
+  if (!CreateBranch(options, muxer)) {
+    std::cerr << "Failed to create a recording branch" << std::endl;
+    DestroyBranch();
+    location_.clear();
+    return false;
+  }
+  start_time_ = g_get_monotonic_time();
+  is_recording_ = true;
+
+  return true;
+}
+
+bool GstVideoRecorder::Stop(OnStopped on_stopped) {
+  if (!IsRecording()) {
+    std::cerr << "Video recording hasn't started" << std::endl;
+    return false;
+  }
+
+  last_stats_ = GetStats();
+  is_recording_ = false;
+
+  // Unlinks the branch from the tee when no data is flowing and lets the EOS
+  // go through the branch so that the muxer finalizes the file.
+  gst_pad_add_probe(branch_.tee_pad, GST_PAD_PROBE_TYPE_IDLE, UnlinkProbe,
+                    nullptr, NULL);
+
+  // Finalizing can take a while for long recordings, so the caller, which is
+  // usually the platform thread, isn't blocked.
+  finalize_thread_ = std::thread(&GstVideoRecorder::Finalize, this,
+                                 std::move(on_stopped));
+  return true;
+}
+
+void GstVideoRecorder::Finalize(OnStopped on_stopped) {
+  bool finalized;
+  {
+    std::unique_lock<std::mutex> lock(mutex_eos_);
+    finalized =
+        cv_eos_.wait_for(lock, kFinalizeTimeout, [this] { return is_eos_; });
+  }
+
+  DestroyBranch();
+
+  std::string location;
+  location.swap(location_);
+  if (!finalized) {
+    std::cerr << "Timed out finalizing " << location << std::endl;
+    location.clear();
+  }
+  if (on_stopped) {
+    on_stopped(location);
+  }
+}
+
+void GstVideoRecorder::JoinFinalizeThread() {
+  if (finalize_thread_.joinable()) {
+    finalize_thread_.join();
+  }
+}
+
+GstVideoRecorder::Stats GstVideoRecorder::GetStats() {
+  if (!IsRecording()) {
+    return last_stats_;
+  }
+
+  Stats stats;
+  stats.duration_ms = (g_get_monotonic_time() - start_time_) / 1000;
+  stats.bytes_written = bytes_written_;
+  if (stats.duration_ms > 0) {
+    // bits per millisecond is equal to kbit/s.
+    stats.bitrate = stats.bytes_written * 8.0 / stats.duration_ms;
+  }
+  stats.frames_encoded = frames_encoded_;
+
+  guint queued = 0;
+  g_object_get(G_OBJECT(branch_.queue), "current-level-buffers", &queued,
+               NULL);
+  const uint64_t frames_in = frames_in_;
+  if (frames_in > stats.frames_encoded + queued) {
+    stats.frames_dropped = frames_in - stats.frames_encoded - queued;
+  }
+  return stats;
+}
+
+bool GstVideoRecorder::CreateBranch(const Options& options,
+                                    const std::string& muxer) {
+  // Elements are added to the bin as soon as they are created so that
+  // DestroyBranch() can clean up a partially created branch.
+  auto make = [this](const char* factory) -> GstElement* {
+    auto* element = gst_element_factory_make(factory, NULL);
+    if (!element) {
+      std::cerr << "Failed to create a " << factory << std::endl;
+      return nullptr;
+    }
+    gst_bin_add(GST_BIN(bin_), element);
+    return element;
+  };
+
+  if (!(branch_.queue = make("queue")) ||
+      !(branch_.video_scale = make("videoscale")) ||
+      !(branch_.video_convert = make("videoconvert")) ||
+      !(branch_.caps_filter = make("capsfilter")) ||
+      !(branch_.parser = make("h264parse")) ||
+      !(branch_.muxer = make(muxer.c_str())) ||
+      !(branch_.file_sink = make("filesink"))) {
+    return false;
+  }
+  branch_.encoder = CreateEncoder(options);
+  if (!branch_.encoder) {
+    return false;
+  }
+  gst_bin_add(GST_BIN(bin_), branch_.encoder);
+
+  g_object_set(G_OBJECT(branch_.queue), "leaky", 2 /* downstream */,
+               "max-size-buffers", kMaxQueuedFrames, "max-size-bytes", 0,
+               "max-size-time", static_cast<guint64>(0), NULL);
+  auto width = options.width;
+  auto height = options.height;
+  if (width <= 0 || height <= 0) {
+    auto* tee_pad = gst_element_get_static_pad(tee_, "sink");
+    auto* current_caps = gst_pad_get_current_caps(tee_pad);
+    gst_object_unref(tee_pad);
+    if (current_caps) {
+      auto* structure = gst_caps_get_structure(current_caps, 0);
+      gst_structure_get_int(structure, "width", &width);
+      gst_structure_get_int(structure, "height", &height);
+      gst_caps_unref(current_caps);
+    }
+  }
+  std::string caps_str = "video/x-raw,format=I420";
+  if (width > 0 && height > 0) {
+    caps_str += ",width=" + std::to_string(width) +
+                ",height=" + std::to_string(height);
+  }
+  auto* caps = gst_caps_from_string(caps_str.c_str());
+  g_object_set(G_OBJECT(branch_.caps_filter), "caps", caps, NULL);
+  gst_caps_unref(caps);
+  // The sink must not make the running pipeline go back to PAUSED for
+  // prerolling.
+  g_object_set(G_OBJECT(branch_.file_sink), "location", location_.c_str(),
+               "async", FALSE, "sync", FALSE, NULL);
+
+  if (!gst_element_link_many(branch_.queue, branch_.video_scale,
+                             branch_.video_convert, branch_.caps_filter,
+                             branch_.encoder, branch_.parser, branch_.muxer,
+                             branch_.file_sink, NULL)) {
+    std::cerr << "Failed to link elements" << std::endl;
+    return false;
+  }
+
+  AddProbe(branch_.queue, "sink", GST_PAD_PROBE_TYPE_BUFFER, QueueSinkProbe);
+  AddProbe(branch_.encoder, "sink", GST_PAD_PROBE_TYPE_BUFFER,
+           EncoderSinkProbe);
+  AddProbe(branch_.file_sink, "sink",
+           static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER |
+                                        GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM),
+           FileSinkProbe);
+
+  for (auto* element :
+       {branch_.file_sink, branch_.muxer, branch_.parser, branch_.encoder,
+        branch_.caps_filter, branch_.video_convert, branch_.video_scale,
+        branch_.queue}) {
+    if (!gst_element_sync_state_with_parent(element)) {
+      std::cerr << "Failed to sync the state of "
+                << GST_ELEMENT_NAME(element) << std::endl;
+      return false;
+    }
+  }
+
+  branch_.tee_pad = gst_element_get_request_pad(tee_, "src_%u");
+  if (!branch_.tee_pad) {
+    std::cerr << "Failed to get a tee pad" << std::endl;
+    return false;
+  }
+  auto* queue_pad = gst_element_get_static_pad(branch_.queue, "sink");
+
+  // Shifts the timestamps so that the recorded file starts at zero instead of
+  // the running time of the camera pipeline.
+  auto* clock = gst_element_get_clock(bin_);
+  if (clock) {
+    auto running_time =
+        gst_clock_get_time(clock) - gst_element_get_base_time(bin_);
+    gst_pad_set_offset(queue_pad, -static_cast<gint64>(running_time));
+    gst_object_unref(clock);
+  }
+
+  auto link_result = gst_pad_link(branch_.tee_pad, queue_pad);
+  gst_object_unref(queue_pad);
+  if (link_result != GST_PAD_LINK_OK) {
+    std::cerr << "Failed to link the recording branch" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+void GstVideoRecorder::DestroyBranch() {
+  if (branch_.tee_pad) {
+    gst_element_release_request_pad(tee_, branch_.tee_pad);
+    gst_object_unref(branch_.tee_pad);
+    branch_.tee_pad = nullptr;
+  }
+
+  for (auto** element :
+       {&branch_.queue, &branch_.video_scale, &branch_.video_convert,
+        &branch_.caps_filter, &branch_.encoder, &branch_.parser,
+        &branch_.muxer, &branch_.file_sink}) {
+    if (*element) {
+      gst_element_set_state(*element, GST_STATE_NULL);
+      gst_bin_remove(GST_BIN(bin_), *element);
+      *element = nullptr;
+    }
+  }
+}
+
+// Creates a software H.264 encoder. Other encoders (e.g. H/W accelerated ones
+// of the target device) can also be specified by their element name, but the
+// options except for the bitrate aren't applied to them.
+GstElement* GstVideoRecorder::CreateEncoder(const Options& options) {
+  std::vector<std::string> candidates = {kEncoderX264, kEncoderOpenH264};
+  if (!options.encoder.empty()) {
+    candidates = {options.encoder};
+  }
+
+  GstElement* encoder = nullptr;
+  std::string name;
+  for (const auto& candidate : candidates) {
+    encoder = gst_element_factory_make(candidate.c_str(), NULL);
+    if (encoder) {
+      name = candidate;
+      break;
+    }
+  }
+  if (!encoder) {
+    std::cerr << "Failed to create a video encoder" << std::endl;
+    return nullptr;
+  }
+
+  if (name == kEncoderX264) {
+    gst_util_set_object_arg(G_OBJECT(encoder), "speed-preset",
+                            options.speed_preset.c_str());
+    gst_util_set_object_arg(G_OBJECT(encoder), "tune", "zerolatency");
+    if (options.bitrate > 0) {
+      g_object_set(G_OBJECT(encoder), "bitrate",
+                   static_cast<guint>(options.bitrate), NULL);
+    }
+  } else if (name == kEncoderOpenH264) {
+    gst_util_set_object_arg(G_OBJECT(encoder), "complexity",
+                            GetOpenH264Complexity(options.speed_preset));
+    if (options.bitrate > 0) {
+      g_object_set(G_OBJECT(encoder), "bitrate",
+                   static_cast<guint>(options.bitrate * 1000), NULL);
+    }
+  } else if (options.bitrate > 0 &&
+             g_object_class_find_property(G_OBJECT_GET_CLASS(encoder),
+                                          "bitrate")) {
+    gst_util_set_object_arg(G_OBJECT(encoder), "bitrate",
+                            std::to_string(options.bitrate).c_str());
+  }
+  return encoder;
+}
+
+void GstVideoRecorder::AddProbe(GstElement* element, const char* pad_name,
+                                GstPadProbeType type,
+                                GstPadProbeCallback callback) {
+  auto* pad = gst_element_get_static_pad(element, pad_name);
+  gst_pad_add_probe(pad, type, callback, this, NULL);
+  gst_object_unref(pad);
+}
+
+// static
+GstPadProbeReturn GstVideoRecorder::QueueSinkProbe(GstPad* pad,
+                                                   GstPadProbeInfo* info,
+                                                   gpointer user_data) {
+  auto* self = reinterpret_cast<GstVideoRecorder*>(user_data);
+  self->frames_in_++;
+  return GST_PAD_PROBE_OK;
+}
+
+// static
+GstPadProbeReturn GstVideoRecorder::EncoderSinkProbe(GstPad* pad,
+                                                     GstPadProbeInfo* info,
+                                                     gpointer user_data) {
+  auto* self = reinterpret_cast<GstVideoRecorder*>(user_data);
+  self->frames_encoded_++;
+  return GST_PAD_PROBE_OK;
+}
+
+// static
+GstPadProbeReturn GstVideoRecorder::FileSinkProbe(GstPad* pad,
+                                                  GstPadProbeInfo* info,
+                                                  gpointer user_data) {
+  auto* self = reinterpret_cast<GstVideoRecorder*>(user_data);
+  if (GST_PAD_PROBE_INFO_TYPE(info) & GST_PAD_PROBE_TYPE_BUFFER) {
+    self->bytes_written_ +=
+        gst_buffer_get_size(GST_PAD_PROBE_INFO_BUFFER(info));
+    return GST_PAD_PROBE_OK;
+  }
+
+  auto* event = GST_PAD_PROBE_INFO_EVENT(info);
+  if (GST_EVENT_TYPE(event) != GST_EVENT_EOS) {
+    return GST_PAD_PROBE_OK;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(self->mutex_eos_);
+    self->is_eos_ = true;
+  }
+  self->cv_eos_.notify_all();
+
+  // Drops the EOS not to post it to the bus of the camera pipeline. All data
+  // has been written by the muxer at this point.
+  return GST_PAD_PROBE_DROP;
+}
+
+// static
+GstPadProbeReturn GstVideoRecorder::UnlinkProbe(GstPad* pad,
+                                                GstPadProbeInfo* info,
+                                                gpointer user_data) {
+  auto* peer = gst_pad_get_peer(pad);
+  if (peer) {
+    gst_pad_unlink(pad, peer);
+    gst_pad_send_event(peer, gst_event_new_eos());
+    gst_object_unref(peer);
+  }
+  return GST_PAD_PROBE_REMOVE;
+}
@@ -0,0 +1,130 @@
+// Copyright 2022 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PACKAGES_CAMERA_CAMERA_ELINUX_GST_VIDEO_RECORDER_H_
+#define PACKAGES_CAMERA_CAMERA_ELINUX_GST_VIDEO_RECORDER_H_
+
+#include <gst/gst.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Records the viewfinder frames to a file using a recording branch which is
+// attached to a tee element of a running pipeline.
+//
+// $ tee. ! queue ! videoscale ! videoconvert !
+// video/x-raw,format=I420,width=<width>,height=<height> ! <encoder> !
+// h264parse ! <muxer> ! filesink
+//
+// The branch is added when a recording starts and is removed when it stops,
+// so the preview branch keeps running and the camera isn't captured twice.
+class GstVideoRecorder {
+ public:
+  struct Options {
+    // The directory where the recorded file is written. When it's empty, the
+    // system temporary directory is used.
+    std::string output_directory;
+    // "x264enc" or "openh264enc". When it's empty, the first available one is
+    // used.
+    std::string encoder;
+    // x264enc speed preset (e.g. "ultrafast", "veryfast", "medium"). It's
+    // mapped to the complexity for openh264enc.
+    std::string speed_preset = "veryfast";
+    // "mp4", "mkv" or "ts".
+    std::string container = "mp4";
+    // The target bitrate in kbit/s. 0 uses the default value of the encoder.
+    int32_t bitrate = 0;
+    // The size of the recorded frames. The frames are scaled to it, so the
+    // size of the file doesn't change when the size of the viewfinder frames
+    // changes, e.g. by zooming. 0 uses the size when the recording starts.
+    int32_t width = 0;
+    int32_t height = 0;
+  };
+
+  struct Stats {
+    int64_t duration_ms = 0;
+    uint64_t bytes_written = 0;
+    // The average bitrate in kbit/s since the recording started.
+    double bitrate = 0;
+    uint64_t frames_encoded = 0;
+    uint64_t frames_dropped = 0;
+  };
+
+  // Called on the finalizing thread with the path of the recorded file, or an
+  // empty string on failure.
+  using OnStopped = std::function<void(const std::string& file_path)>;
+
+  GstVideoRecorder(GstElement* bin, GstElement* tee);
+  ~GstVideoRecorder();
+
+  // Prevent copying.
+  GstVideoRecorder(GstVideoRecorder const&) = delete;
+  GstVideoRecorder& operator=(GstVideoRecorder const&) = delete;
+
+  // Waits for the previous recording to be finalized if it hasn't been yet.
+  bool Start(const Options& options);
+  // Detaches the branch and returns immediately. The muxer finalizes the file
+  // on another thread, and |on_stopped| is called when it's done. Returns
+  // false if the recording hasn't started.
+  bool Stop(OnStopped on_stopped);
+  bool IsRecording() const { return is_recording_; }
+  Stats GetStats();
+
+ private:
+  struct GstRecordingBranchElements {
+    GstElement* queue;
+    GstElement* video_scale;
+    GstElement* video_convert;
+    GstElement* caps_filter;
+    GstElement* encoder;
+    GstElement* parser;
+    GstElement* muxer;
+    GstElement* file_sink;
+    GstPad* tee_pad;
+  };
+
+  static GstPadProbeReturn QueueSinkProbe(GstPad* pad, GstPadProbeInfo* info,
+                                          gpointer user_data);
+  static GstPadProbeReturn EncoderSinkProbe(GstPad* pad, GstPadProbeInfo* info,
+                                            gpointer user_data);
+  static GstPadProbeReturn FileSinkProbe(GstPad* pad, GstPadProbeInfo* info,
+                                         gpointer user_data);
+  static GstPadProbeReturn UnlinkProbe(GstPad* pad, GstPadProbeInfo* info,
+                                       gpointer user_data);
+
+  void Finalize(OnStopped on_stopped);
+  void JoinFinalizeThread();
+  bool CreateBranch(const Options& options, const std::string& muxer);
+  void DestroyBranch();
+  GstElement* CreateEncoder(const Options& options);
+  void AddProbe(GstElement* element, const char* pad_name,
+                GstPadProbeType type, GstPadProbeCallback callback);
+
+  GstElement* bin_;
+  GstElement* tee_;
+  GstRecordingBranchElements branch_ = {nullptr, nullptr, nullptr,
+                                        nullptr, nullptr, nullptr,
+                                        nullptr, nullptr, nullptr};
+  std::string location_;
+  int64_t start_time_ = 0;
+  Stats last_stats_;
+  std::atomic<bool> is_recording_{false};
+  // Waits for the EOS, and destroys the branch of the stopped recording.
+  std::thread finalize_thread_;
+
+  std::atomic<uint64_t> frames_in_{0};
+  std::atomic<uint64_t> frames_encoded_{0};
+  std::atomic<uint64_t> bytes_written_{0};
+
+  std::mutex mutex_eos_;
+  std::condition_variable cv_eos_;
+  bool is_eos_ = false;
+};
+
+#endif  // PACKAGES_CAMERA_CAMERA_ELINUX_GST_VIDEO_RECORDER_H_
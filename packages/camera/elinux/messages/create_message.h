@@ -0,0 +1,65 @@
+// Copyright 2022 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PACKAGES_CAMERA_CAMERA_ELINUX_MESSAGES_CREATE_MESSAGE_H_
+#define PACKAGES_CAMERA_CAMERA_ELINUX_MESSAGES_CREATE_MESSAGE_H_
+
+#include <flutter/binary_messenger.h>
+#include <flutter/encodable_value.h>
+
+#include <string>
+#include <variant>
+
+// The arguments of create. "source" is an eLinux specific extension and
+// optional.
+class CreateMessage {
+ public:
+  CreateMessage() = default;
+  ~CreateMessage() = default;
+
+  // Prevent copying.
+  CreateMessage(CreateMessage const&) = default;
+  CreateMessage& operator=(CreateMessage const&) = default;
+
+  void SetCameraName(const std::string& camera_name) {
+    camera_name_ = camera_name;
+  }
+  std::string GetCameraName() const { return camera_name_; }
+
+  void SetSource(const std::string& source) { source_ = source; }
+  std::string GetSource() const { return source_; }
+
+  flutter::EncodableValue ToMap() {
+    flutter::EncodableMap map = {
+        {flutter::EncodableValue("cameraName"),
+         flutter::EncodableValue(camera_name_)},
+        {flutter::EncodableValue("source"), flutter::EncodableValue(source_)}};
+    return flutter::EncodableValue(map);
+  }
+
+  static CreateMessage FromMap(const flutter::EncodableValue& value) {
+    CreateMessage message;
+    if (std::holds_alternative<flutter::EncodableMap>(value)) {
+      auto map = std::get<flutter::EncodableMap>(value);
+
+      flutter::EncodableValue& camera_name =
+          map[flutter::EncodableValue("cameraName")];
+      if (std::holds_alternative<std::string>(camera_name)) {
+        message.SetCameraName(std::get<std::string>(camera_name));
+      }
+
+      flutter::EncodableValue& source = map[flutter::EncodableValue("source")];
+      if (std::holds_alternative<std::string>(source)) {
+        message.SetSource(std::get<std::string>(source));
+      }
+    }
+    return message;
+  }
+
+ private:
+  std::string camera_name_;
+  std::string source_;
+};
+
+#endif  // PACKAGES_CAMERA_CAMERA_ELINUX_MESSAGES_CREATE_MESSAGE_H_
@@ -6,8 +6,11 @@
 #define PACKAGES_CAMERA_CAMERA_ELINUX_MESSAGES_MESSAGES_H_
 
 #include "available_cameras_message.h"
+#include "create_message.h"
 #include "orientation_message.h"
+#include "take_picture_message.h"
 #include "texture_message.h"
+#include "video_recording_message.h"
 #include "zoom_level_message.h"
 
 #endif  // PACKAGES_CAMERA_CAMERA_ELINUX_MESSAGES_MESSAGES_H_
@@ -0,0 +1,105 @@
+// Copyright 2022 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PACKAGES_CAMERA_CAMERA_ELINUX_MESSAGES_TAKE_PICTURE_MESSAGE_H_
+#define PACKAGES_CAMERA_CAMERA_ELINUX_MESSAGES_TAKE_PICTURE_MESSAGE_H_
+
+#include <flutter/binary_messenger.h>
+#include <flutter/encodable_value.h>
+
+#include <string>
+#include <variant>
+
+// The arguments of takePicture. All the keys except for "cameraId" are
+// eLinux specific extensions and optional.
+class TakePictureMessage {
+ public:
+  TakePictureMessage() = default;
+  ~TakePictureMessage() = default;
+
+  // Prevent copying.
+  TakePictureMessage(TakePictureMessage const&) = default;
+  TakePictureMessage& operator=(TakePictureMessage const&) = default;
+
+  void SetOutputDirectory(const std::string& output_directory) {
+    output_directory_ = output_directory;
+  }
+  std::string GetOutputDirectory() const { return output_directory_; }
+
+  void SetReturnBytes(bool return_bytes) { return_bytes_ = return_bytes; }
+  bool GetReturnBytes() const { return return_bytes_; }
+
+  void SetUseNextFrame(bool use_next_frame) {
+    use_next_frame_ = use_next_frame;
+  }
+  bool GetUseNextFrame() const { return use_next_frame_; }
+
+  void SetBurstCount(int32_t burst_count) { burst_count_ = burst_count; }
+  int32_t GetBurstCount() const { return burst_count_; }
+
+  void SetQuality(int32_t quality) { quality_ = quality; }
+  int32_t GetQuality() const { return quality_; }
+
+  flutter::EncodableValue ToMap() {
+    flutter::EncodableMap map = {
+        {flutter::EncodableValue("outputDirectory"),
+         flutter::EncodableValue(output_directory_)},
+        {flutter::EncodableValue("returnBytes"),
+         flutter::EncodableValue(return_bytes_)},
+        {flutter::EncodableValue("useNextFrame"),
+         flutter::EncodableValue(use_next_frame_)},
+        {flutter::EncodableValue("burstCount"),
+         flutter::EncodableValue(burst_count_)},
+        {flutter::EncodableValue("quality"),
+         flutter::EncodableValue(quality_)}};
+    return flutter::EncodableValue(map);
+  }
+
+  static TakePictureMessage FromMap(const flutter::EncodableValue& value) {
+    TakePictureMessage message;
+    if (std::holds_alternative<flutter::EncodableMap>(value)) {
+      auto map = std::get<flutter::EncodableMap>(value);
+
+      flutter::EncodableValue& output_directory =
+          map[flutter::EncodableValue("outputDirectory")];
+      if (std::holds_alternative<std::string>(output_directory)) {
+        message.SetOutputDirectory(std::get<std::string>(output_directory));
+      }
+
+      flutter::EncodableValue& return_bytes =
+          map[flutter::EncodableValue("returnBytes")];
+      if (std::holds_alternative<bool>(return_bytes)) {
+        message.SetReturnBytes(std::get<bool>(return_bytes));
+      }
+
+      flutter::EncodableValue& use_next_frame =
+          map[flutter::EncodableValue("useNextFrame")];
+      if (std::holds_alternative<bool>(use_next_frame)) {
+        message.SetUseNextFrame(std::get<bool>(use_next_frame));
+      }
+
+      flutter::EncodableValue& burst_count =
+          map[flutter::EncodableValue("burstCount")];
+      if (std::holds_alternative<int32_t>(burst_count)) {
+        message.SetBurstCount(std::get<int32_t>(burst_count));
+      }
+
+      flutter::EncodableValue& quality =
+          map[flutter::EncodableValue("quality")];
+      if (std::holds_alternative<int32_t>(quality)) {
+        message.SetQuality(std::get<int32_t>(quality));
+      }
+    }
+    return message;
+  }
+
+ private:
+  std::string output_directory_;
+  bool return_bytes_ = false;
+  bool use_next_frame_ = false;
+  int32_t burst_count_ = 1;
+  int32_t quality_ = 85;
+};
+
+#endif  // PACKAGES_CAMERA_CAMERA_ELINUX_MESSAGES_TAKE_PICTURE_MESSAGE_H_
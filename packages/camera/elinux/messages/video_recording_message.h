@@ -0,0 +1,104 @@
+// Copyright 2022 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PACKAGES_CAMERA_CAMERA_ELINUX_MESSAGES_VIDEO_RECORDING_MESSAGE_H_
+#define PACKAGES_CAMERA_CAMERA_ELINUX_MESSAGES_VIDEO_RECORDING_MESSAGE_H_
+
+#include <flutter/binary_messenger.h>
+#include <flutter/encodable_value.h>
+
+#include <string>
+#include <variant>
+
+// The arguments of startVideoRecording. All the keys except for "cameraId"
+// are eLinux specific extensions and optional.
+class VideoRecordingMessage {
+ public:
+  VideoRecordingMessage() = default;
+  ~VideoRecordingMessage() = default;
+
+  // Prevent copying.
+  VideoRecordingMessage(VideoRecordingMessage const&) = default;
+  VideoRecordingMessage& operator=(VideoRecordingMessage const&) = default;
+
+  void SetOutputDirectory(const std::string& output_directory) {
+    output_directory_ = output_directory;
+  }
+  std::string GetOutputDirectory() const { return output_directory_; }
+
+  void SetEncoder(const std::string& encoder) { encoder_ = encoder; }
+  std::string GetEncoder() const { return encoder_; }
+
+  void SetSpeedPreset(const std::string& speed_preset) {
+    speed_preset_ = speed_preset;
+  }
+  std::string GetSpeedPreset() const { return speed_preset_; }
+
+  void SetContainer(const std::string& container) { container_ = container; }
+  std::string GetContainer() const { return container_; }
+
+  void SetBitrate(int32_t bitrate) { bitrate_ = bitrate; }
+  int32_t GetBitrate() const { return bitrate_; }
+
+  flutter::EncodableValue ToMap() {
+    flutter::EncodableMap map = {
+        {flutter::EncodableValue("outputDirectory"),
+         flutter::EncodableValue(output_directory_)},
+        {flutter::EncodableValue("encoder"), flutter::EncodableValue(encoder_)},
+        {flutter::EncodableValue("speedPreset"),
+         flutter::EncodableValue(speed_preset_)},
+        {flutter::EncodableValue("container"),
+         flutter::EncodableValue(container_)},
+        {flutter::EncodableValue("bitrate"),
+         flutter::EncodableValue(bitrate_)}};
+    return flutter::EncodableValue(map);
+  }
+
+  static VideoRecordingMessage FromMap(const flutter::EncodableValue& value) {
+    VideoRecordingMessage message;
+    if (std::holds_alternative<flutter::EncodableMap>(value)) {
+      auto map = std::get<flutter::EncodableMap>(value);
+
+      flutter::EncodableValue& output_directory =
+          map[flutter::EncodableValue("outputDirectory")];
+      if (std::holds_alternative<std::string>(output_directory)) {
+        message.SetOutputDirectory(std::get<std::string>(output_directory));
+      }
+
+      flutter::EncodableValue& encoder =
+          map[flutter::EncodableValue("encoder")];
+      if (std::holds_alternative<std::string>(encoder)) {
+        message.SetEncoder(std::get<std::string>(encoder));
+      }
+
+      flutter::EncodableValue& speed_preset =
+          map[flutter::EncodableValue("speedPreset")];
+      if (std::holds_alternative<std::string>(speed_preset)) {
+        message.SetSpeedPreset(std::get<std::string>(speed_preset));
+      }
+
+      flutter::EncodableValue& container =
+          map[flutter::EncodableValue("container")];
+      if (std::holds_alternative<std::string>(container)) {
+        message.SetContainer(std::get<std::string>(container));
+      }
+
+      flutter::EncodableValue& bitrate =
+          map[flutter::EncodableValue("bitrate")];
+      if (std::holds_alternative<int32_t>(bitrate)) {
+        message.SetBitrate(std::get<int32_t>(bitrate));
+      }
+    }
+    return message;
+  }
+
+ private:
+  std::string output_directory_;
+  std::string encoder_;
+  std::string speed_preset_ = "veryfast";
+  std::string container_ = "mp4";
+  int32_t bitrate_ = 0;
+};
+
+#endif  // PACKAGES_CAMERA_CAMERA_ELINUX_MESSAGES_VIDEO_RECORDING_MESSAGE_H_
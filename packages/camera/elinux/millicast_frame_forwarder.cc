@@ -0,0 +1,71 @@
+// Copyright 2023 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "millicast_frame_forwarder.h"
+
+#include <dlfcn.h>
+
+#include <chrono>
+#include <mutex>
+
+namespace {
+// kMillicastFrameFormatRGBA of millicast_frame_source.h.
+constexpr int kMillicastFrameFormatRGBA = 0;
+
+// The signatures of the functions in millicast_frame_source.h.
+using PushVideoFrameFunc = bool (*)(int format, int32_t width, int32_t height,
+                                    const uint8_t* const planes[3],
+                                    const int32_t strides[3],
+                                    int64_t timestamp_us);
+using IsVideoFrameSourceActiveFunc = bool (*)();
+
+struct MillicastFunctions {
+  PushVideoFrameFunc push_video_frame = nullptr;
+  IsVideoFrameSourceActiveFunc is_video_frame_source_active = nullptr;
+};
+
+// Looks up the functions once. They're null if the millicast plugin isn't
+// linked.
+const MillicastFunctions& GetMillicastFunctions() {
+  static std::once_flag once;
+  static MillicastFunctions functions;
+  std::call_once(once, [] {
+    auto push = reinterpret_cast<PushVideoFrameFunc>(
+        dlsym(RTLD_DEFAULT, "MillicastPushVideoFrame"));
+    auto is_active = reinterpret_cast<IsVideoFrameSourceActiveFunc>(
+        dlsym(RTLD_DEFAULT, "MillicastIsVideoFrameSourceActive"));
+    if (push && is_active) {
+      functions.push_video_frame = push;
+      functions.is_video_frame_source_active = is_active;
+    }
+  });
+  return functions;
+}
+}  // namespace
+
+// static
+bool MillicastFrameForwarder::IsActive() {
+  const auto& functions = GetMillicastFunctions();
+  return functions.is_video_frame_source_active &&
+         functions.is_video_frame_source_active();
+}
+
+// static
+bool MillicastFrameForwarder::PushRgbaFrame(const uint8_t* pixels,
+                                            int32_t width, int32_t height,
+                                            int32_t stride) {
+  const auto& functions = GetMillicastFunctions();
+  if (!functions.push_video_frame) {
+    return false;
+  }
+  const uint8_t* const planes[3] = {pixels, nullptr, nullptr};
+  const int32_t strides[3] = {stride, 0, 0};
+  // The same monotonic clock as the frames pushed from Dart without a
+  // timestamp.
+  auto timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                          std::chrono::steady_clock::now().time_since_epoch())
+                          .count();
+  return functions.push_video_frame(kMillicastFrameFormatRGBA, width, height,
+                                    planes, strides, timestamp_us);
+}
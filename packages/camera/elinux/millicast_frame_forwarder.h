@@ -0,0 +1,27 @@
+// Copyright 2023 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PACKAGES_CAMERA_CAMERA_ELINUX_MILLICAST_FRAME_FORWARDER_H_
+#define PACKAGES_CAMERA_CAMERA_ELINUX_MILLICAST_FRAME_FORWARDER_H_
+
+#include <cstdint>
+
+// Forwards the viewfinder frames to the custom video source of the millicast
+// plugin when it's active, so that the camera can be published without
+// copying the frames through Dart. The functions of the millicast plugin are
+// looked up with dlsym(), so this plugin doesn't depend on it and does
+// nothing when it isn't linked into the app.
+class MillicastFrameForwarder {
+ public:
+  // Returns true if the millicast plugin is linked and its custom video
+  // source is active.
+  static bool IsActive();
+
+  // Pushes an RGBA frame with |stride| bytes per row. The pixels are only
+  // read during the call. Returns false if it wasn't pushed.
+  static bool PushRgbaFrame(const uint8_t* pixels, int32_t width,
+                            int32_t height, int32_t stride);
+};
+
+#endif  // PACKAGES_CAMERA_CAMERA_ELINUX_MILLICAST_FRAME_FORWARDER_H_
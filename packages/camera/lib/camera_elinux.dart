@@ -0,0 +1,53 @@
+// Copyright 2023 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+import 'dart:ffi';
+import 'dart:isolate';
+
+import 'package:flutter/services.dart';
+
+/// Lets the eLinux implementation of `camera` wake up its platform thread.
+///
+/// The platform thread only runs the native tasks, e.g. replying to
+/// `takePicture` and `stopVideoRecording`, when it handles a message from
+/// Dart. The plugin posts to a native port when it queues a task, and a
+/// runPlatformThreadTasks message is sent back.
+class CameraElinux {
+  CameraElinux._();
+
+  static const MethodChannel _channel =
+      MethodChannel('plugins.flutter.io/camera');
+
+  /// Called by the plugin registrant when the app starts.
+  static void registerWith() {
+    final DynamicLibrary dylib;
+    try {
+      dylib = DynamicLibrary.open('libcamera_elinux_plugin.so');
+    } on ArgumentError {
+      // The tasks run when the next method call is handled.
+      return;
+    }
+    final int Function(Pointer<Void>) initializeDartApi = dylib
+        .lookup<NativeFunction<IntPtr Function(Pointer<Void>)>>(
+            'camera_elinux_initialize_dart_api')
+        .asFunction();
+    final void Function(int) setWakeupPort = dylib
+        .lookup<NativeFunction<Void Function(Int64)>>(
+            'camera_elinux_set_wakeup_port')
+        .asFunction();
+    if (initializeDartApi(NativeApi.initializeApiDLData) != 0) {
+      return;
+    }
+
+    final ReceivePort port = ReceivePort()
+      ..listen((_) => _runPlatformThreadTasks());
+    setWakeupPort(port.sendPort.nativePort);
+  }
+
+  static void _runPlatformThreadTasks() {
+    _channel
+        .invokeMethod<void>('runPlatformThreadTasks')
+        .catchError((Object error) => null);
+  }
+}
@@ -0,0 +1,410 @@
+// Copyright 2022 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures the latency and the loss of joystick events from their injection to
+// their delivery through the read path of the plugin. A virtual joystick is
+// created with uinput, so no controller is needed (/dev/uinput must be
+// writable).
+//
+// The reader delivery listens to the device with joystick_listen(), the same
+// as joystickEvents, and Dart_PostCObject_DL is replaced with a function which
+// receives the events, so they're measured when the reader thread posts them
+// to Dart. The poll delivery reads them with joystick_read_many() on a timer.
+//
+// Usage:
+// $ joystick_benchmark [--backend=js|evdev] [--delivery=reader|poll]
+//                      [--poll-interval=<ms>] [--rate=<events/s>]
+//                      [--duration=<seconds>]
+//
+// Each event moves ABS_X to a value which encodes its sequence number, so the
+// received events can be matched with their injection time.
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/uinput.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "dart_api_dl.h"
+#include "linux_joystick.h"
+
+namespace {
+constexpr int kDefaultRate = 1000;
+constexpr int kDefaultDurationSeconds = 5;
+constexpr int kDefaultPollIntervalMs = 13;
+constexpr int kReadBufferEvents = 64;
+constexpr int32_t kAxisMax = 32767;
+// The axis value of sequence number n is (n % kSequencePeriod) * kValueStep
+// - kValueOffset.
+constexpr int kSequencePeriod = 2000;
+constexpr int kValueStep = 16;
+constexpr int kValueOffset = kSequencePeriod * kValueStep / 2;
+constexpr auto kDeviceTimeout = std::chrono::seconds(3);
+constexpr auto kDrainDuration = std::chrono::milliseconds(200);
+// The port which the reader thread posts the events to. It's never a real
+// port because Dart_PostCObject_DL is replaced.
+constexpr Dart_Port_DL kReaderPort = 1;
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  std::string backend = "evdev";
+  std::string delivery = "reader";
+  int poll_interval_ms = kDefaultPollIntervalMs;
+  int rate = kDefaultRate;
+  int duration_seconds = kDefaultDurationSeconds;
+};
+
+// A joystick with a single axis and a single button created with uinput.
+class VirtualJoystick {
+ public:
+  VirtualJoystick() = default;
+  ~VirtualJoystick() {
+    if (fd_ >= 0) {
+      ioctl(fd_, UI_DEV_DESTROY);
+      close(fd_);
+    }
+  }
+
+  bool Create() {
+    fd_ = open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd_ < 0) {
+      std::cerr << "Failed to open /dev/uinput (" << errno << ")" << std::endl;
+      return false;
+    }
+
+    ioctl(fd_, UI_SET_EVBIT, EV_KEY);
+    ioctl(fd_, UI_SET_KEYBIT, BTN_SOUTH);
+    ioctl(fd_, UI_SET_EVBIT, EV_ABS);
+    ioctl(fd_, UI_SET_ABSBIT, ABS_X);
+
+    // Both the joystick driver and the evdev backend keep the values of this
+    // range as they are.
+    uinput_abs_setup abs_setup;
+    std::memset(&abs_setup, 0, sizeof(abs_setup));
+    abs_setup.code = ABS_X;
+    abs_setup.absinfo.minimum = -kAxisMax;
+    abs_setup.absinfo.maximum = kAxisMax;
+    uinput_setup setup;
+    std::memset(&setup, 0, sizeof(setup));
+    setup.id.bustype = BUS_VIRTUAL;
+    setup.id.vendor = 0x1234;
+    setup.id.product = 0x5678;
+    std::snprintf(setup.name, sizeof(setup.name), "joystick benchmark");
+    if (ioctl(fd_, UI_ABS_SETUP, &abs_setup) < 0 ||
+        ioctl(fd_, UI_DEV_SETUP, &setup) < 0 ||
+        ioctl(fd_, UI_DEV_CREATE) < 0) {
+      std::cerr << "Failed to create a uinput device (" << errno << ")"
+                << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  // Returns the device node of |prefix| ("js" or "event") of this device.
+  std::string FindDeviceNode(const std::string& prefix) {
+    char sysname[64];
+    if (ioctl(fd_, UI_GET_SYSNAME(sizeof(sysname)), sysname) < 0) {
+      return "";
+    }
+
+    auto sys_path = std::string("/sys/devices/virtual/input/") + sysname;
+    auto deadline = Clock::now() + kDeviceTimeout;
+    while (Clock::now() < deadline) {
+      auto* dir = opendir(sys_path.c_str());
+      while (dir) {
+        auto* entry = readdir(dir);
+        if (!entry) {
+          break;
+        }
+        std::string name = entry->d_name;
+        if (name.compare(0, prefix.size(), prefix) == 0) {
+          auto path = "/dev/input/" + name;
+          // Waits for udev to set the permissions.
+          if (access(path.c_str(), R_OK) == 0) {
+            closedir(dir);
+            return path;
+          }
+        }
+      }
+      if (dir) {
+        closedir(dir);
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return "";
+  }
+
+  bool MoveAxis(int32_t value) {
+    input_event events[2];
+    std::memset(events, 0, sizeof(events));
+    events[0].type = EV_ABS;
+    events[0].code = ABS_X;
+    events[0].value = value;
+    events[1].type = EV_SYN;
+    events[1].code = SYN_REPORT;
+    return write(fd_, events, sizeof(events)) == sizeof(events);
+  }
+
+ private:
+  int fd_ = -1;
+};
+
+int32_t EncodeSequence(int64_t sequence) {
+  return (sequence % kSequencePeriod) * kValueStep - kValueOffset;
+}
+
+// Returns the latest sequence number below |sent| which has the value.
+int64_t DecodeSequence(int32_t value, int64_t sent) {
+  int64_t residue =
+      ((value + kValueOffset + kValueStep / 2) / kValueStep) % kSequencePeriod;
+  auto last = sent - 1;
+  return last - ((last - residue) % kSequencePeriod + kSequencePeriod) %
+                    kSequencePeriod;
+}
+
+// Matches the delivered events with their injection times.
+class EventReceiver {
+ public:
+  EventReceiver(const std::vector<Clock::time_point>& sent_times,
+                const std::atomic<int64_t>& sent)
+      : sent_times_(sent_times),
+        sent_(sent),
+        received_(sent_times.size(), false) {}
+
+  // Prevent copying.
+  EventReceiver(EventReceiver const&) = delete;
+  EventReceiver& operator=(EventReceiver const&) = delete;
+
+  // Called with each batch of the delivered events.
+  void Receive(const js_event* events, int count) {
+    auto now = Clock::now();
+    auto sent_count = sent_.load(std::memory_order_acquire);
+    std::lock_guard<std::mutex> lock(mutex_);
+    batch_count_++;
+    for (int i = 0; i < count; i++) {
+      if (events[i].type != JS_EVENT_AXIS) {
+        continue;
+      }
+      auto sequence = DecodeSequence(events[i].value, sent_count);
+      if (sequence < 0 || received_[sequence]) {
+        continue;
+      }
+      received_[sequence] = true;
+      received_count_++;
+      latencies_us_.push_back(
+          std::chrono::duration<double, std::micro>(now -
+                                                    sent_times_[sequence])
+              .count());
+    }
+  }
+
+  int64_t GetReceivedCount() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return received_count_;
+  }
+
+  int64_t GetBatchCount() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return batch_count_;
+  }
+
+  std::vector<double> GetLatencies() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return latencies_us_;
+  }
+
+ private:
+  const std::vector<Clock::time_point>& sent_times_;
+  const std::atomic<int64_t>& sent_;
+  std::mutex mutex_;
+  std::vector<bool> received_;
+  int64_t received_count_ = 0;
+  int64_t batch_count_ = 0;
+  std::vector<double> latencies_us_;
+};
+
+// The receiver of the events posted by the reader thread.
+EventReceiver* reader_receiver = nullptr;
+
+// Replaces Dart_PostCObject_DL. Receives the messages of
+// JoystickEventReader::PostEvents(), which are [fd, events].
+bool PostToReceiver(Dart_Port_DL port, Dart_CObject* message) {
+  if (port != kReaderPort || message->type != Dart_CObject_kArray ||
+      message->value.as_array.length != 2) {
+    return false;
+  }
+  const auto* events = message->value.as_array.values[1];
+  // null is posted when the device is removed.
+  if (events->type == Dart_CObject_kTypedData && reader_receiver) {
+    reader_receiver->Receive(
+        reinterpret_cast<const js_event*>(events->value.as_typed_data.values),
+        events->value.as_typed_data.length / sizeof(js_event));
+  }
+  return true;
+}
+
+double Percentile(std::vector<double>& values, double percentile) {
+  if (values.empty()) {
+    return 0;
+  }
+  auto index = static_cast<size_t>(percentile / 100 * (values.size() - 1));
+  std::nth_element(values.begin(), values.begin() + index, values.end());
+  return values[index];
+}
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    auto value = arg.substr(arg.find('=') + 1);
+    if (arg.rfind("--backend=", 0) == 0) {
+      options.backend = value;
+    } else if (arg.rfind("--delivery=", 0) == 0) {
+      options.delivery = value;
+    } else if (arg.rfind("--poll-interval=", 0) == 0) {
+      options.poll_interval_ms = std::atoi(value.c_str());
+    } else if (arg.rfind("--rate=", 0) == 0) {
+      options.rate = std::atoi(value.c_str());
+    } else if (arg.rfind("--duration=", 0) == 0) {
+      options.duration_seconds = std::atoi(value.c_str());
+    } else {
+      return false;
+    }
+  }
+  return (options.backend == "js" || options.backend == "evdev") &&
+         (options.delivery == "reader" || options.delivery == "poll") &&
+         options.rate > 0 && options.duration_seconds > 0;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!ParseOptions(argc, argv, options)) {
+    std::cerr << "Usage: " << argv[0]
+              << " [--backend=js|evdev] [--delivery=reader|poll]"
+                 " [--poll-interval=<ms>] [--rate=<events/s>]"
+                 " [--duration=<seconds>]"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  VirtualJoystick device;
+  if (!device.Create()) {
+    return EXIT_FAILURE;
+  }
+  auto path = device.FindDeviceNode(options.backend == "js" ? "js" : "event");
+  if (path.empty()) {
+    std::cerr << "The " << options.backend << " device was not found"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  auto fd = options.backend == "js" ? joystick_open(path.c_str())
+                                    : joystick_open_evdev(path.c_str());
+  if (fd < 0) {
+    return EXIT_FAILURE;
+  }
+
+  auto total = static_cast<int64_t>(options.rate) * options.duration_seconds;
+  std::vector<Clock::time_point> sent_times(total);
+  std::atomic<int64_t> sent{0};
+  std::atomic<bool> injecting{true};
+  std::thread injector([&]() {
+    auto interval = std::chrono::nanoseconds(1000000000LL / options.rate);
+    auto next = Clock::now();
+    for (int64_t sequence = 0; sequence < total; sequence++) {
+      std::this_thread::sleep_until(next);
+      next += interval;
+      // Published before the write so that the receiver never sees an event
+      // which isn't counted yet.
+      sent_times[sequence] = Clock::now();
+      sent.store(sequence + 1, std::memory_order_release);
+      if (!device.MoveAxis(EncodeSequence(sequence))) {
+        std::cerr << "Failed to inject an event (" << errno << ")"
+                  << std::endl;
+        break;
+      }
+    }
+    injecting = false;
+  });
+
+  EventReceiver receiver(sent_times, sent);
+  auto succeeded = true;
+  if (options.delivery == "reader") {
+    reader_receiver = &receiver;
+    Dart_PostCObject_DL = PostToReceiver;
+    if (joystick_listen(fd, kReaderPort) < 0) {
+      std::cerr << "Failed to listen to the device" << std::endl;
+      succeeded = false;
+    }
+    while (succeeded && injecting) {
+      std::this_thread::sleep_for(kDrainDuration);
+    }
+    std::this_thread::sleep_for(kDrainDuration);
+    // Waits for the reader thread if it's reading the device.
+    joystick_unlisten(fd);
+  } else {
+    js_event events[kReadBufferEvents];
+    auto drain_end = Clock::time_point::max();
+    while (Clock::now() < drain_end) {
+      if (!injecting && drain_end == Clock::time_point::max()) {
+        drain_end = Clock::now() + kDrainDuration;
+      }
+      std::this_thread::sleep_for(
+          std::chrono::milliseconds(options.poll_interval_ms));
+
+      int count;
+      while ((count = joystick_read_many(fd, events, kReadBufferEvents)) > 0) {
+        receiver.Receive(events, count);
+        if (count < kReadBufferEvents) {
+          break;
+        }
+      }
+      if (count < 0) {
+        std::cerr << "Failed to read events (" << errno << ")" << std::endl;
+        break;
+      }
+    }
+  }
+  injector.join();
+  joystick_close(fd);
+  reader_receiver = nullptr;
+
+  auto sent_count = sent.load();
+  std::printf("backend: %s (%s), delivery: %s", options.backend.c_str(),
+              path.c_str(), options.delivery.c_str());
+  if (options.delivery == "poll") {
+    std::printf(" (%d ms)", options.poll_interval_ms);
+  }
+  std::printf(", rate: %d events/s, duration: %d s\n", options.rate,
+              options.duration_seconds);
+  std::printf("%10s %10s %10s %10s %10s %10s %10s %10s\n", "sent", "received",
+              "lost", "batches", "p50(us)", "p90(us)", "p99(us)", "max(us)");
+  auto received_count = receiver.GetReceivedCount();
+  auto latencies_us = receiver.GetLatencies();
+  auto max_latency = latencies_us.empty()
+                         ? 0
+                         : *std::max_element(latencies_us.begin(),
+                                             latencies_us.end());
+  std::printf("%10lld %10lld %10lld %10lld %10.1f %10.1f %10.1f %10.1f\n",
+              static_cast<long long>(sent_count),
+              static_cast<long long>(received_count),
+              static_cast<long long>(sent_count - received_count),
+              static_cast<long long>(receiver.GetBatchCount()),
+              Percentile(latencies_us, 50), Percentile(latencies_us, 90),
+              Percentile(latencies_us, 99), max_latency);
+  return succeeded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,322 @@
+// Copyright 2022 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "evdev_joystick.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <climits>
+
+#include "joystick_state.h"
+
+namespace {
+constexpr int kReadBufferEvents = 64;
+constexpr int32_t kAxisMax = 32767;
+constexpr int kBitsPerLong = sizeof(unsigned long) * CHAR_BIT;
+
+using Bits = std::vector<unsigned long>;
+
+Bits MakeBits(int count) {
+  return Bits((count + kBitsPerLong - 1) / kBitsPerLong);
+}
+
+bool TestBit(const Bits& bits, int bit) {
+  return (bits[bit / kBitsPerLong] >> (bit % kBitsPerLong)) & 1;
+}
+
+bool GetBits(int fd, unsigned long request, Bits& bits) {
+  return ioctl(fd, request, bits.data()) >= 0;
+}
+
+uint32_t ToMilliseconds(const input_event& event) {
+  return static_cast<uint32_t>(event.input_event_sec * 1000 +
+                               event.input_event_usec / 1000);
+}
+
+uint32_t GetCurrentMilliseconds() {
+  timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  return static_cast<uint32_t>(now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
+
+std::mutex& GetDevicesMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+std::unordered_map<int, std::unique_ptr<EvdevJoystick>>& GetDevices() {
+  static std::unordered_map<int, std::unique_ptr<EvdevJoystick>> devices;
+  return devices;
+}
+}  // namespace
+
+// static
+int EvdevJoystick::Open(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0) {
+    fprintf(stderr, "Failed to open %s (%d)\n", path.c_str(), errno);
+    return -1;
+  }
+  if (!HasJoystickCapabilities(fd)) {
+    fprintf(stderr, "%s is not a joystick\n", path.c_str());
+    close(fd);
+    return -1;
+  }
+
+  auto device = std::make_unique<EvdevJoystick>(fd);
+  if (!device->Initialize()) {
+    fprintf(stderr, "Failed to initialize %s (%d)\n", path.c_str(), errno);
+    close(fd);
+    return -1;
+  }
+
+  // JSIOCGAXES and JSIOCGBUTTONS fail on evdev fds, so the numbers are the
+  // ones of the mappings.
+  JoystickStateStore::GetInstance().Add(fd, device->axis_count_,
+                                        device->button_count_);
+
+  std::lock_guard<std::mutex> lock(GetDevicesMutex());
+  GetDevices()[fd] = std::move(device);
+  return fd;
+}
+
+// static
+bool EvdevJoystick::IsOpened(int fd) {
+  std::lock_guard<std::mutex> lock(GetDevicesMutex());
+  return GetDevices().count(fd) != 0;
+}
+
+// static
+int EvdevJoystick::Read(int fd, js_event* events, int max) {
+  std::lock_guard<std::mutex> lock(GetDevicesMutex());
+  auto it = GetDevices().find(fd);
+  if (it == GetDevices().end()) {
+    return -1;
+  }
+  return it->second->ReadEvents(events, max);
+}
+
+// static
+void EvdevJoystick::Remove(int fd) {
+  std::lock_guard<std::mutex> lock(GetDevicesMutex());
+  GetDevices().erase(fd);
+}
+
+// static
+bool EvdevJoystick::IsJoystick(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  auto result = HasJoystickCapabilities(fd);
+  close(fd);
+  return result;
+}
+
+// Same as the devices which joydev handles: devices with joystick axes or
+// buttons, except for accelerometers and touch devices.
+// static
+bool EvdevJoystick::HasJoystickCapabilities(int fd) {
+  auto event_bits = MakeBits(EV_CNT);
+  auto abs_bits = MakeBits(ABS_CNT);
+  auto key_bits = MakeBits(KEY_CNT);
+  auto prop_bits = MakeBits(INPUT_PROP_CNT);
+  if (!GetBits(fd, EVIOCGBIT(0, event_bits.size() * sizeof(unsigned long)),
+               event_bits) ||
+      !GetBits(fd, EVIOCGBIT(EV_ABS, abs_bits.size() * sizeof(unsigned long)),
+               abs_bits) ||
+      !GetBits(fd, EVIOCGBIT(EV_KEY, key_bits.size() * sizeof(unsigned long)),
+               key_bits) ||
+      !GetBits(fd, EVIOCGPROP(prop_bits.size() * sizeof(unsigned long)),
+               prop_bits)) {
+    return false;
+  }
+
+  if (TestBit(prop_bits, INPUT_PROP_ACCELEROMETER) ||
+      (TestBit(event_bits, EV_KEY) && TestBit(key_bits, BTN_TOUCH))) {
+    return false;
+  }
+  if (TestBit(event_bits, EV_ABS) &&
+      (TestBit(abs_bits, ABS_X) || TestBit(abs_bits, ABS_WHEEL) ||
+       TestBit(abs_bits, ABS_THROTTLE))) {
+    return true;
+  }
+  if (TestBit(event_bits, EV_KEY)) {
+    for (int code = BTN_JOYSTICK; code <= BTN_THUMBR; code++) {
+      if (TestBit(key_bits, code)) {
+        return true;
+      }
+    }
+    if (TestBit(key_bits, BTN_TRIGGER_HAPPY)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+EvdevJoystick::EvdevJoystick(int fd)
+    : fd_(fd),
+      axis_map_(ABS_CNT, -1),
+      button_map_(KEY_CNT, -1),
+      abs_info_(ABS_CNT) {}
+
+bool EvdevJoystick::Initialize() {
+  auto abs_bits = MakeBits(ABS_CNT);
+  auto key_bits = MakeBits(KEY_CNT);
+  if (!GetBits(fd_, EVIOCGBIT(EV_ABS, abs_bits.size() * sizeof(unsigned long)),
+               abs_bits) ||
+      !GetBits(fd_, EVIOCGBIT(EV_KEY, key_bits.size() * sizeof(unsigned long)),
+               key_bits)) {
+    return false;
+  }
+
+  axis_count_ = 0;
+  for (int code = 0; code < ABS_CNT; code++) {
+    if (TestBit(abs_bits, code)) {
+      axis_map_[code] = axis_count_++;
+    }
+  }
+
+  button_count_ = 0;
+  auto map_button = [&](int code) {
+    if (TestBit(key_bits, code) && button_count_ < kJoystickMaxButtons) {
+      button_map_[code] = button_count_++;
+    }
+  };
+  for (int code = BTN_MISC; code < KEY_CNT; code++) {
+    map_button(code);
+  }
+  for (int code = 0; code < BTN_MISC; code++) {
+    map_button(code);
+  }
+
+  return QueueInitialState(GetCurrentMilliseconds());
+}
+
+int EvdevJoystick::ReadEvents(js_event* events, int max) {
+  input_event buffer[kReadBufferEvents];
+  auto has_error = false;
+  while (static_cast<int>(ready_.size()) < max) {
+    auto bytes = read(fd_, buffer, sizeof(buffer));
+    if (bytes < 0 && errno == EINTR) {
+      continue;
+    }
+    if (bytes < 0) {
+      has_error = errno != EAGAIN;
+      break;
+    }
+    auto count = bytes / sizeof(input_event);
+    for (size_t i = 0; i < count; i++) {
+      HandleInputEvent(buffer[i]);
+    }
+    if (count < kReadBufferEvents) {
+      break;
+    }
+  }
+
+  // Returns the queued events first even if the read failed. The error is
+  // reported by the next call.
+  if (ready_.empty()) {
+    return has_error ? -1 : 0;
+  }
+  auto count = std::min<int>(max, ready_.size());
+  std::copy(ready_.begin(), ready_.begin() + count, events);
+  ready_.erase(ready_.begin(), ready_.begin() + count);
+  return count;
+}
+
+void EvdevJoystick::HandleInputEvent(const input_event& event) {
+  if (event.type == EV_SYN) {
+    if (event.code == SYN_DROPPED) {
+      // The events until the next SYN_REPORT are incomplete. The state is
+      // read again after it instead.
+      dropped_ = true;
+      frame_.clear();
+    } else if (event.code == SYN_REPORT) {
+      if (dropped_) {
+        dropped_ = false;
+        QueueInitialState(ToMilliseconds(event));
+      } else {
+        ready_.insert(ready_.end(), frame_.begin(), frame_.end());
+      }
+      frame_.clear();
+    }
+    return;
+  }
+  if (dropped_) {
+    return;
+  }
+
+  js_event js;
+  js.time = ToMilliseconds(event);
+  if (event.type == EV_ABS && event.code < ABS_CNT &&
+      axis_map_[event.code] >= 0) {
+    js.type = JS_EVENT_AXIS;
+    js.number = axis_map_[event.code];
+    js.value = ScaleAxis(event.code, event.value);
+    frame_.push_back(js);
+  } else if (event.type == EV_KEY && event.code < KEY_CNT &&
+             button_map_[event.code] >= 0 && event.value != 2) {
+    // 2 is an auto-repeat, which the joystick driver doesn't report.
+    js.type = JS_EVENT_BUTTON;
+    js.number = button_map_[event.code];
+    js.value = event.value ? 1 : 0;
+    frame_.push_back(js);
+  }
+}
+
+bool EvdevJoystick::QueueInitialState(uint32_t time) {
+  auto key_states = MakeBits(KEY_CNT);
+  if (!GetBits(fd_, EVIOCGKEY(key_states.size() * sizeof(unsigned long)),
+               key_states)) {
+    return false;
+  }
+
+  js_event js;
+  js.time = time;
+  for (int code = 0; code < KEY_CNT; code++) {
+    if (button_map_[code] >= 0) {
+      js.type = JS_EVENT_BUTTON | JS_EVENT_INIT;
+      js.number = button_map_[code];
+      js.value = TestBit(key_states, code) ? 1 : 0;
+      ready_.push_back(js);
+    }
+  }
+  for (int code = 0; code < ABS_CNT; code++) {
+    if (axis_map_[code] >= 0) {
+      if (ioctl(fd_, EVIOCGABS(code), &abs_info_[code]) < 0) {
+        return false;
+      }
+      js.type = JS_EVENT_AXIS | JS_EVENT_INIT;
+      js.number = axis_map_[code];
+      js.value = ScaleAxis(code, abs_info_[code].value);
+      ready_.push_back(js);
+    }
+  }
+  return true;
+}
+
+int16_t EvdevJoystick::ScaleAxis(int axis, int32_t value) const {
+  const auto& info = abs_info_[axis];
+  if (info.maximum <= info.minimum) {
+    return static_cast<int16_t>(std::clamp(value, -kAxisMax, kAxisMax));
+  }
+
+  int64_t center = (static_cast<int64_t>(info.maximum) + info.minimum) / 2;
+  int64_t half_range =
+      (static_cast<int64_t>(info.maximum) - info.minimum + 1) / 2;
+  int64_t offset = value - center;
+  if (offset >= -info.flat && offset <= info.flat) {
+    return 0;
+  }
+  int64_t scaled = offset * kAxisMax / half_range;
+  return static_cast<int16_t>(
+      std::clamp<int64_t>(scaled, -kAxisMax, kAxisMax));
+}
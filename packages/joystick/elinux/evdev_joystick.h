@@ -0,0 +1,85 @@
+// Copyright 2022 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PACKAGES_JOYSTICK_JOYSTICK_ELINUX_EVDEV_JOYSTICK_H_
+#define PACKAGES_JOYSTICK_JOYSTICK_ELINUX_EVDEV_JOYSTICK_H_
+
+#include <linux/input.h>
+#include <linux/joystick.h>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A joystick device of the evdev interface (/dev/input/eventN).
+//
+// The input_events are translated into js_events in the same way as the
+// joystick driver (joydev) does, so the devices can be used with the same APIs
+// as /dev/input/jsN:
+// - Axes and buttons are numbered in the order of their codes. Buttons from
+//   BTN_MISC come first.
+// - Axis values are scaled to [-32767, 32767] with the flat area as 0.
+// - The initial state is reported as JS_EVENT_INIT events, and again after
+//   SYN_DROPPED.
+// The events of a frame are released together when its SYN_REPORT arrives, so
+// a state is never updated with a partial frame.
+class EvdevJoystick {
+ public:
+  // Opens |path| and returns the fd, or -1 if it can't be opened or is not a
+  // joystick. The state of the fd is added to JoystickStateStore with the
+  // numbers of the mapped axes and buttons.
+  static int Open(const std::string& path);
+
+  // Returns true if |fd| was opened by Open().
+  static bool IsOpened(int fd);
+
+  // Reads up to |max| translated events. Returns the number of events, 0 if
+  // there are no pending events, or -1 on error.
+  static int Read(int fd, js_event* events, int max);
+
+  // Forgets |fd|. The fd is not closed.
+  static void Remove(int fd);
+
+  // Returns true if |path| is an evdev device which has joystick axes or
+  // buttons.
+  static bool IsJoystick(const std::string& path);
+
+  explicit EvdevJoystick(int fd);
+  ~EvdevJoystick() = default;
+
+  // Prevent copying.
+  EvdevJoystick(EvdevJoystick const&) = delete;
+  EvdevJoystick& operator=(EvdevJoystick const&) = delete;
+
+ private:
+  static bool HasJoystickCapabilities(int fd);
+
+  bool Initialize();
+  int ReadEvents(js_event* events, int max);
+  void HandleInputEvent(const input_event& event);
+  // Queues the current state of all the axes and buttons as JS_EVENT_INIT
+  // events.
+  bool QueueInitialState(uint32_t time);
+  int16_t ScaleAxis(int axis, int32_t value) const;
+
+  int fd_;
+  int axis_count_ = 0;
+  int button_count_ = 0;
+  // Code to js_event number.
+  std::vector<int> axis_map_;
+  std::vector<int> button_map_;
+  std::vector<input_absinfo> abs_info_;
+  // The events of the current frame until its SYN_REPORT.
+  std::vector<js_event> frame_;
+  // The events ready to be read.
+  std::deque<js_event> ready_;
+  // True from SYN_DROPPED until the next SYN_REPORT.
+  bool dropped_ = false;
+};
+
+#endif  // PACKAGES_JOYSTICK_JOYSTICK_ELINUX_EVDEV_JOYSTICK_H_
@@ -0,0 +1,344 @@
+// Copyright 2022 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "joystick_event_reader.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <linux/joystick.h>
+#include <stdio.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "dart_api_dl.h"
+#include "evdev_joystick.h"
+#include "joystick_state.h"
+#include "linux_joystick.h"
+
+namespace {
+constexpr int kMaxEpollEvents = 16;
+constexpr int kReadBufferEvents = 64;
+constexpr char kInputDirectory[] = "/dev/input";
+
+bool StartsWith(const std::string& str, const std::string& prefix) {
+  return str.compare(0, prefix.size(), prefix) == 0;
+}
+}  // namespace
+
+// static
+JoystickEventReader& JoystickEventReader::GetInstance() {
+  static JoystickEventReader instance;
+  return instance;
+}
+
+JoystickEventReader::~JoystickEventReader() { Stop(); }
+
+bool JoystickEventReader::Listen(int fd, int64_t port) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!reader_thread_.joinable() && !Start()) {
+    return false;
+  }
+
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.fd = fd;
+  auto op = ports_.count(fd) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+  if (epoll_ctl(epoll_fd_, op, fd, &event) < 0) {
+    fprintf(stderr, "Failed to listen to joystick fd %d (%d)\n", fd, errno);
+    return false;
+  }
+  ports_[fd] = port;
+  return true;
+}
+
+bool JoystickEventReader::Unlisten(int fd) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto erased = ports_.erase(fd) != 0;
+  if (erased) {
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+  }
+  // A read started before the fd was removed may still be in progress. It
+  // must finish before the fd is closed, or it would read a closed or reused
+  // fd and post to a port which may have been closed.
+  cv_reading_.wait(lock, [this, fd]() { return reading_fd_ != fd; });
+  return erased;
+}
+
+bool JoystickEventReader::IsListening(int fd) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return ports_.count(fd) != 0;
+}
+
+bool JoystickEventReader::WatchDevices(int64_t port) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!reader_thread_.joinable() && !Start()) {
+    return false;
+  }
+  devices_port_ = port;
+  if (inotify_fd_ >= 0) {
+    for (const auto& name : devices_) {
+      PostDeviceChange(std::string(kInputDirectory) + "/" + name, true);
+    }
+    return true;
+  }
+
+  inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_fd_ < 0) {
+    fprintf(stderr, "Failed to create an inotify instance (%d)\n", errno);
+    return false;
+  }
+  // Device nodes may be readable only after udev changes their permissions,
+  // so IN_ATTRIB is watched too.
+  if (inotify_add_watch(inotify_fd_, kInputDirectory,
+                        IN_CREATE | IN_ATTRIB | IN_DELETE | IN_MOVED_FROM |
+                            IN_MOVED_TO) < 0) {
+    fprintf(stderr, "Failed to watch %s (%d)\n", kInputDirectory, errno);
+    close(inotify_fd_);
+    inotify_fd_ = -1;
+    return false;
+  }
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.fd = inotify_fd_;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, inotify_fd_, &event);
+
+  devices_.clear();
+  auto* dir = opendir(kInputDirectory);
+  if (dir) {
+    while (auto* entry = readdir(dir)) {
+      UpdateDevice(entry->d_name, true);
+    }
+    closedir(dir);
+  }
+  return true;
+}
+
+void JoystickEventReader::UnwatchDevices() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (inotify_fd_ < 0) {
+    return;
+  }
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, inotify_fd_, nullptr);
+  close(inotify_fd_);
+  inotify_fd_ = -1;
+  devices_.clear();
+}
+
+void JoystickEventReader::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!reader_thread_.joinable()) {
+      return;
+    }
+    uint64_t value = 1;
+    if (write(wakeup_fd_, &value, sizeof(value)) < 0) {
+      fprintf(stderr, "Failed to wake up the joystick reader (%d)\n", errno);
+    }
+  }
+  reader_thread_.join();
+  UnwatchDevices();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  close(epoll_fd_);
+  close(wakeup_fd_);
+  epoll_fd_ = -1;
+  wakeup_fd_ = -1;
+  ports_.clear();
+}
+
+bool JoystickEventReader::Start() {
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd_ < 0) {
+    fprintf(stderr, "Failed to create an epoll instance (%d)\n", errno);
+    return false;
+  }
+  wakeup_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (wakeup_fd_ < 0) {
+    fprintf(stderr, "Failed to create an eventfd (%d)\n", errno);
+    close(epoll_fd_);
+    epoll_fd_ = -1;
+    return false;
+  }
+
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.fd = wakeup_fd_;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wakeup_fd_, &event);
+
+  reader_thread_ = std::thread(&JoystickEventReader::ReaderThreadMain, this);
+  return true;
+}
+
+void JoystickEventReader::ReaderThreadMain() {
+  epoll_event events[kMaxEpollEvents];
+  while (true) {
+    auto count = epoll_wait(epoll_fd_, events, kMaxEpollEvents, -1);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      fprintf(stderr, "Failed to wait for joystick events (%d)\n", errno);
+      return;
+    }
+
+    for (int i = 0; i < count; i++) {
+      auto fd = events[i].data.fd;
+      if (fd == wakeup_fd_) {
+        return;
+      }
+
+      int64_t port;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (fd == inotify_fd_) {
+          HandleDeviceChanges();
+          continue;
+        }
+        auto it = ports_.find(fd);
+        if (it == ports_.end()) {
+          continue;
+        }
+        port = it->second;
+        reading_fd_ = fd;
+      }
+
+      // Drains the pending events before handling a hang-up.
+      auto alive = ReadAndPost(fd, port) &&
+                   !(events[i].events & (EPOLLERR | EPOLLHUP));
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // The disconnection is posted only if the fd hasn't been unlistened
+        // in the meantime, as its port may have been closed then.
+        if (!alive && ports_.erase(fd)) {
+          epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+          PostEvents(fd, port, nullptr, 0);
+        }
+        reading_fd_ = -1;
+      }
+      cv_reading_.notify_all();
+    }
+  }
+}
+
+bool JoystickEventReader::ReadAndPost(int fd, int64_t port) {
+  js_event buffer[kReadBufferEvents];
+  std::vector<uint8_t> batch;
+  auto alive = true;
+  while (true) {
+    auto count = joystick_read_many(fd, buffer, kReadBufferEvents);
+    if (count <= 0) {
+      alive = count == 0;
+      break;
+    }
+    auto* data = reinterpret_cast<const uint8_t*>(buffer);
+    batch.insert(batch.end(), data, data + count * sizeof(js_event));
+    if (count < kReadBufferEvents) {
+      break;
+    }
+  }
+
+  // joystick_read_many() has applied the events to the state of |fd|.
+  if (!batch.empty()) {
+    PostEvents(fd, port, batch.data(), batch.size());
+  }
+  return alive;
+}
+
+void JoystickEventReader::PostEvents(int fd, int64_t port, const uint8_t* data,
+                                     intptr_t length) {
+  if (!Dart_PostCObject_DL) {
+    fprintf(stderr, "The Dart API is not initialized\n");
+    return;
+  }
+
+  Dart_CObject fd_object;
+  fd_object.type = Dart_CObject_kInt64;
+  fd_object.value.as_int64 = fd;
+
+  Dart_CObject events_object;
+  if (data) {
+    events_object.type = Dart_CObject_kTypedData;
+    events_object.value.as_typed_data.type = Dart_TypedData_kUint8;
+    events_object.value.as_typed_data.length = length;
+    events_object.value.as_typed_data.values = const_cast<uint8_t*>(data);
+  } else {
+    events_object.type = Dart_CObject_kNull;
+  }
+
+  Dart_CObject* values[] = {&fd_object, &events_object};
+  Dart_CObject message;
+  message.type = Dart_CObject_kArray;
+  message.value.as_array.length = 2;
+  message.value.as_array.values = values;
+  Dart_PostCObject_DL(port, &message);
+}
+
+// |mutex_| must be held.
+void JoystickEventReader::HandleDeviceChanges() {
+  alignas(inotify_event) char buffer[4096];
+  while (true) {
+    auto bytes = read(inotify_fd_, buffer, sizeof(buffer));
+    if (bytes <= 0) {
+      return;
+    }
+    for (char* p = buffer; p < buffer + bytes;) {
+      auto* event = reinterpret_cast<inotify_event*>(p);
+      if (event->len > 0) {
+        UpdateDevice(event->name,
+                     !(event->mask & (IN_DELETE | IN_MOVED_FROM)));
+      }
+      p += sizeof(inotify_event) + event->len;
+    }
+  }
+}
+
+// |mutex_| must be held.
+void JoystickEventReader::UpdateDevice(const std::string& name, bool exists) {
+  if (!StartsWith(name, "js") && !StartsWith(name, "event")) {
+    return;
+  }
+
+  auto path = std::string(kInputDirectory) + "/" + name;
+  if (!exists) {
+    if (devices_.erase(name)) {
+      PostDeviceChange(path, false);
+    }
+    return;
+  }
+  if (devices_.count(name) || access(path.c_str(), R_OK) != 0) {
+    return;
+  }
+  if (StartsWith(name, "event") && !EvdevJoystick::IsJoystick(path)) {
+    return;
+  }
+  devices_.insert(name);
+  PostDeviceChange(path, true);
+}
+
+void JoystickEventReader::PostDeviceChange(const std::string& path,
+                                           bool added) {
+  if (!Dart_PostCObject_DL) {
+    fprintf(stderr, "The Dart API is not initialized\n");
+    return;
+  }
+
+  Dart_CObject path_object;
+  path_object.type = Dart_CObject_kString;
+  path_object.value.as_string = const_cast<char*>(path.c_str());
+
+  Dart_CObject added_object;
+  added_object.type = Dart_CObject_kBool;
+  added_object.value.as_bool = added;
+
+  Dart_CObject* values[] = {&path_object, &added_object};
+  Dart_CObject message;
+  message.type = Dart_CObject_kArray;
+  message.value.as_array.length = 2;
+  message.value.as_array.values = values;
+  Dart_PostCObject_DL(devices_port_, &message);
+}
@@ -0,0 +1,85 @@
+// Copyright 2022 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PACKAGES_JOYSTICK_JOYSTICK_ELINUX_JOYSTICK_EVENT_READER_H_
+#define PACKAGES_JOYSTICK_JOYSTICK_ELINUX_JOYSTICK_EVENT_READER_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+// Reads the events of all the listened joystick devices on a single thread
+// with epoll and posts them to the Dart native port of each device.
+//
+// The events are applied to JoystickStateStore before being posted.
+//
+// Each message is a list of [fd, Uint8List], where the Uint8List is a batch of
+// js_event structs read at once. The Uint8List is null when the device was
+// disconnected or an error occurred, and the device is not listened anymore.
+//
+// It also watches /dev/input with inotify for hotplugged devices. Each message
+// is a list of [path, added].
+class JoystickEventReader {
+ public:
+  static JoystickEventReader& GetInstance();
+
+  ~JoystickEventReader();
+
+  // Prevent copying.
+  JoystickEventReader(JoystickEventReader const&) = delete;
+  JoystickEventReader& operator=(JoystickEventReader const&) = delete;
+
+  // Starts posting the events of |fd| to |port|. The reader thread is started
+  // on the first call.
+  bool Listen(int fd, int64_t port);
+
+  // Stops posting the events of |fd|. The fd is not closed. When this returns,
+  // the reader thread has finished reading |fd| and won't touch it anymore, so
+  // it can be closed.
+  bool Unlisten(int fd);
+
+  bool IsListening(int fd);
+
+  // Starts posting the joystick devices added to or removed from /dev/input to
+  // |port|. The devices which already exist are posted as added first.
+  bool WatchDevices(int64_t port);
+
+  // Stops watching /dev/input.
+  void UnwatchDevices();
+
+  // Stops the reader thread and forgets all the listened devices.
+  void Stop();
+
+ private:
+  JoystickEventReader() = default;
+
+  bool Start();
+  void ReaderThreadMain();
+  // Reads all the pending events of |fd| and posts them as one message.
+  // Returns false if the device can't be read anymore.
+  bool ReadAndPost(int fd, int64_t port);
+  void PostEvents(int fd, int64_t port, const uint8_t* data, intptr_t length);
+  void HandleDeviceChanges();
+  void UpdateDevice(const std::string& name, bool exists);
+  void PostDeviceChange(const std::string& path, bool added);
+
+  std::mutex mutex_;
+  int epoll_fd_ = -1;
+  int wakeup_fd_ = -1;
+  std::thread reader_thread_;
+  std::unordered_map<int, int64_t> ports_;
+  // The fd which the reader thread is reading without |mutex_|, or -1.
+  int reading_fd_ = -1;
+  std::condition_variable cv_reading_;
+  int inotify_fd_ = -1;
+  int64_t devices_port_ = 0;
+  // The names of the joystick devices in /dev/input.
+  std::set<std::string> devices_;
+};
+
+#endif  // PACKAGES_JOYSTICK_JOYSTICK_ELINUX_JOYSTICK_EVENT_READER_H_
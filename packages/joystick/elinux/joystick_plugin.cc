@@ -9,6 +9,8 @@
 #include <memory>
 #include <sstream>
 
+#include "joystick_event_reader.h"
+
 namespace {
 
 class JoystickPlugin : public flutter::Plugin {
@@ -29,7 +31,9 @@ void JoystickPlugin::RegisterWithRegistrar(
 
 JoystickPlugin::JoystickPlugin() {}
 
-JoystickPlugin::~JoystickPlugin() {}
+JoystickPlugin::~JoystickPlugin() {
+  JoystickEventReader::GetInstance().Stop();
+}
 
 }  // namespace
 
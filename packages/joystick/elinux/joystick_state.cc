@@ -0,0 +1,92 @@
+// Copyright 2022 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "joystick_state.h"
+
+#include <sys/ioctl.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+// static
+JoystickStateStore& JoystickStateStore::GetInstance() {
+  static JoystickStateStore instance;
+  return instance;
+}
+
+void JoystickStateStore::Add(int fd) {
+  uint8_t axis_count;
+  uint8_t button_count;
+  if (ioctl(fd, JSIOCGAXES, &axis_count) < 0) {
+    axis_count = 0;
+  }
+  if (ioctl(fd, JSIOCGBUTTONS, &button_count) < 0) {
+    button_count = 0;
+  }
+  Add(fd, axis_count, button_count);
+}
+
+void JoystickStateStore::Add(int fd, int axis_count, int button_count) {
+  joystick_state state;
+  std::memset(&state, 0, sizeof(state));
+  // The counts are 8 bits, the same as the ioctls.
+  state.axis_count = static_cast<uint8_t>(std::min(axis_count, UINT8_MAX));
+  state.button_count = static_cast<uint8_t>(std::min(button_count, UINT8_MAX));
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  states_[fd] = state;
+}
+
+void JoystickStateStore::Update(int fd, const js_event* events, int count) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = states_.find(fd);
+  if (it == states_.end()) {
+    return;
+  }
+  auto& state = it->second;
+  for (int i = 0; i < count; i++) {
+    const auto& event = events[i];
+    auto is_init = (event.type & JS_EVENT_INIT) != 0;
+    auto type = event.type & ~JS_EVENT_INIT;
+
+    // The driver sends the current state as JS_EVENT_INIT events right after
+    // opening the device. They seed the state but aren't counted.
+    if (type == JS_EVENT_AXIS && event.number < kJoystickMaxAxes) {
+      state.axes[event.number] = event.value;
+      if (!is_init) {
+        state.axis_event_count++;
+      }
+    } else if (type == JS_EVENT_BUTTON && event.number < kJoystickMaxButtons) {
+      state.buttons[event.number] = event.value ? 1 : 0;
+      if (!is_init) {
+        state.button_event_count++;
+      }
+    } else {
+      continue;
+    }
+
+    if (is_init) {
+      state.initialized = 1;
+    } else {
+      state.event_count++;
+    }
+    state.time = event.time;
+  }
+}
+
+bool JoystickStateStore::Get(int fd, joystick_state* state) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = states_.find(fd);
+  if (it == states_.end()) {
+    return false;
+  }
+  *state = it->second;
+  return true;
+}
+
+void JoystickStateStore::Remove(int fd) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  states_.erase(fd);
+}
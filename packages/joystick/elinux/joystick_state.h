@@ -0,0 +1,74 @@
+// Copyright 2022 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PACKAGES_JOYSTICK_JOYSTICK_ELINUX_JOYSTICK_STATE_H_
+#define PACKAGES_JOYSTICK_JOYSTICK_ELINUX_JOYSTICK_STATE_H_
+
+#include <linux/joystick.h>
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+// The maximum numbers of axes and buttons of the joystick driver.
+constexpr int kJoystickMaxAxes = ABS_CNT;
+constexpr int kJoystickMaxButtons = KEY_MAX - BTN_MISC + 1;
+
+// The current state of a joystick device, coalesced from its js_events. This
+// is shared with Dart as is (see JoystickState in joystick.dart).
+struct joystick_state {
+  // The timestamp of the last event in milliseconds.
+  uint32_t time;
+  // The number of events applied except for the initial state events.
+  uint32_t event_count;
+  uint32_t axis_event_count;
+  uint32_t button_event_count;
+  uint8_t axis_count;
+  uint8_t button_count;
+  // Non-zero once the initial state (JS_EVENT_INIT) has been received.
+  uint8_t initialized;
+  uint8_t reserved;
+  int16_t axes[kJoystickMaxAxes];
+  uint8_t buttons[kJoystickMaxButtons];
+};
+
+// Keeps the state of each joystick device.
+class JoystickStateStore {
+ public:
+  static JoystickStateStore& GetInstance();
+
+  // Prevent copying.
+  JoystickStateStore(JoystickStateStore const&) = delete;
+  JoystickStateStore& operator=(JoystickStateStore const&) = delete;
+
+  // Starts keeping the state of |fd|, which has just been opened. The states
+  // are created only here, so the events of an fd which has been closed, or
+  // reused by something else, never create a state.
+  void Add(int fd);
+
+  // Same as Add(int), but with the numbers of the axes and buttons given
+  // instead of queried with the ioctls of the joystick driver, which fail on
+  // the fds of the other interfaces (e.g. evdev).
+  void Add(int fd, int axis_count, int button_count);
+
+  // Applies |count| events read from |fd| to its state. Does nothing if |fd|
+  // hasn't been added.
+  void Update(int fd, const js_event* events, int count);
+
+  // Copies the state of |fd| to |state|. Returns false if |fd| hasn't been
+  // added.
+  bool Get(int fd, joystick_state* state);
+
+  // Forgets the state of |fd|. This must be called after the events of |fd|
+  // have stopped being read.
+  void Remove(int fd);
+
+ private:
+  JoystickStateStore() = default;
+
+  std::mutex mutex_;
+  std::unordered_map<int, joystick_state> states_;
+};
+
+#endif  // PACKAGES_JOYSTICK_JOYSTICK_ELINUX_JOYSTICK_STATE_H_
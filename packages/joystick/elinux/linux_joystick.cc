@@ -2,26 +2,151 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include "linux_joystick.h"
+
 #include <errno.h>
 #include <fcntl.h>
-#include <linux/joystick.h>
 #include <stdio.h>
 #include <unistd.h>
 
+#include "dart_api_dl.h"
+#include "evdev_joystick.h"
+#include "joystick_event_reader.h"
+
 extern "C" __attribute__((visibility("default"))) int joystick_open(
     const char* device) {
   int fd = open(device, O_NONBLOCK);
   if (fd < 0) {
     fprintf(stderr, "Failed to open %s (%d)\n", device, errno);
+    return fd;
   }
+  JoystickStateStore::GetInstance().Add(fd);
   return fd;
 }
 
+// Opens an evdev device (/dev/input/eventN) as a joystick. Its events are
+// translated into js_events, so the fd can be used with all the other
+// functions. Returns -1 if it's not a joystick.
+extern "C" __attribute__((visibility("default"))) int joystick_open_evdev(
+    const char* device) {
+  return EvdevJoystick::Open(device);
+}
+
+// Returns 1 if |device| is an evdev device with joystick axes or buttons.
+extern "C" __attribute__((visibility("default"))) int
+joystick_is_evdev_joystick(const char* device) {
+  return EvdevJoystick::IsJoystick(device) ? 1 : 0;
+}
+
+namespace {
+
+// Reads up to |max| pending events of |fd| with a single read, without
+// applying them to the state.
+int ReadEvents(int fd, js_event* events, int max) {
+  if (EvdevJoystick::IsOpened(fd)) {
+    return EvdevJoystick::Read(fd, events, max);
+  }
+  ssize_t bytes;
+  do {
+    bytes = read(fd, events, sizeof(*events) * max);
+  } while (bytes < 0 && errno == EINTR);
+  if (bytes < 0) {
+    return errno == EAGAIN ? 0 : -1;
+  }
+  return bytes / sizeof(*events);
+}
+
+}  // namespace
+
+// Reads one event. Returns 1 if an event is read, or -1 if there are no
+// pending events or on error. The event is applied to the state of |fd|, so
+// this can be mixed with joystick_get_state().
 extern "C" __attribute__((visibility("default"))) int joystick_read(
     int fd, js_event* ev) {
-  int bytes = read(fd, ev, sizeof(*ev));
-  if (bytes < 0) {
+  return joystick_read_many(fd, ev, 1) > 0 ? 1 : -1;
+}
+
+// Reads all the pending events up to |max| with a single read. Returns the
+// number of events read, 0 if there are no pending events, or -1 on error.
+// The events are applied to the state of |fd|, the same as joystick_read().
+extern "C" __attribute__((visibility("default"))) int joystick_read_many(
+    int fd, js_event* events, int max) {
+  if (max <= 0) {
+    return 0;
+  }
+  auto count = ReadEvents(fd, events, max);
+  if (count > 0) {
+    JoystickStateStore::GetInstance().Update(fd, events, count);
+  }
+  return count;
+}
+
+// Initializes the Dart API used to post events to native ports. |data| is
+// NativeApi.initializeApiDLData.
+extern "C" __attribute__((visibility("default"))) intptr_t
+joystick_initialize_dart_api(void* data) {
+  return Dart_InitializeApiDL(data);
+}
+
+// Starts posting the events of |fd| to the native port |port| from the reader
+// thread. Returns 0 on success or -1 on error.
+extern "C" __attribute__((visibility("default"))) int joystick_listen(
+    int fd, int64_t port) {
+  return JoystickEventReader::GetInstance().Listen(fd, port) ? 0 : -1;
+}
+
+// Stops posting the events of |fd|. This must be called before closing |fd|.
+// It waits for the reader thread if it's reading |fd|.
+extern "C" __attribute__((visibility("default"))) int joystick_unlisten(
+    int fd) {
+  return JoystickEventReader::GetInstance().Unlisten(fd) ? 0 : -1;
+}
+
+// Starts posting the joystick devices added to or removed from /dev/input to
+// the native port |port|. Returns 0 on success or -1 on error.
+extern "C" __attribute__((visibility("default"))) int joystick_watch_devices(
+    int64_t port) {
+  return JoystickEventReader::GetInstance().WatchDevices(port) ? 0 : -1;
+}
+
+// Stops watching /dev/input.
+extern "C" __attribute__((visibility("default"))) void
+joystick_unwatch_devices() {
+  JoystickEventReader::GetInstance().UnwatchDevices();
+}
+
+// Copies the current state of |fd| to |state|. If the events of |fd| are not
+// listened, the pending events are read and applied first. Returns 0 on
+// success or -1 on error, including when |fd| wasn't opened by
+// joystick_open() or joystick_open_evdev().
+extern "C" __attribute__((visibility("default"))) int joystick_get_state(
+    int fd, joystick_state* state) {
+  auto& store = JoystickStateStore::GetInstance();
+  // Doesn't read an fd which isn't a joystick opened by this library.
+  if (!store.Get(fd, state)) {
     return -1;
   }
-  return bytes == sizeof(*ev);
+  if (!JoystickEventReader::GetInstance().IsListening(fd)) {
+    js_event events[64];
+    constexpr int kMaxEvents = sizeof(events) / sizeof(events[0]);
+    // The events are applied to the state as they're read.
+    int count;
+    do {
+      count = joystick_read_many(fd, events, kMaxEvents);
+    } while (count > 0);
+    if (count < 0) {
+      return -1;
+    }
+  }
+  return store.Get(fd, state) ? 0 : -1;
+}
+
+// Stops listening to |fd|, forgets its state and closes it. The state is
+// removed after Unlisten(), which waits for the reader thread, so a read in
+// progress can't update it anymore.
+extern "C" __attribute__((visibility("default"))) int joystick_close(int fd) {
+  JoystickEventReader::GetInstance().Unlisten(fd);
+  JoystickStateStore::GetInstance().Remove(fd);
+  EvdevJoystick::Remove(fd);
+  return close(fd);
 }
@@ -0,0 +1,31 @@
+// Copyright 2022 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PACKAGES_JOYSTICK_JOYSTICK_ELINUX_LINUX_JOYSTICK_H_
+#define PACKAGES_JOYSTICK_JOYSTICK_ELINUX_LINUX_JOYSTICK_H_
+
+#include <linux/joystick.h>
+
+#include <cstdint>
+
+#include "joystick_state.h"
+
+// The FFI functions called from joystick.dart. See linux_joystick.cc for the
+// details.
+extern "C" {
+int joystick_open(const char* device);
+int joystick_open_evdev(const char* device);
+int joystick_is_evdev_joystick(const char* device);
+int joystick_read(int fd, js_event* ev);
+int joystick_read_many(int fd, js_event* events, int max);
+intptr_t joystick_initialize_dart_api(void* data);
+int joystick_listen(int fd, int64_t port);
+int joystick_unlisten(int fd);
+int joystick_watch_devices(int64_t port);
+void joystick_unwatch_devices();
+int joystick_get_state(int fd, joystick_state* state);
+int joystick_close(int fd);
+}
+
+#endif  // PACKAGES_JOYSTICK_JOYSTICK_ELINUX_LINUX_JOYSTICK_H_
@@ -1,5 +1,4 @@
 import 'dart:async';
-import 'dart:ffi';
 
 import 'package:ffi/ffi.dart';
 import 'package:flutter/material.dart';
@@ -17,6 +16,7 @@ class MyApp extends StatefulWidget {
 }
 
 class _MyAppState extends State<MyApp> {
+  StreamSubscription<List<JoystickEvent>>? _subscription;
   int _fd = -1;
   int _ev_time = 0;
   int _ev_value = 0;
@@ -33,22 +33,23 @@ class _MyAppState extends State<MyApp> {
       return;
     }
 
-    Timer.periodic(
-      const Duration(milliseconds: 13),
-      _onPolling,
-    );
+    _subscription = joystickEvents(_fd).listen(_onEvents);
   }
 
-  void _onPolling(Timer timer) {
-    final Pointer<JSEvent> pEv = malloc<JSEvent>();
-    if (joystickRead(_fd, pEv) < 0) {
-      return;
-    }
+  @override
+  void dispose() {
+    _subscription?.cancel();
+    super.dispose();
+  }
+
+  void _onEvents(List<JoystickEvent> events) {
+    // Shows the last event of the batch.
+    final JoystickEvent ev = events.last;
     setState(() {
-      _ev_time = pEv.ref.type;
-      _ev_value = pEv.ref.value;
-      _ev_type = pEv.ref.type;
-      _ev_number = pEv.ref.number;
+      _ev_time = ev.time;
+      _ev_value = ev.value;
+      _ev_type = ev.type;
+      _ev_number = ev.number;
     });
   }
 
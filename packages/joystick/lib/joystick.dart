@@ -4,7 +4,11 @@
 
 // ignore_for_file: public_member_api_docs
 
+import 'dart:async';
 import 'dart:ffi';
+import 'dart:isolate';
+import 'dart:typed_data';
+
 import 'package:ffi/ffi.dart';
 
 DynamicLibrary _dylib = DynamicLibrary.open('libjoystick_plugin.so');
@@ -44,6 +48,18 @@ final JoystickOpen joystickOpen = _dylib
     .lookup<NativeFunction<JoystickOpenNative>>('joystick_open')
     .asFunction();
 
+/// Opens an evdev device (/dev/input/eventN) as a joystick. Its events are
+/// translated into the same events as /dev/input/jsN, so the returned fd can
+/// be used with all the other functions. Returns -1 if it's not a joystick.
+final JoystickOpen joystickOpenEvdev = _dylib
+    .lookup<NativeFunction<JoystickOpenNative>>('joystick_open_evdev')
+    .asFunction();
+
+/// Returns 1 if the device is an evdev device with joystick axes or buttons.
+final JoystickOpen joystickIsEvdevJoystick = _dylib
+    .lookup<NativeFunction<JoystickOpenNative>>('joystick_is_evdev_joystick')
+    .asFunction();
+
 typedef JoystickReadNative = Int32 Function(Int32 fd, Pointer<JSEvent>);
 typedef JoystickRead = int Function(int fd, Pointer<JSEvent>);
 
@@ -52,6 +68,18 @@ final JoystickRead joystickRead = _dylib
     .lookup<NativeFunction<JoystickReadNative>>('joystick_read')
     .asFunction();
 
+typedef JoystickReadManyNative = Int32 Function(
+    Int32 fd, Pointer<JSEvent> events, Int32 max);
+typedef JoystickReadMany = int Function(
+    int fd, Pointer<JSEvent> events, int max);
+
+/// Reads all pending joystick input data up to [max] events into [events] at
+/// once. Returns the number of events read, 0 if there are no pending events,
+/// or -1 on error.
+final JoystickReadMany joystickReadMany = _dylib
+    .lookup<NativeFunction<JoystickReadManyNative>>('joystick_read_many')
+    .asFunction();
+
 /// Returns true if no events.
 bool joystickInputIsInactive(JSEvent ev) {
   return (ev.type & JS_EVENT_INIT) != 0;
@@ -71,3 +99,245 @@ bool joystickInputIsAxis(JSEvent ev) {
 bool joystickButtonIsPressed(JSEvent ev) {
   return (ev.value & 1) != 0;
 }
+
+/// The maximum number of axes. See ABS_CNT in <linux/input.h>.
+const int JOYSTICK_MAX_AXES = 0x40;
+
+/// The maximum number of buttons. See KEY_MAX and BTN_MISC in <linux/input.h>.
+const int JOYSTICK_MAX_BUTTONS = 0x200;
+
+/// The current state of a joystick device coalesced from its events.
+/// See struct joystick_state in joystick_state.h.
+class JoystickState extends Struct {
+  /// The timestamp of the last event in milliseconds.
+  @Uint32()
+  external int time;
+
+  /// The number of events applied except for the initial state events.
+  @Uint32()
+  external int eventCount;
+  @Uint32()
+  external int axisEventCount;
+  @Uint32()
+  external int buttonEventCount;
+  @Uint8()
+  external int axisCount;
+  @Uint8()
+  external int buttonCount;
+
+  /// Non-zero once the initial state of the device has been received.
+  @Uint8()
+  external int initialized;
+  @Uint8()
+  external int reserved;
+  @Array(JOYSTICK_MAX_AXES)
+  external Array<Int16> axes;
+  @Array(JOYSTICK_MAX_BUTTONS)
+  external Array<Uint8> buttons;
+}
+
+typedef JoystickGetStateNative = Int32 Function(
+    Int32 fd, Pointer<JoystickState> state);
+typedef JoystickGetState = int Function(int fd, Pointer<JoystickState> state);
+
+/// Copies the current state of the joystick device [fd] to [state]. The
+/// pending events are read first unless they are listened by
+/// [joystickEvents]. Returns 0 on success or -1 on error.
+///
+/// Allocate [state] once and call this every frame instead of handling each
+/// event when only the current state is needed.
+final JoystickGetState joystickGetState = _dylib
+    .lookup<NativeFunction<JoystickGetStateNative>>('joystick_get_state')
+    .asFunction();
+
+typedef JoystickCloseNative = Int32 Function(Int32 fd);
+typedef JoystickClose = int Function(int fd);
+
+/// Closes the joystick device [fd] and forgets its state.
+final JoystickClose joystickClose = _dylib
+    .lookup<NativeFunction<JoystickCloseNative>>('joystick_close')
+    .asFunction();
+
+/// A joystick event delivered by [joystickEvents]. The fields are the same as
+/// [JSEvent], but it doesn't need native memory.
+class JoystickEvent {
+  const JoystickEvent(this.time, this.value, this.type, this.number);
+
+  /// The size of struct js_event.
+  static const int size = 8;
+
+  /// The event timestamp in milliseconds.
+  final int time;
+  final int value;
+  final int type;
+  final int number;
+
+  bool get isInit => (type & JS_EVENT_INIT) != 0;
+  bool get isButton => (type & JS_EVENT_BUTTON) != 0;
+  bool get isAxis => (type & JS_EVENT_AXIS) != 0;
+  bool get isPressed => (value & 1) != 0;
+}
+
+typedef JoystickInitializeDartApiNative = IntPtr Function(Pointer<Void>);
+typedef JoystickInitializeDartApi = int Function(Pointer<Void>);
+
+final JoystickInitializeDartApi _joystickInitializeDartApi = _dylib
+    .lookup<NativeFunction<JoystickInitializeDartApiNative>>(
+        'joystick_initialize_dart_api')
+    .asFunction();
+
+typedef JoystickListenNative = Int32 Function(Int32 fd, Int64 port);
+typedef JoystickListen = int Function(int fd, int port);
+
+final JoystickListen _joystickListen = _dylib
+    .lookup<NativeFunction<JoystickListenNative>>('joystick_listen')
+    .asFunction();
+
+typedef JoystickUnlistenNative = Int32 Function(Int32 fd);
+typedef JoystickUnlisten = int Function(int fd);
+
+final JoystickUnlisten _joystickUnlisten = _dylib
+    .lookup<NativeFunction<JoystickUnlistenNative>>('joystick_unlisten')
+    .asFunction();
+
+bool _isDartApiInitialized = false;
+
+bool _initializeDartApi() {
+  if (!_isDartApiInitialized) {
+    _isDartApiInitialized =
+        _joystickInitializeDartApi(NativeApi.initializeApiDLData) == 0;
+  }
+  return _isDartApiInitialized;
+}
+
+/// Returns a stream of the events of the joystick device [fd] opened by
+/// [joystickOpen].
+///
+/// The events are read by a native thread as soon as they arrive and are
+/// delivered in batches, so no polling is needed. The stream is closed when
+/// the device is disconnected. Cancel the subscription before closing [fd].
+Stream<List<JoystickEvent>> joystickEvents(int fd) {
+  late StreamController<List<JoystickEvent>> controller;
+  ReceivePort? port;
+
+  void stop() {
+    port?.close();
+    port = null;
+  }
+
+  controller = StreamController<List<JoystickEvent>>(
+    onListen: () {
+      if (!_initializeDartApi()) {
+        controller.addError(StateError('Failed to initialize the Dart API'));
+        controller.close();
+        return;
+      }
+
+      port = ReceivePort();
+      port!.listen((dynamic message) {
+        final Uint8List? data = (message as List<dynamic>)[1] as Uint8List?;
+        if (data == null) {
+          stop();
+          controller.close();
+          return;
+        }
+        controller.add(_parseEvents(data));
+      });
+      if (_joystickListen(fd, port!.sendPort.nativePort) < 0) {
+        stop();
+        controller.addError(StateError('Failed to listen to $fd'));
+        controller.close();
+      }
+    },
+    onCancel: () {
+      if (port != null) {
+        _joystickUnlisten(fd);
+        stop();
+      }
+    },
+  );
+  return controller.stream;
+}
+
+List<JoystickEvent> _parseEvents(Uint8List data) {
+  final ByteData bytes = ByteData.sublistView(data);
+  final int count = data.length ~/ JoystickEvent.size;
+  return List<JoystickEvent>.generate(count, (int i) {
+    final int offset = i * JoystickEvent.size;
+    return JoystickEvent(
+      bytes.getUint32(offset, Endian.host),
+      bytes.getInt16(offset + 4, Endian.host),
+      bytes.getUint8(offset + 6),
+      bytes.getUint8(offset + 7),
+    );
+  });
+}
+
+/// A joystick device added to or removed from /dev/input.
+class JoystickDeviceChange {
+  const JoystickDeviceChange(this.path, this.added);
+
+  /// The path of the device. /dev/input/jsN devices can be opened by
+  /// [joystickOpen], and /dev/input/eventN devices by [joystickOpenEvdev].
+  final String path;
+  final bool added;
+
+  bool get isEvdev => path.startsWith('/dev/input/event');
+}
+
+typedef JoystickWatchDevicesNative = Int32 Function(Int64 port);
+typedef JoystickWatchDevices = int Function(int port);
+
+final JoystickWatchDevices _joystickWatchDevices = _dylib
+    .lookup<NativeFunction<JoystickWatchDevicesNative>>(
+        'joystick_watch_devices')
+    .asFunction();
+
+typedef JoystickUnwatchDevicesNative = Void Function();
+typedef JoystickUnwatchDevices = void Function();
+
+final JoystickUnwatchDevices _joystickUnwatchDevices = _dylib
+    .lookup<NativeFunction<JoystickUnwatchDevicesNative>>(
+        'joystick_unwatch_devices')
+    .asFunction();
+
+/// Returns a stream of the joystick devices added to or removed from
+/// /dev/input. The devices which already exist are reported as added first.
+///
+/// Both the /dev/input/jsN and the /dev/input/eventN devices of a joystick are
+/// reported. Only one stream can be listened at a time.
+Stream<JoystickDeviceChange> joystickDeviceChanges() {
+  late StreamController<JoystickDeviceChange> controller;
+  ReceivePort? port;
+
+  controller = StreamController<JoystickDeviceChange>(
+    onListen: () {
+      if (!_initializeDartApi()) {
+        controller.addError(StateError('Failed to initialize the Dart API'));
+        controller.close();
+        return;
+      }
+
+      port = ReceivePort();
+      port!.listen((dynamic message) {
+        final List<dynamic> change = message as List<dynamic>;
+        controller.add(
+            JoystickDeviceChange(change[0] as String, change[1] as bool));
+      });
+      if (_joystickWatchDevices(port!.sendPort.nativePort) < 0) {
+        port?.close();
+        port = null;
+        controller.addError(StateError('Failed to watch /dev/input'));
+        controller.close();
+      }
+    },
+    onCancel: () {
+      if (port != null) {
+        _joystickUnwatchDevices();
+        port?.close();
+        port = null;
+      }
+    },
+  );
+  return controller.stream;
+}
@@ -0,0 +1,89 @@
+// Copyright 2023 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "adaptive_bitrate_controller.h"
+
+#include <algorithm>
+
+namespace {
+constexpr double kHighLoss = 0.1;
+constexpr double kLowLoss = 0.02;
+constexpr double kRttIncreaseFactor = 2.0;
+constexpr double kDecreaseFactor = 0.85;
+// The increase per step, as a fraction of the maximum.
+constexpr double kIncreaseStep = 0.05;
+constexpr int kStableReports = 5;
+constexpr auto kDecreaseInterval = std::chrono::seconds(2);
+}  // namespace
+
+void AdaptiveBitrateController::Configure(int min_kbps, int max_kbps) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  max_kbps_ = std::max(max_kbps, 0);
+  min_kbps_ = std::clamp(min_kbps, 0, max_kbps_);
+  target_kbps_ = max_kbps_;
+  ResetHistoryLocked();
+}
+
+bool AdaptiveBitrateController::IsEnabled() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return max_kbps_ > 0;
+}
+
+void AdaptiveBitrateController::ResetHistory() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ResetHistoryLocked();
+}
+
+void AdaptiveBitrateController::ResetHistoryLocked() {
+  min_round_trip_time_ms_.reset();
+  stable_reports_ = 0;
+  last_decrease_.reset();
+}
+
+std::optional<int> AdaptiveBitrateController::Update(
+    const PublisherStatsSample& sample, Clock::time_point time) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (max_kbps_ <= 0) {
+    return std::nullopt;
+  }
+
+  auto congested = false;
+  if (sample.fraction_lost && *sample.fraction_lost > kHighLoss) {
+    congested = true;
+  }
+  if (sample.round_trip_time_ms) {
+    auto rtt = *sample.round_trip_time_ms;
+    if (min_round_trip_time_ms_ &&
+        rtt > *min_round_trip_time_ms_ * kRttIncreaseFactor) {
+      congested = true;
+    }
+    min_round_trip_time_ms_ =
+        std::min(min_round_trip_time_ms_.value_or(rtt), rtt);
+  }
+
+  auto target = target_kbps_;
+  if (congested) {
+    stable_reports_ = 0;
+    // The effect of a decrease shows up in the reports after a while, so the
+    // reports until then don't decrease it again.
+    if (!last_decrease_ || time - *last_decrease_ >= kDecreaseInterval) {
+      target = std::max(min_kbps_,
+                        static_cast<int>(target_kbps_ * kDecreaseFactor));
+      last_decrease_ = time;
+    }
+  } else if (sample.fraction_lost && *sample.fraction_lost <= kLowLoss) {
+    if (++stable_reports_ >= kStableReports) {
+      stable_reports_ = 0;
+      target = std::min(
+          max_kbps_,
+          target_kbps_ + std::max(1, static_cast<int>(max_kbps_ * kIncreaseStep)));
+    }
+  }
+
+  if (target == target_kbps_) {
+    return std::nullopt;
+  }
+  target_kbps_ = target;
+  return target;
+}
@@ -0,0 +1,64 @@
+// Copyright 2023 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PACKAGES_MILLICAST_MILLICAST_ELINUX_ADAPTIVE_BITRATE_CONTROLLER_H_
+#define PACKAGES_MILLICAST_MILLICAST_ELINUX_ADAPTIVE_BITRATE_CONTROLLER_H_
+
+#include <chrono>
+#include <mutex>
+#include <optional>
+
+#include "publisher_stats.h"
+
+// Steps the maximum bitrate of the publisher down while the receiver reports
+// congestion, and back up while it doesn't, so that a constrained uplink
+// degrades the quality instead of stalling.
+//
+// Congestion is a packet loss above kHighLoss or a round trip time more than
+// kRttIncreaseFactor times the lowest one seen. The target is decreased
+// multiplicatively at most once per kDecreaseInterval, and increased
+// additively after kStableReports consecutive reports without loss.
+class AdaptiveBitrateController {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  AdaptiveBitrateController() = default;
+  ~AdaptiveBitrateController() = default;
+
+  // Prevent copying.
+  AdaptiveBitrateController(AdaptiveBitrateController const&) = delete;
+  AdaptiveBitrateController& operator=(AdaptiveBitrateController const&) =
+      delete;
+
+  // Enables the control between |min_kbps| and |max_kbps|, starting from
+  // |max_kbps|. Disabled if |max_kbps| is 0.
+  void Configure(int min_kbps, int max_kbps);
+
+  // Whether the control is configured, in which case the stats reports of
+  // the publisher are needed even if no stats events are sent.
+  bool IsEnabled();
+
+  // Forgets the history of the reports, e.g. on reconnection, because the
+  // round trip times and the losses of another connection don't compare. The
+  // target is kept, so that the adaptation goes on from the maximum which the
+  // publisher keeps across the reconnection.
+  void ResetHistory();
+
+  // Returns the new target in kbps if |sample| changes it.
+  std::optional<int> Update(const PublisherStatsSample& sample,
+                            Clock::time_point time);
+
+ private:
+  void ResetHistoryLocked();
+
+  std::mutex mutex_;
+  int min_kbps_ = 0;
+  int max_kbps_ = 0;
+  int target_kbps_ = 0;
+  std::optional<double> min_round_trip_time_ms_;
+  int stable_reports_ = 0;
+  std::optional<Clock::time_point> last_decrease_;
+};
+
+#endif  // PACKAGES_MILLICAST_MILLICAST_ELINUX_ADAPTIVE_BITRATE_CONTROLLER_H_
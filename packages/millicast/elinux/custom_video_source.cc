@@ -0,0 +1,271 @@
+// Copyright 2023 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "custom_video_source.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace {
+constexpr int kBytesPerPixel = 4;
+
+// The byte offsets of R, G and B in a 4 bytes pixel.
+struct PixelLayout {
+  int r;
+  int g;
+  int b;
+};
+constexpr PixelLayout kRgbaLayout = {0, 1, 2};
+// millicast::VideoType::ARGB is in the word order of libyuv, which is B, G,
+// R, A in memory.
+constexpr PixelLayout kBgraLayout = {2, 1, 0};
+
+uint8_t Clamp(int value) {
+  return static_cast<uint8_t>(std::clamp(value, 0, 255));
+}
+
+int64_t GetMonotonicTimeUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+int GetChromaWidth(int width) { return (width + 1) / 2; }
+int GetChromaHeight(int height) { return (height + 1) / 2; }
+
+void CopyPlane(const uint8_t* src, int src_stride, uint8_t* dst,
+               int dst_stride, int row_bytes, int rows) {
+  if (src_stride == row_bytes && dst_stride == row_bytes) {
+    std::memcpy(dst, src, static_cast<size_t>(row_bytes) * rows);
+    return;
+  }
+  for (int y = 0; y < rows; y++) {
+    std::memcpy(dst + y * dst_stride, src + y * src_stride, row_bytes);
+  }
+}
+
+void ConvertPixels(const VideoFrameView& frame, const PixelLayout& src_layout,
+                   uint8_t* dst) {
+  auto row_bytes = frame.width * kBytesPerPixel;
+  for (int y = 0; y < frame.height; y++) {
+    const auto* src_row = frame.planes[0] + y * frame.strides[0];
+    auto* dst_row = dst + y * row_bytes;
+    for (int x = 0; x < frame.width; x++) {
+      const auto* src_pixel = src_row + x * kBytesPerPixel;
+      auto* dst_pixel = dst_row + x * kBytesPerPixel;
+      dst_pixel[kBgraLayout.r] = src_pixel[src_layout.r];
+      dst_pixel[kBgraLayout.g] = src_pixel[src_layout.g];
+      dst_pixel[kBgraLayout.b] = src_pixel[src_layout.b];
+      dst_pixel[3] = src_pixel[3];
+    }
+  }
+}
+
+// BT.601 limited range, as the encoders expect.
+void ConvertRgbToI420(const VideoFrameView& frame, const PixelLayout& layout,
+                      uint8_t* dst) {
+  auto chroma_width = GetChromaWidth(frame.width);
+  auto* dst_y = dst;
+  auto* dst_u = dst_y + frame.width * frame.height;
+  auto* dst_v = dst_u + chroma_width * GetChromaHeight(frame.height);
+  for (int y = 0; y < frame.height; y++) {
+    const auto* src_row = frame.planes[0] + y * frame.strides[0];
+    for (int x = 0; x < frame.width; x++) {
+      const auto* pixel = src_row + x * kBytesPerPixel;
+      int r = pixel[layout.r], g = pixel[layout.g], b = pixel[layout.b];
+      dst_y[y * frame.width + x] =
+          Clamp(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+    }
+  }
+  // The chroma is the average of each 2x2 block.
+  for (int y = 0; y < frame.height; y += 2) {
+    for (int x = 0; x < frame.width; x += 2) {
+      int r = 0, g = 0, b = 0, count = 0;
+      for (int dy = 0; dy < 2 && y + dy < frame.height; dy++) {
+        for (int dx = 0; dx < 2 && x + dx < frame.width; dx++) {
+          const auto* pixel = frame.planes[0] + (y + dy) * frame.strides[0] +
+                              (x + dx) * kBytesPerPixel;
+          r += pixel[layout.r];
+          g += pixel[layout.g];
+          b += pixel[layout.b];
+          count++;
+        }
+      }
+      r /= count;
+      g /= count;
+      b /= count;
+      auto index = (y / 2) * chroma_width + x / 2;
+      dst_u[index] = Clamp(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+      dst_v[index] = Clamp(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
+  }
+}
+
+void ConvertI420ToBgra(const VideoFrameView& frame, uint8_t* dst) {
+  for (int y = 0; y < frame.height; y++) {
+    const auto* src_y = frame.planes[0] + y * frame.strides[0];
+    const auto* src_u = frame.planes[1] + (y / 2) * frame.strides[1];
+    const auto* src_v = frame.planes[2] + (y / 2) * frame.strides[2];
+    auto* dst_row = dst + y * frame.width * kBytesPerPixel;
+    for (int x = 0; x < frame.width; x++) {
+      int c = src_y[x] - 16;
+      int d = src_u[x / 2] - 128;
+      int e = src_v[x / 2] - 128;
+      auto* pixel = dst_row + x * kBytesPerPixel;
+      pixel[kBgraLayout.r] = Clamp((298 * c + 409 * e + 128) >> 8);
+      pixel[kBgraLayout.g] = Clamp((298 * c - 100 * d - 208 * e + 128) >> 8);
+      pixel[kBgraLayout.b] = Clamp((298 * c + 516 * d + 128) >> 8);
+      pixel[3] = 255;
+    }
+  }
+}
+
+// Wraps a frame of a producer without copying it. The SDK copies the pixels
+// in the type it requests with get_buffer().
+class VideoFrameAdapter : public millicast::VideoFrame {
+ public:
+  explicit VideoFrameAdapter(const VideoFrameView& frame) : frame_(frame) {}
+  ~VideoFrameAdapter() override = default;
+
+  int width() const override { return frame_.width; }
+  int height() const override { return frame_.height; }
+  uint64_t timestamp() const override { return frame_.timestamp_us; }
+
+  millicast::VideoType frame_type() const override {
+    return frame_.format == kMillicastFrameFormatI420
+               ? millicast::VideoType::I420
+               : millicast::VideoType::ARGB;
+  }
+
+  uint32_t size(millicast::VideoType type) const override {
+    if (type == millicast::VideoType::I420) {
+      return frame_.width * frame_.height +
+             2 * GetChromaWidth(frame_.width) * GetChromaHeight(frame_.height);
+    }
+    return frame_.width * frame_.height * kBytesPerPixel;
+  }
+
+  void get_buffer(millicast::VideoType type, uint8_t* buffer) const override {
+    if (type == millicast::VideoType::I420) {
+      GetI420Buffer(buffer);
+    } else {
+      GetArgbBuffer(buffer);
+    }
+  }
+
+ private:
+  void GetI420Buffer(uint8_t* buffer) const {
+    switch (frame_.format) {
+      case kMillicastFrameFormatI420: {
+        auto chroma_width = GetChromaWidth(frame_.width);
+        auto chroma_height = GetChromaHeight(frame_.height);
+        auto* dst_u = buffer + frame_.width * frame_.height;
+        auto* dst_v = dst_u + chroma_width * chroma_height;
+        CopyPlane(frame_.planes[0], frame_.strides[0], buffer, frame_.width,
+                  frame_.width, frame_.height);
+        CopyPlane(frame_.planes[1], frame_.strides[1], dst_u, chroma_width,
+                  chroma_width, chroma_height);
+        CopyPlane(frame_.planes[2], frame_.strides[2], dst_v, chroma_width,
+                  chroma_width, chroma_height);
+        break;
+      }
+      case kMillicastFrameFormatRGBA:
+        ConvertRgbToI420(frame_, kRgbaLayout, buffer);
+        break;
+      case kMillicastFrameFormatBGRA:
+        ConvertRgbToI420(frame_, kBgraLayout, buffer);
+        break;
+    }
+  }
+
+  void GetArgbBuffer(uint8_t* buffer) const {
+    switch (frame_.format) {
+      case kMillicastFrameFormatBGRA:
+        CopyPlane(frame_.planes[0], frame_.strides[0], buffer,
+                  frame_.width * kBytesPerPixel, frame_.width * kBytesPerPixel,
+                  frame_.height);
+        break;
+      case kMillicastFrameFormatRGBA:
+        ConvertPixels(frame_, kRgbaLayout, buffer);
+        break;
+      case kMillicastFrameFormatI420:
+        ConvertI420ToBgra(frame_, buffer);
+        break;
+    }
+  }
+
+  const VideoFrameView& frame_;
+};
+
+bool IsValid(const VideoFrameView& frame) {
+  if (frame.width <= 0 || frame.height <= 0 || !frame.planes[0]) {
+    return false;
+  }
+  if (frame.format == kMillicastFrameFormatI420) {
+    return frame.planes[1] && frame.planes[2] &&
+           frame.strides[0] >= frame.width &&
+           frame.strides[1] >= GetChromaWidth(frame.width) &&
+           frame.strides[2] >= GetChromaWidth(frame.width);
+  }
+  return (frame.format == kMillicastFrameFormatRGBA ||
+          frame.format == kMillicastFrameFormatBGRA) &&
+         frame.strides[0] >= frame.width * kBytesPerPixel;
+}
+}  // namespace
+
+// static
+CustomVideoSource& CustomVideoSource::GetInstance() {
+  static CustomVideoSource instance;
+  return instance;
+}
+
+void CustomVideoSource::Attach(millicast::CustomSource::Ptr source) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  source_ = std::move(source);
+}
+
+void CustomVideoSource::Detach() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  source_ = nullptr;
+}
+
+bool CustomVideoSource::IsAttached() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return source_ != nullptr;
+}
+
+bool CustomVideoSource::PushFrame(const VideoFrameView& frame) {
+  if (!IsValid(frame)) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!source_) {
+    return false;
+  }
+  auto stamped_frame = frame;
+  if (stamped_frame.timestamp_us <= 0) {
+    stamped_frame.timestamp_us = GetMonotonicTimeUs();
+  }
+  VideoFrameAdapter adapter(stamped_frame);
+  source_->on_video_frame(adapter);
+  return true;
+}
+
+bool MillicastPushVideoFrame(MillicastFrameFormat format, int32_t width,
+                             int32_t height, const uint8_t* const planes[3],
+                             const int32_t strides[3], int64_t timestamp_us) {
+  if (!planes || !strides) {
+    return false;
+  }
+  VideoFrameView frame = {format, width, height,
+                          {planes[0], planes[1], planes[2]},
+                          {strides[0], strides[1], strides[2]},
+                          timestamp_us};
+  return CustomVideoSource::GetInstance().PushFrame(frame);
+}
+
+bool MillicastIsVideoFrameSourceActive(void) {
+  return CustomVideoSource::GetInstance().IsAttached();
+}
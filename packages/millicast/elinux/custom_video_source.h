@@ -0,0 +1,57 @@
+// Copyright 2023 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PACKAGES_MILLICAST_MILLICAST_ELINUX_CUSTOM_VIDEO_SOURCE_H_
+#define PACKAGES_MILLICAST_MILLICAST_ELINUX_CUSTOM_VIDEO_SOURCE_H_
+
+#include <millicast-sdk/media.h>
+
+#include <cstdint>
+#include <mutex>
+
+#include "include/millicast/millicast_frame_source.h"
+
+// A frame owned by its producer.
+struct VideoFrameView {
+  MillicastFrameFormat format;
+  int32_t width;
+  int32_t height;
+  const uint8_t* planes[3];
+  int32_t strides[3];
+  int64_t timestamp_us;
+};
+
+// Forwards the frames pushed by the producers in the process to the custom
+// source of the SDK, so that a video track can be published without capturing
+// a device.
+class CustomVideoSource {
+ public:
+  static CustomVideoSource& GetInstance();
+
+  // Prevent copying.
+  CustomVideoSource(CustomVideoSource const&) = delete;
+  CustomVideoSource& operator=(CustomVideoSource const&) = delete;
+
+  // Starts forwarding the frames to |source|.
+  void Attach(millicast::CustomSource::Ptr source);
+
+  // Stops forwarding. A frame being forwarded is waited for.
+  void Detach();
+
+  bool IsAttached();
+
+  // Forwards |frame| to the source. The frame is read only during the call.
+  // A frame without a timestamp (0 or less) is stamped with the current time
+  // of the monotonic clock.
+  bool PushFrame(const VideoFrameView& frame);
+
+ private:
+  CustomVideoSource() = default;
+  ~CustomVideoSource() = default;
+
+  std::mutex mutex_;
+  millicast::CustomSource::Ptr source_;
+};
+
+#endif  // PACKAGES_MILLICAST_MILLICAST_ELINUX_CUSTOM_VIDEO_SOURCE_H_
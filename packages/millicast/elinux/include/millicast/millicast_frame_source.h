@@ -0,0 +1,53 @@
+#ifndef FLUTTER_PLUGIN_MILLICAST_FRAME_SOURCE_H_
+#define FLUTTER_PLUGIN_MILLICAST_FRAME_SOURCE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "millicast_plugin.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// The pixel formats of the frames which can be pushed to the custom video
+// source.
+typedef enum {
+  // 4 bytes per pixel in R, G, B, A order, which the camera plugin produces.
+  kMillicastFrameFormatRGBA = 0,
+  // 4 bytes per pixel in B, G, R, A order.
+  kMillicastFrameFormatBGRA = 1,
+  // Planar Y, U and V, with U and V subsampled by 2 in both directions.
+  kMillicastFrameFormatI420 = 2,
+} MillicastFrameFormat;
+
+// Pushes a video frame to the custom video source, which setCustomVideoSrc
+// added to the publisher. It can be called from any thread by native frame
+// producers, such as the camera plugin or an offscreen renderer, which find it
+// with dlsym() so they don't depend on this plugin.
+//
+// |planes| and |strides| are the pointers to and the bytes per row of the
+// planes: only [0] for RGBA and BGRA, and Y, U, V for I420. The buffers are
+// only read during the call. The pixels are copied into the encoder buffer
+// directly when the format matches the one which it requests, or converted
+// while being copied otherwise.
+//
+// |timestamp_us| is the capture time in microseconds on the monotonic clock
+// (CLOCK_MONOTONIC). If it's 0 or less, the time of the call is used.
+//
+// Returns false if the custom video source is not active or the frame is
+// invalid.
+FLUTTER_PLUGIN_EXPORT bool MillicastPushVideoFrame(
+    MillicastFrameFormat format, int32_t width, int32_t height,
+    const uint8_t* const planes[3], const int32_t strides[3],
+    int64_t timestamp_us);
+
+// Returns true if the custom video source is active. Producers can skip
+// preparing frames while it's false.
+FLUTTER_PLUGIN_EXPORT bool MillicastIsVideoFrameSourceActive(void);
+
+#if defined(__cplusplus)
+}  // extern "C"
+#endif
+
+#endif  // FLUTTER_PLUGIN_MILLICAST_FRAME_SOURCE_H_
@@ -0,0 +1,139 @@
+// Copyright 2023 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "media_source_registry.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cstring>
+
+namespace {
+constexpr char kDeviceDirectory[] = "/dev";
+constexpr char kSoundDeviceDirectory[] = "/dev/snd";
+constexpr char kVideoDevicePrefix[] = "video";
+constexpr char kSoundDevicePrefix[] = "pcm";
+
+bool HasPrefix(const char* name, const char* prefix) {
+  return std::strncmp(name, prefix, std::strlen(prefix)) == 0;
+}
+
+template <typename Sources>
+typename Sources::value_type FindSource(const Sources& sources,
+                                        const std::string& name) {
+  for (const auto& source : sources) {
+    if (source && (name.empty() || source->name() == name ||
+                   source->unique_id() == name)) {
+      return source;
+    }
+  }
+  return nullptr;
+}
+}  // namespace
+
+MediaSourceRegistry::MediaSourceRegistry() {
+  inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  stop_event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (inotify_fd_ < 0 || stop_event_fd_ < 0) {
+    fprintf(stderr,
+            "Failed to watch the devices (%d). The sources are only "
+            "enumerated once.\n",
+            errno);
+    return;
+  }
+  inotify_add_watch(inotify_fd_, kDeviceDirectory, IN_CREATE | IN_DELETE);
+  inotify_add_watch(inotify_fd_, kSoundDeviceDirectory, IN_CREATE | IN_DELETE);
+  watch_thread_ = std::thread(&MediaSourceRegistry::WatchDevices, this);
+}
+
+MediaSourceRegistry::~MediaSourceRegistry() {
+  if (watch_thread_.joinable()) {
+    uint64_t value = 1;
+    if (write(stop_event_fd_, &value, sizeof(value)) < 0) {
+      fprintf(stderr, "Failed to stop the device watcher (%d)\n", errno);
+    }
+    watch_thread_.join();
+  }
+  if (inotify_fd_ >= 0) {
+    close(inotify_fd_);
+  }
+  if (stop_event_fd_ >= 0) {
+    close(stop_event_fd_);
+  }
+}
+
+MediaSourceRegistry::AudioSources MediaSourceRegistry::GetAudioSources() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!audio_sources_valid_) {
+    audio_sources_ = millicast::Media::get_audio_sources();
+    audio_sources_valid_ = true;
+  }
+  return audio_sources_;
+}
+
+MediaSourceRegistry::VideoSources MediaSourceRegistry::GetVideoSources() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!video_sources_valid_) {
+    video_sources_ = millicast::Media::get_video_sources();
+    video_sources_valid_ = true;
+  }
+  return video_sources_;
+}
+
+MediaSourceRegistry::AudioSource MediaSourceRegistry::FindAudioSource(
+    const std::string& name) {
+  return FindSource(GetAudioSources(), name);
+}
+
+MediaSourceRegistry::VideoSource MediaSourceRegistry::FindVideoSource(
+    const std::string& name) {
+  return FindSource(GetVideoSources(), name);
+}
+
+void MediaSourceRegistry::Invalidate() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  audio_sources_valid_ = false;
+  video_sources_valid_ = false;
+}
+
+void MediaSourceRegistry::WatchDevices() {
+  pollfd fds[2] = {{inotify_fd_, POLLIN, 0}, {stop_event_fd_, POLLIN, 0}};
+  alignas(inotify_event) char buffer[4096];
+  while (true) {
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      fprintf(stderr, "Failed to watch the devices (%d)\n", errno);
+      return;
+    }
+    if (fds[1].revents) {
+      return;
+    }
+
+    auto bytes = read(inotify_fd_, buffer, sizeof(buffer));
+    auto audio_changed = false;
+    auto video_changed = false;
+    for (ssize_t offset = 0; offset < bytes;) {
+      const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+      if (event->len > 0) {
+        video_changed |= HasPrefix(event->name, kVideoDevicePrefix);
+        audio_changed |= HasPrefix(event->name, kSoundDevicePrefix);
+      }
+      offset += sizeof(inotify_event) + event->len;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (audio_changed) {
+      audio_sources_valid_ = false;
+    }
+    if (video_changed) {
+      video_sources_valid_ = false;
+    }
+  }
+}
@@ -0,0 +1,59 @@
+// Copyright 2023 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PACKAGES_MILLICAST_MILLICAST_ELINUX_MEDIA_SOURCE_REGISTRY_H_
+#define PACKAGES_MILLICAST_MILLICAST_ELINUX_MEDIA_SOURCE_REGISTRY_H_
+
+#include <millicast-sdk/media.h>
+
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Caches the audio and video sources, because enumerating them takes hundreds
+// of milliseconds on devices with many ALSA devices.
+//
+// The cache is invalidated when a device node is added to or removed from
+// /dev or /dev/snd, and is refreshed by the next lookup.
+class MediaSourceRegistry {
+ public:
+  using AudioSources = decltype(millicast::Media::get_audio_sources());
+  using VideoSources = decltype(millicast::Media::get_video_sources());
+  using AudioSource = AudioSources::value_type;
+  using VideoSource = VideoSources::value_type;
+
+  MediaSourceRegistry();
+  ~MediaSourceRegistry();
+
+  // Prevent copying.
+  MediaSourceRegistry(MediaSourceRegistry const&) = delete;
+  MediaSourceRegistry& operator=(MediaSourceRegistry const&) = delete;
+
+  AudioSources GetAudioSources();
+  VideoSources GetVideoSources();
+
+  // Returns the source whose name or unique id is |name|, or the first one if
+  // |name| is empty. Returns nullptr if there is no such source.
+  AudioSource FindAudioSource(const std::string& name);
+  VideoSource FindVideoSource(const std::string& name);
+
+  // Enumerates the sources again at the next lookup.
+  void Invalidate();
+
+ private:
+  void WatchDevices();
+
+  std::mutex mutex_;
+  bool audio_sources_valid_ = false;
+  bool video_sources_valid_ = false;
+  AudioSources audio_sources_;
+  VideoSources video_sources_;
+
+  int inotify_fd_ = -1;
+  int stop_event_fd_ = -1;
+  std::thread watch_thread_;
+};
+
+#endif  // PACKAGES_MILLICAST_MILLICAST_ELINUX_MEDIA_SOURCE_REGISTRY_H_
@@ -1,16 +1,34 @@
 #include "include/millicast/millicast_plugin.h"
 
+#include <flutter/event_channel.h>
+#include <flutter/event_stream_handler_functions.h>
 #include <flutter/method_channel.h>
 #include <flutter/plugin_registrar.h>
 #include <flutter/standard_method_codec.h>
 
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <sstream>
+#include <unordered_map>
+#include <vector>
 #include <algorithm>
 
 #include <millicast-sdk/media.h>
 #include <millicast-sdk/publisher.h>
+#include <millicast-sdk/stats.h>
+
+#include "adaptive_bitrate_controller.h"
+#include "custom_video_source.h"
+#include "dart_api_dl.h"
+#include "media_source_registry.h"
+#include "publisher_connection.h"
+#include "publisher_stats.h"
 
 namespace {
 
@@ -26,6 +44,17 @@ constexpr char kMethodPrintSuppAud[] = "printSupportedAudioCodecs";
 constexpr char kMethodPrintSuppVid[] = "printSupportedVideoCodecs";
 constexpr char kMethodSetCodecs[] = "setCodecs";
 constexpr char kMethodDispose[] = "dispose";
+constexpr char kMethodSetStatsInterval[] = "setStatsInterval";
+constexpr char kMethodDisconnect[] = "disconnect";
+constexpr char kMethodSetCustomVideoSrc[] = "setCustomVideoSrc";
+constexpr char kMethodPushVideoFrame[] = "pushVideoFrame";
+constexpr char kMethodGetAudioSources[] = "getAudioSources";
+constexpr char kMethodGetVideoSources[] = "getVideoSources";
+constexpr char kMethodRefreshSources[] = "refreshSources";
+constexpr char kMethodSetPublishingProfile[] = "setPublishingProfile";
+// Called by MethodChannelMillicast when the plugin wakes it up to deliver the
+// queued events.
+constexpr char kMethodDeliverEvents[] = "deliverEvents";
 
 // Arguments
 constexpr char kArgsApiUrl[] = "api_url";
@@ -35,44 +64,485 @@ constexpr char kArgsAudioSrc[] = "audio_src";
 constexpr char kArgsVideoSrc[] = "video_src";
 constexpr char kArgsAudioCdc[] = "audio_cdc";
 constexpr char kArgsVideoCdc[] = "video_cdc";
+constexpr char kArgsIntervalMs[] = "interval_ms";
+constexpr char kArgsInitialDelayMs[] = "initial_delay_ms";
+constexpr char kArgsMaxDelayMs[] = "max_delay_ms";
+constexpr char kArgsMaxAttempts[] = "max_attempts";
+constexpr char kArgsConnectTimeoutMs[] = "connect_timeout_ms";
+constexpr char kArgsFormat[] = "format";
+constexpr char kArgsWidth[] = "width";
+constexpr char kArgsHeight[] = "height";
+constexpr char kArgsBytes[] = "bytes";
+constexpr char kArgsTimestampUs[] = "timestamp_us";
+constexpr char kArgsFps[] = "fps";
+constexpr char kArgsMaxBitrateKbps[] = "max_bitrate_kbps";
+constexpr char kArgsMinBitrateKbps[] = "min_bitrate_kbps";
+constexpr char kArgsStartBitrateKbps[] = "start_bitrate_kbps";
+constexpr char kArgsSimulcast[] = "simulcast";
+constexpr char kArgsScalabilityMode[] = "scalability_mode";
+constexpr char kArgsDegradationPreference[] = "degradation_preference";
+constexpr char kArgsAdaptiveBitrate[] = "adaptive_bitrate";
+
+// Events
+constexpr char kEventChannelName[] = "millicast/events";
+constexpr char kEventKey[] = "event";
+constexpr char kEventConnected[] = "connected";
+constexpr char kEventConnectionError[] = "connectionError";
+constexpr char kEventSignalingError[] = "signalingError";
+constexpr char kEventPublishing[] = "publishing";
+constexpr char kEventPublishingError[] = "publishingError";
+constexpr char kEventActive[] = "active";
+constexpr char kEventInactive[] = "inactive";
+constexpr char kEventViewerCount[] = "viewerCount";
+constexpr char kEventStats[] = "stats";
+constexpr char kEventState[] = "state";
+constexpr char kEventBitrate[] = "bitrate";
+
+constexpr int kDefaultStatsIntervalMs = 5000;
+
+// The native port which MethodChannelMillicast listens to, to be woken up when
+// events are queued. Set by millicast_set_wakeup_port().
+std::atomic<Dart_Port> events_wakeup_port(ILLEGAL_PORT);
+
+// Returns |value| as a double whether the SDK declares it as an optional or
+// not.
+template <typename T>
+std::optional<double> ToOptionalDouble(const std::optional<T> &value) {
+  return value ? std::optional<double>(static_cast<double>(*value))
+               : std::nullopt;
+}
+
+template <typename T>
+std::optional<double> ToOptionalDouble(const T &value) {
+  return static_cast<double>(value);
+}
+
+// Picks the values which the stats events report out of |report|.
+PublisherStatsSample GetStatsSample(const millicast::StatsReport &report) {
+  PublisherStatsSample sample;
+  for (const auto &stats : report) {
+    switch (stats->type()) {
+      case millicast::StatsType::OUTBOUND_RTP: {
+        const auto &outbound =
+            static_cast<const millicast::OutboundRtpStreamStats &>(*stats);
+        auto bytes_sent = ToOptionalDouble(outbound.bytes_sent);
+        if (bytes_sent) {
+          sample.bytes_sent =
+              sample.bytes_sent.value_or(0) + static_cast<uint64_t>(*bytes_sent);
+        }
+        if (outbound.kind == "video") {
+          auto fps = ToOptionalDouble(outbound.frames_per_second);
+          if (fps) {
+            sample.encoder_fps = fps;
+          }
+        }
+        break;
+      }
+      case millicast::StatsType::REMOTE_INBOUND_RTP: {
+        const auto &remote_inbound =
+            static_cast<const millicast::RemoteInboundRtpStreamStats &>(*stats);
+        // The round trip time is reported in seconds. The worst of the streams
+        // is taken.
+        auto rtt = ToOptionalDouble(remote_inbound.round_trip_time);
+        if (rtt) {
+          sample.round_trip_time_ms =
+              std::max(sample.round_trip_time_ms.value_or(0), *rtt * 1000);
+        }
+        auto fraction_lost = ToOptionalDouble(remote_inbound.fraction_lost);
+        if (fraction_lost) {
+          sample.fraction_lost =
+              std::max(sample.fraction_lost.value_or(0), *fraction_lost);
+        }
+        break;
+      }
+      default:
+        break;
+    }
+  }
+  return sample;
+}
+
+flutter::EncodableValue EncodeMetric(const PublisherStatsMetric &metric) {
+  if (metric.IsEmpty()) {
+    return flutter::EncodableValue();
+  }
+  return flutter::EncodableValue(flutter::EncodableMap{
+      {flutter::EncodableValue("min"), flutter::EncodableValue(metric.GetMin())},
+      {flutter::EncodableValue("avg"),
+       flutter::EncodableValue(metric.GetAverage())},
+      {flutter::EncodableValue("max"), flutter::EncodableValue(metric.GetMax())},
+  });
+}
+
+template <typename Sources>
+flutter::EncodableValue EncodeSources(const Sources &sources) {
+  flutter::EncodableList list;
+  for (const auto &source : sources) {
+    if (!source) {
+      continue;
+    }
+    list.push_back(flutter::EncodableValue(flutter::EncodableMap{
+        {flutter::EncodableValue("name"),
+         flutter::EncodableValue(source->name())},
+        {flutter::EncodableValue("id"),
+         flutter::EncodableValue(source->unique_id())},
+    }));
+  }
+  return flutter::EncodableValue(list);
+}
+
+template <typename Sources>
+void PrintSources(const char *title, const Sources &sources) {
+  std::cout << title << " : " << std::endl;
+  for (const auto &source : sources) {
+    if (source) {
+      std::cout << source->name() << " (" << source->unique_id() << ")"
+                << std::endl;
+    }
+  }
+}
+
+// Sets the capability of |source| which is the closest to the requested size
+// and frame rate. 0 is any.
+template <typename Source>
+void SelectCapability(const Source &source, int width, int height, int fps) {
+  if (width <= 0 && height <= 0 && fps <= 0) {
+    return;
+  }
+  const auto capabilities = source->capabilities();
+  auto best = capabilities.end();
+  int64_t best_distance = 0;
+  for (auto it = capabilities.begin(); it != capabilities.end(); ++it) {
+    // The size matters more than the frame rate.
+    int64_t distance =
+        (width > 0 ? std::abs(it->width - width) : 0) * 1000 +
+        (height > 0 ? std::abs(it->height - height) : 0) * 1000 +
+        (fps > 0 ? std::abs(it->fps - fps) : 0);
+    if (best == capabilities.end() || distance < best_distance) {
+      best = it;
+      best_distance = distance;
+    }
+  }
+  if (best != capabilities.end()) {
+    source->set_capability(*best);
+  }
+}
+
+const char *GetStateName(PublisherState state) {
+  switch (state) {
+    case PublisherState::kIdle:
+      return "idle";
+    case PublisherState::kConnecting:
+      return "connecting";
+    case PublisherState::kPublishing:
+      return "publishing";
+    case PublisherState::kBackoff:
+      return "backoff";
+    case PublisherState::kFailed:
+      return "failed";
+  }
+  return "idle";
+}
+
+const std::unordered_map<std::string, millicast::ScalabilityMode>
+    kScalabilityModes = {
+        {"L1T2", millicast::ScalabilityMode::L1T2},
+        {"L1T3", millicast::ScalabilityMode::L1T3},
+        {"L2T1", millicast::ScalabilityMode::L2T1},
+        {"L2T2", millicast::ScalabilityMode::L2T2},
+        {"L2T3", millicast::ScalabilityMode::L2T3},
+        {"L3T1", millicast::ScalabilityMode::L3T1},
+        {"L3T3", millicast::ScalabilityMode::L3T3},
+};
+
+const std::unordered_map<std::string, millicast::DegradationPreferences>
+    kDegradationPreferences = {
+        {"maintainFramerate",
+         millicast::DegradationPreferences::MAINTAIN_FRAMERATE},
+        {"maintainResolution",
+         millicast::DegradationPreferences::MAINTAIN_RESOLUTION},
+        {"balanced", millicast::DegradationPreferences::BALANCED},
+};
+
+class MillicastPublisherAdapter : public PublisherInterface {
+  public:
+  explicit MillicastPublisherAdapter(millicast::Publisher * publisher)
+  : m_publisher( publisher )
+  {}
+
+  bool Connect() override { return m_publisher->connect(); }
+  bool Publish() override { return m_publisher->publish(); }
+  void Disconnect() override { m_publisher->disconnect(); }
+
+  // The adapted bitrate overrides the maximum of the profile, which is kept
+  // in the options, so a later profile without a maximum doesn't read the
+  // adapted one back as its ceiling. 0 restores the maximum of the profile.
+  void SetMaxBitrate(int kbps) override {
+    std::lock_guard<std::mutex> lock(m_options_mutex);
+    m_adapted_max_bitrate_kbps =
+        kbps > 0 ? std::optional<int>(kbps) : std::nullopt;
+    ApplyOptionsLocked();
+  }
+
+  // The options are kept here so that the codecs, the profile and the
+  // bitrate adjustments are applied on top of each other.
+  void UpdateOptions(
+      const std::function<void(millicast::Publisher::Option &)> &update) {
+    std::lock_guard<std::mutex> lock(m_options_mutex);
+    update(m_options);
+    ApplyOptionsLocked();
+  }
+
+  // Updates the options of the publishing profile. The adaptation starts over
+  // from the maximum of the new profile, so the adapted bitrate is dropped.
+  void UpdateProfile(
+      const std::function<void(millicast::Publisher::Option &)> &update) {
+    std::lock_guard<std::mutex> lock(m_options_mutex);
+    update(m_options);
+    m_adapted_max_bitrate_kbps.reset();
+    ApplyOptionsLocked();
+  }
+
+  private:
+  void ApplyOptionsLocked() {
+    auto options = m_options;
+    if (m_adapted_max_bitrate_kbps) {
+      options.bitrate_settings.max_bitrate_kbps = *m_adapted_max_bitrate_kbps;
+    }
+    m_publisher->set_options(options);
+  }
+
+  millicast::Publisher * m_publisher;
+  std::mutex m_options_mutex;
+  millicast::Publisher::Option m_options;
+  std::optional<int> m_adapted_max_bitrate_kbps;
+};
+
+// Sends the events of the publisher to Dart.
+//
+// The events are raised on the threads of the SDK and on the worker of the
+// connection, but the event sink can only be used on the platform thread. So
+// Send() queues them, and Deliver() sends them on the platform thread, which
+// is called when a method call is handled. flutter-elinux doesn't let plugins
+// post tasks to the platform thread, so the first event queued wakes up
+// MethodChannelMillicast through its native port, which calls deliverEvents
+// back.
+class PublisherEventSender {
+  public:
+  PublisherEventSender() = default;
+  ~PublisherEventSender() = default;
+
+  // Called on the platform thread.
+  void SetSink(
+      std::unique_ptr<flutter::EventSink<flutter::EncodableValue>> sink) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sink_ = std::move(sink);
+    // The events queued before Dart listened are not sent.
+    events_.clear();
+  }
+
+  // Can be called from any thread.
+  void Send(const std::string &event,
+            flutter::EncodableMap values = flutter::EncodableMap()) {
+    bool wakes_up;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!sink_) {
+        return;
+      }
+      values[flutter::EncodableValue(kEventKey)] =
+          flutter::EncodableValue(event);
+      // The queue is delivered as a whole, so only the first event needs to
+      // wake up the platform thread.
+      wakes_up = events_.empty();
+      events_.push_back(flutter::EncodableValue(std::move(values)));
+    }
+
+    auto port = events_wakeup_port.load();
+    if (wakes_up && port != ILLEGAL_PORT && Dart_PostCObject_DL) {
+      Dart_CObject message;
+      message.type = Dart_CObject_kNull;
+      Dart_PostCObject_DL(port, &message);
+    }
+  }
+
+  // Sends the queued events in order. Called on the platform thread.
+  void Deliver() {
+    std::vector<flutter::EncodableValue> events;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      events.swap(events_);
+    }
+    // The sink is only replaced on this thread.
+    for (const auto &event : events) {
+      if (sink_) {
+        sink_->Success(event);
+      }
+    }
+  }
+
+  private:
+  std::mutex mutex_;
+  std::unique_ptr<flutter::EventSink<flutter::EncodableValue>> sink_;
+  std::vector<flutter::EncodableValue> events_;
+};
 
 class PubListener : public millicast::Publisher::Listener
 {
   public:
-  PubListener(millicast::Publisher * publisher)
-  : m_publisher( publisher )
+  PubListener(PublisherConnection * connection,
+              PublisherEventSender * event_sender,
+              PublisherStatsAggregator * stats_aggregator,
+              AdaptiveBitrateController * bitrate_controller)
+  : m_connection( connection ),
+    m_event_sender( event_sender ),
+    m_stats_aggregator( stats_aggregator ),
+    m_bitrate_controller( bitrate_controller )
   {}
   virtual ~PubListener() = default;
 
   void on_connected() override { 
-    if ( m_publisher )
-      m_publisher->publish(); 
+    // The counters and the congestion history of the previous connection
+    // must not be mixed. The adapted maximum bitrate is kept in the options
+    // of the publisher, which the new connection is set up with, so the
+    // adaptation goes on from it.
+    m_stats_aggregator->Reset();
+    m_bitrate_controller->ResetHistory();
+    m_event_sender->Send(kEventConnected);
+    NotifyConnection([](PublisherConnection *connection) {
+      connection->OnConnected();
+    });
+  }
+  void on_connection_error(int code, const std::string & message) override {
+    m_event_sender->Send(kEventConnectionError,
+                         {{flutter::EncodableValue("code"),
+                           flutter::EncodableValue(code)},
+                          {flutter::EncodableValue("message"),
+                           flutter::EncodableValue(message)}});
+    NotifyConnection([&message](PublisherConnection *connection) {
+      connection->OnError(message);
+    });
+  }
+  void on_signaling_error(const std::string & message) override {
+    m_event_sender->Send(kEventSignalingError,
+                         {{flutter::EncodableValue("message"),
+                           flutter::EncodableValue(message)}});
+    NotifyConnection([&message](PublisherConnection *connection) {
+      connection->OnError(message);
+    });
+  }
+  void on_publishing() override {
+    m_event_sender->Send(kEventPublishing);
+    NotifyConnection([](PublisherConnection *connection) {
+      connection->OnPublishing();
+    });
+  }
+  void on_publishing_error(const std::string & message) override {
+    m_event_sender->Send(kEventPublishingError,
+                         {{flutter::EncodableValue("message"),
+                           flutter::EncodableValue(message)}});
+    NotifyConnection([&message](PublisherConnection *connection) {
+      connection->OnError(message);
+    });
+  }
+  void on_stats_report(const millicast::StatsReport & report) override {
+    auto sample = GetStatsSample(report);
+    auto now = PublisherStatsAggregator::Clock::now();
+    auto target_kbps = m_bitrate_controller->Update(sample, now);
+    if (target_kbps) {
+      NotifyConnection([kbps = *target_kbps](PublisherConnection *connection) {
+        connection->SetMaxBitrate(kbps);
+      });
+      m_event_sender->Send(kEventBitrate,
+                           {{flutter::EncodableValue("target_kbps"),
+                             flutter::EncodableValue(*target_kbps)}});
+    }
+
+    PublisherStatsSummary summary;
+    if (!m_stats_aggregator->Add(sample, now, summary)) {
+      return;
+    }
+    m_event_sender->Send(
+        kEventStats,
+        {{flutter::EncodableValue("window_ms"),
+          flutter::EncodableValue(
+              static_cast<int64_t>(summary.window.count()))},
+         {flutter::EncodableValue("sample_count"),
+          flutter::EncodableValue(summary.sample_count)},
+         {flutter::EncodableValue("bitrate_bps"),
+          EncodeMetric(summary.bitrate_bps)},
+         {flutter::EncodableValue("round_trip_time_ms"),
+          EncodeMetric(summary.round_trip_time_ms)},
+         {flutter::EncodableValue("fraction_lost"),
+          EncodeMetric(summary.fraction_lost)},
+         {flutter::EncodableValue("encoder_fps"),
+          EncodeMetric(summary.encoder_fps)}});
+  }
+  void on_active() override { m_event_sender->Send(kEventActive); }
+  void on_inactive() override { m_event_sender->Send(kEventInactive); }
+  void on_viewer_count(int count) override {
+    m_event_sender->Send(kEventViewerCount,
+                         {{flutter::EncodableValue("count"),
+                           flutter::EncodableValue(count)}});
+  }
+
+  // Stops notifying the connection, which can be destroyed afterwards even if
+  // the publisher still calls the listener.
+  void DetachConnection() {
+    std::lock_guard<std::mutex> lock(m_connection_mutex);
+    m_connection = nullptr;
   }
-  void on_connection_error(int, const std::string &) override {}
-  void on_signaling_error(const std::string &) override {}
-  void on_publishing() override {}
-  void on_publishing_error(const std::string &) override {}
-  void on_stats_report(const millicast::StatsReport &) override {}
-  void on_active() override {}
-  void on_inactive() override {}
-  void on_viewer_count(int) override {}
 
   private:
-  millicast::Publisher * m_publisher;
+  void NotifyConnection(
+      const std::function<void(PublisherConnection *)> &notify) {
+    std::lock_guard<std::mutex> lock(m_connection_mutex);
+    if ( m_connection )
+      notify(m_connection);
+  }
+
+  std::mutex m_connection_mutex;
+  PublisherConnection * m_connection;
+  PublisherEventSender * m_event_sender;
+  PublisherStatsAggregator * m_stats_aggregator;
+  AdaptiveBitrateController * m_bitrate_controller;
 };
 
 class MillicastPlugin : public flutter::Plugin {
  public:
   static void RegisterWithRegistrar(flutter::PluginRegistrar *registrar);
 
-  MillicastPlugin();
+  MillicastPlugin(flutter::PluginRegistrar *registrar);
 
   virtual ~MillicastPlugin();
 
  private:
+  // Declared before the publisher because the listener uses them until the
+  // publisher is destroyed.
+  PublisherEventSender event_sender;
+  MediaSourceRegistry source_registry;
+  PublisherStatsAggregator stats_aggregator{
+      std::chrono::milliseconds(kDefaultStatsIntervalMs)};
+  AdaptiveBitrateController bitrate_controller;
+  std::unique_ptr < flutter::EventChannel<flutter::EncodableValue> > event_channel;
   std::unique_ptr < millicast::Publisher > publisher;
+  std::unique_ptr < MillicastPublisherAdapter > publisher_adapter;
+  std::unique_ptr < PublisherConnection > connection;
   std::unique_ptr < PubListener > listener;
 
+  // Collects the stats reports while either the stats events or the adaptive
+  // bitrate need them.
+  void UpdateStatsEnabled();
+
+  // Called on the worker of the connection. The state events are queued and
+  // delivered on the platform thread in order with the other events.
+  void SendStateEvent(PublisherState state, int attempt,
+                      std::chrono::milliseconds delay,
+                      const std::string &reason);
+
+  // Stops the connection and destroys the publisher.
+  void DisposePublisher();
+
   // Called when a method is called on this plugin's channel from Dart.
   void HandleMethodCall(
       const flutter::MethodCall<flutter::EncodableValue> &method_call,
@@ -87,7 +557,7 @@ void MillicastPlugin::RegisterWithRegistrar(
           registrar->messenger(), "millicast",
           &flutter::StandardMethodCodec::GetInstance());
 
-  auto plugin = std::make_unique<MillicastPlugin>();
+  auto plugin = std::make_unique<MillicastPlugin>(registrar);
 
   channel->SetMethodCallHandler(
       [plugin_pointer = plugin.get()](const auto &call, auto result) {
@@ -97,37 +567,108 @@ void MillicastPlugin::RegisterWithRegistrar(
   registrar->AddPlugin(std::move(plugin));
 }
 
-MillicastPlugin::MillicastPlugin() {}
+MillicastPlugin::MillicastPlugin(flutter::PluginRegistrar *registrar) {
+  event_channel =
+      std::make_unique<flutter::EventChannel<flutter::EncodableValue>>(
+          registrar->messenger(), kEventChannelName,
+          &flutter::StandardMethodCodec::GetInstance());
+  auto event_channel_handler = std::make_unique<
+      flutter::StreamHandlerFunctions<flutter::EncodableValue>>(
+      [sender = &event_sender](
+          const flutter::EncodableValue* arguments,
+          std::unique_ptr<flutter::EventSink<flutter::EncodableValue>>&&
+              events)
+          -> std::unique_ptr<
+              flutter::StreamHandlerError<flutter::EncodableValue>> {
+        sender->SetSink(std::move(events));
+        return nullptr;
+      },
+      [sender = &event_sender](const flutter::EncodableValue* arguments)
+          -> std::unique_ptr<
+              flutter::StreamHandlerError<flutter::EncodableValue>> {
+        sender->SetSink(nullptr);
+        return nullptr;
+      });
+  event_channel->SetStreamHandler(std::move(event_channel_handler));
+}
+
+MillicastPlugin::~MillicastPlugin() { DisposePublisher(); }
+
+void MillicastPlugin::SendStateEvent(PublisherState state, int attempt,
+                                     std::chrono::milliseconds delay,
+                                     const std::string &reason) {
+  event_sender.Send(kEventState,
+                    {{flutter::EncodableValue("state"),
+                      flutter::EncodableValue(GetStateName(state))},
+                     {flutter::EncodableValue("attempt"),
+                      flutter::EncodableValue(attempt)},
+                     {flutter::EncodableValue("delay_ms"),
+                      flutter::EncodableValue(
+                          static_cast<int64_t>(delay.count()))},
+                     {flutter::EncodableValue("reason"),
+                      flutter::EncodableValue(reason)}});
+}
+
+void MillicastPlugin::UpdateStatsEnabled() {
+  // The reports are not even collected when they are not needed.
+  if (publisher) {
+    publisher->enable_stats(stats_aggregator.GetInterval().count() > 0 ||
+                            bitrate_controller.IsEnabled());
+  }
+}
 
-MillicastPlugin::~MillicastPlugin() {}
+void MillicastPlugin::DisposePublisher() {
+  CustomVideoSource::GetInstance().Detach();
+  // The connection is stopped first so that the worker no longer uses the
+  // publisher.
+  if (listener) {
+    listener->DetachConnection();
+  }
+  connection.reset();
+  publisher_adapter.reset();
+  if (publisher) {
+    publisher->disconnect();
+  }
+  publisher.reset();
+  listener.reset();
+}
 
 void MillicastPlugin::HandleMethodCall(
     const flutter::MethodCall<flutter::EncodableValue> &method_call,
     std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
-  if (method_call.method_name().compare("getPlatformVersion") == 0) {
+  event_sender.Deliver();
+  if (method_call.method_name().compare(kMethodDeliverEvents) == 0) {
+    result->Success(flutter::EncodableValue());
+  } else if (method_call.method_name().compare("getPlatformVersion") == 0) {
     std::ostringstream version_stream;
     version_stream << "eLinux";
     result->Success(flutter::EncodableValue(version_stream.str()));
   } else if (method_call.method_name().compare(kMethodInit) == 0) {
+    DisposePublisher();
     publisher = millicast::Publisher::create();
-    listener = std::make_unique<PubListener>(publisher.get());
+    publisher_adapter =
+        std::make_unique<MillicastPublisherAdapter>(publisher.get());
+    connection = std::make_unique<PublisherConnection>(
+        publisher_adapter.get(),
+        [this](PublisherState state, int attempt,
+               std::chrono::milliseconds delay, const std::string &reason) {
+          SendStateEvent(state, attempt, delay, reason);
+        });
+    listener = std::make_unique<PubListener>(connection.get(), &event_sender,
+                                             &stats_aggregator,
+                                             &bitrate_controller);
 
     publisher->set_listener(listener.get());
+    UpdateStatsEnabled();
     
     result->Success(flutter::EncodableValue());
   } else if (method_call.method_name().compare(kMethodPrintAudioSrc) == 0) {
-    // auto audio_src = millicast::Media::get_audio_sources();
-    // std::cout << "Audio sources : " << std::endl;
-    // for (const auto & src : audio_src)
-    //   std::cout << src->name() << std::endl;
-    
+    PrintSources("Audio sources", source_registry.GetAudioSources());
+
     result->Success(flutter::EncodableValue());
   } else if (method_call.method_name().compare(kMethodPrintVideoSrc) == 0) {
-    // auto video_src = millicast::Media::get_video_sources();
-    // std::cout << "Video sources : " << std::endl;
-    // for (const auto & src : video_src)
-    //   std::cout << src->name() << std::endl;
-    
+    PrintSources("Video sources", source_registry.GetVideoSources());
+
     result->Success(flutter::EncodableValue());
   } else if (method_call.method_name().compare(kMethodSetСredentials) == 0) {
     if ( !method_call.arguments() ) {
@@ -172,22 +713,18 @@ void MillicastPlugin::HandleMethodCall(
     }
     
     const auto& arguments = std::get<flutter::EncodableMap>(*method_call.arguments());
-    auto audio_src = millicast::Media::get_audio_sources();
     auto audio_iter = arguments.find(flutter::EncodableValue(std::string(kArgsAudioSrc)));
     if (audio_iter == arguments.end()) {
       result->Error("Argument error",
-                    "Missing argument token");
+                    "Missing argument audio_src");
       return;
     }
 
-    // auto selected_iter = std::find_if(audio_src.begin(), audio_src.begin(), 
-    // [&](const millicast::AudioSource::Ptr src) -> bool
-    // { return src->name() == std::get<std::string>(audio_iter->second); });
-
-    // if ( selected_iter != audio_src.end() ) {
-      // auto audio_track = (*selected_iter)->start_capture();
-    if ( audio_src[0] ) {
-      auto audio_track = audio_src[0]->start_capture();
+    // An empty name selects the first source.
+    auto audio_src = source_registry.FindAudioSource(
+        std::get<std::string>(audio_iter->second));
+    if ( audio_src ) {
+      auto audio_track = audio_src->start_capture();
       publisher->add_track(audio_track);
     } else {
       result->Error("Argument error",
@@ -203,22 +740,27 @@ void MillicastPlugin::HandleMethodCall(
     }
     
     const auto& arguments = std::get<flutter::EncodableMap>(*method_call.arguments());
-    auto video_src = millicast::Media::get_video_sources();
     auto video_iter = arguments.find(flutter::EncodableValue(std::string(kArgsVideoSrc)));
     if (video_iter == arguments.end()) {
       result->Error("Argument error",
-                    "Missing argument token");
+                    "Missing argument video_src");
       return;
     }
 
-    // auto selected_iter = std::find_if(video_src.begin(), video_src.begin(), 
-    // [&](const millicast::VideoSource::Ptr src) -> bool
-    // { return src->name() == std::get<std::string>(video_iter->second); });
+    auto get_int = [&arguments](const char *key) {
+      auto iter = arguments.find(flutter::EncodableValue(std::string(key)));
+      return iter != arguments.end() && !iter->second.IsNull()
+                 ? static_cast<int>(iter->second.LongValue())
+                 : 0;
+    };
 
-    // if ( selected_iter != video_src.end() ) {
-      // auto video_track = (*selected_iter)->start_capture();
-    if ( video_src[0] ) {
-      auto video_track = video_src[0]->start_capture();
+    // An empty name selects the first source.
+    auto video_src = source_registry.FindVideoSource(
+        std::get<std::string>(video_iter->second));
+    if ( video_src ) {
+      SelectCapability(video_src, get_int(kArgsWidth), get_int(kArgsHeight),
+                       get_int(kArgsFps));
+      auto video_track = video_src->start_capture();
       publisher->add_track(video_track);
     } else {
       result->Error("Argument error",
@@ -227,6 +769,81 @@ void MillicastPlugin::HandleMethodCall(
     }
     
     result->Success(flutter::EncodableValue());
+  } else if (method_call.method_name().compare(kMethodGetAudioSources) == 0) {
+    result->Success(EncodeSources(source_registry.GetAudioSources()));
+  } else if (method_call.method_name().compare(kMethodGetVideoSources) == 0) {
+    result->Success(EncodeSources(source_registry.GetVideoSources()));
+  } else if (method_call.method_name().compare(kMethodRefreshSources) == 0) {
+    source_registry.Invalidate();
+    result->Success(flutter::EncodableValue());
+  } else if (method_call.method_name().compare(kMethodSetCustomVideoSrc) == 0) {
+    if ( !publisher ) {
+      result->Error("Invalid state", "init must be called before setCustomVideoSrc");
+      return;
+    }
+
+    // The frames are pushed by the producers in the process, so no device is
+    // captured for this track.
+    auto source = millicast::CustomSource::create();
+    auto video_track = source->start_capture();
+    publisher->add_track(video_track);
+    CustomVideoSource::GetInstance().Attach(std::move(source));
+
+    result->Success(flutter::EncodableValue());
+  } else if (method_call.method_name().compare(kMethodPushVideoFrame) == 0) {
+    if ( !method_call.arguments() ) {
+      result->Error("Argument error","No arguments were provided to push video frame call");
+      return;
+    }
+
+    const auto& arguments = std::get<flutter::EncodableMap>(*method_call.arguments());
+    auto format_iter = arguments.find(flutter::EncodableValue(std::string(kArgsFormat)));
+    auto width_iter = arguments.find(flutter::EncodableValue(std::string(kArgsWidth)));
+    auto height_iter = arguments.find(flutter::EncodableValue(std::string(kArgsHeight)));
+    auto bytes_iter = arguments.find(flutter::EncodableValue(std::string(kArgsBytes)));
+    if (format_iter == arguments.end() || width_iter == arguments.end() ||
+        height_iter == arguments.end() || bytes_iter == arguments.end()) {
+      result->Error("Argument error",
+                    "Missing argument format, width, height or bytes");
+      return;
+    }
+
+    VideoFrameView frame = {};
+    frame.format = static_cast<MillicastFrameFormat>(format_iter->second.LongValue());
+    frame.width = static_cast<int32_t>(width_iter->second.LongValue());
+    frame.height = static_cast<int32_t>(height_iter->second.LongValue());
+    // A frame without a timestamp is stamped when it's pushed.
+    auto timestamp_iter = arguments.find(flutter::EncodableValue(std::string(kArgsTimestampUs)));
+    if (timestamp_iter != arguments.end() && !timestamp_iter->second.IsNull()) {
+      frame.timestamp_us = timestamp_iter->second.LongValue();
+    }
+
+    // The planes of the frames from Dart are packed.
+    const auto& bytes = std::get<std::vector<uint8_t>>(bytes_iter->second);
+    size_t expected_size;
+    if (frame.format == kMillicastFrameFormatI420) {
+      auto chroma_width = (frame.width + 1) / 2;
+      auto luma_size = static_cast<size_t>(frame.width) * frame.height;
+      auto chroma_size = static_cast<size_t>(chroma_width) * ((frame.height + 1) / 2);
+      frame.planes[0] = bytes.data();
+      frame.planes[1] = bytes.data() + luma_size;
+      frame.planes[2] = bytes.data() + luma_size + chroma_size;
+      frame.strides[0] = frame.width;
+      frame.strides[1] = frame.strides[2] = chroma_width;
+      expected_size = luma_size + chroma_size * 2;
+    } else {
+      frame.planes[0] = bytes.data();
+      frame.strides[0] = frame.width * 4;
+      expected_size = static_cast<size_t>(frame.strides[0]) * frame.height;
+    }
+    if (frame.width <= 0 || frame.height <= 0 || bytes.size() < expected_size) {
+      result->Error("Argument error",
+                    "The size of bytes doesn't match the frame");
+      return;
+    }
+
+    result->Success(flutter::EncodableValue(
+        CustomVideoSource::GetInstance().PushFrame(frame)));
   } else if (method_call.method_name().compare(kMethodPrintSuppAud) == 0) {
     // auto audio_codecs = millicast::Client::get_supported_audio_codecs();
     
@@ -263,13 +880,15 @@ void MillicastPlugin::HandleMethodCall(
                     "Missing argument video_cdc");
       return;
     }
-    millicast::Publisher::Option options;
+    if ( !publisher_adapter ) {
+      result->Error("Invalid state", "init must be called before setCodecs");
+      return;
+    }
     
     // auto audio_codecs = millicast::Client::get_supported_audio_codecs();
     auto audio_codec_str = std::get<std::string>(audio_iter->second);
     // auto audFindIter = std::find(audio_codecs.begin(), audio_codecs.end(), audio_codec_str);
     // if (audFindIter != audio_codecs.end())
-      options.codecs.audio = audio_codec_str;
     // else {
     //   result->Error("Argument error",
     //                 "Invalid audio_cdc argument provided");
@@ -280,23 +899,150 @@ void MillicastPlugin::HandleMethodCall(
     auto video_codec_str = std::get<std::string>(video_iter->second);
     // auto vidFindIter = std::find(video_codecs.begin(), video_codecs.end(), video_codec_str);
     // if (vidFindIter != video_codecs.end() )
-      options.codecs.video = video_codec_str;
     // else {
     //   result->Error("Argument error",
     //                 "Invalid video_cdc argument provided");
     //   return;
     // }
 
-    publisher->set_options(options);
+    publisher_adapter->UpdateOptions([&](millicast::Publisher::Option &options) {
+      options.codecs.audio = audio_codec_str;
+      options.codecs.video = video_codec_str;
+    });
+
+    result->Success(flutter::EncodableValue());
+  } else if (method_call.method_name().compare(kMethodSetPublishingProfile) == 0) {
+    if ( !method_call.arguments() ) {
+      result->Error("Argument error","No arguments were provided to set publishing profile call");
+      return;
+    }
+    if ( !publisher_adapter ) {
+      result->Error("Invalid state", "init must be called before setPublishingProfile");
+      return;
+    }
+
+    const auto& arguments = std::get<flutter::EncodableMap>(*method_call.arguments());
+    auto find = [&arguments](const char *key) -> const flutter::EncodableValue * {
+      auto iter = arguments.find(flutter::EncodableValue(std::string(key)));
+      return iter != arguments.end() && !iter->second.IsNull() ? &iter->second
+                                                              : nullptr;
+    };
+
+    const auto *scalability_mode = find(kArgsScalabilityMode);
+    auto scalability_mode_iter = kScalabilityModes.end();
+    if (scalability_mode) {
+      scalability_mode_iter = kScalabilityModes.find(std::get<std::string>(*scalability_mode));
+      if (scalability_mode_iter == kScalabilityModes.end()) {
+        result->Error("Argument error",
+                      "Invalid scalability_mode argument provided");
+        return;
+      }
+    }
+    const auto *degradation = find(kArgsDegradationPreference);
+    auto degradation_iter = kDegradationPreferences.end();
+    if (degradation) {
+      degradation_iter = kDegradationPreferences.find(std::get<std::string>(*degradation));
+      if (degradation_iter == kDegradationPreferences.end()) {
+        result->Error("Argument error",
+                      "Invalid degradation_preference argument provided");
+        return;
+      }
+    }
+
+    int max_kbps = 0;
+    int min_kbps = 0;
+    publisher_adapter->UpdateProfile([&](millicast::Publisher::Option &options) {
+      if (const auto *value = find(kArgsMaxBitrateKbps)) {
+        options.bitrate_settings.max_bitrate_kbps = static_cast<int>(value->LongValue());
+      }
+      if (const auto *value = find(kArgsMinBitrateKbps)) {
+        options.bitrate_settings.min_bitrate_kbps = static_cast<int>(value->LongValue());
+      }
+      if (const auto *value = find(kArgsStartBitrateKbps)) {
+        options.bitrate_settings.start_bitrate_kbps = static_cast<int>(value->LongValue());
+      }
+      if (const auto *value = find(kArgsSimulcast)) {
+        options.simulcast = std::get<bool>(*value);
+      }
+      if (scalability_mode_iter != kScalabilityModes.end()) {
+        options.svc_mode = scalability_mode_iter->second;
+      }
+      if (degradation_iter != kDegradationPreferences.end()) {
+        options.degradation_preference = degradation_iter->second;
+      }
+      max_kbps = options.bitrate_settings.max_bitrate_kbps;
+      min_kbps = options.bitrate_settings.min_bitrate_kbps;
+    });
+
+    // The adaptation steps the maximum bitrate between the minimum and the
+    // maximum of the profile.
+    const auto *adaptive = find(kArgsAdaptiveBitrate);
+    if (adaptive && std::get<bool>(*adaptive) && max_kbps > 0) {
+      bitrate_controller.Configure(min_kbps, max_kbps);
+    } else {
+      bitrate_controller.Configure(0, 0);
+    }
+    UpdateStatsEnabled();
 
     result->Success(flutter::EncodableValue());
   } else if (method_call.method_name().compare(kMethodConnect) == 0) {
-    publisher->connect();
+    if ( !connection ) {
+      result->Error("Invalid state", "init must be called before connect");
+      return;
+    }
+
+    // Connecting, publishing and reconnecting are done by the worker of the
+    // connection, and their progress is sent as the state events.
+    ReconnectPolicy policy;
+    if ( method_call.arguments() ) {
+      const auto& arguments = std::get<flutter::EncodableMap>(*method_call.arguments());
+      auto get_ms = [&arguments](const char *key, std::chrono::milliseconds &value) {
+        auto iter = arguments.find(flutter::EncodableValue(std::string(key)));
+        if (iter != arguments.end() && !iter->second.IsNull()) {
+          value = std::chrono::milliseconds(iter->second.LongValue());
+        }
+      };
+      get_ms(kArgsInitialDelayMs, policy.initial_delay);
+      get_ms(kArgsMaxDelayMs, policy.max_delay);
+      get_ms(kArgsConnectTimeoutMs, policy.connect_timeout);
+      auto max_attempts_iter = arguments.find(flutter::EncodableValue(std::string(kArgsMaxAttempts)));
+      if (max_attempts_iter != arguments.end() && !max_attempts_iter->second.IsNull()) {
+        policy.max_attempts = static_cast<int>(max_attempts_iter->second.LongValue());
+      }
+    }
+    connection->Start(policy);
+    result->Success(flutter::EncodableValue());
+  } else if (method_call.method_name().compare(kMethodDisconnect) == 0) {
+    if (connection) {
+      connection->Stop();
+    }
+    result->Success(flutter::EncodableValue());
+  } else if (method_call.method_name().compare(kMethodSetStatsInterval) == 0) {
+    if ( !method_call.arguments() ) {
+      result->Error("Argument error","No arguments were provided to set stats interval call");
+      return;
+    }
+
+    const auto& arguments = std::get<flutter::EncodableMap>(*method_call.arguments());
+    auto interval_iter = arguments.find(flutter::EncodableValue(std::string(kArgsIntervalMs)));
+    if (interval_iter == arguments.end()) {
+      result->Error("Argument error",
+                    "Missing argument interval_ms");
+      return;
+    }
+
+    auto interval_ms = interval_iter->second.LongValue();
+    if (interval_ms < 0) {
+      result->Error("Argument error",
+                    "Invalid interval_ms argument provided");
+      return;
+    }
+    stats_aggregator.SetInterval(std::chrono::milliseconds(interval_ms));
+    UpdateStatsEnabled();
+
     result->Success(flutter::EncodableValue());
   } else if (method_call.method_name().compare(kMethodDispose) == 0) {
-    publisher->disconnect();
-    publisher.reset();
-    listener.reset();
+    DisposePublisher();
     result->Success(flutter::EncodableValue());
   } else {
     result->NotImplemented();
@@ -305,6 +1051,20 @@ void MillicastPlugin::HandleMethodCall(
 
 }  // namespace
 
+// Initializes the Dart API used to post to native ports. |data| is
+// NativeApi.initializeApiDLData.
+extern "C" __attribute__((visibility("default"))) intptr_t
+millicast_initialize_dart_api(void *data) {
+  return Dart_InitializeApiDL(data);
+}
+
+// Sets the native port which is posted a null when events are queued, or
+// ILLEGAL_PORT to stop posting.
+extern "C" __attribute__((visibility("default"))) void
+millicast_set_wakeup_port(int64_t port) {
+  events_wakeup_port = port;
+}
+
 void MillicastPluginRegisterWithRegistrar(
     FlutterDesktopPluginRegistrarRef registrar) {
   MillicastPlugin::RegisterWithRegistrar(
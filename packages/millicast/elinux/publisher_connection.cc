@@ -0,0 +1,207 @@
+// Copyright 2023 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "publisher_connection.h"
+
+#include <algorithm>
+#include <cmath>
+
+PublisherConnection::PublisherConnection(PublisherInterface* publisher,
+                                         StateHandler handler)
+    : publisher_(publisher),
+      handler_(std::move(handler)),
+      random_engine_(std::random_device()()) {
+  thread_ = std::thread(&PublisherConnection::Run, this);
+}
+
+PublisherConnection::~PublisherConnection() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    events_.push_back({Event::kStop, std::string(), 0, generation_});
+    terminated_ = true;
+  }
+  cv_.notify_one();
+  thread_.join();
+}
+
+void PublisherConnection::Start(const ReconnectPolicy& policy) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    policy_ = policy;
+  }
+  Post(Event::kStart);
+}
+
+void PublisherConnection::Stop() { Post(Event::kStop); }
+
+PublisherState PublisherConnection::GetState() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return state_;
+}
+
+void PublisherConnection::OnConnected() { Post(Event::kConnected); }
+
+void PublisherConnection::OnPublishing() { Post(Event::kPublishing); }
+
+void PublisherConnection::OnError(const std::string& reason) {
+  Post(Event::kError, reason);
+}
+
+void PublisherConnection::SetMaxBitrate(int kbps) {
+  Post(Event::kSetMaxBitrate, std::string(), kbps);
+}
+
+void PublisherConnection::Post(Event event, const std::string& reason,
+                               int value) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    events_.push_back({event, reason, value, generation_});
+  }
+  cv_.notify_one();
+}
+
+void PublisherConnection::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    if (events_.empty()) {
+      if (terminated_) {
+        break;
+      }
+      if (deadline_) {
+        if (!cv_.wait_until(lock, *deadline_,
+                            [this]() { return !events_.empty(); })) {
+          deadline_.reset();
+          HandleTimeout(lock);
+        }
+      } else {
+        cv_.wait(lock, [this]() { return !events_.empty(); });
+      }
+      continue;
+    }
+
+    auto event = events_.front();
+    events_.pop_front();
+    HandleEvent(lock, event);
+  }
+}
+
+void PublisherConnection::HandleEvent(std::unique_lock<std::mutex>& lock,
+                                      const QueuedEvent& event) {
+  auto is_notification = event.event == Event::kConnected ||
+                         event.event == Event::kPublishing ||
+                         event.event == Event::kError;
+  if (is_notification && event.generation != generation_) {
+    // A notification of an attempt which has already ended.
+    return;
+  }
+
+  switch (event.event) {
+    case Event::kStart:
+      if (state_ == PublisherState::kIdle ||
+          state_ == PublisherState::kFailed) {
+        attempt_ = 0;
+        BeginConnect(lock);
+      }
+      break;
+    case Event::kStop:
+      if (state_ != PublisherState::kIdle) {
+        EndConnection(lock);
+        SetState(PublisherState::kIdle);
+      }
+      break;
+    case Event::kConnected:
+      if (state_ == PublisherState::kConnecting) {
+        lock.unlock();
+        auto result = publisher_->Publish();
+        lock.lock();
+        if (!result && state_ == PublisherState::kConnecting) {
+          HandleFailure(lock, "Failed to start publishing");
+        }
+      }
+      break;
+    case Event::kPublishing:
+      if (state_ == PublisherState::kConnecting) {
+        deadline_.reset();
+        attempt_ = 0;
+        SetState(PublisherState::kPublishing);
+      }
+      break;
+    case Event::kError:
+      if (state_ == PublisherState::kConnecting ||
+          state_ == PublisherState::kPublishing) {
+        HandleFailure(lock, event.reason);
+      }
+      break;
+    case Event::kSetMaxBitrate:
+      lock.unlock();
+      publisher_->SetMaxBitrate(event.value);
+      lock.lock();
+      break;
+  }
+}
+
+void PublisherConnection::HandleTimeout(std::unique_lock<std::mutex>& lock) {
+  if (state_ == PublisherState::kBackoff) {
+    BeginConnect(lock);
+  } else if (state_ == PublisherState::kConnecting) {
+    HandleFailure(lock, "Timed out");
+  }
+}
+
+void PublisherConnection::BeginConnect(std::unique_lock<std::mutex>& lock) {
+  generation_++;
+  SetState(PublisherState::kConnecting);
+  deadline_ = std::chrono::steady_clock::now() + policy_.connect_timeout;
+  lock.unlock();
+  auto result = publisher_->Connect();
+  lock.lock();
+  if (!result && state_ == PublisherState::kConnecting) {
+    HandleFailure(lock, "Failed to start connecting");
+  }
+}
+
+void PublisherConnection::EndConnection(std::unique_lock<std::mutex>& lock) {
+  // The notifications called from here on, including from inside
+  // Disconnect(), are the ones of the connection being given up.
+  generation_++;
+  deadline_.reset();
+  lock.unlock();
+  publisher_->Disconnect();
+  lock.lock();
+}
+
+void PublisherConnection::HandleFailure(std::unique_lock<std::mutex>& lock,
+                                        const std::string& reason) {
+  EndConnection(lock);
+
+  attempt_++;
+  if (policy_.max_attempts > 0 && attempt_ >= policy_.max_attempts) {
+    SetState(PublisherState::kFailed, std::chrono::milliseconds(0), reason);
+    return;
+  }
+  auto delay = GetBackoffDelay();
+  deadline_ = std::chrono::steady_clock::now() + delay;
+  SetState(PublisherState::kBackoff, delay, reason);
+}
+
+void PublisherConnection::SetState(PublisherState state,
+                                   std::chrono::milliseconds delay,
+                                   const std::string& reason) {
+  state_ = state;
+  if (handler_) {
+    handler_(state, attempt_, delay, reason);
+  }
+}
+
+std::chrono::milliseconds PublisherConnection::GetBackoffDelay() {
+  auto delay = policy_.initial_delay.count() *
+               std::pow(policy_.multiplier, attempt_ - 1);
+  delay = std::min<double>(delay, policy_.max_delay.count());
+  if (policy_.jitter > 0) {
+    std::uniform_real_distribution<double> distribution(1 - policy_.jitter,
+                                                        1 + policy_.jitter);
+    delay *= distribution(random_engine_);
+  }
+  return std::chrono::milliseconds(static_cast<int64_t>(delay));
+}
@@ -0,0 +1,159 @@
+// Copyright 2023 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PACKAGES_MILLICAST_MILLICAST_ELINUX_PUBLISHER_CONNECTION_H_
+#define PACKAGES_MILLICAST_MILLICAST_ELINUX_PUBLISHER_CONNECTION_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+
+// The operations of a publisher which PublisherConnection drives. It's
+// implemented with millicast::Publisher, and can be replaced with a mock to
+// exercise the state machine without the service.
+class PublisherInterface {
+ public:
+  virtual ~PublisherInterface() = default;
+
+  // Starts connecting. The result is notified by OnConnected() or OnError()
+  // of PublisherConnection. Returns false if it couldn't be started.
+  virtual bool Connect() = 0;
+
+  // Starts publishing. The result is notified by OnPublishing() or OnError()
+  // of PublisherConnection. Returns false if it couldn't be started.
+  virtual bool Publish() = 0;
+
+  virtual void Disconnect() = 0;
+
+  // Changes the maximum bitrate of the video encoder. 0 restores the one
+  // configured by the publishing profile.
+  virtual void SetMaxBitrate(int kbps) = 0;
+};
+
+enum class PublisherState {
+  kIdle,
+  kConnecting,
+  kPublishing,
+  // Waiting to reconnect after an error.
+  kBackoff,
+  // Gave up reconnecting.
+  kFailed,
+};
+
+struct ReconnectPolicy {
+  std::chrono::milliseconds initial_delay{500};
+  std::chrono::milliseconds max_delay{30000};
+  double multiplier = 2.0;
+  // The delays are randomized by up to this fraction so that many units don't
+  // reconnect at the same time.
+  double jitter = 0.2;
+  // The number of consecutive failures until giving up. 0 is unlimited.
+  int max_attempts = 0;
+  // The time allowed from connecting until publishing starts.
+  std::chrono::milliseconds connect_timeout{10000};
+};
+
+// Connects and publishes with a publisher on a worker thread, and reconnects
+// with a jittered exponential backoff when the connection fails or is lost,
+// so neither the platform thread nor the callbacks of the SDK are blocked.
+class PublisherConnection {
+ public:
+  // Called on the worker thread when the state changes. |attempt| is the
+  // number of the consecutive failures, |delay| is the time until the next
+  // attempt in kBackoff, and |reason| is the error which caused kBackoff or
+  // kFailed. It must not call the methods of PublisherConnection.
+  using StateHandler =
+      std::function<void(PublisherState state, int attempt,
+                         std::chrono::milliseconds delay,
+                         const std::string& reason)>;
+
+  PublisherConnection(PublisherInterface* publisher, StateHandler handler);
+  ~PublisherConnection();
+
+  // Prevent copying.
+  PublisherConnection(PublisherConnection const&) = delete;
+  PublisherConnection& operator=(PublisherConnection const&) = delete;
+
+  // Starts connecting with |policy|, unless it's already connecting or
+  // publishing. Returns immediately.
+  void Start(const ReconnectPolicy& policy);
+
+  // Disconnects and stops reconnecting. Returns immediately.
+  void Stop();
+
+  PublisherState GetState();
+
+  // Notifications from the listener of the publisher. They can be called from
+  // any thread, including from inside the calls to PublisherInterface. Each
+  // is tagged with the connection attempt in progress when it's called, and
+  // is dropped if that attempt has ended by the time it's handled, so a late
+  // notification of an abandoned connection never affects the next one.
+  void OnConnected();
+  void OnPublishing();
+  void OnError(const std::string& reason);
+
+  // Changes the maximum bitrate on the worker thread, so that it's never
+  // called from the callbacks of the SDK.
+  void SetMaxBitrate(int kbps);
+
+ private:
+  enum class Event {
+    kStart,
+    kStop,
+    kConnected,
+    kPublishing,
+    kError,
+    kSetMaxBitrate,
+  };
+
+  struct QueuedEvent {
+    Event event;
+    std::string reason;
+    int value;
+    // |generation_| when the event was posted.
+    uint64_t generation;
+  };
+
+  void Post(Event event, const std::string& reason = std::string(),
+            int value = 0);
+  void Run();
+  void HandleEvent(std::unique_lock<std::mutex>& lock,
+                   const QueuedEvent& event);
+  void HandleTimeout(std::unique_lock<std::mutex>& lock);
+  void BeginConnect(std::unique_lock<std::mutex>& lock);
+  // Disconnects the publisher and ends the current attempt.
+  void EndConnection(std::unique_lock<std::mutex>& lock);
+  void HandleFailure(std::unique_lock<std::mutex>& lock,
+                     const std::string& reason);
+  void SetState(PublisherState state,
+                std::chrono::milliseconds delay = std::chrono::milliseconds(0),
+                const std::string& reason = std::string());
+  std::chrono::milliseconds GetBackoffDelay();
+
+  PublisherInterface* publisher_;
+  StateHandler handler_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<QueuedEvent> events_;
+  PublisherState state_ = PublisherState::kIdle;
+  ReconnectPolicy policy_;
+  int attempt_ = 0;
+  // Incremented when a connection attempt begins or ends, so that the
+  // notifications of an attempt which has ended can be told apart.
+  uint64_t generation_ = 0;
+  // When the connection attempt times out, or the backoff ends.
+  std::optional<std::chrono::steady_clock::time_point> deadline_;
+  std::mt19937 random_engine_;
+  bool terminated_ = false;
+  std::thread thread_;
+};
+
+#endif  // PACKAGES_MILLICAST_MILLICAST_ELINUX_PUBLISHER_CONNECTION_H_
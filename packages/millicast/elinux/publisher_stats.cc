@@ -0,0 +1,92 @@
+// Copyright 2023 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "publisher_stats.h"
+
+#include <algorithm>
+
+void PublisherStatsMetric::Add(double value) {
+  if (count_ == 0) {
+    min_ = max_ = value;
+  } else {
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+  }
+  sum_ += value;
+  count_++;
+}
+
+PublisherStatsAggregator::PublisherStatsAggregator(
+    std::chrono::milliseconds interval)
+    : interval_(interval) {}
+
+void PublisherStatsAggregator::SetInterval(
+    std::chrono::milliseconds interval) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  interval_ = interval;
+  ResetLocked();
+}
+
+std::chrono::milliseconds PublisherStatsAggregator::GetInterval() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return interval_;
+}
+
+bool PublisherStatsAggregator::Add(const PublisherStatsSample& sample,
+                                   Clock::time_point time,
+                                   PublisherStatsSummary& summary) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (interval_.count() <= 0) {
+    return false;
+  }
+  if (!window_start_) {
+    window_start_ = time;
+  }
+
+  if (sample.bytes_sent) {
+    // The counter restarts when the connection is renewed, in which case the
+    // sample only becomes the base of the next one.
+    if (last_bytes_sent_ && *sample.bytes_sent >= *last_bytes_sent_ &&
+        time > last_bytes_sent_time_) {
+      auto seconds =
+          std::chrono::duration<double>(time - last_bytes_sent_time_).count();
+      current_.bitrate_bps.Add((*sample.bytes_sent - *last_bytes_sent_) * 8 /
+                               seconds);
+    }
+    last_bytes_sent_ = sample.bytes_sent;
+    last_bytes_sent_time_ = time;
+  }
+  if (sample.round_trip_time_ms) {
+    current_.round_trip_time_ms.Add(*sample.round_trip_time_ms);
+  }
+  if (sample.fraction_lost) {
+    current_.fraction_lost.Add(*sample.fraction_lost);
+  }
+  if (sample.encoder_fps) {
+    current_.encoder_fps.Add(*sample.encoder_fps);
+  }
+  current_.sample_count++;
+
+  auto elapsed = time - *window_start_;
+  if (elapsed < interval_) {
+    return false;
+  }
+  current_.window =
+      std::chrono::duration_cast<std::chrono::milliseconds>(elapsed);
+  summary = current_;
+  current_ = PublisherStatsSummary();
+  window_start_ = time;
+  return true;
+}
+
+void PublisherStatsAggregator::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ResetLocked();
+}
+
+void PublisherStatsAggregator::ResetLocked() {
+  current_ = PublisherStatsSummary();
+  window_start_.reset();
+  last_bytes_sent_.reset();
+}
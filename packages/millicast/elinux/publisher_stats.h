@@ -0,0 +1,89 @@
+// Copyright 2023 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PACKAGES_MILLICAST_MILLICAST_ELINUX_PUBLISHER_STATS_H_
+#define PACKAGES_MILLICAST_MILLICAST_ELINUX_PUBLISHER_STATS_H_
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+
+// The values taken from a single stats report of the publisher. The values
+// which the report doesn't contain are left empty.
+struct PublisherStatsSample {
+  // The total bytes sent by all the outbound RTP streams.
+  std::optional<uint64_t> bytes_sent;
+  std::optional<double> round_trip_time_ms;
+  // Fraction of the packets lost reported by the receiver, in [0, 1].
+  std::optional<double> fraction_lost;
+  std::optional<double> encoder_fps;
+};
+
+class PublisherStatsMetric {
+ public:
+  void Add(double value);
+  bool IsEmpty() const { return count_ == 0; }
+  double GetMin() const { return min_; }
+  double GetMax() const { return max_; }
+  double GetAverage() const { return count_ ? sum_ / count_ : 0; }
+
+ private:
+  double min_ = 0;
+  double max_ = 0;
+  double sum_ = 0;
+  int count_ = 0;
+};
+
+// The min/avg/max of the samples over a window.
+struct PublisherStatsSummary {
+  std::chrono::milliseconds window{0};
+  int sample_count = 0;
+  PublisherStatsMetric bitrate_bps;
+  PublisherStatsMetric round_trip_time_ms;
+  PublisherStatsMetric fraction_lost;
+  PublisherStatsMetric encoder_fps;
+};
+
+// Aggregates the stats reports of the publisher, which arrive every second or
+// so, into a summary per interval, so that only one message per interval is
+// sent to Dart.
+class PublisherStatsAggregator {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit PublisherStatsAggregator(std::chrono::milliseconds interval);
+  ~PublisherStatsAggregator() = default;
+
+  // Prevent copying.
+  PublisherStatsAggregator(PublisherStatsAggregator const&) = delete;
+  PublisherStatsAggregator& operator=(PublisherStatsAggregator const&) =
+      delete;
+
+  // Sets the length of the windows. 0 disables the aggregation. The current
+  // window is discarded.
+  void SetInterval(std::chrono::milliseconds interval);
+  std::chrono::milliseconds GetInterval();
+
+  // Adds |sample| taken at |time|. Returns true and sets |summary| when the
+  // window is complete.
+  bool Add(const PublisherStatsSample& sample, Clock::time_point time,
+           PublisherStatsSummary& summary);
+
+  // Discards the current window and the last sample, e.g. on reconnection.
+  void Reset();
+
+ private:
+  void ResetLocked();
+
+  std::mutex mutex_;
+  std::chrono::milliseconds interval_;
+  PublisherStatsSummary current_;
+  std::optional<Clock::time_point> window_start_;
+  // The previous sample which had the bytes sent, to calculate the bitrate.
+  std::optional<uint64_t> last_bytes_sent_;
+  Clock::time_point last_bytes_sent_time_;
+};
+
+#endif  // PACKAGES_MILLICAST_MILLICAST_ELINUX_PUBLISHER_STATS_H_
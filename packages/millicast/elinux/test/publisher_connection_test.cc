@@ -0,0 +1,300 @@
+// Copyright 2023 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Tests the state machine of PublisherConnection with a mock publisher.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "publisher_connection.h"
+
+namespace {
+constexpr auto kWaitTimeout = std::chrono::seconds(5);
+
+struct StateChange {
+  PublisherState state;
+  int attempt;
+  std::chrono::milliseconds delay;
+  std::string reason;
+};
+
+// Records the state changes of a connection.
+class StateRecorder {
+ public:
+  PublisherConnection::StateHandler GetHandler() {
+    return [this](PublisherState state, int attempt,
+                  std::chrono::milliseconds delay, const std::string& reason) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        changes_.push_back({state, attempt, delay, reason});
+      }
+      cv_.notify_all();
+    };
+  }
+
+  // Waits until |count| state changes have been recorded. Returns false on
+  // timeout.
+  bool WaitForChanges(size_t count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cv_.wait_for(lock, kWaitTimeout,
+                        [this, count]() { return changes_.size() >= count; });
+  }
+
+  std::vector<StateChange> GetChanges() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return changes_;
+  }
+
+  std::vector<PublisherState> GetStates() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<PublisherState> states;
+    for (const auto& change : changes_) {
+      states.push_back(change.state);
+    }
+    return states;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<StateChange> changes_;
+};
+
+// A publisher which connects and publishes immediately unless it's told to
+// fail or to stay silent.
+class MockPublisher : public PublisherInterface {
+ public:
+  void SetConnection(PublisherConnection* connection) {
+    connection_ = connection;
+  }
+
+  bool Connect() override {
+    connect_count++;
+    if (connect_failures > 0) {
+      connect_failures--;
+      return false;
+    }
+    if (notifies_connected) {
+      connection_->OnConnected();
+    }
+    return true;
+  }
+
+  bool Publish() override {
+    publish_count++;
+    connection_->OnPublishing();
+    return true;
+  }
+
+  void Disconnect() override { disconnect_count++; }
+
+  // Blocks the worker thread while |blocked| is set.
+  void SetMaxBitrate(int kbps) override {
+    std::unique_lock<std::mutex> lock(mutex_);
+    max_bitrate_kbps = kbps;
+    entered_ = true;
+    cv_.notify_all();
+    cv_.wait(lock, [this]() { return !blocked_; });
+  }
+
+  void Block() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    blocked_ = true;
+    entered_ = false;
+  }
+
+  // Waits until the worker thread is blocked in SetMaxBitrate().
+  bool WaitForBlocked() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cv_.wait_for(lock, kWaitTimeout, [this]() { return entered_; });
+  }
+
+  void Unblock() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      blocked_ = false;
+    }
+    cv_.notify_all();
+  }
+
+  // The number of the next Connect() calls which fail.
+  std::atomic<int> connect_failures{0};
+  // Whether Connect() notifies OnConnected(). Otherwise, it times out.
+  std::atomic<bool> notifies_connected{true};
+  std::atomic<int> connect_count{0};
+  std::atomic<int> publish_count{0};
+  std::atomic<int> disconnect_count{0};
+  std::atomic<int> max_bitrate_kbps{0};
+
+ private:
+  PublisherConnection* connection_ = nullptr;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool blocked_ = false;
+  bool entered_ = false;
+};
+
+// The policy of the tests, without jitter so that the delays are exact.
+ReconnectPolicy GetTestPolicy() {
+  ReconnectPolicy policy;
+  policy.initial_delay = std::chrono::milliseconds(10);
+  policy.max_delay = std::chrono::milliseconds(25);
+  policy.multiplier = 2.0;
+  policy.jitter = 0;
+  policy.connect_timeout = std::chrono::milliseconds(1000);
+  return policy;
+}
+
+TEST(PublisherConnectionTest, Publish) {
+  MockPublisher publisher;
+  StateRecorder recorder;
+  PublisherConnection connection(&publisher, recorder.GetHandler());
+  publisher.SetConnection(&connection);
+
+  connection.Start(GetTestPolicy());
+  ASSERT_TRUE(recorder.WaitForChanges(2));
+  EXPECT_EQ(recorder.GetStates(),
+            std::vector<PublisherState>(
+                {PublisherState::kConnecting, PublisherState::kPublishing}));
+  EXPECT_EQ(publisher.publish_count.load(), 1);
+
+  // Starting while publishing does nothing.
+  connection.Start(GetTestPolicy());
+  connection.Stop();
+  ASSERT_TRUE(recorder.WaitForChanges(3));
+  EXPECT_EQ(recorder.GetStates().back(), PublisherState::kIdle);
+  EXPECT_EQ(publisher.connect_count.load(), 1);
+  EXPECT_EQ(publisher.disconnect_count.load(), 1);
+}
+
+TEST(PublisherConnectionTest, Backoff) {
+  MockPublisher publisher;
+  publisher.connect_failures = 3;
+  StateRecorder recorder;
+  PublisherConnection connection(&publisher, recorder.GetHandler());
+  publisher.SetConnection(&connection);
+
+  connection.Start(GetTestPolicy());
+  ASSERT_TRUE(recorder.WaitForChanges(8));
+  auto changes = recorder.GetChanges();
+  ASSERT_EQ(changes.size(), 8u);
+  EXPECT_EQ(changes[1].state, PublisherState::kBackoff);
+  EXPECT_EQ(changes[1].attempt, 1);
+  EXPECT_EQ(changes[1].delay, std::chrono::milliseconds(10));
+  EXPECT_EQ(changes[1].reason, "Failed to start connecting");
+  EXPECT_EQ(changes[3].state, PublisherState::kBackoff);
+  EXPECT_EQ(changes[3].delay, std::chrono::milliseconds(20));
+  // Capped by max_delay.
+  EXPECT_EQ(changes[5].state, PublisherState::kBackoff);
+  EXPECT_EQ(changes[5].attempt, 3);
+  EXPECT_EQ(changes[5].delay, std::chrono::milliseconds(25));
+  EXPECT_EQ(changes[6].state, PublisherState::kConnecting);
+  EXPECT_EQ(changes[7].state, PublisherState::kPublishing);
+  // The attempts are reset once publishing.
+  EXPECT_EQ(changes[7].attempt, 0);
+  EXPECT_EQ(publisher.connect_count.load(), 4);
+}
+
+TEST(PublisherConnectionTest, GiveUp) {
+  MockPublisher publisher;
+  publisher.connect_failures = 100;
+  StateRecorder recorder;
+  PublisherConnection connection(&publisher, recorder.GetHandler());
+  publisher.SetConnection(&connection);
+
+  auto policy = GetTestPolicy();
+  policy.max_attempts = 2;
+  connection.Start(policy);
+  ASSERT_TRUE(recorder.WaitForChanges(4));
+  EXPECT_EQ(recorder.GetStates(),
+            std::vector<PublisherState>(
+                {PublisherState::kConnecting, PublisherState::kBackoff,
+                 PublisherState::kConnecting, PublisherState::kFailed}));
+  EXPECT_EQ(connection.GetState(), PublisherState::kFailed);
+
+  // It can be started again after giving up.
+  publisher.connect_failures = 0;
+  connection.Start(policy);
+  ASSERT_TRUE(recorder.WaitForChanges(6));
+  EXPECT_EQ(connection.GetState(), PublisherState::kPublishing);
+}
+
+TEST(PublisherConnectionTest, ConnectTimeout) {
+  MockPublisher publisher;
+  publisher.notifies_connected = false;
+  StateRecorder recorder;
+  PublisherConnection connection(&publisher, recorder.GetHandler());
+  publisher.SetConnection(&connection);
+
+  auto policy = GetTestPolicy();
+  policy.connect_timeout = std::chrono::milliseconds(20);
+  connection.Start(policy);
+  ASSERT_TRUE(recorder.WaitForChanges(2));
+  auto changes = recorder.GetChanges();
+  EXPECT_EQ(changes[1].state, PublisherState::kBackoff);
+  EXPECT_EQ(changes[1].reason, "Timed out");
+  EXPECT_EQ(publisher.disconnect_count.load(), 1);
+
+  publisher.notifies_connected = true;
+  ASSERT_TRUE(recorder.WaitForChanges(4));
+  EXPECT_EQ(connection.GetState(), PublisherState::kPublishing);
+}
+
+TEST(PublisherConnectionTest, ErrorWhilePublishing) {
+  MockPublisher publisher;
+  StateRecorder recorder;
+  PublisherConnection connection(&publisher, recorder.GetHandler());
+  publisher.SetConnection(&connection);
+
+  connection.Start(GetTestPolicy());
+  ASSERT_TRUE(recorder.WaitForChanges(2));
+  connection.OnError("Connection lost");
+  ASSERT_TRUE(recorder.WaitForChanges(5));
+  auto changes = recorder.GetChanges();
+  EXPECT_EQ(changes[2].state, PublisherState::kBackoff);
+  EXPECT_EQ(changes[2].reason, "Connection lost");
+  EXPECT_EQ(connection.GetState(), PublisherState::kPublishing);
+}
+
+// A notification of a connection which has been given up must not affect the
+// next one, even if it's handled after the next one has started.
+TEST(PublisherConnectionTest, StaleNotification) {
+  MockPublisher publisher;
+  StateRecorder recorder;
+  PublisherConnection connection(&publisher, recorder.GetHandler());
+  publisher.SetConnection(&connection);
+
+  connection.Start(GetTestPolicy());
+  ASSERT_TRUE(recorder.WaitForChanges(2));
+
+  // Queues a restart, and an error of the current connection behind it.
+  publisher.Block();
+  connection.SetMaxBitrate(1000);
+  EXPECT_TRUE(publisher.WaitForBlocked());
+  connection.Stop();
+  connection.Start(GetTestPolicy());
+  connection.OnError("Stale error");
+  publisher.Unblock();
+
+  ASSERT_TRUE(recorder.WaitForChanges(5));
+  // Waits for the stale error to be handled, if it weren't dropped.
+  publisher.Block();
+  connection.SetMaxBitrate(2000);
+  EXPECT_TRUE(publisher.WaitForBlocked());
+  publisher.Unblock();
+
+  EXPECT_EQ(recorder.GetStates(),
+            std::vector<PublisherState>(
+                {PublisherState::kConnecting, PublisherState::kPublishing,
+                 PublisherState::kIdle, PublisherState::kConnecting,
+                 PublisherState::kPublishing}));
+  EXPECT_EQ(publisher.max_bitrate_kbps.load(), 2000);
+}
+}  // namespace
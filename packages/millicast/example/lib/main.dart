@@ -17,7 +17,9 @@ class MyApp extends StatefulWidget {
 
 class _MyAppState extends State<MyApp> {
   String _platformVersion = 'Unknown';
+  String _status = '';
   final _millicastPlugin = Millicast();
+  StreamSubscription<MillicastEvent>? _eventSubscription;
 
   @override
   void initState() {
@@ -37,6 +39,20 @@ class _MyAppState extends State<MyApp> {
       platformVersion = 'Failed to get platform version.';
     }
 
+    _eventSubscription = _millicastPlugin.events.listen((event) {
+      if (!mounted) return;
+      setState(() {
+        final stats = event.stats;
+        _status = stats == null
+            ? '${event.state?.name ?? event.type.name} '
+                '${event.message ?? event.viewerCount ?? ''}'
+            : 'bitrate: ${stats.bitrate}\n'
+                'rtt: ${stats.roundTripTime}\n'
+                'packet loss: ${stats.packetLoss}\n'
+                'fps: ${stats.encoderFps}';
+      });
+    });
+
     await _millicastPlugin.init();
     await _millicastPlugin.setCredentials("", "", "");
     await _millicastPlugin.setAudioSrc("");
@@ -54,6 +70,12 @@ class _MyAppState extends State<MyApp> {
     });
   }
 
+  @override
+  void dispose() {
+    _eventSubscription?.cancel();
+    super.dispose();
+  }
+
   @override
   Widget build(BuildContext context) {
     return MaterialApp(
@@ -62,7 +84,7 @@ class _MyAppState extends State<MyApp> {
           title: const Text('Plugin example app'),
         ),
         body: Center(
-          child: Text('Running on: $_platformVersion\n'),
+          child: Text('Running on: $_platformVersion\n$_status'),
         ),
       ),
     );
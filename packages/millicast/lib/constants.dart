@@ -10,6 +10,15 @@ const String kMethodPrintSuppAud = "printSupportedAudioCodecs";
 const String kMethodPrintSuppVid = "printSupportedVideoCodecs";
 const String kMethodSetCodecs = "setCodecs";
 const String kMethodDispose = "dispose";
+const String kMethodSetStatsInterval = "setStatsInterval";
+const String kMethodDisconnect = "disconnect";
+const String kMethodSetCustomVideoSrc = "setCustomVideoSrc";
+const String kMethodPushVideoFrame = "pushVideoFrame";
+const String kMethodGetAudioSources = "getAudioSources";
+const String kMethodGetVideoSources = "getVideoSources";
+const String kMethodRefreshSources = "refreshSources";
+const String kMethodSetPublishingProfile = "setPublishingProfile";
+const String kMethodDeliverEvents = "deliverEvents";
 
 // Arguments
 const String kArgsApiUrl = "api_url";
@@ -19,3 +28,24 @@ const String kArgsAudioSrc = "audio_src";
 const String kArgsVideoSrc = "video_src";
 const String kArgsAudioCdc = "audio_cdc";
 const String kArgsVideoCdc = "video_cdc";
+const String kArgsIntervalMs = "interval_ms";
+const String kArgsInitialDelayMs = "initial_delay_ms";
+const String kArgsMaxDelayMs = "max_delay_ms";
+const String kArgsMaxAttempts = "max_attempts";
+const String kArgsConnectTimeoutMs = "connect_timeout_ms";
+const String kArgsFormat = "format";
+const String kArgsWidth = "width";
+const String kArgsHeight = "height";
+const String kArgsBytes = "bytes";
+const String kArgsTimestampUs = "timestamp_us";
+const String kArgsFps = "fps";
+const String kArgsMaxBitrateKbps = "max_bitrate_kbps";
+const String kArgsMinBitrateKbps = "min_bitrate_kbps";
+const String kArgsStartBitrateKbps = "start_bitrate_kbps";
+const String kArgsSimulcast = "simulcast";
+const String kArgsScalabilityMode = "scalability_mode";
+const String kArgsDegradationPreference = "degradation_preference";
+const String kArgsAdaptiveBitrate = "adaptive_bitrate";
+
+// Events
+const String kEventChannelName = "millicast/events";
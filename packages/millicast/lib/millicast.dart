@@ -5,7 +5,18 @@
 // platforms in the `pubspec.yaml` at
 // https://flutter.dev/docs/development/packages-and-plugins/developing-packages#plugin-platforms.
 
+import 'dart:typed_data';
+
+import 'millicast_event.dart';
+import 'millicast_frame_format.dart';
 import 'millicast_platform_interface.dart';
+import 'millicast_publishing_profile.dart';
+import 'millicast_source.dart';
+
+export 'millicast_event.dart';
+export 'millicast_frame_format.dart';
+export 'millicast_publishing_profile.dart';
+export 'millicast_source.dart';
 
 class Millicast {
   Future<String?> getPlatformVersion() {
@@ -30,16 +41,85 @@ class Millicast {
         .setCredentials(api_url, stream_name, token);
   }
 
+  /// Returns the audio capture devices. The devices are enumerated once and
+  /// cached until a device is plugged or unplugged, or [refreshSources] is
+  /// called.
+  Future<List<MillicastSource>> getAudioSources() {
+    return MillicastPlatform.instance.getAudioSources();
+  }
+
+  /// Returns the video capture devices, cached as [getAudioSources].
+  Future<List<MillicastSource>> getVideoSources() {
+    return MillicastPlatform.instance.getVideoSources();
+  }
+
+  /// Enumerates the devices again at the next lookup.
+  Future<void> refreshSources() async {
+    await MillicastPlatform.instance.refreshSources();
+  }
+
+  /// Captures the audio source whose name or id is [audio_src], or the first
+  /// one if it's empty.
   Future<void> setAudioSrc(String audio_src) async {
     await MillicastPlatform.instance.setAudioSrc(audio_src);
   }
 
-  Future<void> setVideoSrc(String video_src) async {
-    await MillicastPlatform.instance.setVideoSrc(video_src);
+  /// Captures the video source whose name or id is [video_src], or the first
+  /// one if it's empty. The capture format which is the closest to [width],
+  /// [height] and [fps] is used when they are given.
+  Future<void> setVideoSrc(String video_src,
+      {int? width, int? height, int? fps}) async {
+    await MillicastPlatform.instance
+        .setVideoSrc(video_src, width: width, height: height, fps: fps);
+  }
+
+  /// Connects and starts publishing in the background. The progress is sent
+  /// as the [MillicastEventType.state] events of [events].
+  ///
+  /// When the connection fails or is lost, it reconnects after a delay which
+  /// starts from [initialBackoff] (500 ms by default) and doubles up to
+  /// [maxBackoff] (30 s by default), randomized by 20%. It gives up after
+  /// [maxAttempts] consecutive failures, or never if it's null. An attempt
+  /// fails if publishing doesn't start within [connectTimeout] (10 s by
+  /// default).
+  Future<void> connect(
+      {Duration? initialBackoff,
+      Duration? maxBackoff,
+      int? maxAttempts,
+      Duration? connectTimeout}) async {
+    await MillicastPlatform.instance.connect(
+        initialBackoff: initialBackoff,
+        maxBackoff: maxBackoff,
+        maxAttempts: maxAttempts,
+        connectTimeout: connectTimeout);
+  }
+
+  /// Adds a video track whose frames are pushed by the app instead of being
+  /// captured from a device, so a camera which the app already has open, or
+  /// content which the app renders, can be published.
+  ///
+  /// Native producers push the frames with MillicastPushVideoFrame() of
+  /// `millicast_frame_source.h`, and Dart producers with [pushVideoFrame].
+  Future<void> setCustomVideoSrc() async {
+    await MillicastPlatform.instance.setCustomVideoSrc();
+  }
+
+  /// Pushes a frame to the track added by [setCustomVideoSrc]. The planes in
+  /// [bytes] must be packed without padding. [timestamp] is the capture time
+  /// on the monotonic clock, and defaults to the time the frame is pushed.
+  /// Returns false if the track is not active.
+  Future<bool> pushVideoFrame(Uint8List bytes,
+      {required int width,
+      required int height,
+      MillicastFrameFormat format = MillicastFrameFormat.rgba,
+      Duration? timestamp}) {
+    return MillicastPlatform.instance.pushVideoFrame(bytes,
+        width: width, height: height, format: format, timestamp: timestamp);
   }
 
-  Future<void> connect() async {
-    await MillicastPlatform.instance.connect();
+  /// Disconnects and stops reconnecting.
+  Future<void> disconnect() async {
+    await MillicastPlatform.instance.disconnect();
   }
 
   Future<void> printSupportedAudioCodecs() async {
@@ -57,4 +137,24 @@ class Millicast {
   Future<void> dispose() async {
     await MillicastPlatform.instance.dispose();
   }
+
+  /// Sets the bitrate, simulcast, SVC and degradation settings of the
+  /// publisher. It's called after [setCodecs], whose codecs are kept.
+  Future<void> setPublishingProfile(MillicastPublishingProfile profile) async {
+    await MillicastPlatform.instance.setPublishingProfile(profile);
+  }
+
+  /// Sets the interval of the [MillicastEventType.stats] events. The stats
+  /// reports of the publisher are aggregated natively over the interval, so
+  /// only one event is sent per interval. [Duration.zero] stops the events,
+  /// and stops collecting the stats unless
+  /// [MillicastPublishingProfile.adaptiveBitrate] needs them. The default is
+  /// 5 seconds.
+  Future<void> setStatsInterval(Duration interval) async {
+    await MillicastPlatform.instance.setStatsInterval(interval);
+  }
+
+  /// The connection state changes, errors, viewer counts and stats of the
+  /// publisher.
+  Stream<MillicastEvent> get events => MillicastPlatform.instance.events();
 }
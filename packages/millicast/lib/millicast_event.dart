@@ -0,0 +1,163 @@
+/// The kinds of the events of the publisher.
+enum MillicastEventType {
+  connected,
+  connectionError,
+  signalingError,
+  publishing,
+  publishingError,
+  active,
+  inactive,
+  viewerCount,
+  stats,
+  state,
+  bitrate,
+}
+
+/// The states of the connection which [Millicast.connect] maintains.
+enum MillicastPublisherState {
+  idle,
+  connecting,
+  publishing,
+
+  /// Waiting to reconnect after an error.
+  backoff,
+
+  /// Gave up reconnecting after the maximum number of attempts.
+  failed,
+}
+
+/// The min/avg/max of a value over a stats window.
+class MillicastStatsMetric {
+  const MillicastStatsMetric(this.min, this.avg, this.max);
+
+  final double min;
+  final double avg;
+  final double max;
+
+  static MillicastStatsMetric? fromMap(Object? map) {
+    if (map is! Map) {
+      return null;
+    }
+    return MillicastStatsMetric((map['min'] as num).toDouble(),
+        (map['avg'] as num).toDouble(), (map['max'] as num).toDouble());
+  }
+
+  @override
+  String toString() => 'min: $min, avg: $avg, max: $max';
+}
+
+/// The stats of the publisher aggregated natively over a window of the
+/// interval set by [Millicast.setStatsInterval]. The metrics which no report
+/// contained in the window are null.
+class MillicastStats {
+  const MillicastStats({
+    required this.window,
+    required this.sampleCount,
+    this.bitrate,
+    this.roundTripTime,
+    this.packetLoss,
+    this.encoderFps,
+  });
+
+  final Duration window;
+
+  /// The number of the stats reports in the window.
+  final int sampleCount;
+
+  /// The sending bitrate in bits per second.
+  final MillicastStatsMetric? bitrate;
+
+  /// The round trip time in milliseconds.
+  final MillicastStatsMetric? roundTripTime;
+
+  /// The fraction of the packets lost, in [0, 1].
+  final MillicastStatsMetric? packetLoss;
+
+  /// The frame rate of the video encoder.
+  final MillicastStatsMetric? encoderFps;
+
+  factory MillicastStats.fromMap(Map<Object?, Object?> map) {
+    return MillicastStats(
+      window: Duration(milliseconds: map['window_ms'] as int),
+      sampleCount: map['sample_count'] as int,
+      bitrate: MillicastStatsMetric.fromMap(map['bitrate_bps']),
+      roundTripTime: MillicastStatsMetric.fromMap(map['round_trip_time_ms']),
+      packetLoss: MillicastStatsMetric.fromMap(map['fraction_lost']),
+      encoderFps: MillicastStatsMetric.fromMap(map['encoder_fps']),
+    );
+  }
+}
+
+/// An event of the publisher.
+class MillicastEvent {
+  const MillicastEvent(this.type,
+      {this.code,
+      this.message,
+      this.viewerCount,
+      this.stats,
+      this.state,
+      this.attempt,
+      this.retryDelay,
+      this.targetBitrateKbps});
+
+  final MillicastEventType type;
+
+  /// The error code of [MillicastEventType.connectionError].
+  final int? code;
+
+  /// The error message of the error events.
+  final String? message;
+
+  /// The number of the viewers of [MillicastEventType.viewerCount].
+  final int? viewerCount;
+
+  /// The stats of [MillicastEventType.stats].
+  final MillicastStats? stats;
+
+  /// The new state of [MillicastEventType.state].
+  final MillicastPublisherState? state;
+
+  /// The number of the consecutive failed attempts of
+  /// [MillicastEventType.state].
+  final int? attempt;
+
+  /// The time until the next attempt in [MillicastPublisherState.backoff].
+  final Duration? retryDelay;
+
+  /// The maximum bitrate which the adaptation of
+  /// [MillicastPublishingProfile.adaptiveBitrate] set.
+  final int? targetBitrateKbps;
+
+  /// Returns null for the events which are unknown to this version.
+  static MillicastEvent? fromMap(Map<Object?, Object?> map) {
+    final String? name = map['event'] as String?;
+    final Iterable<MillicastEventType> types =
+        MillicastEventType.values.where((type) => type.name == name);
+    if (types.isEmpty) {
+      return null;
+    }
+    final MillicastEventType type = types.first;
+    final bool isState = type == MillicastEventType.state;
+    final Iterable<MillicastPublisherState> states = MillicastPublisherState
+        .values
+        .where((state) => isState && state.name == map['state']);
+    final String? reason = map['reason'] as String?;
+    return MillicastEvent(
+      type,
+      code: map['code'] as int?,
+      message: isState
+          ? (reason == null || reason.isEmpty ? null : reason)
+          : map['message'] as String?,
+      viewerCount: map['count'] as int?,
+      stats: type == MillicastEventType.stats
+          ? MillicastStats.fromMap(map)
+          : null,
+      state: states.isEmpty ? null : states.first,
+      attempt: isState ? map['attempt'] as int? : null,
+      retryDelay: isState && map['delay_ms'] != null
+          ? Duration(milliseconds: map['delay_ms'] as int)
+          : null,
+      targetBitrateKbps: map['target_kbps'] as int?,
+    );
+  }
+}
@@ -0,0 +1,13 @@
+/// The pixel formats of the frames pushed by [Millicast.pushVideoFrame]. The
+/// indices match MillicastFrameFormat of the native API.
+enum MillicastFrameFormat {
+  /// 4 bytes per pixel in R, G, B, A order, e.g. `ImageByteFormat.rawRgba`.
+  rgba,
+
+  /// 4 bytes per pixel in B, G, R, A order.
+  bgra,
+
+  /// Packed Y, U and V planes, with U and V subsampled by 2 in both
+  /// directions.
+  i420,
+}
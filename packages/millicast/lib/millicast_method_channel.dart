@@ -1,6 +1,13 @@
+import 'dart:ffi';
+import 'dart:isolate';
+
 import 'package:flutter/foundation.dart';
 import 'package:flutter/services.dart';
 
+import 'millicast_event.dart';
+import 'millicast_frame_format.dart';
+import 'millicast_publishing_profile.dart';
+import 'millicast_source.dart';
 import 'millicast_platform_interface.dart';
 import 'constants.dart' as Constants;
 
@@ -10,6 +17,10 @@ class MethodChannelMillicast extends MillicastPlatform {
   @visibleForTesting
   final methodChannel = const MethodChannel('millicast');
 
+  /// The event channel which the events of the publisher are sent to.
+  @visibleForTesting
+  final eventChannel = const EventChannel(Constants.kEventChannelName);
+
   @override
   Future<String?> getPlatformVersion() async {
     final version =
@@ -43,13 +54,71 @@ class MethodChannelMillicast extends MillicastPlatform {
   }
 
   @override
-  Future<void> setVideoSrc(String video_src) async {
-    await methodChannel.invokeMethod<String>(Constants.kMethodPrintVideoSrc, {Constants.kArgsVideoSrc: video_src});
+  Future<void> setVideoSrc(String video_src,
+      {int? width, int? height, int? fps}) async {
+    await methodChannel.invokeMethod<String>(Constants.kMethodSetVideoSrc, {
+      Constants.kArgsVideoSrc: video_src,
+      Constants.kArgsWidth: width,
+      Constants.kArgsHeight: height,
+      Constants.kArgsFps: fps,
+    });
+  }
+
+  @override
+  Future<void> connect(
+      {Duration? initialBackoff,
+      Duration? maxBackoff,
+      int? maxAttempts,
+      Duration? connectTimeout}) async {
+    await methodChannel.invokeMethod<String>(Constants.kMethodConnect, {
+      Constants.kArgsInitialDelayMs: initialBackoff?.inMilliseconds,
+      Constants.kArgsMaxDelayMs: maxBackoff?.inMilliseconds,
+      Constants.kArgsMaxAttempts: maxAttempts,
+      Constants.kArgsConnectTimeoutMs: connectTimeout?.inMilliseconds,
+    });
+  }
+
+  @override
+  Future<void> disconnect() async {
+    await methodChannel.invokeMethod<String>(Constants.kMethodDisconnect);
+  }
+
+  @override
+  Future<List<MillicastSource>> getAudioSources() async {
+    final sources = await methodChannel.invokeListMethod<Map<Object?, Object?>>(Constants.kMethodGetAudioSources);
+    return sources?.map(MillicastSource.fromMap).toList() ?? <MillicastSource>[];
+  }
+
+  @override
+  Future<List<MillicastSource>> getVideoSources() async {
+    final sources = await methodChannel.invokeListMethod<Map<Object?, Object?>>(Constants.kMethodGetVideoSources);
+    return sources?.map(MillicastSource.fromMap).toList() ?? <MillicastSource>[];
+  }
+
+  @override
+  Future<void> refreshSources() async {
+    await methodChannel.invokeMethod<String>(Constants.kMethodRefreshSources);
   }
 
   @override
-  Future<void> connect() async {
-    await methodChannel.invokeMethod<String>(Constants.kMethodConnect);
+  Future<void> setCustomVideoSrc() async {
+    await methodChannel.invokeMethod<String>(Constants.kMethodSetCustomVideoSrc);
+  }
+
+  @override
+  Future<bool> pushVideoFrame(Uint8List bytes,
+      {required int width,
+      required int height,
+      MillicastFrameFormat format = MillicastFrameFormat.rgba,
+      Duration? timestamp}) async {
+    final pushed = await methodChannel.invokeMethod<bool>(Constants.kMethodPushVideoFrame, {
+      Constants.kArgsFormat: format.index,
+      Constants.kArgsWidth: width,
+      Constants.kArgsHeight: height,
+      Constants.kArgsBytes: bytes,
+      Constants.kArgsTimestampUs: timestamp?.inMicroseconds,
+    });
+    return pushed ?? false;
   }
 
   @override
@@ -71,4 +140,71 @@ class MethodChannelMillicast extends MillicastPlatform {
   Future<void> dispose() async {
     await methodChannel.invokeMethod<String>(Constants.kMethodDispose);
   }
+
+  @override
+  Future<void> setPublishingProfile(MillicastPublishingProfile profile) async {
+    await methodChannel.invokeMethod<String>(Constants.kMethodSetPublishingProfile, {
+      Constants.kArgsMaxBitrateKbps: profile.maxBitrateKbps,
+      Constants.kArgsMinBitrateKbps: profile.minBitrateKbps,
+      Constants.kArgsStartBitrateKbps: profile.startBitrateKbps,
+      Constants.kArgsSimulcast: profile.simulcast,
+      Constants.kArgsScalabilityMode: profile.scalabilityMode,
+      Constants.kArgsDegradationPreference: profile.degradationPreference?.name,
+      Constants.kArgsAdaptiveBitrate: profile.adaptiveBitrate,
+    });
+  }
+
+  @override
+  Future<void> setStatsInterval(Duration interval) async {
+    await methodChannel.invokeMethod<String>(Constants.kMethodSetStatsInterval, {Constants.kArgsIntervalMs: interval.inMilliseconds});
+  }
+
+  static bool _isListeningToWakeups = false;
+
+  /// Lets the plugin deliver its events, which are only sent on the platform
+  /// thread when it handles a message from Dart. The plugin posts to a native
+  /// port when it queues an event, and a deliverEvents call is sent back.
+  static void _listenToWakeups(MethodChannel methodChannel) {
+    if (_isListeningToWakeups) {
+      return;
+    }
+    _isListeningToWakeups = true;
+    final DynamicLibrary dylib;
+    try {
+      dylib = DynamicLibrary.open('libmillicast_plugin.so');
+    } on ArgumentError {
+      // The events are delivered when the next method is called.
+      return;
+    }
+    final int Function(Pointer<Void>) initializeDartApi = dylib
+        .lookup<NativeFunction<IntPtr Function(Pointer<Void>)>>(
+            'millicast_initialize_dart_api')
+        .asFunction();
+    final void Function(int) setWakeupPort = dylib
+        .lookup<NativeFunction<Void Function(Int64)>>(
+            'millicast_set_wakeup_port')
+        .asFunction();
+    if (initializeDartApi(NativeApi.initializeApiDLData) != 0) {
+      return;
+    }
+
+    final ReceivePort port = ReceivePort()
+      ..listen((_) {
+        methodChannel
+            .invokeMethod<void>(Constants.kMethodDeliverEvents)
+            .catchError((Object error) => null);
+      });
+    setWakeupPort(port.sendPort.nativePort);
+  }
+
+  @override
+  Stream<MillicastEvent> events() {
+    _listenToWakeups(methodChannel);
+    return eventChannel
+        .receiveBroadcastStream()
+        .map((dynamic event) =>
+            MillicastEvent.fromMap(event as Map<Object?, Object?>))
+        .where((MillicastEvent? event) => event != null)
+        .cast<MillicastEvent>();
+  }
 }
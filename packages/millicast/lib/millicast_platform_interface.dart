@@ -1,5 +1,11 @@
 import 'package:plugin_platform_interface/plugin_platform_interface.dart';
 
+import 'dart:typed_data';
+
+import 'millicast_event.dart';
+import 'millicast_frame_format.dart';
+import 'millicast_publishing_profile.dart';
+import 'millicast_source.dart';
 import 'millicast_method_channel.dart';
 
 abstract class MillicastPlatform extends PlatformInterface {
@@ -50,15 +56,48 @@ abstract class MillicastPlatform extends PlatformInterface {
         'setAudioSrc(String audio_src) has not been implemented.');
   }
 
-  Future<void> setVideoSrc(String video_src) async {
+  Future<void> setVideoSrc(String video_src,
+      {int? width, int? height, int? fps}) async {
     throw UnimplementedError(
         'setVideoSrc(String video_src) has not been implemented.');
   }
 
-  Future<void> connect() async {
+  Future<void> connect(
+      {Duration? initialBackoff,
+      Duration? maxBackoff,
+      int? maxAttempts,
+      Duration? connectTimeout}) async {
     throw UnimplementedError('connect() has not been implemented.');
   }
 
+  Future<void> disconnect() async {
+    throw UnimplementedError('disconnect() has not been implemented.');
+  }
+
+  Future<List<MillicastSource>> getAudioSources() async {
+    throw UnimplementedError('getAudioSources() has not been implemented.');
+  }
+
+  Future<List<MillicastSource>> getVideoSources() async {
+    throw UnimplementedError('getVideoSources() has not been implemented.');
+  }
+
+  Future<void> refreshSources() async {
+    throw UnimplementedError('refreshSources() has not been implemented.');
+  }
+
+  Future<void> setCustomVideoSrc() async {
+    throw UnimplementedError('setCustomVideoSrc() has not been implemented.');
+  }
+
+  Future<bool> pushVideoFrame(Uint8List bytes,
+      {required int width,
+      required int height,
+      MillicastFrameFormat format = MillicastFrameFormat.rgba,
+      Duration? timestamp}) async {
+    throw UnimplementedError('pushVideoFrame() has not been implemented.');
+  }
+
   Future<void> printSupportedAudioCodecs() async {
     throw UnimplementedError(
         'printSupportedAudioCodecs() has not been implemented.');
@@ -77,4 +116,18 @@ abstract class MillicastPlatform extends PlatformInterface {
   Future<void> dispose() async {
     throw UnimplementedError('dispose() has not been implemented.');
   }
+
+  Future<void> setPublishingProfile(MillicastPublishingProfile profile) async {
+    throw UnimplementedError(
+        'setPublishingProfile(MillicastPublishingProfile profile) has not been implemented.');
+  }
+
+  Future<void> setStatsInterval(Duration interval) async {
+    throw UnimplementedError(
+        'setStatsInterval(Duration interval) has not been implemented.');
+  }
+
+  Stream<MillicastEvent> events() {
+    throw UnimplementedError('events() has not been implemented.');
+  }
 }
@@ -0,0 +1,40 @@
+/// What the encoder gives up first when the bandwidth or the CPU is short.
+enum MillicastDegradationPreference {
+  maintainFramerate,
+  maintainResolution,
+  balanced,
+}
+
+/// The encoding settings of the publisher. The settings which are null are
+/// left unchanged.
+class MillicastPublishingProfile {
+  const MillicastPublishingProfile({
+    this.maxBitrateKbps,
+    this.minBitrateKbps,
+    this.startBitrateKbps,
+    this.simulcast,
+    this.scalabilityMode,
+    this.degradationPreference,
+    this.adaptiveBitrate = false,
+  });
+
+  final int? maxBitrateKbps;
+  final int? minBitrateKbps;
+  final int? startBitrateKbps;
+
+  /// Whether several resolutions are sent so the viewers can receive the one
+  /// which fits their bandwidth.
+  final bool? simulcast;
+
+  /// The SVC mode, such as 'L1T3' or 'L3T3'.
+  final String? scalabilityMode;
+
+  final MillicastDegradationPreference? degradationPreference;
+
+  /// Whether the maximum bitrate is stepped down between [minBitrateKbps] and
+  /// [maxBitrateKbps] while the viewers report packet loss or a growing round
+  /// trip time, and back up when it recovers. The changes are sent as
+  /// [MillicastEventType.bitrate] events. The adapted maximum is kept when the
+  /// publisher reconnects.
+  final bool adaptiveBitrate;
+}
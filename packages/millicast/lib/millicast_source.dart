@@ -0,0 +1,17 @@
+/// An audio or video capture device.
+class MillicastSource {
+  const MillicastSource(this.name, this.id);
+
+  final String name;
+
+  /// The unique id, which can be used instead of [name] to select the source
+  /// when several devices have the same name.
+  final String id;
+
+  factory MillicastSource.fromMap(Map<Object?, Object?> map) {
+    return MillicastSource(map['name'] as String, map['id'] as String);
+  }
+
+  @override
+  String toString() => '$name ($id)';
+}
@@ -1,5 +1,10 @@
+import 'dart:typed_data';
+
 import 'package:flutter/services.dart';
 import 'package:flutter_test/flutter_test.dart';
+import 'package:millicast/millicast_event.dart';
+import 'package:millicast/millicast_frame_format.dart';
+import 'package:millicast/millicast_publishing_profile.dart';
 import 'package:millicast/millicast_method_channel.dart';
 
 void main() {
@@ -8,9 +13,16 @@ void main() {
 
   TestWidgetsFlutterBinding.ensureInitialized();
 
+  // The last call to the channel and the value returned to it.
+  MethodCall? call;
+  Object? result;
+
   setUp(() {
+    call = null;
+    result = '42';
     channel.setMockMethodCallHandler((MethodCall methodCall) async {
-      return '42';
+      call = methodCall;
+      return result;
     });
   });
 
@@ -21,4 +33,125 @@ void main() {
   test('getPlatformVersion', () async {
     expect(await platform.getPlatformVersion(), '42');
   });
+
+  test('setStatsInterval', () async {
+    await platform.setStatsInterval(const Duration(seconds: 2));
+    expect(call!.method, 'setStatsInterval');
+    expect(call!.arguments, <String, Object>{'interval_ms': 2000});
+  });
+
+  test('connect', () async {
+    await platform.connect(
+        initialBackoff: const Duration(seconds: 1), maxAttempts: 5);
+    expect(call!.method, 'connect');
+    expect(call!.arguments, <String, Object?>{
+      'initial_delay_ms': 1000,
+      'max_delay_ms': null,
+      'max_attempts': 5,
+      'connect_timeout_ms': null,
+    });
+  });
+
+  test('setPublishingProfile', () async {
+    await platform.setPublishingProfile(const MillicastPublishingProfile(
+      maxBitrateKbps: 2500,
+      minBitrateKbps: 300,
+      simulcast: true,
+      degradationPreference: MillicastDegradationPreference.maintainFramerate,
+      adaptiveBitrate: true,
+    ));
+    expect(call!.method, 'setPublishingProfile');
+    expect(call!.arguments, <String, Object?>{
+      'max_bitrate_kbps': 2500,
+      'min_bitrate_kbps': 300,
+      'start_bitrate_kbps': null,
+      'simulcast': true,
+      'scalability_mode': null,
+      'degradation_preference': 'maintainFramerate',
+      'adaptive_bitrate': true,
+    });
+  });
+
+  test('setVideoSrc', () async {
+    await platform.setVideoSrc('USB Camera', width: 1280, height: 720);
+    expect(call!.method, 'setVideoSrc');
+    expect(call!.arguments, <String, Object?>{
+      'video_src': 'USB Camera',
+      'width': 1280,
+      'height': 720,
+      'fps': null,
+    });
+  });
+
+  test('getVideoSources', () async {
+    result = <Object?>[
+      <Object?, Object?>{'name': 'USB Camera', 'id': '/dev/video0'},
+    ];
+    final sources = await platform.getVideoSources();
+    expect(call!.method, 'getVideoSources');
+    expect(sources.length, 1);
+    expect(sources[0].name, 'USB Camera');
+    expect(sources[0].id, '/dev/video0');
+  });
+
+  test('pushVideoFrame', () async {
+    result = true;
+    final Uint8List bytes = Uint8List(2 * 2 * 4);
+    expect(
+        await platform.pushVideoFrame(bytes,
+            width: 2, height: 2, timestamp: const Duration(seconds: 1)),
+        isTrue);
+    expect(call!.method, 'pushVideoFrame');
+    expect(call!.arguments, <String, Object?>{
+      'format': MillicastFrameFormat.rgba.index,
+      'width': 2,
+      'height': 2,
+      'bytes': bytes,
+      'timestamp_us': 1000000,
+    });
+  });
+
+  test('MillicastEvent.fromMap', () {
+    final MillicastEvent? stats = MillicastEvent.fromMap(<Object?, Object?>{
+      'event': 'stats',
+      'window_ms': 5000,
+      'sample_count': 5,
+      'bitrate_bps': <Object?, Object?>{'min': 1.0, 'avg': 2.0, 'max': 3.0},
+      'round_trip_time_ms': null,
+      'fraction_lost': <Object?, Object?>{'min': 0.0, 'avg': 0.0, 'max': 0.0},
+      'encoder_fps': <Object?, Object?>{'min': 29.5, 'avg': 30.0, 'max': 30},
+    });
+    expect(stats!.type, MillicastEventType.stats);
+    expect(stats.stats!.window, const Duration(seconds: 5));
+    expect(stats.stats!.sampleCount, 5);
+    expect(stats.stats!.bitrate!.avg, 2.0);
+    expect(stats.stats!.roundTripTime, isNull);
+    expect(stats.stats!.encoderFps!.max, 30.0);
+
+    final MillicastEvent? error = MillicastEvent.fromMap(<Object?, Object?>{
+      'event': 'connectionError',
+      'code': 401,
+      'message': 'Unauthorized',
+    });
+    expect(error!.type, MillicastEventType.connectionError);
+    expect(error.code, 401);
+    expect(error.message, 'Unauthorized');
+    expect(error.stats, isNull);
+
+    final MillicastEvent? state = MillicastEvent.fromMap(<Object?, Object?>{
+      'event': 'state',
+      'state': 'backoff',
+      'attempt': 2,
+      'delay_ms': 1000,
+      'reason': 'Timed out',
+    });
+    expect(state!.type, MillicastEventType.state);
+    expect(state.state, MillicastPublisherState.backoff);
+    expect(state.attempt, 2);
+    expect(state.retryDelay, const Duration(seconds: 1));
+    expect(state.message, 'Timed out');
+
+    expect(MillicastEvent.fromMap(<Object?, Object?>{'event': 'unknown'}),
+        isNull);
+  });
 }
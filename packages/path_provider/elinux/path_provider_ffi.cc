@@ -0,0 +1,127 @@
+// Copyright 2022 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace {
+
+// Returns the name of the executable without the extension, the same as
+// path.basenameWithoutExtension of /proc/self/exe.
+std::string GetExecutableName() {
+  char path[PATH_MAX];
+  auto length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+  if (length < 0) {
+    return "";
+  }
+  std::string name(path, length);
+  name = name.substr(name.find_last_of('/') + 1);
+  auto extension = name.find_last_of('.');
+  if (extension != std::string::npos && extension != 0) {
+    name = name.substr(0, extension);
+  }
+  return name;
+}
+
+std::string GetHome() {
+  const auto* home = getenv("HOME");
+  return home ? home : "";
+}
+
+// Returns $<name>, or $HOME/<fallback> if it's not set.
+std::string GetXdgBaseDirectory(const char* name, const char* fallback) {
+  const auto* directory = getenv(name);
+  if (directory && directory[0] != '\0') {
+    return directory;
+  }
+  return GetHome() + "/" + fallback;
+}
+
+// Returns the user directory |name| (e.g. DOCUMENTS) in user-dirs.dirs, or
+// $HOME if it's not set, the same as xdg-user-dir. Only the "$HOME/..." and
+// "/..." forms written by xdg-user-dirs-update are supported.
+std::string GetUserDirectory(const std::string& name) {
+  std::ifstream file(GetXdgBaseDirectory("XDG_CONFIG_HOME", ".config") +
+                     "/user-dirs.dirs");
+  const auto prefix = "XDG_" + name + "_DIR=\"";
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.compare(0, prefix.size(), prefix) != 0 || line.back() != '"') {
+      continue;
+    }
+    auto value = line.substr(prefix.size(), line.size() - prefix.size() - 1);
+    if (value.compare(0, 5, "$HOME") == 0) {
+      return GetHome() + value.substr(5);
+    }
+    if (!value.empty() && value[0] == '/') {
+      return value;
+    }
+  }
+  return GetHome();
+}
+
+bool CreateDirectories(const std::string& path) {
+  for (size_t pos = path.find('/', 1);; pos = path.find('/', pos + 1)) {
+    auto directory = path.substr(0, pos);
+    // The same mode as Directory.create of Dart, which is used when this
+    // library isn't available.
+    if (mkdir(directory.c_str(), 0777) < 0 && errno != EEXIST) {
+      fprintf(stderr, "Failed to create %s (%d)\n", directory.c_str(), errno);
+      return false;
+    }
+    if (pos == std::string::npos) {
+      return true;
+    }
+  }
+}
+
+}  // namespace
+
+// Returns the application support directory ($XDG_DATA_HOME/<executable>),
+// creating it if needed. It's resolved only once per process. Returns nullptr
+// on error. The returned string must not be freed.
+extern "C" __attribute__((visibility("default"))) const char*
+path_provider_get_application_support_path() {
+  static std::once_flag once;
+  static std::string path;
+  std::call_once(once, [] {
+    auto name = GetExecutableName();
+    if (name.empty()) {
+      fprintf(stderr, "Failed to resolve /proc/self/exe (%d)\n", errno);
+      return;
+    }
+    auto directory =
+        GetXdgBaseDirectory("XDG_DATA_HOME", ".local/share") + "/" + name;
+    if (CreateDirectories(directory)) {
+      path = directory;
+    }
+  });
+  return path.empty() ? nullptr : path.c_str();
+}
+
+// Returns the XDG user directory |name| (e.g. DOCUMENTS or DOWNLOAD) without
+// running xdg-user-dir. Each directory is resolved only once per process. The
+// returned string must not be freed.
+extern "C" __attribute__((visibility("default"))) const char*
+path_provider_get_user_directory(const char* name) {
+  static std::mutex mutex;
+  // The values of std::map aren't moved by insertions, so the returned
+  // strings stay valid.
+  static std::map<std::string, std::string> directories;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = directories.find(name);
+  if (it == directories.end()) {
+    it = directories.emplace(name, GetUserDirectory(name)).first;
+  }
+  return it->second.c_str();
+}
@@ -3,12 +3,82 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+import 'dart:ffi';
 import 'dart:io';
 
+import 'package:ffi/ffi.dart';
 import 'package:path/path.dart' as path;
 import 'package:path_provider_platform_interface/path_provider_platform_interface.dart';
 import 'package:xdg_directories/xdg_directories.dart' as xdg;
 
+typedef _GetPathNative = Pointer<Utf8> Function();
+typedef _GetPath = Pointer<Utf8> Function();
+typedef _GetUserDirectoryNative = Pointer<Utf8> Function(Pointer<Utf8> name);
+typedef _GetUserDirectory = Pointer<Utf8> Function(Pointer<Utf8> name);
+
+DynamicLibrary? _openLibrary() {
+  try {
+    return DynamicLibrary.open('libpath_provider_elinux_plugin.so');
+  } catch (_) {
+    return null;
+  }
+}
+
+final DynamicLibrary? _dylib = _openLibrary();
+
+/// Resolves the application support path natively, which resolves
+/// /proc/self/exe and creates the directory only once per process. Returns
+/// null when the native library isn't available.
+String? _getApplicationSupportPathNatively() {
+  final DynamicLibrary? dylib = _dylib;
+  if (dylib == null) {
+    return null;
+  }
+  final _GetPath getPath = dylib
+      .lookup<NativeFunction<_GetPathNative>>(
+          'path_provider_get_application_support_path')
+      .asFunction();
+  final Pointer<Utf8> nativePath = getPath();
+  return nativePath == nullptr ? null : nativePath.toDartString();
+}
+
+Future<String?> _resolveApplicationSupportPath() async {
+  final String? nativePath = _getApplicationSupportPathNatively();
+  if (nativePath != null) {
+    return nativePath;
+  }
+
+  final String processName = path.basenameWithoutExtension(
+      await File('/proc/self/exe').resolveSymbolicLinks());
+  final Directory directory =
+      Directory(path.join(xdg.dataHome.path, processName));
+  // Creating the directory if it doesn't exist, because mobile implementations assume the directory exists
+  if (!directory.existsSync()) {
+    await directory.create(recursive: true);
+  }
+  return directory.path;
+}
+
+/// Resolves the XDG user directory [name] (e.g. DOCUMENTS). It's read from
+/// user-dirs.dirs by the native library when it's available, which saves
+/// running xdg-user-dir.
+Future<String?> _resolveUserDirectory(String name) async {
+  final DynamicLibrary? dylib = _dylib;
+  if (dylib == null) {
+    return xdg.getUserDirectory(name)?.path;
+  }
+  final _GetUserDirectory getUserDirectory = dylib
+      .lookup<NativeFunction<_GetUserDirectoryNative>>(
+          'path_provider_get_user_directory')
+      .asFunction();
+  final Pointer<Utf8> nativeName = name.toNativeUtf8();
+  try {
+    return getUserDirectory(nativeName).toDartString();
+  } finally {
+    malloc.free(nativeName);
+  }
+}
+
 /// The elinux implementation of [PathProviderPlatform]
 ///
 /// This class implements the `package:path_provider` functionality for eLinux
@@ -23,26 +93,39 @@ class PathProviderELinux extends PathProviderPlatform {
     return Future<String?>.value('/tmp');
   }
 
-  @override
-  Future<String?> getApplicationSupportPath() async {
-    final String processName = path.basenameWithoutExtension(
-        await File('/proc/self/exe').resolveSymbolicLinks());
-    final Directory directory =
-        Directory(path.join(xdg.dataHome.path, processName));
-    // Creating the directory if it doesn't exist, because mobile implementations assume the directory exists
-    if (!directory.existsSync()) {
-      await directory.create(recursive: true);
+  // The paths don't change while the process is running, so they are
+  // resolved only once and shared by all the instances. A failed resolution
+  // isn't kept, so the next call tries again.
+  static final Map<String, Future<String?>> _paths = {};
+
+  static Future<String?> _memoize(
+      String key, Future<String?> Function() resolve) {
+    final Future<String?>? memoized = _paths[key];
+    if (memoized != null) {
+      return memoized;
     }
-    return directory.path;
+    final Future<String?> resolving = _paths[key] = resolve();
+    resolving.catchError((Object _) {
+      if (identical(_paths[key], resolving)) {
+        _paths.remove(key);
+      }
+      return null;
+    });
+    return resolving;
+  }
+
+  @override
+  Future<String?> getApplicationSupportPath() {
+    return _memoize('support', _resolveApplicationSupportPath);
   }
 
   @override
   Future<String?> getApplicationDocumentsPath() {
-    return Future<String?>.value(xdg.getUserDirectory('DOCUMENTS')?.path);
+    return _memoize('documents', () => _resolveUserDirectory('DOCUMENTS'));
   }
 
   @override
   Future<String?> getDownloadsPath() {
-    return Future<String?>.value(xdg.getUserDirectory('DOWNLOAD')?.path);
+    return _memoize('downloads', () => _resolveUserDirectory('DOWNLOAD'));
   }
 }
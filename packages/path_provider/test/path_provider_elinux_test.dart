@@ -23,6 +23,14 @@ void main() {
     expect(await plugin.getApplicationSupportPath(), startsWith('/'));
   });
 
+  test('getApplicationSupportPath is resolved once', () async {
+    final PathProviderPlatform plugin = PathProviderPlatform.instance;
+    final Future<String?> first = plugin.getApplicationSupportPath();
+    expect(identical(plugin.getApplicationSupportPath(), first), isTrue);
+    expect(await PathProviderELinux().getApplicationSupportPath(),
+        await first);
+  });
+
   test('getApplicationDocumentsPath', () async {
     final PathProviderPlatform plugin = PathProviderPlatform.instance;
     expect(await plugin.getApplicationDocumentsPath(), startsWith('/'));
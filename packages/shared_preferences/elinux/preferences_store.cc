@@ -0,0 +1,408 @@
+// Copyright 2022 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "preferences_store.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <array>
+
+namespace {
+constexpr char kMagic[] = {'F', 'E', 'P', 'S'};
+constexpr uint32_t kVersion = 1;
+constexpr size_t kHeaderSize = sizeof(kMagic) + sizeof(uint32_t);
+// crc32, payload length.
+constexpr size_t kRecordHeaderSize = sizeof(uint32_t) * 2;
+// operation, key length.
+constexpr size_t kPayloadHeaderSize = sizeof(uint8_t) + sizeof(uint32_t);
+// The log isn't compacted while it's smaller than this.
+constexpr uint64_t kMinCompactionSize = 64 * 1024;
+
+uint32_t Crc32(const char* data, size_t length) {
+  static const auto table = [] {
+    std::array<uint32_t, 256> table;
+    for (uint32_t i = 0; i < table.size(); i++) {
+      uint32_t crc = i;
+      for (int bit = 0; bit < 8; bit++) {
+        crc = (crc & 1) ? 0xedb88320 ^ (crc >> 1) : crc >> 1;
+      }
+      table[i] = crc;
+    }
+    return table;
+  }();
+
+  uint32_t crc = 0xffffffff;
+  for (size_t i = 0; i < length; i++) {
+    crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xff] ^ (crc >> 8);
+  }
+  return crc ^ 0xffffffff;
+}
+
+void AppendUint32(std::string& buffer, uint32_t value) {
+  for (int i = 0; i < 4; i++) {
+    buffer.push_back(static_cast<char>((value >> (i * 8)) & 0xff));
+  }
+}
+
+uint32_t ReadUint32(const char* data) {
+  uint32_t value = 0;
+  for (int i = 0; i < 4; i++) {
+    value |= static_cast<uint32_t>(static_cast<uint8_t>(data[i])) << (i * 8);
+  }
+  return value;
+}
+
+std::string EncodeHeader() {
+  std::string header(kMagic, sizeof(kMagic));
+  AppendUint32(header, kVersion);
+  return header;
+}
+
+uint64_t GetEntrySize(const std::string& key, const std::string& value) {
+  return kRecordHeaderSize + kPayloadHeaderSize + key.size() + value.size();
+}
+
+bool WriteAll(int fd, const std::string& data) {
+  size_t written = 0;
+  while (written < data.size()) {
+    auto bytes = write(fd, data.data() + written, data.size() - written);
+    if (bytes < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    written += bytes;
+  }
+  return true;
+}
+
+bool ReadAll(int fd, std::string& data) {
+  char buffer[64 * 1024];
+  while (true) {
+    auto bytes = read(fd, buffer, sizeof(buffer));
+    if (bytes < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    if (bytes == 0) {
+      return true;
+    }
+    data.append(buffer, bytes);
+  }
+}
+
+void AppendJsonString(std::string& json, const std::string& str) {
+  json.push_back('"');
+  for (auto c : str) {
+    switch (c) {
+      case '"':
+        json.append("\\\"");
+        break;
+      case '\\':
+        json.append("\\\\");
+        break;
+      default:
+        if (static_cast<uint8_t>(c) < 0x20) {
+          char escaped[7];
+          snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+          json.append(escaped);
+        } else {
+          json.push_back(c);
+        }
+    }
+  }
+  json.push_back('"');
+}
+
+// Makes a rename in the directory of |path| durable.
+void SyncDirectory(const std::string& path) {
+  auto pos = path.find_last_of('/');
+  auto directory = pos == std::string::npos ? "." : path.substr(0, pos);
+  int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd >= 0) {
+    fsync(fd);
+    close(fd);
+  }
+}
+}  // namespace
+
+// static
+std::unique_ptr<PreferencesStore> PreferencesStore::Open(
+    const std::string& path) {
+  auto store = std::unique_ptr<PreferencesStore>(new PreferencesStore(path));
+  if (!store->Load()) {
+    return nullptr;
+  }
+  return store;
+}
+
+PreferencesStore::PreferencesStore(const std::string& path) : path_(path) {}
+
+PreferencesStore::~PreferencesStore() {
+  if (fd_ >= 0) {
+    fdatasync(fd_);
+    close(fd_);
+  }
+}
+
+bool PreferencesStore::Set(const std::string& key, const std::string& value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(key);
+  if (it != entries_.end() && it->second == value) {
+    return true;
+  }
+  return Append(Operation::kSet, key, value);
+}
+
+bool PreferencesStore::Remove(const std::string& key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!entries_.count(key)) {
+    return true;
+  }
+  return Append(Operation::kRemove, key, "");
+}
+
+bool PreferencesStore::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (entries_.empty()) {
+    return true;
+  }
+  return Append(Operation::kClear, "", "");
+}
+
+bool PreferencesStore::Sync() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (fdatasync(fd_) < 0) {
+    fprintf(stderr, "Failed to sync %s (%d)\n", path_.c_str(), errno);
+    return false;
+  }
+  if (NeedsCompaction()) {
+    // The appended records are already durable, so a failure isn't fatal.
+    CompactLocked();
+  }
+  return true;
+}
+
+bool PreferencesStore::Compact() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return CompactLocked();
+}
+
+bool PreferencesStore::CompactLocked() {
+  auto log = EncodeHeader();
+  for (const auto& entry : entries_) {
+    log.append(EncodeRecord(Operation::kSet, entry.first, entry.second));
+  }
+
+  // Writes the new log next to the current one and replaces it atomically, so
+  // either of them is always complete.
+  auto temp_path = path_ + ".tmp";
+  int fd =
+      open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    fprintf(stderr, "Failed to create %s (%d)\n", temp_path.c_str(), errno);
+    return false;
+  }
+  if (!WriteAll(fd, log) || fsync(fd) < 0) {
+    fprintf(stderr, "Failed to write %s (%d)\n", temp_path.c_str(), errno);
+    close(fd);
+    unlink(temp_path.c_str());
+    return false;
+  }
+  close(fd);
+  if (rename(temp_path.c_str(), path_.c_str()) < 0) {
+    fprintf(stderr, "Failed to replace %s (%d)\n", path_.c_str(), errno);
+    unlink(temp_path.c_str());
+    return false;
+  }
+  SyncDirectory(path_);
+
+  close(fd_);
+  if (!OpenLog()) {
+    return false;
+  }
+  log_size_ = log.size();
+  live_size_ = log.size();
+  return true;
+}
+
+std::string PreferencesStore::ExportJson() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::string json = "{";
+  for (const auto& entry : entries_) {
+    if (json.size() > 1) {
+      json.push_back(',');
+    }
+    AppendJsonString(json, entry.first);
+    json.push_back(':');
+    json.append(entry.second);
+  }
+  json.push_back('}');
+  return json;
+}
+
+size_t PreferencesStore::GetEntryCount() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+bool PreferencesStore::Load() {
+  if (!OpenLog()) {
+    return false;
+  }
+
+  std::string data;
+  if (!ReadAll(fd_, data)) {
+    fprintf(stderr, "Failed to read %s (%d)\n", path_.c_str(), errno);
+    return false;
+  }
+
+  auto header = EncodeHeader();
+  if (data.compare(0, header.size(), header) != 0) {
+    if (!data.empty()) {
+      fprintf(stderr, "%s is not a preferences store, it's reset\n",
+              path_.c_str());
+    }
+    if (ftruncate(fd_, 0) < 0 || !WriteAll(fd_, header)) {
+      fprintf(stderr, "Failed to initialize %s (%d)\n", path_.c_str(), errno);
+      return false;
+    }
+    log_size_ = header.size();
+    live_size_ = header.size();
+    return true;
+  }
+
+  size_t offset = kHeaderSize;
+  while (offset + kRecordHeaderSize <= data.size()) {
+    auto crc = ReadUint32(data.data() + offset);
+    auto length = ReadUint32(data.data() + offset + sizeof(uint32_t));
+    auto payload_offset = offset + kRecordHeaderSize;
+    if (length > data.size() - payload_offset ||
+        Crc32(data.data() + offset + sizeof(uint32_t),
+              sizeof(uint32_t) + length) != crc ||
+        !Apply(data.substr(payload_offset, length))) {
+      break;
+    }
+    offset = payload_offset + length;
+  }
+
+  if (offset < data.size()) {
+    fprintf(stderr, "Discarded %zu bytes of incomplete records in %s\n",
+            data.size() - offset, path_.c_str());
+    if (ftruncate(fd_, offset) < 0) {
+      fprintf(stderr, "Failed to truncate %s (%d)\n", path_.c_str(), errno);
+      return false;
+    }
+  }
+  log_size_ = offset;
+  live_size_ = kHeaderSize;
+  for (const auto& entry : entries_) {
+    live_size_ += GetEntrySize(entry.first, entry.second);
+  }
+  return true;
+}
+
+bool PreferencesStore::Apply(const std::string& payload) {
+  if (payload.size() < kPayloadHeaderSize) {
+    return false;
+  }
+  auto operation = static_cast<Operation>(payload[0]);
+  auto key_length = ReadUint32(payload.data() + 1);
+  if (key_length > payload.size() - kPayloadHeaderSize) {
+    return false;
+  }
+  auto key = payload.substr(kPayloadHeaderSize, key_length);
+
+  switch (operation) {
+    case Operation::kSet:
+      entries_[key] = payload.substr(kPayloadHeaderSize + key_length);
+      return true;
+    case Operation::kRemove:
+      entries_.erase(key);
+      return true;
+    case Operation::kClear:
+      entries_.clear();
+      return true;
+  }
+  return false;
+}
+
+bool PreferencesStore::Append(Operation operation, const std::string& key,
+                              const std::string& value) {
+  auto record = EncodeRecord(operation, key, value);
+  if (!WriteAll(fd_, record)) {
+    fprintf(stderr, "Failed to write %s (%d)\n", path_.c_str(), errno);
+    // Drops the partial record so that the following records stay readable.
+    if (ftruncate(fd_, log_size_) < 0) {
+      fprintf(stderr, "Failed to truncate %s (%d)\n", path_.c_str(), errno);
+    }
+    return false;
+  }
+  log_size_ += record.size();
+
+  auto it = entries_.find(key);
+  switch (operation) {
+    case Operation::kSet:
+      if (it != entries_.end()) {
+        live_size_ -= GetEntrySize(key, it->second);
+        it->second = value;
+      } else {
+        entries_.emplace(key, value);
+      }
+      live_size_ += GetEntrySize(key, value);
+      break;
+    case Operation::kRemove:
+      if (it != entries_.end()) {
+        live_size_ -= GetEntrySize(key, it->second);
+        entries_.erase(it);
+      }
+      break;
+    case Operation::kClear:
+      entries_.clear();
+      live_size_ = kHeaderSize;
+      break;
+  }
+  return true;
+}
+
+bool PreferencesStore::OpenLog() {
+  fd_ = open(path_.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+  if (fd_ < 0) {
+    fprintf(stderr, "Failed to open %s (%d)\n", path_.c_str(), errno);
+    return false;
+  }
+  return true;
+}
+
+bool PreferencesStore::NeedsCompaction() const {
+  return log_size_ > kMinCompactionSize && log_size_ > live_size_ * 2;
+}
+
+// static
+std::string PreferencesStore::EncodeRecord(Operation operation,
+                                           const std::string& key,
+                                           const std::string& value) {
+  std::string record;
+  record.reserve(GetEntrySize(key, value));
+  // The crc32 is filled in after the rest is encoded.
+  AppendUint32(record, 0);
+  AppendUint32(record, kPayloadHeaderSize + key.size() + value.size());
+  record.push_back(static_cast<char>(operation));
+  AppendUint32(record, key.size());
+  record.append(key);
+  record.append(value);
+
+  std::string crc;
+  AppendUint32(crc, Crc32(record.data() + sizeof(uint32_t),
+                          record.size() - sizeof(uint32_t)));
+  record.replace(0, crc.size(), crc);
+  return record;
+}
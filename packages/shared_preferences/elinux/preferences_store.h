@@ -0,0 +1,83 @@
+// Copyright 2022 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PACKAGES_SHARED_PREFERENCES_SHARED_PREFERENCES_ELINUX_PREFERENCES_STORE_H_
+#define PACKAGES_SHARED_PREFERENCES_SHARED_PREFERENCES_ELINUX_PREFERENCES_STORE_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// A key/value store backed by an append-only log file.
+//
+// Each update appends a single record to the log, so its cost doesn't depend
+// on the size of the store. The log is rewritten with only the live entries
+// (compaction) by Sync() when it grows more than twice as large as them.
+//
+// File format:
+//   header: "FEPS" (4 bytes), version (uint32)
+//   record: crc32 of the rest (uint32), payload length (uint32), payload
+//   payload: operation (uint8), key length (uint32), key, value
+// All integers are little-endian. On load, the log is truncated at the first
+// incomplete or corrupted record, which is what a crash in the middle of an
+// append leaves behind, so the store recovers to the last complete update.
+class PreferencesStore {
+ public:
+  // Opens or creates the store at |path|. Returns nullptr on error.
+  static std::unique_ptr<PreferencesStore> Open(const std::string& path);
+
+  ~PreferencesStore();
+
+  // Prevent copying.
+  PreferencesStore(PreferencesStore const&) = delete;
+  PreferencesStore& operator=(PreferencesStore const&) = delete;
+
+  bool Set(const std::string& key, const std::string& value);
+  bool Remove(const std::string& key);
+  bool Clear();
+
+  // Makes the appended records durable, and compacts the log if needed.
+  bool Sync();
+
+  // Rewrites the log with only the live entries.
+  bool Compact();
+
+  // Returns the entries as a JSON object. The values are embedded as they are,
+  // so they must be JSON texts.
+  std::string ExportJson();
+
+  size_t GetEntryCount();
+
+ private:
+  enum class Operation : uint8_t {
+    kSet = 1,
+    kRemove = 2,
+    kClear = 3,
+  };
+
+  explicit PreferencesStore(const std::string& path);
+
+  bool Load();
+  // Applies |payload| to |entries_|. Returns false if it's malformed.
+  bool Apply(const std::string& payload);
+  bool Append(Operation operation, const std::string& key,
+              const std::string& value);
+  bool CompactLocked();
+  bool OpenLog();
+  bool NeedsCompaction() const;
+  static std::string EncodeRecord(Operation operation, const std::string& key,
+                                  const std::string& value);
+
+  std::mutex mutex_;
+  std::string path_;
+  int fd_ = -1;
+  std::unordered_map<std::string, std::string> entries_;
+  // The size of the log file and the size which the live entries take in it.
+  uint64_t log_size_ = 0;
+  uint64_t live_size_ = 0;
+};
+
+#endif  // PACKAGES_SHARED_PREFERENCES_SHARED_PREFERENCES_ELINUX_PREFERENCES_STORE_H_
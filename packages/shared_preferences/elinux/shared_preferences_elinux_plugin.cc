@@ -0,0 +1,42 @@
+// Copyright 2022 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "include/shared_preferences_elinux/shared_preferences_elinux_plugin.h"
+
+#include <flutter/plugin_registrar.h>
+
+#include <memory>
+
+namespace {
+
+// The preferences store is used through FFI, so this plugin only makes the
+// Flutter tool build and bundle the library.
+class SharedPreferencesElinuxPlugin : public flutter::Plugin {
+ public:
+  static void RegisterWithRegistrar(flutter::PluginRegistrar* registrar);
+
+  SharedPreferencesElinuxPlugin();
+
+  virtual ~SharedPreferencesElinuxPlugin();
+};
+
+// static
+void SharedPreferencesElinuxPlugin::RegisterWithRegistrar(
+    flutter::PluginRegistrar* registrar) {
+  auto plugin = std::make_unique<SharedPreferencesElinuxPlugin>();
+  registrar->AddPlugin(std::move(plugin));
+}
+
+SharedPreferencesElinuxPlugin::SharedPreferencesElinuxPlugin() {}
+
+SharedPreferencesElinuxPlugin::~SharedPreferencesElinuxPlugin() {}
+
+}  // namespace
+
+void SharedPreferencesElinuxPluginRegisterWithRegistrar(
+    FlutterDesktopPluginRegistrarRef registrar) {
+  SharedPreferencesElinuxPlugin::RegisterWithRegistrar(
+      flutter::PluginRegistrarManager::GetInstance()
+          ->GetRegistrar<flutter::PluginRegistrar>(registrar));
+}
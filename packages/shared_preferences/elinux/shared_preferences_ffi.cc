@@ -0,0 +1,54 @@
+// Copyright 2022 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "preferences_store.h"
+
+// Opens the preferences store at |path|. Returns nullptr on error.
+extern "C" __attribute__((visibility("default"))) void*
+shared_preferences_open(const char* path) {
+  return PreferencesStore::Open(path).release();
+}
+
+extern "C" __attribute__((visibility("default"))) void
+shared_preferences_close(void* store) {
+  delete static_cast<PreferencesStore*>(store);
+}
+
+// Sets |value|, which must be a JSON text, to |key|. Returns 0 on success or
+// -1 on error.
+extern "C" __attribute__((visibility("default"))) int shared_preferences_set(
+    void* store, const char* key, const char* value) {
+  return static_cast<PreferencesStore*>(store)->Set(key, value) ? 0 : -1;
+}
+
+extern "C" __attribute__((visibility("default"))) int
+shared_preferences_remove(void* store, const char* key) {
+  return static_cast<PreferencesStore*>(store)->Remove(key) ? 0 : -1;
+}
+
+extern "C" __attribute__((visibility("default"))) int shared_preferences_clear(
+    void* store) {
+  return static_cast<PreferencesStore*>(store)->Clear() ? 0 : -1;
+}
+
+// Makes the updates durable. Returns 0 on success or -1 on error.
+extern "C" __attribute__((visibility("default"))) int shared_preferences_sync(
+    void* store) {
+  return static_cast<PreferencesStore*>(store)->Sync() ? 0 : -1;
+}
+
+// Returns all the preferences as a JSON object. The returned string must be
+// released by shared_preferences_free.
+extern "C" __attribute__((visibility("default"))) char*
+shared_preferences_export(void* store) {
+  return strdup(static_cast<PreferencesStore*>(store)->ExportJson().c_str());
+}
+
+extern "C" __attribute__((visibility("default"))) void shared_preferences_free(
+    char* str) {
+  free(str);
+}
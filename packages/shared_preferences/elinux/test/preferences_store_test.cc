@@ -0,0 +1,195 @@
+// Copyright 2022 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Tests the recovery and the compaction of the native preferences store.
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "preferences_store.h"
+
+namespace {
+// "FEPS" and the version.
+constexpr size_t kHeaderSize = 8;
+// crc32, payload length, operation and key length.
+constexpr size_t kRecordOverhead = 13;
+
+// Gives each test a store file in a temporary directory.
+class PreferencesStoreTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    char directory_template[] = "/tmp/preferences_store_test.XXXXXX";
+    ASSERT_NE(mkdtemp(directory_template), nullptr);
+    directory_ = directory_template;
+  }
+
+  void TearDown() override {
+    if (directory_.empty()) {
+      return;
+    }
+    unlink(GetPath().c_str());
+    unlink((GetPath() + ".tmp").c_str());
+    rmdir(directory_.c_str());
+  }
+
+  std::string GetPath() const { return directory_ + "/preferences.log"; }
+
+ private:
+  std::string directory_;
+};
+
+size_t GetRecordSize(const std::string& key, const std::string& value) {
+  return kRecordOverhead + key.size() + value.size();
+}
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file),
+                     std::istreambuf_iterator<char>());
+}
+
+void WriteFile(const std::string& path, const std::string& data) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(data.data(), data.size());
+}
+
+off_t GetFileSize(const std::string& path) {
+  struct stat st;
+  return stat(path.c_str(), &st) == 0 ? st.st_size : -1;
+}
+
+TEST_F(PreferencesStoreTest, Reopen) {
+  auto path = GetPath();
+  {
+    auto store = PreferencesStore::Open(path);
+    ASSERT_NE(store, nullptr);
+    EXPECT_TRUE(store->Set("key1", "\"one\""));
+    EXPECT_TRUE(store->Set("key2", "2"));
+    EXPECT_TRUE(store->Set("key3", "true"));
+    EXPECT_TRUE(store->Remove("key3"));
+    EXPECT_TRUE(store->Set("key1", "\"uno\""));
+    EXPECT_TRUE(store->Sync());
+  }
+  auto store = PreferencesStore::Open(path);
+  ASSERT_NE(store, nullptr);
+  EXPECT_EQ(store->GetEntryCount(), 2u);
+  auto json = store->ExportJson();
+  EXPECT_TRUE(json == "{\"key1\":\"uno\",\"key2\":2}" ||
+              json == "{\"key2\":2,\"key1\":\"uno\"}");
+
+  EXPECT_TRUE(store->Clear());
+  store = PreferencesStore::Open(path);
+  ASSERT_NE(store, nullptr);
+  EXPECT_EQ(store->GetEntryCount(), 0u);
+  EXPECT_EQ(store->ExportJson(), "{}");
+}
+
+// A crash in the middle of an append leaves an incomplete record at the end.
+TEST_F(PreferencesStoreTest, CrashTruncation) {
+  auto path = GetPath();
+  {
+    auto store = PreferencesStore::Open(path);
+    ASSERT_NE(store, nullptr);
+    EXPECT_TRUE(store->Set("key1", "\"one\""));
+    EXPECT_TRUE(store->Set("key2", "\"two\""));
+    EXPECT_TRUE(store->Sync());
+  }
+  auto complete_size = kHeaderSize + GetRecordSize("key1", "\"one\"");
+  EXPECT_EQ(GetFileSize(path),
+            static_cast<off_t>(complete_size +
+                               GetRecordSize("key2", "\"two\"")));
+  EXPECT_EQ(truncate(path.c_str(), complete_size + 6), 0);
+
+  {
+    auto store = PreferencesStore::Open(path);
+    ASSERT_NE(store, nullptr);
+    EXPECT_EQ(store->ExportJson(), "{\"key1\":\"one\"}");
+    // The incomplete record is discarded, so the next one is readable.
+    EXPECT_EQ(GetFileSize(path), static_cast<off_t>(complete_size));
+    EXPECT_TRUE(store->Set("key3", "3"));
+    EXPECT_TRUE(store->Sync());
+  }
+  auto store = PreferencesStore::Open(path);
+  ASSERT_NE(store, nullptr);
+  EXPECT_EQ(store->GetEntryCount(), 2u);
+}
+
+// The log is truncated at the first corrupted record, even if the following
+// ones are intact.
+TEST_F(PreferencesStoreTest, CrcCorruption) {
+  auto path = GetPath();
+  {
+    auto store = PreferencesStore::Open(path);
+    ASSERT_NE(store, nullptr);
+    EXPECT_TRUE(store->Set("key1", "\"one\""));
+    EXPECT_TRUE(store->Set("key2", "\"two\""));
+    EXPECT_TRUE(store->Set("key3", "\"three\""));
+    EXPECT_TRUE(store->Sync());
+  }
+  auto data = ReadFile(path);
+  auto corrupted_offset = kHeaderSize + GetRecordSize("key1", "\"one\"");
+  // Flips a byte of the value of key2.
+  data[corrupted_offset + GetRecordSize("key2", "\"two\"") - 2] ^= 0x01;
+  WriteFile(path, data);
+
+  auto store = PreferencesStore::Open(path);
+  ASSERT_NE(store, nullptr);
+  EXPECT_EQ(store->ExportJson(), "{\"key1\":\"one\"}");
+  EXPECT_EQ(GetFileSize(path), static_cast<off_t>(corrupted_offset));
+}
+
+// A file which isn't a store is reset instead of failing to open.
+TEST_F(PreferencesStoreTest, InvalidHeader) {
+  auto path = GetPath();
+  WriteFile(path, "{\"key1\":\"one\"}");
+  auto store = PreferencesStore::Open(path);
+  ASSERT_NE(store, nullptr);
+  EXPECT_EQ(store->GetEntryCount(), 0u);
+  EXPECT_EQ(GetFileSize(path), static_cast<off_t>(kHeaderSize));
+}
+
+TEST_F(PreferencesStoreTest, Compaction) {
+  auto path = GetPath();
+  const std::string value = "\"" + std::string(1000, 'x') + "\"";
+  {
+    auto store = PreferencesStore::Open(path);
+    ASSERT_NE(store, nullptr);
+    EXPECT_TRUE(store->Set("kept", "1"));
+    // Overwrites a single entry until the log is well over the minimum
+    // compaction size (64 KiB).
+    for (int i = 0; i < 100; i++) {
+      EXPECT_TRUE(store->Set("key", std::to_string(i) + value));
+    }
+    EXPECT_GT(GetFileSize(path), 64 * 1024);
+    EXPECT_TRUE(store->Sync());
+    EXPECT_EQ(GetFileSize(path),
+              static_cast<off_t>(kHeaderSize + GetRecordSize("kept", "1") +
+                                 GetRecordSize("key", "99" + value)));
+    // The log is reopened after the compaction, so it's still appendable.
+    EXPECT_TRUE(store->Remove("kept"));
+    EXPECT_TRUE(store->Sync());
+  }
+  EXPECT_NE(access((path + ".tmp").c_str(), F_OK), 0);
+
+  auto store = PreferencesStore::Open(path);
+
+  ASSERT_NE(store, nullptr);
+  EXPECT_EQ(store->GetEntryCount(), 1u);
+  EXPECT_EQ(store->ExportJson(), "{\"key\":99" + value + "}");
+
+  // A small log isn't compacted even if most of it is stale.
+  EXPECT_TRUE(store->Clear());
+  EXPECT_TRUE(store->Set("key", "1"));
+  EXPECT_TRUE(store->Set("key", "2"));
+  auto size = GetFileSize(path);
+  EXPECT_TRUE(store->Sync());
+  EXPECT_EQ(GetFileSize(path), size);
+}
+}  // namespace
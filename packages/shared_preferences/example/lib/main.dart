@@ -11,6 +11,7 @@ import 'package:flutter/material.dart';
 import 'package:shared_preferences_elinux/shared_preferences_elinux.dart';
 
 void main() {
+  SharedPreferencesELinux.prefetch();
   runApp(MyApp());
 }
 
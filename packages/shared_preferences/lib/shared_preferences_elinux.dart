@@ -8,11 +8,18 @@ import 'dart:convert' show json;
 
 import 'package:file/file.dart';
 import 'package:file/local.dart';
+import 'package:flutter/foundation.dart' show compute;
 import 'package:meta/meta.dart';
 import 'package:path/path.dart' as path;
 import 'package:path_provider_elinux/path_provider_elinux.dart';
 import 'package:shared_preferences_platform_interface/shared_preferences_platform_interface.dart';
 
+import 'src/native_preferences_store.dart';
+
+/// JSON files larger than this are decoded on a background isolate. Spawning
+/// an isolate costs more than decoding smaller files.
+const int _kBackgroundDecodeThreshold = 64 * 1024;
+
 /// The Linux implementation of [SharedPreferencesStorePlatform].
 ///
 /// This class implements the `package:shared_preferences` functionality for Linux.
@@ -25,13 +32,49 @@ class SharedPreferencesELinux extends SharedPreferencesStorePlatform {
     SharedPreferencesStorePlatform.instance = instance;
   }
 
+  /// Starts loading the preferences in the background so that they are ready
+  /// by the first access. Call this before `runApp`; there is no need to wait
+  /// for it.
+  static Future<void> prefetch() => instance._readPreferences();
+
   /// Local copy of preferences
   Map<String, Object>? _cachedPreferences;
 
+  /// The preferences being loaded.
+  Future<Map<String, Object>>? _loadingPreferences;
+
+  /// How long changes are collected before they are written to disk. All the
+  /// changes within this window are written at once.
+  Duration writeDelay = const Duration(milliseconds: 100);
+
+  /// Completes with the result of the next write, which contains all the
+  /// changes since the last write.
+  Completer<bool>? _pendingWrite;
+  Timer? _writeTimer;
+
+  /// The last write. Writes are serialized so that an older snapshot never
+  /// overwrites a newer one.
+  Future<void> _lastWrite = Future<void>.value();
+
   /// File system used to store to disk. Exposed for testing only.
   @visibleForTesting
   FileSystem fs = LocalFileSystem();
 
+  /// Whether the preferences are stored by the native store, which writes only
+  /// the changed entries, instead of rewriting a JSON file. It's used when the
+  /// native library is available. Changing this after the preferences have
+  /// been read has no effect.
+  bool useNativeStore = NativePreferencesStore.isAvailable;
+
+  NativePreferencesStore? _nativeStore;
+
+  /// The keys changed since the last write to the native store.
+  final Set<String> _changedKeys = <String>{};
+
+  /// Whether the preferences were cleared since the last write to the native
+  /// store.
+  bool _cleared = false;
+
   /// Gets the file where the preferences are stored.
   Future<File?> _getLocalDataFile() async {
     final pathProvider = PathProviderELinux();
@@ -41,38 +84,112 @@ class SharedPreferencesELinux extends SharedPreferencesStorePlatform {
   }
 
   /// Gets the preferences from the stored file. Once read, the preferences are
-  /// maintained in memory.
-  Future<Map<String, Object>> _readPreferences() async {
-    if (_cachedPreferences != null) {
-      return _cachedPreferences!;
+  /// maintained in memory. Concurrent calls share a single load. A failed load
+  /// isn't kept, so the next call tries again.
+  Future<Map<String, Object>> _readPreferences() {
+    final Map<String, Object>? cachedPreferences = _cachedPreferences;
+    if (cachedPreferences != null) {
+      return Future<Map<String, Object>>.value(cachedPreferences);
     }
+    return _loadingPreferences ??=
+        _loadPreferences().then((Map<String, Object> preferences) {
+      _cachedPreferences = preferences;
+      _loadingPreferences = null;
+      return preferences;
+    }, onError: (Object error, StackTrace stackTrace) {
+      _loadingPreferences = null;
+      return Future<Map<String, Object>>.error(error, stackTrace);
+    });
+  }
 
-    Map<String, Object> preferences = {};
+  /// Loads the preferences without blocking the UI isolate. The native store
+  /// is opened on a background isolate, and a large JSON file is decoded on a
+  /// background isolate.
+  Future<Map<String, Object>> _loadPreferences() async {
     final File? localDataFile = await _getLocalDataFile();
-    if (localDataFile != null && localDataFile.existsSync()) {
-      String stringMap = localDataFile.readAsStringSync();
-      if (stringMap.isNotEmpty) {
-        preferences = json.decode(stringMap).cast<String, Object>();
+
+    if (useNativeStore && localDataFile != null) {
+      final String storePath =
+          path.join(localDataFile.parent.path, 'shared_preferences.log');
+      final NativePreferencesLoadResult? result = await compute(
+          loadNativePreferencesStore, <String>[storePath, localDataFile.path]);
+      if (result != null) {
+        _nativeStore = NativePreferencesStore.fromAddress(result.address);
+        return result.preferences;
+      }
+      print("Unable to open the native store, falling back to JSON.");
+    }
+
+    Map<String, Object> preferences = {};
+    if (localDataFile != null && await localDataFile.exists()) {
+      String stringMap = await localDataFile.readAsString();
+      if (stringMap.length > _kBackgroundDecodeThreshold) {
+        preferences = await compute(decodePreferences, stringMap);
+      } else if (stringMap.isNotEmpty) {
+        preferences = decodePreferences(stringMap);
       }
     }
-    _cachedPreferences = preferences;
     return preferences;
   }
 
+  /// Schedules a write of the cached preferences. The returned future
+  /// completes with [true] once the preferences have been written.
+  Future<bool> _scheduleWrite() {
+    var completer = _pendingWrite;
+    if (completer == null) {
+      completer = _pendingWrite = Completer<bool>();
+      _writeTimer = Timer(writeDelay, _writePendingPreferences);
+    }
+    return completer.future;
+  }
+
+  /// Starts the scheduled write now.
+  Future<void> _writePendingPreferences() {
+    _writeTimer?.cancel();
+    _writeTimer = null;
+    final completer = _pendingWrite;
+    if (completer == null) {
+      return _lastWrite;
+    }
+    _pendingWrite = null;
+    _lastWrite = _lastWrite.then((_) async {
+      completer.complete(await _writePreferences(_cachedPreferences!));
+    });
+    return _lastWrite;
+  }
+
+  /// Writes the pending changes to disk immediately. Call this before the
+  /// app exits, otherwise the changes of the last [writeDelay] may be lost.
+  /// Returns [true] if there are no pending changes or they were written.
+  Future<bool> flush() async {
+    final pendingWrite = _pendingWrite;
+    await _writePendingPreferences();
+    return pendingWrite == null ? true : pendingWrite.future;
+  }
+
   /// Writes the cached preferences to disk. Returns [true] if the operation
   /// succeeded.
+  ///
+  /// The preferences are written to a temporary file first, which is synced
+  /// and then renamed to the data file, so the data file is never left half
+  /// written.
   Future<bool> _writePreferences(Map<String, Object> preferences) async {
+    if (_nativeStore != null) {
+      return _writeNativePreferences(_nativeStore!, preferences);
+    }
     try {
       var localDataFile = await _getLocalDataFile();
       if (localDataFile == null) {
         print("Unable to determine where to write preferences.");
         return false;
       }
-      if (!localDataFile.existsSync()) {
-        localDataFile.createSync(recursive: true);
+      if (!localDataFile.parent.existsSync()) {
+        await localDataFile.parent.create(recursive: true);
       }
       var stringMap = json.encode(preferences);
-      localDataFile.writeAsStringSync(stringMap);
+      var tempFile = fs.file('${localDataFile.path}.tmp');
+      await tempFile.writeAsString(stringMap, flush: true);
+      await tempFile.rename(localDataFile.path);
     } catch (e) {
       print("Error saving preferences to disk: $e");
       return false;
@@ -80,11 +197,36 @@ class SharedPreferencesELinux extends SharedPreferencesStorePlatform {
     return true;
   }
 
+  /// Writes the changed entries to the native store. Appending them is cheap,
+  /// but syncing may take long, especially when the log is compacted, so it's
+  /// done on a background isolate. Writes are serialized, so the store isn't
+  /// updated while it's being synced.
+  Future<bool> _writeNativePreferences(
+      NativePreferencesStore store, Map<String, Object> preferences) async {
+    var succeeded = true;
+    if (_cleared) {
+      succeeded &= store.clear();
+      _cleared = false;
+    }
+    for (final key in _changedKeys) {
+      final value = preferences[key];
+      succeeded &= value == null ? store.remove(key) : store.set(key, value);
+    }
+    _changedKeys.clear();
+    succeeded &= await compute(syncNativePreferencesStore, store.address);
+    if (!succeeded) {
+      print("Error saving preferences to the native store.");
+    }
+    return succeeded;
+  }
+
   @override
   Future<bool> clear() async {
     var preferences = await _readPreferences();
     preferences.clear();
-    return _writePreferences(preferences);
+    _changedKeys.clear();
+    _cleared = true;
+    return _scheduleWrite();
   }
 
   @override
@@ -96,13 +238,15 @@ class SharedPreferencesELinux extends SharedPreferencesStorePlatform {
   Future<bool> remove(String key) async {
     var preferences = await _readPreferences();
     preferences.remove(key);
-    return _writePreferences(preferences);
+    _changedKeys.add(key);
+    return _scheduleWrite();
   }
 
   @override
   Future<bool> setValue(String valueType, String key, Object value) async {
     var preferences = await _readPreferences();
     preferences[key] = value;
-    return _writePreferences(preferences);
+    _changedKeys.add(key);
+    return _scheduleWrite();
   }
 }
@@ -0,0 +1,168 @@
+// Copyright 2022 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+import 'dart:convert' show json;
+import 'dart:ffi';
+import 'dart:io';
+
+import 'package:ffi/ffi.dart';
+
+typedef _OpenNative = Pointer<Void> Function(Pointer<Utf8> path);
+typedef _Open = Pointer<Void> Function(Pointer<Utf8> path);
+typedef _CloseNative = Void Function(Pointer<Void> store);
+typedef _Close = void Function(Pointer<Void> store);
+typedef _SetNative = Int32 Function(
+    Pointer<Void> store, Pointer<Utf8> key, Pointer<Utf8> value);
+typedef _Set = int Function(
+    Pointer<Void> store, Pointer<Utf8> key, Pointer<Utf8> value);
+typedef _RemoveNative = Int32 Function(Pointer<Void> store, Pointer<Utf8> key);
+typedef _Remove = int Function(Pointer<Void> store, Pointer<Utf8> key);
+typedef _StoreNative = Int32 Function(Pointer<Void> store);
+typedef _Store = int Function(Pointer<Void> store);
+typedef _ExportNative = Pointer<Utf8> Function(Pointer<Void> store);
+typedef _Export = Pointer<Utf8> Function(Pointer<Void> store);
+typedef _FreeNative = Void Function(Pointer<Utf8> str);
+typedef _Free = void Function(Pointer<Utf8> str);
+
+DynamicLibrary? _openLibrary() {
+  try {
+    return DynamicLibrary.open('libshared_preferences_elinux_plugin.so');
+  } catch (_) {
+    return null;
+  }
+}
+
+/// The native preferences store, which keeps the preferences in an
+/// append-only log so that an update writes only the changed entry.
+/// See preferences_store.h.
+class NativePreferencesStore {
+  NativePreferencesStore._(this._store);
+
+  static final DynamicLibrary? _dylib = _openLibrary();
+
+  /// Whether the native library is available.
+  static bool get isAvailable => _dylib != null;
+
+  static final _Open _open = _dylib!
+      .lookup<NativeFunction<_OpenNative>>('shared_preferences_open')
+      .asFunction();
+  static final _Close _close = _dylib!
+      .lookup<NativeFunction<_CloseNative>>('shared_preferences_close')
+      .asFunction();
+  static final _Set _set = _dylib!
+      .lookup<NativeFunction<_SetNative>>('shared_preferences_set')
+      .asFunction();
+  static final _Remove _remove = _dylib!
+      .lookup<NativeFunction<_RemoveNative>>('shared_preferences_remove')
+      .asFunction();
+  static final _Store _clear = _dylib!
+      .lookup<NativeFunction<_StoreNative>>('shared_preferences_clear')
+      .asFunction();
+  static final _Store _sync = _dylib!
+      .lookup<NativeFunction<_StoreNative>>('shared_preferences_sync')
+      .asFunction();
+  static final _Export _export = _dylib!
+      .lookup<NativeFunction<_ExportNative>>('shared_preferences_export')
+      .asFunction();
+  static final _Free _free = _dylib!
+      .lookup<NativeFunction<_FreeNative>>('shared_preferences_free')
+      .asFunction();
+
+  final Pointer<Void> _store;
+
+  /// Returns the store opened by another isolate.
+  factory NativePreferencesStore.fromAddress(int address) =>
+      NativePreferencesStore._(Pointer<Void>.fromAddress(address));
+
+  /// The address of the native store, which can be passed to other isolates.
+  int get address => _store.address;
+
+  /// Opens or creates the store at [path]. Returns null on error.
+  static NativePreferencesStore? open(String path) {
+    final nativePath = path.toNativeUtf8();
+    try {
+      final store = _open(nativePath);
+      return store == nullptr ? null : NativePreferencesStore._(store);
+    } finally {
+      malloc.free(nativePath);
+    }
+  }
+
+  /// Returns all the preferences.
+  Map<String, Object> getAll() {
+    final exported = _export(_store);
+    try {
+      return json.decode(exported.toDartString()).cast<String, Object>();
+    } finally {
+      _free(exported);
+    }
+  }
+
+  bool set(String key, Object value) {
+    final nativeKey = key.toNativeUtf8();
+    final nativeValue = json.encode(value).toNativeUtf8();
+    try {
+      return _set(_store, nativeKey, nativeValue) == 0;
+    } finally {
+      malloc.free(nativeKey);
+      malloc.free(nativeValue);
+    }
+  }
+
+  bool remove(String key) {
+    final nativeKey = key.toNativeUtf8();
+    try {
+      return _remove(_store, nativeKey) == 0;
+    } finally {
+      malloc.free(nativeKey);
+    }
+  }
+
+  bool clear() => _clear(_store) == 0;
+
+  /// Makes the updates durable.
+  bool sync() => _sync(_store) == 0;
+
+  void close() => _close(_store);
+}
+
+/// Decodes the preferences in JSON.
+Map<String, Object> decodePreferences(String stringMap) {
+  return json.decode(stringMap).cast<String, Object>();
+}
+
+/// Makes the updates of the native store at [address] durable. This is run on
+/// a background isolate by [compute].
+bool syncNativePreferencesStore(int address) =>
+    NativePreferencesStore.fromAddress(address).sync();
+
+/// The result of [loadNativePreferencesStore].
+class NativePreferencesLoadResult {
+  NativePreferencesLoadResult(this.address, this.preferences);
+
+  /// The address of the opened [NativePreferencesStore].
+  final int address;
+  final Map<String, Object> preferences;
+}
+
+/// Opens the native store at `paths[0]` and returns it with all the
+/// preferences. When the store is created, the preferences in the JSON file at
+/// `paths[1]` are imported. This is run on a background isolate by [compute].
+NativePreferencesLoadResult? loadNativePreferencesStore(List<String> paths) {
+  final bool exists = File(paths[0]).existsSync();
+  final NativePreferencesStore? store = NativePreferencesStore.open(paths[0]);
+  if (store == null) {
+    return null;
+  }
+
+  final File jsonFile = File(paths[1]);
+  if (!exists && jsonFile.existsSync()) {
+    final String stringMap = jsonFile.readAsStringSync();
+    if (stringMap.isNotEmpty) {
+      decodePreferences(stringMap).forEach(store.set);
+      store.sync();
+    }
+  }
+  return NativePreferencesLoadResult(store.address, store.getAll());
+}
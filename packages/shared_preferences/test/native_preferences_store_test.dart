@@ -0,0 +1,82 @@
+// Copyright 2022 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+import 'dart:io';
+
+import 'package:flutter/foundation.dart' show compute;
+import 'package:flutter_test/flutter_test.dart';
+import 'package:path/path.dart' as path;
+import 'package:shared_preferences_elinux/src/native_preferences_store.dart';
+
+/// These tests need the plugin library, which is built by
+/// elinux/test/CMakeLists.txt:
+/// $ LD_LIBRARY_PATH=build/shared_preferences_test flutter test
+void main() {
+  late Directory directory;
+  late String logPath;
+  late String jsonPath;
+
+  setUp(() {
+    directory = Directory.systemTemp.createTempSync('shared_preferences');
+    logPath = path.join(directory.path, 'shared_preferences.log');
+    jsonPath = path.join(directory.path, 'shared_preferences.json');
+  });
+
+  tearDown(() {
+    directory.deleteSync(recursive: true);
+  });
+
+  /// Loads the store and returns its preferences after closing it.
+  Map<String, Object> _loadAndClose() {
+    final result = loadNativePreferencesStore(<String>[logPath, jsonPath])!;
+    NativePreferencesStore.fromAddress(result.address).close();
+    return result.preferences;
+  }
+
+  group('native store', () {
+    test('imports the JSON file when the log is created', () {
+      File(jsonPath).writeAsStringSync('{"key1":"one","key2":2}');
+
+      expect(_loadAndClose(), {'key1': 'one', 'key2': 2});
+
+      // Once the log exists, the JSON file is no longer imported.
+      File(jsonPath).writeAsStringSync('{"key3":true}');
+      expect(_loadAndClose(), {'key1': 'one', 'key2': 2});
+    });
+
+    test('starts empty without the JSON file', () {
+      expect(_loadAndClose(), isEmpty);
+      expect(File(logPath).existsSync(), isTrue);
+    });
+
+    test('syncs the updates on another isolate', () async {
+      final store = NativePreferencesStore.open(logPath)!;
+      expect(store.set('key1', 'one'), isTrue);
+      expect(store.set('key2', <String>['a', 'b']), isTrue);
+      expect(store.remove('key1'), isTrue);
+      expect(await compute(syncNativePreferencesStore, store.address), isTrue);
+      store.close();
+
+      expect(_loadAndClose(), {
+        'key2': ['a', 'b']
+      });
+    });
+
+    test('discards an incomplete record left by a crash', () {
+      final store = NativePreferencesStore.open(logPath)!;
+      expect(store.set('key1', 'one'), isTrue);
+      expect(store.sync(), isTrue);
+      final completeSize = File(logPath).lengthSync();
+      expect(store.set('key2', 'two'), isTrue);
+      expect(store.sync(), isTrue);
+      store.close();
+
+      final log = File(logPath).openSync(mode: FileMode.append);
+      log.truncateSync(completeSize + 5);
+      log.closeSync();
+
+      expect(_loadAndClose(), {'key1': 'one'});
+      expect(File(logPath).lengthSync(), completeSize);
+    });
+  }, skip: !NativePreferencesStore.isAvailable);
+}
@@ -19,7 +19,7 @@ void main() {
   });
 
   Future<String> _getFilePath() async {
-    final pathProvider = PathProviderLinux();
+    final pathProvider = PathProviderELinux();
     final directory = await pathProvider.getApplicationSupportPath();
     return path.join(directory!, 'shared_preferences.json');
   }
@@ -34,15 +34,16 @@ void main() {
     return fs.file(await _getFilePath()).readAsStringSync();
   }
 
-  SharedPreferencesLinux _getPreferences() {
-    var prefs = SharedPreferencesLinux();
+  SharedPreferencesELinux _getPreferences() {
+    var prefs = SharedPreferencesELinux();
     prefs.fs = fs;
+    prefs.useNativeStore = false;
     return prefs;
   }
 
   test('registered instance', () {
     expect(
-        SharedPreferencesStorePlatform.instance, isA<SharedPreferencesLinux>());
+        SharedPreferencesStorePlatform.instance, isA<SharedPreferencesELinux>());
   });
 
   test('getAll', () async {
@@ -74,6 +75,65 @@ void main() {
     expect(await _readTestFile(), '{"key1":"one","key2":2}');
   });
 
+  test('getAll loads once', () async {
+    await _writeTestFile('{"key1":"one"}');
+    var prefs = _getPreferences();
+
+    final values = await Future.wait([prefs.getAll(), prefs.getAll()]);
+    expect(identical(values[0], values[1]), isTrue);
+    expect(values[0]['key1'], 'one');
+  });
+
+  test('getAll retries after a failed load', () async {
+    await _writeTestFile('{"key1":');
+    var prefs = _getPreferences();
+
+    await expectLater(prefs.getAll(), throwsFormatException);
+
+    await _writeTestFile('{"key1":"one"}');
+    var values = await prefs.getAll();
+    expect(values['key1'], 'one');
+  });
+
+  test('getAll decodes a large file', () async {
+    final largeValue = 'x' * (128 * 1024);
+    await _writeTestFile('{"key1":"$largeValue","key2":2}');
+    var prefs = _getPreferences();
+
+    var values = await prefs.getAll();
+    expect(values['key1'], largeValue);
+    expect(values['key2'], 2);
+  });
+
+  test('setValue coalesces writes', () async {
+    await _writeTestFile('{}');
+    var prefs = _getPreferences();
+
+    final results = await Future.wait([
+      prefs.setValue('', 'key1', 'one'),
+      prefs.setValue('', 'key2', 2),
+      prefs.remove('key1'),
+    ]);
+
+    expect(results, [true, true, true]);
+    expect(await _readTestFile(), '{"key2":2}');
+    expect(fs.file('${await _getFilePath()}.tmp').existsSync(), isFalse);
+  });
+
+  test('flush', () async {
+    await _writeTestFile('{}');
+    var prefs = _getPreferences();
+    prefs.writeDelay = const Duration(days: 1);
+    await prefs.getAll();
+
+    final result = prefs.setValue('', 'key1', 'one');
+    expect(await _readTestFile(), '{}');
+
+    expect(await prefs.flush(), isTrue);
+    expect(await result, isTrue);
+    expect(await _readTestFile(), '{"key1":"one"}');
+  });
+
   test('clear', () async {
     await _writeTestFile('{"key1":"one","key2":2}');
     var prefs = _getPreferences();
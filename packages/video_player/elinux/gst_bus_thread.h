@@ -0,0 +1,57 @@
+// Copyright 2023 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PACKAGES_VIDEO_PLAYER_VIDEO_PLAYER_ELINUX_GST_BUS_THREAD_H_
+#define PACKAGES_VIDEO_PLAYER_VIDEO_PLAYER_ELINUX_GST_BUS_THREAD_H_
+
+#include <gst/gst.h>
+
+#include <chrono>
+#include <thread>
+
+// Runs one GMainContext on a worker thread shared by all the pipelines of the
+// plugin, and dispatches the messages posted to their buses there instead of
+// on the streaming threads which post them. It also runs the timeouts of the
+// players.
+//
+// The camera plugin has its own CameraBusThread, which only dispatches the bus
+// messages.
+class GstBusThread {
+ public:
+  static GstBusThread& GetInstance();
+
+  // Prevent copying.
+  GstBusThread(GstBusThread const&) = delete;
+  GstBusThread& operator=(GstBusThread const&) = delete;
+
+  // Calls |func| with |user_data| on the bus thread for each message posted
+  // to |bus| until RemoveSource() is called. Returns nullptr on failure.
+  GSource* AddWatch(GstBus* bus, GstBusFunc func, gpointer user_data);
+
+  // Calls |func| with |user_data| on the bus thread after |interval|, and
+  // repeatedly while it returns G_SOURCE_CONTINUE. The returned source must
+  // be released by RemoveSource(), or by g_source_destroy() and
+  // g_source_unref() if the caller doesn't need to wait for |func|.
+  GSource* AddTimeout(std::chrono::milliseconds interval, GSourceFunc func,
+                      gpointer user_data);
+
+  // Removes |source| added by AddWatch() or AddTimeout(). Once this returns,
+  // no callback of the bus thread, including the one of |source|, is running,
+  // and the one of |source| is never called anymore, so its |user_data| can
+  // be destroyed.
+  void RemoveSource(GSource* source);
+
+ private:
+  GstBusThread();
+  ~GstBusThread();
+
+  // Calls |func| with |user_data| once on the bus thread.
+  void Invoke(GSourceFunc func, gpointer user_data);
+
+  GMainContext* context_;
+  GMainLoop* loop_;
+  std::thread thread_;
+};
+
+#endif  // PACKAGES_VIDEO_PLAYER_VIDEO_PLAYER_ELINUX_GST_BUS_THREAD_H_
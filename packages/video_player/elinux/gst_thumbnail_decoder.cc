@@ -0,0 +1,267 @@
+// Copyright 2023 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "gst_thumbnail_decoder.h"
+
+#include <gst/app/gstappsink.h>
+
+#include <iostream>
+
+namespace {
+constexpr GstClockTime kDecodeTimeout = 5 * GST_SECOND;
+}  // namespace
+
+GstThumbnailDecoder::~GstThumbnailDecoder() { DestroyPipeline(); }
+
+bool GstThumbnailDecoder::Open(const std::string& uri, int32_t width,
+                               int32_t height, ThumbnailFormat format) {
+  if (IsOpen(uri, width, height, format)) {
+    return true;
+  }
+
+  DestroyPipeline();
+  uri_ = uri;
+  width_ = width;
+  height_ = height;
+  format_ = format;
+  if (!CreatePipeline()) {
+    std::cerr << "Failed to create a thumbnail pipeline" << std::endl;
+    DestroyPipeline();
+    return false;
+  }
+
+  if (gst_element_set_state(gst_.pipeline, GST_STATE_PAUSED) ==
+          GST_STATE_CHANGE_FAILURE ||
+      !WaitForPreroll()) {
+    std::cerr << "Failed to open " << uri << std::endl;
+    DestroyPipeline();
+    return false;
+  }
+  return true;
+}
+
+void GstThumbnailDecoder::Close() { DestroyPipeline(); }
+
+bool GstThumbnailDecoder::IsOpen(const std::string& uri, int32_t width,
+                                 int32_t height, ThumbnailFormat format) const {
+  return gst_.pipeline && uri_ == uri && width_ == width &&
+         height_ == height && format_ == format;
+}
+
+int64_t GstThumbnailDecoder::GetDuration() {
+  gint64 duration;
+  if (!gst_.pipeline ||
+      !gst_element_query_duration(gst_.pipeline, GST_FORMAT_TIME, &duration)) {
+    return -1;
+  }
+  return duration / GST_MSECOND;
+}
+
+bool GstThumbnailDecoder::Decode(int64_t position_ms, bool accurate,
+                                 Thumbnail& thumbnail) {
+  if (!gst_.pipeline) {
+    return false;
+  }
+
+  auto flags = accurate ? GST_SEEK_FLAG_ACCURATE
+                        : (GstSeekFlags)(GST_SEEK_FLAG_KEY_UNIT |
+                                         GST_SEEK_FLAG_SNAP_NEAREST);
+  if (!gst_element_seek_simple(gst_.pipeline, GST_FORMAT_TIME,
+                               (GstSeekFlags)(GST_SEEK_FLAG_FLUSH | flags),
+                               position_ms * GST_MSECOND) ||
+      !WaitForPreroll()) {
+    std::cerr << "Failed to seek to " << position_ms << " ms in " << uri_
+              << std::endl;
+    return false;
+  }
+
+  auto* sample = gst_app_sink_try_pull_preroll(GST_APP_SINK(gst_.app_sink),
+                                               kDecodeTimeout);
+  if (!sample) {
+    std::cerr << "Failed to get a frame at " << position_ms << " ms in "
+              << uri_ << std::endl;
+    return false;
+  }
+
+  auto* caps = gst_sample_get_caps(sample);
+  auto* structure = caps ? gst_caps_get_structure(caps, 0) : nullptr;
+  auto* buffer = gst_sample_get_buffer(sample);
+  GstMapInfo map;
+  if (!structure || !buffer || !gst_buffer_map(buffer, &map, GST_MAP_READ)) {
+    std::cerr << "Failed to map a frame" << std::endl;
+    gst_sample_unref(sample);
+    return false;
+  }
+  gst_structure_get_int(structure, "width", &thumbnail.width);
+  gst_structure_get_int(structure, "height", &thumbnail.height);
+  thumbnail.position_ms = GetStreamTime(sample, position_ms);
+  thumbnail.data.assign(map.data, map.data + map.size);
+  gst_buffer_unmap(buffer, &map);
+  gst_sample_unref(sample);
+
+  return true;
+}
+
+// Returns the position of the frame of |sample| in milliseconds, e.g. the one
+// of the keyframe which a seek has snapped to, or |default_position_ms| if it
+// doesn't have a timestamp.
+// static
+int64_t GstThumbnailDecoder::GetStreamTime(GstSample* sample,
+                                           int64_t default_position_ms) {
+  auto* buffer = gst_sample_get_buffer(sample);
+  auto* segment = gst_sample_get_segment(sample);
+  if (!buffer || !segment || !GST_BUFFER_PTS_IS_VALID(buffer)) {
+    return default_position_ms;
+  }
+  auto stream_time = gst_segment_to_stream_time(segment, GST_FORMAT_TIME,
+                                                GST_BUFFER_PTS(buffer));
+  if (!GST_CLOCK_TIME_IS_VALID(stream_time)) {
+    return default_position_ms;
+  }
+  return stream_time / GST_MSECOND;
+}
+
+// Creates a thumbnail pipeline.
+// $ uridecodebin caps=video/x-raw ! videoconvert ! videoscale !
+//   video/x-raw,format=RGBA,width=<width>,height=<height> ! [jpegenc !]
+//   appsink
+bool GstThumbnailDecoder::CreatePipeline() {
+  gst_.pipeline = gst_pipeline_new("thumbnail_pipeline");
+  if (!gst_.pipeline) {
+    std::cerr << "Failed to create a pipeline" << std::endl;
+    return false;
+  }
+  gst_.decode_bin = gst_element_factory_make("uridecodebin", "thumbnail_src");
+  if (!gst_.decode_bin) {
+    std::cerr << "Failed to create a uridecodebin" << std::endl;
+    return false;
+  }
+  gst_.video_convert =
+      gst_element_factory_make("videoconvert", "thumbnail_convert");
+  if (!gst_.video_convert) {
+    std::cerr << "Failed to create a videoconvert" << std::endl;
+    return false;
+  }
+  gst_.video_scale = gst_element_factory_make("videoscale", "thumbnail_scale");
+  if (!gst_.video_scale) {
+    std::cerr << "Failed to create a videoscale" << std::endl;
+    return false;
+  }
+  gst_.caps_filter = gst_element_factory_make("capsfilter", "thumbnail_caps");
+  if (!gst_.caps_filter) {
+    std::cerr << "Failed to create a capsfilter" << std::endl;
+    return false;
+  }
+  if (format_ == ThumbnailFormat::kJpeg) {
+    gst_.jpeg_encoder = gst_element_factory_make("jpegenc", "thumbnail_enc");
+    if (!gst_.jpeg_encoder) {
+      std::cerr << "Failed to create a jpegenc" << std::endl;
+      return false;
+    }
+  }
+  gst_.app_sink = gst_element_factory_make("appsink", "thumbnail_sink");
+  if (!gst_.app_sink) {
+    std::cerr << "Failed to create an appsink" << std::endl;
+    return false;
+  }
+
+  // Only the video stream is exposed, so the other streams aren't decoded.
+  auto* decode_caps = gst_caps_from_string("video/x-raw");
+  g_object_set(G_OBJECT(gst_.decode_bin), "uri", uri_.c_str(), "caps",
+               decode_caps, "expose-all-streams", FALSE, NULL);
+  gst_caps_unref(decode_caps);
+  g_signal_connect(G_OBJECT(gst_.decode_bin), "pad-added",
+                   G_CALLBACK(HandlePadAdded), gst_.video_convert);
+
+  // jpegenc doesn't accept RGBA, but RGBx has the same memory layout.
+  std::string caps_str = format_ == ThumbnailFormat::kJpeg
+                             ? "video/x-raw,format=RGBx"
+                             : "video/x-raw,format=RGBA";
+  caps_str += ",pixel-aspect-ratio=1/1";
+  if (width_ > 0) {
+    caps_str += ",width=" + std::to_string(width_);
+  }
+  if (height_ > 0) {
+    caps_str += ",height=" + std::to_string(height_);
+  }
+  auto* caps = gst_caps_from_string(caps_str.c_str());
+  g_object_set(G_OBJECT(gst_.caps_filter), "caps", caps, NULL);
+  gst_caps_unref(caps);
+
+  g_object_set(G_OBJECT(gst_.app_sink), "sync", FALSE, "max-buffers", 1,
+               "enable-last-sample", FALSE, NULL);
+
+  gst_bin_add_many(GST_BIN(gst_.pipeline), gst_.decode_bin, gst_.video_convert,
+                   gst_.video_scale, gst_.caps_filter, gst_.app_sink, NULL);
+  auto linked = false;
+  if (gst_.jpeg_encoder) {
+    gst_bin_add(GST_BIN(gst_.pipeline), gst_.jpeg_encoder);
+    linked = gst_element_link_many(gst_.video_convert, gst_.video_scale,
+                                   gst_.caps_filter, gst_.jpeg_encoder,
+                                   gst_.app_sink, NULL);
+  } else {
+    linked = gst_element_link_many(gst_.video_convert, gst_.video_scale,
+                                   gst_.caps_filter, gst_.app_sink, NULL);
+  }
+  if (!linked) {
+    std::cerr << "Failed to link the thumbnail pipeline" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void GstThumbnailDecoder::DestroyPipeline() {
+  if (gst_.pipeline) {
+    gst_element_set_state(gst_.pipeline, GST_STATE_NULL);
+    gst_object_unref(gst_.pipeline);
+  } else {
+    // The elements which weren't added to the pipeline yet.
+    for (auto* element : {gst_.decode_bin, gst_.video_convert, gst_.video_scale,
+                          gst_.caps_filter, gst_.jpeg_encoder, gst_.app_sink}) {
+      if (element) {
+        gst_object_unref(element);
+      }
+    }
+  }
+  gst_ = {nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
+  uri_.clear();
+}
+
+// static
+void GstThumbnailDecoder::HandlePadAdded(GstElement* decode_bin, GstPad* pad,
+                                         gpointer user_data) {
+  auto* video_convert = reinterpret_cast<GstElement*>(user_data);
+  auto* sink_pad = gst_element_get_static_pad(video_convert, "sink");
+  if (!gst_pad_is_linked(sink_pad) &&
+      gst_pad_link(pad, sink_pad) != GST_PAD_LINK_OK) {
+    std::cerr << "Failed to link the video stream" << std::endl;
+  }
+  gst_object_unref(sink_pad);
+}
+
+// Waits until the pipeline prerolls, e.g. after a flushing seek.
+bool GstThumbnailDecoder::WaitForPreroll() {
+  auto* bus = gst_pipeline_get_bus(GST_PIPELINE(gst_.pipeline));
+  auto* message = gst_bus_timed_pop_filtered(
+      bus, kDecodeTimeout,
+      (GstMessageType)(GST_MESSAGE_ASYNC_DONE | GST_MESSAGE_ERROR));
+  gst_object_unref(bus);
+  if (!message) {
+    std::cerr << "Timed out prerolling " << uri_ << std::endl;
+    return false;
+  }
+
+  auto prerolled = GST_MESSAGE_TYPE(message) == GST_MESSAGE_ASYNC_DONE;
+  if (!prerolled) {
+    gchar* debug;
+    GError* error;
+    gst_message_parse_error(message, &error, &debug);
+    std::cerr << "Failed to decode " << uri_ << ": " << error->message
+              << std::endl;
+    g_free(debug);
+    g_error_free(error);
+  }
+  gst_message_unref(message);
+  return prerolled;
+}
@@ -0,0 +1,93 @@
+// Copyright 2023 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PACKAGES_VIDEO_PLAYER_VIDEO_PLAYER_ELINUX_GST_THUMBNAIL_DECODER_H_
+#define PACKAGES_VIDEO_PLAYER_VIDEO_PLAYER_ELINUX_GST_THUMBNAIL_DECODER_H_
+
+#include <gst/gst.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class ThumbnailFormat {
+  kRgba,
+  kJpeg,
+};
+
+struct Thumbnail {
+  // The position of the decoded frame, which is the one of the keyframe
+  // unless it's decoded accurately.
+  int64_t position_ms = 0;
+  int32_t width = 0;
+  int32_t height = 0;
+  // RGBA pixels without padding, or a JPEG image.
+  std::vector<uint8_t> data;
+};
+
+// Decodes still frames of a video at small sizes without a player or a
+// texture. Only the video stream is decoded.
+//
+// The pipeline is kept in the PAUSED state and each frame is prerolled by a
+// flushing seek, so consecutive frames of the same video don't pay the cost
+// of the pipeline construction. This class is not thread-safe and is supposed
+// to be used from a single worker thread.
+class GstThumbnailDecoder {
+ public:
+  GstThumbnailDecoder() = default;
+  ~GstThumbnailDecoder();
+
+  // Prevent copying.
+  GstThumbnailDecoder(GstThumbnailDecoder const&) = delete;
+  GstThumbnailDecoder& operator=(GstThumbnailDecoder const&) = delete;
+
+  // Opens |uri| to decode frames of |width| x |height| pixels in |format|. If
+  // either |width| or |height| is 0, it's derived from the other one with the
+  // aspect ratio of the video. Does nothing if it's already open with the same
+  // parameters.
+  bool Open(const std::string& uri, int32_t width, int32_t height,
+            ThumbnailFormat format);
+
+  bool IsOpen(const std::string& uri, int32_t width, int32_t height,
+              ThumbnailFormat format) const;
+  bool IsOpen() const { return gst_.pipeline != nullptr; }
+
+  // Destroys the pipeline, releasing the file and the buffers of the decoder.
+  void Close();
+
+  // Returns the duration in milliseconds, or -1 if unknown.
+  int64_t GetDuration();
+
+  // Decodes the frame at |position_ms|. The keyframe nearest to the position
+  // is decoded unless |accurate| is true, and |thumbnail.position_ms| is set
+  // to the one of the decoded frame.
+  bool Decode(int64_t position_ms, bool accurate, Thumbnail& thumbnail);
+
+ private:
+  struct GstThumbnailDecoderElements {
+    GstElement* pipeline;
+    GstElement* decode_bin;
+    GstElement* video_convert;
+    GstElement* video_scale;
+    GstElement* caps_filter;
+    GstElement* jpeg_encoder;
+    GstElement* app_sink;
+  };
+
+  static void HandlePadAdded(GstElement* decode_bin, GstPad* pad,
+                             gpointer user_data);
+  static int64_t GetStreamTime(GstSample* sample, int64_t default_position_ms);
+  bool CreatePipeline();
+  void DestroyPipeline();
+  bool WaitForPreroll();
+
+  GstThumbnailDecoderElements gst_ = {nullptr, nullptr, nullptr, nullptr,
+                                      nullptr, nullptr, nullptr};
+  std::string uri_;
+  int32_t width_ = 0;
+  int32_t height_ = 0;
+  ThumbnailFormat format_ = ThumbnailFormat::kRgba;
+};
+
+#endif  // PACKAGES_VIDEO_PLAYER_VIDEO_PLAYER_ELINUX_GST_THUMBNAIL_DECODER_H_
@@ -13,15 +13,36 @@ extern "C" {
 #include <unordered_map>
 #include <algorithm>
 
+#include "gst_bus_thread.h"
+
+namespace {
+// GST_PLAY_FLAG_VIDEO of GstPlayFlags of playbin3, which isn't in the public
+// headers.
+constexpr guint kGstPlayFlagVideo = 1 << 0;
+
+// In kAuto, the seeks to a position this close after a keyframe snap to the
+// keyframe.
+constexpr int64_t kKeyframeSnapToleranceMs = 100;
+// In kAuto, the seeks to a position farther than this after a keyframe snap
+// to the nearest keyframe, because decoding up to the position takes too
+// long.
+constexpr int64_t kMaxAccurateSeekDistanceMs = 5000;
+// How long a seek can take before the pending one is started without waiting
+// for it, in case the pipeline never prerolls.
+constexpr auto kSeekTimeout = std::chrono::milliseconds(2000);
+}  // namespace
+
 GstVideoPlayer::GstVideoPlayer(
-    const std::string& uri, std::unique_ptr<VideoPlayerStreamHandler> handler)
-    : stream_handler_(std::move(handler)) {
+    const std::string& uri, std::unique_ptr<VideoPlayerStreamHandler> handler,
+    bool audio_only)
+    : is_audio_only_(audio_only), stream_handler_(std::move(handler)) {
   gst_.pipeline = nullptr;
   gst_.video_src = nullptr;
   gst_.video_convert = nullptr;
   gst_.video_sink = nullptr;
   gst_.output = nullptr;
   gst_.bus = nullptr;
+  gst_.bus_watch = nullptr;
   gst_.buffer = nullptr;
 
   if (!regex_match(uri, GstVideoPlayer::camera_path_regex_))
@@ -50,10 +71,15 @@ GstVideoPlayer::GstVideoPlayer(
   // Prerolls before getting information from the pipeline.
   Preroll();
 
-  // Sets internal video size and buffier.
-  GetVideoSize(width_, height_);
-
-  pixels_.reset(new uint32_t[width_ * height_]);
+  // Sets internal video size.
+  {
+    int32_t width = width_;
+    int32_t height = height_;
+    GetVideoSize(width, height);
+    std::lock_guard<std::shared_mutex> lock(mutex_buffer_);
+    width_ = width;
+    height_ = height;
+  }
 
   // Sometimes live streams doesn't contain aspect ratio
   // which leads to issue with playback picture
@@ -63,6 +89,8 @@ GstVideoPlayer::GstVideoPlayer(
 }
 
 GstVideoPlayer::~GstVideoPlayer() {
+  // Stops building the keyframe index. The future waits for it.
+  cancel_keyframe_index_ = true;
   Stop();
   DestroyPipeline();
 }
@@ -245,43 +273,309 @@ bool GstVideoPlayer::SetPlaybackRate(double rate) {
     return false;
   }
 
-  auto position = GetCurrentPosition();
-  if (position < 0) {
-    return false;
-  }
-
-  if (!gst_element_seek(gst_.pipeline, rate, GST_FORMAT_TIME,
-                        GST_SEEK_FLAG_FLUSH, GST_SEEK_TYPE_SET,
-                        position * GST_MSECOND, GST_SEEK_TYPE_SET,
-                        GST_CLOCK_TIME_NONE)) {
-    std::cerr << "Failed to set playback rate to " << rate
-              << " (gst_element_seek failed)" << std::endl;
-    return false;
+  // Changes the rate without flushing the pipeline if possible, which
+  // otherwise freezes the video until it prerolls again.
+  if (!ChangePlaybackRateInstantly(rate)) {
+    // The rate is applied by a flushing seek to the current position. The
+    // seeks are started with |playback_rate_|, so if a seek is in progress,
+    // the pending one applies it.
+    auto previous_rate = playback_rate_.exchange(rate);
+    if (!RequestSeek({std::nullopt, GST_SEEK_FLAG_FLUSH}, false)) {
+      std::cerr << "Failed to set playback rate to " << rate
+                << " (gst_element_seek failed)" << std::endl;
+      playback_rate_ = previous_rate;
+      return false;
+    }
   }
 
   playback_rate_ = rate;
-  mute_ = (rate < 0.5 || rate > 2);
+  // Without scaletempo, the audio is muted at the rates where the change of
+  // the pitch is too large.
+  mute_ = !has_scaletempo_ && (rate < 0.5 || rate > 2);
   g_object_set(gst_.video_src, "mute", mute_, NULL);
 
   return true;
 }
 
+bool GstVideoPlayer::ChangePlaybackRateInstantly(double rate) {
+#if GST_CHECK_VERSION(1, 18, 0)
+  // The headers might be newer than the library.
+  guint major, minor, micro, nano;
+  gst_version(&major, &minor, &micro, &nano);
+  if (major == 1 && minor < 18) {
+    return false;
+  }
+
+  // Only the rate can be changed, and the direction can't be. Negative rates
+  // aren't supported by SetPlaybackRate anyway. It fails e.g. if the pipeline
+  // isn't prerolled or the elements don't support it.
+  return gst_element_seek(gst_.pipeline, rate, GST_FORMAT_TIME,
+                          GST_SEEK_FLAG_INSTANT_RATE_CHANGE, GST_SEEK_TYPE_NONE,
+                          0, GST_SEEK_TYPE_NONE, 0);
+#else
+  return false;
+#endif
+}
+
 bool GstVideoPlayer::SetSeek(int64_t position) {
   if (is_stream_ || is_camera_)
     return false;
 
+  // Scrubbing requests seeks faster than they complete, so only the latest
+  // one is kept and started when the current one completes.
+  return RequestSeek({position, std::nullopt}, true);
+}
+
+GstVideoPlayer::SeekStats GstVideoPlayer::GetSeekStats() {
+  std::lock_guard<std::mutex> lock(mutex_seek_);
+  return seek_stats_;
+}
+
+bool GstVideoPlayer::RequestSeek(const SeekRequest& request,
+                                 bool replaces_pending) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_seek_);
+    if (seek_start_time_) {
+      if (!pending_seek_) {
+        pending_seek_ = request;
+      } else if (replaces_pending) {
+        seek_stats_.coalesced_count++;
+        pending_seek_ = request;
+      }
+      return true;
+    }
+
+    // Only the flushing seeks in PAUSED or PLAYING post ASYNC_DONE when they
+    // complete.
+    GstState state;
+    gst_element_get_state(gst_.pipeline, &state, NULL, 0);
+    if (state >= GST_STATE_PAUSED) {
+      seek_start_time_ = std::chrono::steady_clock::now();
+      ArmSeekTimeoutLocked();
+    }
+  }
+  return StartSeek(request);
+}
+
+bool GstVideoPlayer::StartSeek(const SeekRequest& request) {
+  auto position = request.position ? *request.position : GetCurrentPosition();
   auto nanosecond = position * 1000 * 1000;
-  if (!gst_element_seek(
-          gst_.pipeline, playback_rate_, GST_FORMAT_TIME,
-          (GstSeekFlags)(GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_KEY_UNIT),
-          GST_SEEK_TYPE_SET, nanosecond, GST_SEEK_TYPE_SET,
-          GST_CLOCK_TIME_NONE)) {
+  if (position < 0 ||
+      !gst_element_seek(gst_.pipeline, playback_rate_, GST_FORMAT_TIME,
+                        request.flags ? *request.flags
+                                      : GetSeekFlags(position),
+                        GST_SEEK_TYPE_SET, nanosecond, GST_SEEK_TYPE_SET,
+                        GST_CLOCK_TIME_NONE)) {
     std::cerr << "Failed to seek " << nanosecond << std::endl;
+    std::optional<SeekRequest> next;
+    {
+      std::lock_guard<std::mutex> lock(mutex_seek_);
+      if (seek_start_time_) {
+        next = FinishSeekLocked(false);
+      }
+    }
+    if (next) {
+      StartSeek(*next);
+    }
     return false;
   }
   return true;
 }
 
+std::optional<GstVideoPlayer::SeekRequest> GstVideoPlayer::FinishSeekLocked(
+    bool completed) {
+  auto now = std::chrono::steady_clock::now();
+  if (completed) {
+    auto latency = std::chrono::duration_cast<std::chrono::milliseconds>(
+                       now - *seek_start_time_)
+                       .count();
+    seek_stats_.count++;
+    seek_stats_.last_latency_ms = latency;
+    seek_stats_.max_latency_ms = std::max(seek_stats_.max_latency_ms, latency);
+    seek_stats_.total_latency_ms += latency;
+  }
+
+  auto next = pending_seek_;
+  pending_seek_.reset();
+  if (next) {
+    seek_start_time_ = now;
+    ArmSeekTimeoutLocked();
+  } else {
+    seek_start_time_.reset();
+    DisarmSeekTimeoutLocked();
+  }
+  return next;
+}
+
+void GstVideoPlayer::ArmSeekTimeoutLocked() {
+  DisarmSeekTimeoutLocked();
+  seek_timeout_ = GstBusThread::GetInstance().AddTimeout(
+      kSeekTimeout, HandleSeekTimeout, this);
+}
+
+void GstVideoPlayer::DisarmSeekTimeoutLocked() {
+  // The callback might be running, but it does nothing once |seek_timeout_|
+  // is no longer its source. DestroyPipeline() waits for it.
+  if (seek_timeout_) {
+    g_source_destroy(seek_timeout_);
+    g_source_unref(seek_timeout_);
+    seek_timeout_ = nullptr;
+  }
+}
+
+// Called on the thread of GstBusThread when the pipeline has prerolled, e.g.
+// after a flushing seek.
+void GstVideoPlayer::OnAsyncDone() {
+  std::optional<SeekRequest> next;
+  {
+    std::lock_guard<std::mutex> lock(mutex_seek_);
+    if (!seek_start_time_) {
+      return;
+    }
+    next = FinishSeekLocked(true);
+  }
+
+  if (next) {
+    StartSeek(*next);
+  }
+}
+
+// static
+gboolean GstVideoPlayer::HandleSeekTimeout(gpointer user_data) {
+  reinterpret_cast<GstVideoPlayer*>(user_data)->OnSeekTimeout();
+  return G_SOURCE_REMOVE;
+}
+
+// Called on the thread of GstBusThread when the seek in progress hasn't
+// completed within kSeekTimeout.
+void GstVideoPlayer::OnSeekTimeout() {
+  std::optional<SeekRequest> next;
+  {
+    std::lock_guard<std::mutex> lock(mutex_seek_);
+    if (!seek_timeout_ || g_main_current_source() != seek_timeout_) {
+      return;
+    }
+    std::cerr << "The seek didn't complete in time" << std::endl;
+    next = FinishSeekLocked(false);
+  }
+
+  if (next) {
+    StartSeek(*next);
+  }
+}
+
+GstSeekFlags GstVideoPlayer::GetSeekFlags(int64_t position) {
+  auto flags = GST_SEEK_FLAG_FLUSH;
+  switch (seek_mode_.load()) {
+    case SeekMode::kKeyframe:
+      return (GstSeekFlags)(flags | GST_SEEK_FLAG_KEY_UNIT);
+    case SeekMode::kAccurate:
+      return (GstSeekFlags)(flags | GST_SEEK_FLAG_ACCURATE);
+    case SeekMode::kAuto:
+      break;
+  }
+
+  // Until the index is available, e.g. at the first seek, it seeks in the
+  // same way as kKeyframe.
+  auto keyframe_index = GetKeyframeIndex();
+  if (!keyframe_index) {
+    return (GstSeekFlags)(flags | GST_SEEK_FLAG_KEY_UNIT);
+  }
+
+  auto distance = position - keyframe_index->GetKeyframeBefore(position);
+  if (distance <= kKeyframeSnapToleranceMs) {
+    return (GstSeekFlags)(flags | GST_SEEK_FLAG_KEY_UNIT |
+                          GST_SEEK_FLAG_SNAP_BEFORE);
+  }
+  if (distance <= kMaxAccurateSeekDistanceMs) {
+    return (GstSeekFlags)(flags | GST_SEEK_FLAG_ACCURATE);
+  }
+  return (GstSeekFlags)(flags | GST_SEEK_FLAG_KEY_UNIT |
+                        GST_SEEK_FLAG_SNAP_NEAREST);
+}
+
+// Returns the keyframe index, or nullptr if it's not available yet. It starts
+// building the index in the background at the first call.
+std::shared_ptr<const KeyframeIndex> GstVideoPlayer::GetKeyframeIndex() {
+  std::lock_guard<std::mutex> lock(mutex_seek_);
+  if (!keyframe_index_requested_) {
+    keyframe_index_requested_ = true;
+    // Only the local files are indexed.
+    auto* filename = g_filename_from_uri(uri_.c_str(), NULL, NULL);
+    if (!filename) {
+      return nullptr;
+    }
+    std::string path(filename);
+    g_free(filename);
+    keyframe_index_future_ = std::async(std::launch::async, [this, path]() {
+      return KeyframeIndex::Load(path, cancel_keyframe_index_);
+    });
+    return nullptr;
+  }
+
+  if (keyframe_index_future_.valid() &&
+      keyframe_index_future_.wait_for(std::chrono::seconds(0)) ==
+          std::future_status::ready) {
+    keyframe_index_ = keyframe_index_future_.get();
+  }
+  return keyframe_index_;
+}
+
+void GstVideoPlayer::SetVisible(bool visible) {
+  if (is_visible_ == visible) {
+    return;
+  }
+  is_visible_ = visible;
+  if (visible && is_waiting_keyframe_) {
+    CatchUpVideo();
+  }
+}
+
+bool GstVideoPlayer::SetAudioOnly(bool audio_only) {
+  // The camera pipeline isn't playbin3.
+  if (is_camera_ || !gst_.video_src) {
+    return false;
+  }
+
+  if (is_audio_only_ == audio_only) {
+    return true;
+  }
+  is_audio_only_ = audio_only;
+  SetVideoFlag(!audio_only);
+  if (!audio_only) {
+    CatchUpVideo();
+  }
+  return true;
+}
+
+void GstVideoPlayer::SetVideoFlag(bool enabled) {
+  guint flags;
+  g_object_get(gst_.video_src, "flags", &flags, NULL);
+  if (enabled) {
+    flags |= kGstPlayFlagVideo;
+  } else {
+    flags &= ~kGstPlayFlagVideo;
+  }
+  g_object_set(gst_.video_src, "flags", flags, NULL);
+}
+
+// Restarts decoding the video from the keyframe before the current position
+// instead of waiting for the next one. The frames before the position are
+// decoded but not rendered because of the accurate seek.
+void GstVideoPlayer::CatchUpVideo() {
+  if (is_stream_ || is_camera_) {
+    return;
+  }
+
+  // A pending seek restarts decoding the video as well, so it isn't
+  // replaced.
+  if (!RequestSeek({std::nullopt, (GstSeekFlags)(GST_SEEK_FLAG_FLUSH |
+                                                 GST_SEEK_FLAG_ACCURATE)},
+                   false)) {
+    std::cerr << "Failed to seek to catch up the video" << std::endl;
+  }
+}
+
 int64_t GstVideoPlayer::GetDuration() {
   if (is_stream_ || is_camera_)
     return 0;
@@ -308,24 +602,6 @@ int64_t GstVideoPlayer::GetCurrentPosition() {
     return -1;
   }
 
-  // TODO: We need to handle this code in the proper plase.
-  // The VideoPlayer plugin doesn't have a main loop, so EOS message
-  // received from GStreamer cannot be processed directly in a callback
-  // function. This is because the event channel message of playback complettion
-  // needs to be thrown in the main thread.
-  {
-    std::unique_lock<std::mutex> lock(mutex_event_completed_);
-    if (is_completed_) {
-      is_completed_ = false;
-      lock.unlock();
-
-      stream_handler_->OnNotifyCompleted();
-      if (auto_repeat_) {
-        SetSeek(0);
-      }
-    }
-  }
-
   return position / GST_MSECOND;
 }
 
@@ -423,15 +699,28 @@ void GstVideoPlayer::CorrectAspectRatio() {
   gst_object_unref (pad);
 }
 
-const uint8_t* GstVideoPlayer::GetFrameBuffer() {
+bool GstVideoPlayer::CopyFrame(std::vector<uint8_t>& pixels, int32_t& width,
+                               int32_t& height) {
   std::shared_lock<std::shared_mutex> lock(mutex_buffer_);
   if (!gst_.buffer) {
-    return nullptr;
+    return false;
   }
 
-  const uint32_t pixel_bytes = width_ * height_ * 4;
-  gst_buffer_extract(gst_.buffer, 0, pixels_.get(), pixel_bytes);
-  return reinterpret_cast<const uint8_t*>(pixels_.get());
+  width = width_;
+  height = height_;
+  pixels.resize(static_cast<size_t>(width) * height * 4);
+  gst_buffer_extract(gst_.buffer, 0, pixels.data(), pixels.size());
+  return true;
+}
+
+int32_t GstVideoPlayer::GetWidth() {
+  std::shared_lock<std::shared_mutex> lock(mutex_buffer_);
+  return width_;
+}
+
+int32_t GstVideoPlayer::GetHeight() {
+  std::shared_lock<std::shared_mutex> lock(mutex_buffer_);
+  return height_;
 }
 
 // Creats a video pipeline using playbin.
@@ -529,7 +818,11 @@ bool GstVideoPlayer::CreatePipeline() {
     std::cerr << "Failed to create a bus" << std::endl;
     return false;
   }
-  gst_bus_set_sync_handler(gst_.bus, HandleGstMessage, this, NULL);
+  gst_.bus_watch =
+      GstBusThread::GetInstance().AddWatch(gst_.bus, HandleGstMessage, this);
+  if (!gst_.bus_watch) {
+    return false;
+  }
 
   // Sets properties to fakesink to get the callback of a decoded frame.
   g_object_set(G_OBJECT(gst_.video_sink), "sync", TRUE, "qos", TRUE, NULL);
@@ -538,6 +831,12 @@ bool GstVideoPlayer::CreatePipeline() {
     g_object_set(G_OBJECT(gst_.video_convert), "add-borders", TRUE, NULL);
   g_signal_connect(G_OBJECT(gst_.video_sink), "handoff",
                    G_CALLBACK(HandoffHandler), this);
+  if (video_src == "playbin3") {
+    g_signal_connect(G_OBJECT(gst_.video_src), "element-setup",
+                     G_CALLBACK(HandleElementSetup), this);
+  } else {
+    AddVideoDecoderProbe(gst_.camera_dec);
+  }
 
   if (video_src == "playbin3")
     gst_bin_add_many(GST_BIN(gst_.output), gst_.video_convert, gst_.caps_filter, gst_.video_sink,
@@ -562,6 +861,20 @@ bool GstVideoPlayer::CreatePipeline() {
 
     g_object_set(gst_.video_src, "uri", uri_.c_str(), NULL);
     g_object_set(gst_.video_src, "video-sink", gst_.output, NULL);
+    auto* scaletempo = gst_element_factory_make("scaletempo", "scaletempo");
+    if (scaletempo) {
+      g_object_set(gst_.video_src, "audio-filter", scaletempo, NULL);
+      has_scaletempo_ = true;
+    } else {
+      std::cerr << "scaletempo is not available. The audio is muted at the "
+                   "playback rates below 0.5 or above 2."
+                << std::endl;
+    }
+    // The video branch is still created so that the video can be enabled
+    // later, but it gets no stream.
+    if (is_audio_only_) {
+      SetVideoFlag(false);
+    }
     gst_bin_add_many(GST_BIN(gst_.pipeline), gst_.video_src, NULL);
   }
   else
@@ -596,6 +909,21 @@ void GstVideoPlayer::Preroll() {
 }
 
 void GstVideoPlayer::DestroyPipeline() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_seek_);
+    pending_seek_.reset();
+    seek_start_time_.reset();
+    DisarmSeekTimeoutLocked();
+  }
+
+  // Removes the watch first so that HandleGstMessage is not called while
+  // destroying the pipeline. It also waits for HandleSeekTimeout which might
+  // be running.
+  if (gst_.bus_watch) {
+    GstBusThread::GetInstance().RemoveSource(gst_.bus_watch);
+    gst_.bus_watch = nullptr;
+  }
+
   if (gst_.video_sink) {
     g_object_set(G_OBJECT(gst_.video_sink), "signal-handoffs", FALSE, NULL);
   }
@@ -636,6 +964,18 @@ void GstVideoPlayer::DestroyPipeline() {
   }
 }
 
+void GstVideoPlayer::AddVideoDecoderProbe(GstElement* decoder) {
+  auto* sink_pad = gst_element_get_static_pad(decoder, "sink");
+  if (!sink_pad) {
+    std::cerr << "Failed to get the sink pad of "
+              << GST_ELEMENT_NAME(decoder) << std::endl;
+    return;
+  }
+  gst_pad_add_probe(sink_pad, GST_PAD_PROBE_TYPE_BUFFER,
+                    HandleVideoDecoderBuffer, this, NULL);
+  gst_object_unref(sink_pad);
+}
+
 std::string GstVideoPlayer::ParseUri(const std::string& uri) {
   if (gst_uri_is_valid(uri.c_str())) {
     return uri;
@@ -665,7 +1005,11 @@ void GstVideoPlayer::GetVideoSize(int32_t& width, int32_t& height) {
     return;
   }
 
+  // There are no caps without the video, e.g. in audio only mode.
   auto* caps = gst_pad_get_current_caps(sink_pad);
+  if (!caps) {
+    return;
+  }
   auto* structure = gst_caps_get_structure(caps, 0);
   if (!structure) {
     std::cerr << "Failed to get a structure";
@@ -686,32 +1030,81 @@ void GstVideoPlayer::HandoffHandler(GstElement* fakesink, GstBuffer* buf,
   int height;
   gst_structure_get_int(structure, "width", &width);
   gst_structure_get_int(structure, "height", &height);
-  if (width != self->width_ || height != self->height_) {
-    self->width_ = width;
-    self->height_ = height;
-    self->pixels_.reset(new uint32_t[width * height]);
-    std::cout << "Pixel buffer size: width = " << width
-              << ", height = " << height << std::endl;
-  }
+  gst_caps_unref(caps);
 
-  std::lock_guard<std::shared_mutex> lock(self->mutex_buffer_);
-  if (self->gst_.buffer) {
-    gst_buffer_unref(self->gst_.buffer);
-    self->gst_.buffer = nullptr;
+  {
+    std::lock_guard<std::shared_mutex> lock(self->mutex_buffer_);
+    if (width != self->width_ || height != self->height_) {
+      self->width_ = width;
+      self->height_ = height;
+      std::cout << "Pixel buffer size: width = " << width
+                << ", height = " << height << std::endl;
+    }
+
+    if (self->gst_.buffer) {
+      gst_buffer_unref(self->gst_.buffer);
+      self->gst_.buffer = nullptr;
+    }
+    self->gst_.buffer = gst_buffer_ref(buf);
   }
-  self->gst_.buffer = gst_buffer_ref(buf);
   self->stream_handler_->OnNotifyFrameDecoded();
 }
 
 // static
-GstBusSyncReply GstVideoPlayer::HandleGstMessage(GstBus* bus,
-                                                 GstMessage* message,
-                                                 gpointer user_data) {
+void GstVideoPlayer::HandleElementSetup(GstElement* playbin,
+                                        GstElement* element,
+                                        gpointer user_data) {
+  auto* factory = gst_element_get_factory(element);
+  if (factory &&
+      gst_element_factory_list_is_type(
+          factory, GST_ELEMENT_FACTORY_TYPE_DECODER |
+                       GST_ELEMENT_FACTORY_TYPE_MEDIA_VIDEO)) {
+    auto* self = reinterpret_cast<GstVideoPlayer*>(user_data);
+    self->AddVideoDecoderProbe(element);
+  }
+}
+
+// static
+GstPadProbeReturn GstVideoPlayer::HandleVideoDecoderBuffer(
+    GstPad* pad, GstPadProbeInfo* info, gpointer user_data) {
+  auto* self = reinterpret_cast<GstVideoPlayer*>(user_data);
+  auto* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+  if (!self->is_visible_) {
+    self->is_waiting_keyframe_ = true;
+  } else if (self->is_waiting_keyframe_ &&
+             !GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT)) {
+    self->is_waiting_keyframe_ = false;
+  }
+  if (!self->is_waiting_keyframe_) {
+    return GST_PAD_PROBE_OK;
+  }
+
+  // Replaces the buffer with a gap so that the video sink still prerolls and
+  // doesn't hold the audio and the clock back.
+  if (GST_BUFFER_PTS_IS_VALID(buffer)) {
+    gst_pad_send_event(pad, gst_event_new_gap(GST_BUFFER_PTS(buffer),
+                                              GST_BUFFER_DURATION(buffer)));
+  }
+  return GST_PAD_PROBE_DROP;
+}
+
+// static
+gboolean GstVideoPlayer::HandleGstMessage(GstBus* bus, GstMessage* message,
+                                          gpointer user_data) {
   switch (GST_MESSAGE_TYPE(message)) {
     case GST_MESSAGE_EOS: {
       auto* self = reinterpret_cast<GstVideoPlayer*>(user_data);
-      std::lock_guard<std::mutex> lock(self->mutex_event_completed_);
-      self->is_completed_ = true;
+      self->stream_handler_->OnNotifyCompleted();
+      if (self->auto_repeat_) {
+        self->SetSeek(0);
+      }
+      break;
+    }
+    case GST_MESSAGE_ASYNC_DONE: {
+      auto* self = reinterpret_cast<GstVideoPlayer*>(user_data);
+      if (GST_MESSAGE_SRC(message) == GST_OBJECT(self->gst_.pipeline)) {
+        self->OnAsyncDone();
+      }
       break;
     }
     case GST_MESSAGE_WARNING: {
@@ -739,5 +1132,5 @@ GstBusSyncReply GstVideoPlayer::HandleGstMessage(GstBus* bus,
     default:
       break;
   }
-  return GST_BUS_PASS;
+  return TRUE;
 }
@@ -7,19 +7,50 @@
 
 #include <gst/gst.h>
 
+#include <atomic>
+#include <chrono>
+#include <future>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <shared_mutex>
 #include <string>
 #include <regex>
 #include <vector>
 
+#include "keyframe_index.h"
 #include "video_player_stream_handler.h"
 
 class GstVideoPlayer {
  public:
+  enum class SeekMode {
+    // Seeks to the keyframe before the position, which is fast but can be
+    // seconds off in long-GOP videos.
+    kKeyframe,
+    // Seeks to the exact position by decoding from the keyframe before it.
+    kAccurate,
+    // Chooses one of the above with the keyframe index of the file. See
+    // GetSeekFlags().
+    kAuto,
+  };
+
+  struct SeekStats {
+    // The number of the seeks which have completed.
+    int64_t count = 0;
+    // The number of the seeks which were replaced by a later one before they
+    // started.
+    int64_t coalesced_count = 0;
+    // The time from starting a seek until the pipeline prerolls again.
+    int64_t last_latency_ms = 0;
+    int64_t max_latency_ms = 0;
+    int64_t total_latency_ms = 0;
+  };
+
+  // |audio_only| creates a player which doesn't decode the video. See
+  // SetAudioOnly().
   GstVideoPlayer(const std::string& uri,
-                 std::unique_ptr<VideoPlayerStreamHandler> handler);
+                 std::unique_ptr<VideoPlayerStreamHandler> handler,
+                 bool audio_only = false);
   ~GstVideoPlayer();
 
   static void GstLibraryLoad();
@@ -31,14 +62,39 @@ class GstVideoPlayer {
   bool SetVolume(double volume);
   bool SetPlaybackRate(double rate);
   void SetAutoRepeat(bool auto_repeat) { auto_repeat_ = auto_repeat; };
+  // Seeks to |position| in milliseconds. While a seek is in progress, only
+  // the latest position is sought after it completes.
   bool SetSeek(int64_t position);
+  void SetSeekMode(SeekMode mode) { seek_mode_ = mode; };
+  SeekStats GetSeekStats();
+  // Stops decoding the video while |visible| is false, e.g. while the texture
+  // is off screen. The audio and the clock keep running, and the decoding
+  // catches up with the current position when it becomes visible again.
+  void SetVisible(bool visible);
+  // Disables the video of playbin3 while |audio_only| is true, so the video
+  // isn't even decoded. The size of a player created with |audio_only| is 0x0
+  // until it's disabled and the frames are decoded.
+  bool SetAudioOnly(bool audio_only);
   int64_t GetDuration();
   int64_t GetCurrentPosition();
-  const uint8_t* GetFrameBuffer();
-  int32_t GetWidth() const { return width_; };
-  int32_t GetHeight() const { return height_; };
+  // Copies the latest frame in RGBA to |pixels|, resizing it to the size of
+  // the frame, which is returned with |width| and |height|. The size can
+  // change while playing, e.g. when the audio only mode is disabled. Returns
+  // false if there's no frame yet.
+  bool CopyFrame(std::vector<uint8_t>& pixels, int32_t& width,
+                 int32_t& height);
+  int32_t GetWidth();
+  int32_t GetHeight();
 
  private:
+  // A flushing seek.
+  struct SeekRequest {
+    // The current position when the seek starts if it's not set.
+    std::optional<int64_t> position;
+    // Chosen by GetSeekFlags() when the seek starts if they're not set.
+    std::optional<GstSeekFlags> flags;
+  };
+
   struct GstVideoElements {
     GstElement* pipeline;
     GstElement* video_src;
@@ -50,19 +106,45 @@ class GstVideoPlayer {
     GstElement* output;
 
     GstBus* bus;
+    GSource* bus_watch;
     GstBuffer* buffer;
   };
 
   static void HandoffHandler(GstElement* fakesink, GstBuffer* buf,
                              GstPad* new_pad, gpointer user_data);
-  static GstBusSyncReply HandleGstMessage(GstBus* bus, GstMessage* message,
-                                          gpointer user_data);
+  static void HandleElementSetup(GstElement* playbin, GstElement* element,
+                                 gpointer user_data);
+  static GstPadProbeReturn HandleVideoDecoderBuffer(GstPad* pad,
+                                                    GstPadProbeInfo* info,
+                                                    gpointer user_data);
+  // Called on the thread of GstBusThread.
+  static gboolean HandleGstMessage(GstBus* bus, GstMessage* message,
+                                   gpointer user_data);
+  static gboolean HandleSeekTimeout(gpointer user_data);
   std::string ParseUri(const std::string& uri);
   bool CreatePipeline();
   bool CheckPluginAvailability(const std::string & element);
   void IncreasePluginRank(const std::string & element);
   void CorrectAspectRatio();
   void DestroyPipeline();
+  void AddVideoDecoderProbe(GstElement* decoder);
+  void SetVideoFlag(bool enabled);
+  bool ChangePlaybackRateInstantly(double rate);
+  // Starts |request| with |playback_rate_|, or after the seek in progress
+  // completes. While a seek is in progress, only one request is kept pending:
+  // a later request replaces it if |replaces_pending| is true.
+  bool RequestSeek(const SeekRequest& request, bool replaces_pending);
+  bool StartSeek(const SeekRequest& request);
+  // Ends the seek in progress, and makes the pending request the one in
+  // progress if any. Returns it, which the caller must start.
+  std::optional<SeekRequest> FinishSeekLocked(bool completed);
+  void ArmSeekTimeoutLocked();
+  void DisarmSeekTimeoutLocked();
+  void OnAsyncDone();
+  void OnSeekTimeout();
+  GstSeekFlags GetSeekFlags(int64_t position);
+  std::shared_ptr<const KeyframeIndex> GetKeyframeIndex();
+  void CatchUpVideo();
   void Preroll();
   void GetVideoSize(int32_t& width, int32_t& height);
   bool IsStreamUri(const std::string &uri) const;
@@ -73,19 +155,37 @@ class GstVideoPlayer {
   GstVideoElements gst_;
   std::string uri_;
   std::string aspect_ratio_;
-  std::unique_ptr<uint32_t> pixels_;
-  int32_t width_;
-  int32_t height_;
+  // The size of the frames. Guarded by |mutex_buffer_|.
+  int32_t width_ = 0;
+  int32_t height_ = 0;
   double volume_ = 1.0;
-  double playback_rate_ = 1.0;
+  std::atomic<double> playback_rate_{1.0};
   bool mute_ = false;
   bool is_stream_ = false;
   bool is_camera_ = false;
   bool is_inconsistent_ = false;
-  bool auto_repeat_ = false;
-  bool is_completed_ = false;
-  std::mutex mutex_event_completed_;
+  bool is_audio_only_ = false;
+  // scaletempo keeps the pitch of the audio at playback rates other than 1.0.
+  bool has_scaletempo_ = false;
+  std::atomic<bool> auto_repeat_{false};
+  std::atomic<bool> is_visible_{true};
+  // The video decoders drop their input until a keyframe arrives.
+  std::atomic<bool> is_waiting_keyframe_{false};
   std::shared_mutex mutex_buffer_;
+  std::atomic<SeekMode> seek_mode_{SeekMode::kAuto};
+  std::mutex mutex_seek_;
+  // When the seek in progress started.
+  std::optional<std::chrono::steady_clock::time_point> seek_start_time_;
+  // The latest request while the seek is in progress.
+  std::optional<SeekRequest> pending_seek_;
+  // Ends the seek in progress after kSeekTimeout in case the pipeline never
+  // prerolls, so that the pending request isn't left behind.
+  GSource* seek_timeout_ = nullptr;
+  SeekStats seek_stats_;
+  std::atomic<bool> cancel_keyframe_index_{false};
+  bool keyframe_index_requested_ = false;
+  std::future<std::shared_ptr<const KeyframeIndex>> keyframe_index_future_;
+  std::shared_ptr<const KeyframeIndex> keyframe_index_;
   std::unique_ptr<VideoPlayerStreamHandler> stream_handler_;
 
   static inline auto const stream_type_regex_ {std::regex("((?:rtp|rtmp|rtcp|rtsp|udp)://.*)", std::regex::icase)};
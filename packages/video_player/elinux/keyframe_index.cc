@@ -0,0 +1,182 @@
+// Copyright 2023 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "keyframe_index.h"
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <deque>
+#include <iterator>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+namespace {
+constexpr size_t kMaxCachedIndexes = 16;
+
+// The device, the inode, the size and the modification time of a file.
+using FileIdentity = std::tuple<dev_t, ino_t, off_t, int64_t>;
+
+std::mutex cache_mutex;
+std::map<FileIdentity, std::shared_ptr<const KeyframeIndex>> cache;
+// The keys of |cache| from the oldest one.
+std::deque<FileIdentity> cache_order;
+
+bool GetFileIdentity(const std::string& path, FileIdentity& identity) {
+  struct stat file_stat;
+  if (stat(path.c_str(), &file_stat) != 0) {
+    return false;
+  }
+  identity = FileIdentity(
+      file_stat.st_dev, file_stat.st_ino, file_stat.st_size,
+      static_cast<int64_t>(file_stat.st_mtim.tv_sec) * 1000000000 +
+          file_stat.st_mtim.tv_nsec);
+  return true;
+}
+
+int InterruptCallback(void* opaque) {
+  return reinterpret_cast<const std::atomic<bool>*>(opaque)->load() ? 1 : 0;
+}
+}  // namespace
+
+KeyframeIndex::KeyframeIndex(std::vector<int64_t> positions_ms)
+    : positions_ms_(std::move(positions_ms)) {
+  std::sort(positions_ms_.begin(), positions_ms_.end());
+  positions_ms_.erase(std::unique(positions_ms_.begin(), positions_ms_.end()),
+                      positions_ms_.end());
+}
+
+// static
+std::shared_ptr<const KeyframeIndex> KeyframeIndex::Load(
+    const std::string& path, const std::atomic<bool>& cancel) {
+  FileIdentity identity;
+  if (!GetFileIdentity(path, identity)) {
+    std::cerr << "Failed to get the status of " << path << std::endl;
+    return nullptr;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    auto itr = cache.find(identity);
+    if (itr != cache.end()) {
+      return itr->second;
+    }
+  }
+
+  // Two players might build the index of the same file at the same time, but
+  // it's rare enough not to wait for each other.
+  auto index = Build(path, cancel);
+  if (!index) {
+    return nullptr;
+  }
+
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  if (cache.emplace(identity, index).second) {
+    cache_order.push_back(identity);
+    if (cache_order.size() > kMaxCachedIndexes) {
+      cache.erase(cache_order.front());
+      cache_order.pop_front();
+    }
+  }
+  return index;
+}
+
+// static
+std::shared_ptr<const KeyframeIndex> KeyframeIndex::Build(
+    const std::string& path, const std::atomic<bool>& cancel) {
+  auto* format_context = avformat_alloc_context();
+  if (!format_context) {
+    std::cerr << "Failed to allocate a format context" << std::endl;
+    return nullptr;
+  }
+  format_context->interrupt_callback.callback = InterruptCallback;
+  format_context->interrupt_callback.opaque =
+      const_cast<std::atomic<bool>*>(&cancel);
+
+  // |format_context| is freed on failure.
+  if (avformat_open_input(&format_context, path.c_str(), NULL, NULL) != 0) {
+    std::cerr << "Failed to open " << path << std::endl;
+    return nullptr;
+  }
+  if (avformat_find_stream_info(format_context, NULL) < 0) {
+    std::cerr << "Failed to get the stream info of " << path << std::endl;
+    avformat_close_input(&format_context);
+    return nullptr;
+  }
+
+  auto stream_index = av_find_best_stream(format_context, AVMEDIA_TYPE_VIDEO,
+                                          -1, -1, NULL, 0);
+  if (stream_index < 0) {
+    avformat_close_input(&format_context);
+    return nullptr;
+  }
+  auto* stream = format_context->streams[stream_index];
+  auto start_time =
+      stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+  auto to_milliseconds = [stream, start_time](int64_t timestamp) {
+    return av_rescale_q(timestamp - start_time, stream->time_base,
+                        AVRational{1, 1000});
+  };
+
+  std::vector<int64_t> positions_ms;
+#if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(58, 78, 100)
+  auto entry_count = avformat_index_get_entries_count(stream);
+  for (int i = 0; i < entry_count; i++) {
+    const auto* entry = avformat_index_get_entry(stream, i);
+    if (entry->flags & AVINDEX_KEYFRAME) {
+      positions_ms.push_back(to_milliseconds(entry->timestamp));
+    }
+  }
+#else
+  for (int i = 0; i < stream->nb_index_entries; i++) {
+    const auto& entry = stream->index_entries[i];
+    if (entry.flags & AVINDEX_KEYFRAME) {
+      positions_ms.push_back(to_milliseconds(entry.timestamp));
+    }
+  }
+#endif
+
+  // Reads all the packets of the video stream if the container has no index,
+  // e.g. MPEG-TS.
+  if (positions_ms.empty()) {
+    for (unsigned int i = 0; i < format_context->nb_streams; i++) {
+      if (static_cast<int>(i) != stream_index) {
+        format_context->streams[i]->discard = AVDISCARD_ALL;
+      }
+    }
+    auto* packet = av_packet_alloc();
+    while (packet && av_read_frame(format_context, packet) >= 0) {
+      if (packet->stream_index == stream_index &&
+          (packet->flags & AV_PKT_FLAG_KEY)) {
+        auto timestamp =
+            packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+        if (timestamp != AV_NOPTS_VALUE) {
+          positions_ms.push_back(to_milliseconds(timestamp));
+        }
+      }
+      av_packet_unref(packet);
+    }
+    av_packet_free(&packet);
+  }
+  avformat_close_input(&format_context);
+
+  if (cancel || positions_ms.empty()) {
+    return nullptr;
+  }
+  return std::make_shared<const KeyframeIndex>(std::move(positions_ms));
+}
+
+int64_t KeyframeIndex::GetKeyframeBefore(int64_t position_ms) const {
+  auto itr = std::upper_bound(positions_ms_.begin(), positions_ms_.end(),
+                              position_ms);
+  if (itr == positions_ms_.begin()) {
+    return 0;
+  }
+  return *std::prev(itr);
+}
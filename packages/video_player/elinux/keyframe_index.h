@@ -0,0 +1,47 @@
+// Copyright 2023 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PACKAGES_VIDEO_PLAYER_VIDEO_PLAYER_ELINUX_KEYFRAME_INDEX_H_
+#define PACKAGES_VIDEO_PLAYER_VIDEO_PLAYER_ELINUX_KEYFRAME_INDEX_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// The positions of the keyframes of the video stream of a local file. They are
+// read from the index of the container, or from all the packets if the
+// container has no index.
+class KeyframeIndex {
+ public:
+  explicit KeyframeIndex(std::vector<int64_t> positions_ms);
+  ~KeyframeIndex() = default;
+
+  // Prevent copying.
+  KeyframeIndex(KeyframeIndex const&) = delete;
+  KeyframeIndex& operator=(KeyframeIndex const&) = delete;
+
+  // Returns the index of |path|. The indexes are cached by the identity of the
+  // file, so opening the same file again doesn't read it again. Returns
+  // nullptr if |path| has no video stream, or if |cancel| becomes true while
+  // reading it.
+  static std::shared_ptr<const KeyframeIndex> Load(
+      const std::string& path, const std::atomic<bool>& cancel);
+
+  // Returns the position of the last keyframe at or before |position_ms|, or 0
+  // if there is none.
+  int64_t GetKeyframeBefore(int64_t position_ms) const;
+
+  size_t GetSize() const { return positions_ms_.size(); }
+
+ private:
+  static std::shared_ptr<const KeyframeIndex> Build(
+      const std::string& path, const std::atomic<bool>& cancel);
+
+  // Sorted in ascending order.
+  std::vector<int64_t> positions_ms_;
+};
+
+#endif  // PACKAGES_VIDEO_PLAYER_VIDEO_PLAYER_ELINUX_KEYFRAME_INDEX_H_
@@ -0,0 +1,63 @@
+// Copyright 2023 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PACKAGES_VIDEO_PLAYER_VIDEO_PLAYER_ELINUX_MESSAGES_AUDIO_ONLY_MESSAGE_H_
+#define PACKAGES_VIDEO_PLAYER_VIDEO_PLAYER_ELINUX_MESSAGES_AUDIO_ONLY_MESSAGE_H_
+
+#include <flutter/binary_messenger.h>
+#include <flutter/encodable_value.h>
+
+class AudioOnlyMessage {
+ public:
+  AudioOnlyMessage() = default;
+  ~AudioOnlyMessage() = default;
+
+  // Prevent copying.
+  AudioOnlyMessage(AudioOnlyMessage const&) = default;
+  AudioOnlyMessage& operator=(AudioOnlyMessage const&) = default;
+
+  void SetTextureId(int64_t texture_id) { texture_id_ = texture_id; }
+
+  int64_t GetTextureId() const { return texture_id_; }
+
+  void SetIsAudioOnly(bool is_audio_only) { is_audio_only_ = is_audio_only; }
+
+  bool GetIsAudioOnly() const { return is_audio_only_; }
+
+  flutter::EncodableValue ToMap() {
+    flutter::EncodableMap map = {{flutter::EncodableValue("textureId"),
+                                  flutter::EncodableValue(texture_id_)},
+                                 {flutter::EncodableValue("isAudioOnly"),
+                                  flutter::EncodableValue(is_audio_only_)}};
+    return flutter::EncodableValue(map);
+  }
+
+  static AudioOnlyMessage FromMap(const flutter::EncodableValue& value) {
+    AudioOnlyMessage message;
+    if (std::holds_alternative<flutter::EncodableMap>(value)) {
+      auto map = std::get<flutter::EncodableMap>(value);
+
+      flutter::EncodableValue& texture_id =
+          map[flutter::EncodableValue("textureId")];
+      if (std::holds_alternative<int32_t>(texture_id) ||
+          std::holds_alternative<int64_t>(texture_id)) {
+        message.SetTextureId(texture_id.LongValue());
+      }
+
+      flutter::EncodableValue& is_audio_only =
+          map[flutter::EncodableValue("isAudioOnly")];
+      if (std::holds_alternative<bool>(is_audio_only)) {
+        message.SetIsAudioOnly(std::get<bool>(is_audio_only));
+      }
+    }
+
+    return message;
+  }
+
+ private:
+  int64_t texture_id_ = 0;
+  bool is_audio_only_ = false;
+};
+
+#endif  // PACKAGES_VIDEO_PLAYER_VIDEO_PLAYER_ELINUX_MESSAGES_AUDIO_ONLY_MESSAGE_H_
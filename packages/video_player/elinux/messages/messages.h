@@ -5,12 +5,16 @@
 #ifndef PACKAGES_VIDEO_PLAYER_VIDEO_PLAYER_ELINUX_MESSAGES_MESSAGES_H_
 #define PACKAGES_VIDEO_PLAYER_VIDEO_PLAYER_ELINUX_MESSAGES_MESSAGES_H_
 
+#include "audio_only_message.h"
 #include "create_message.h"
 #include "looping_message.h"
 #include "mix_with_others_message.h"
 #include "playback_speed_message.h"
 #include "position_message.h"
+#include "seek_mode_message.h"
 #include "texture_message.h"
+#include "thumbnail_message.h"
+#include "visibility_message.h"
 #include "volume_message.h"
 
 #endif  // PACKAGES_VIDEO_PLAYER_VIDEO_PLAYER_ELINUX_MESSAGES_MESSAGES_H_
@@ -0,0 +1,152 @@
+// Copyright 2023 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PACKAGES_VIDEO_PLAYER_VIDEO_PLAYER_ELINUX_MESSAGES_THUMBNAIL_MESSAGE_H_
+#define PACKAGES_VIDEO_PLAYER_VIDEO_PLAYER_ELINUX_MESSAGES_THUMBNAIL_MESSAGE_H_
+
+#include <flutter/binary_messenger.h>
+#include <flutter/encodable_value.h>
+
+#include <string>
+#include <vector>
+
+class ThumbnailMessage {
+ public:
+  ThumbnailMessage() = default;
+  ~ThumbnailMessage() = default;
+
+  // Prevent copying.
+  ThumbnailMessage(ThumbnailMessage const&) = default;
+  ThumbnailMessage& operator=(ThumbnailMessage const&) = default;
+
+  void SetAsset(const std::string& asset) { asset_ = asset; }
+
+  std::string GetAsset() const { return asset_; }
+
+  void SetUri(const std::string& uri) { uri_ = uri; }
+
+  std::string GetUri() const { return uri_; }
+
+  void SetPositionsMs(const std::vector<int64_t>& positions_ms) {
+    positions_ms_ = positions_ms;
+  }
+
+  std::vector<int64_t> GetPositionsMs() const { return positions_ms_; }
+
+  void SetCount(int64_t count) { count_ = count; }
+
+  int64_t GetCount() const { return count_; }
+
+  void SetWidth(int64_t width) { width_ = width; }
+
+  int64_t GetWidth() const { return width_; }
+
+  void SetHeight(int64_t height) { height_ = height; }
+
+  int64_t GetHeight() const { return height_; }
+
+  void SetFormat(int64_t format) { format_ = format; }
+
+  int64_t GetFormat() const { return format_; }
+
+  void SetIsAccurate(bool is_accurate) { is_accurate_ = is_accurate; }
+
+  bool GetIsAccurate() const { return is_accurate_; }
+
+  flutter::EncodableValue ToMap() {
+    flutter::EncodableList positions_ms;
+    for (auto position_ms : positions_ms_) {
+      positions_ms.push_back(flutter::EncodableValue(position_ms));
+    }
+    flutter::EncodableMap map = {
+        {flutter::EncodableValue("asset"), flutter::EncodableValue(asset_)},
+        {flutter::EncodableValue("uri"), flutter::EncodableValue(uri_)},
+        {flutter::EncodableValue("positionsMs"),
+         flutter::EncodableValue(positions_ms)},
+        {flutter::EncodableValue("count"), flutter::EncodableValue(count_)},
+        {flutter::EncodableValue("width"), flutter::EncodableValue(width_)},
+        {flutter::EncodableValue("height"), flutter::EncodableValue(height_)},
+        {flutter::EncodableValue("format"), flutter::EncodableValue(format_)},
+        {flutter::EncodableValue("isAccurate"),
+         flutter::EncodableValue(is_accurate_)}};
+    return flutter::EncodableValue(map);
+  }
+
+  static ThumbnailMessage FromMap(const flutter::EncodableValue& value) {
+    ThumbnailMessage message;
+    if (std::holds_alternative<flutter::EncodableMap>(value)) {
+      auto map = std::get<flutter::EncodableMap>(value);
+
+      flutter::EncodableValue& asset = map[flutter::EncodableValue("asset")];
+      if (std::holds_alternative<std::string>(asset)) {
+        message.SetAsset(std::get<std::string>(asset));
+      }
+
+      flutter::EncodableValue& uri = map[flutter::EncodableValue("uri")];
+      if (std::holds_alternative<std::string>(uri)) {
+        message.SetUri(std::get<std::string>(uri));
+      }
+
+      flutter::EncodableValue& positions_ms =
+          map[flutter::EncodableValue("positionsMs")];
+      if (std::holds_alternative<flutter::EncodableList>(positions_ms)) {
+        std::vector<int64_t> values;
+        for (const auto& position_ms :
+             std::get<flutter::EncodableList>(positions_ms)) {
+          if (std::holds_alternative<int32_t>(position_ms) ||
+              std::holds_alternative<int64_t>(position_ms)) {
+            values.push_back(position_ms.LongValue());
+          }
+        }
+        message.SetPositionsMs(values);
+      } else if (std::holds_alternative<std::vector<int64_t>>(positions_ms)) {
+        message.SetPositionsMs(std::get<std::vector<int64_t>>(positions_ms));
+      }
+
+      flutter::EncodableValue& count = map[flutter::EncodableValue("count")];
+      if (std::holds_alternative<int32_t>(count) ||
+          std::holds_alternative<int64_t>(count)) {
+        message.SetCount(count.LongValue());
+      }
+
+      flutter::EncodableValue& width = map[flutter::EncodableValue("width")];
+      if (std::holds_alternative<int32_t>(width) ||
+          std::holds_alternative<int64_t>(width)) {
+        message.SetWidth(width.LongValue());
+      }
+
+      flutter::EncodableValue& height = map[flutter::EncodableValue("height")];
+      if (std::holds_alternative<int32_t>(height) ||
+          std::holds_alternative<int64_t>(height)) {
+        message.SetHeight(height.LongValue());
+      }
+
+      flutter::EncodableValue& format = map[flutter::EncodableValue("format")];
+      if (std::holds_alternative<int32_t>(format) ||
+          std::holds_alternative<int64_t>(format)) {
+        message.SetFormat(format.LongValue());
+      }
+
+      flutter::EncodableValue& is_accurate =
+          map[flutter::EncodableValue("isAccurate")];
+      if (std::holds_alternative<bool>(is_accurate)) {
+        message.SetIsAccurate(std::get<bool>(is_accurate));
+      }
+    }
+
+    return message;
+  }
+
+ private:
+  std::string asset_;
+  std::string uri_;
+  std::vector<int64_t> positions_ms_;
+  int64_t count_ = 0;
+  int64_t width_ = 0;
+  int64_t height_ = 0;
+  int64_t format_ = 0;
+  bool is_accurate_ = false;
+};
+
+#endif  // PACKAGES_VIDEO_PLAYER_VIDEO_PLAYER_ELINUX_MESSAGES_THUMBNAIL_MESSAGE_H_
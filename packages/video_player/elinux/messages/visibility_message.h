@@ -0,0 +1,63 @@
+// Copyright 2023 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PACKAGES_VIDEO_PLAYER_VIDEO_PLAYER_ELINUX_MESSAGES_VISIBILITY_MESSAGE_H_
+#define PACKAGES_VIDEO_PLAYER_VIDEO_PLAYER_ELINUX_MESSAGES_VISIBILITY_MESSAGE_H_
+
+#include <flutter/binary_messenger.h>
+#include <flutter/encodable_value.h>
+
+class VisibilityMessage {
+ public:
+  VisibilityMessage() = default;
+  ~VisibilityMessage() = default;
+
+  // Prevent copying.
+  VisibilityMessage(VisibilityMessage const&) = default;
+  VisibilityMessage& operator=(VisibilityMessage const&) = default;
+
+  void SetTextureId(int64_t texture_id) { texture_id_ = texture_id; }
+
+  int64_t GetTextureId() const { return texture_id_; }
+
+  void SetIsVisible(bool is_visible) { is_visible_ = is_visible; }
+
+  bool GetIsVisible() const { return is_visible_; }
+
+  flutter::EncodableValue ToMap() {
+    flutter::EncodableMap map = {{flutter::EncodableValue("textureId"),
+                                  flutter::EncodableValue(texture_id_)},
+                                 {flutter::EncodableValue("isVisible"),
+                                  flutter::EncodableValue(is_visible_)}};
+    return flutter::EncodableValue(map);
+  }
+
+  static VisibilityMessage FromMap(const flutter::EncodableValue& value) {
+    VisibilityMessage message;
+    if (std::holds_alternative<flutter::EncodableMap>(value)) {
+      auto map = std::get<flutter::EncodableMap>(value);
+
+      flutter::EncodableValue& texture_id =
+          map[flutter::EncodableValue("textureId")];
+      if (std::holds_alternative<int32_t>(texture_id) ||
+          std::holds_alternative<int64_t>(texture_id)) {
+        message.SetTextureId(texture_id.LongValue());
+      }
+
+      flutter::EncodableValue& is_visible =
+          map[flutter::EncodableValue("isVisible")];
+      if (std::holds_alternative<bool>(is_visible)) {
+        message.SetIsVisible(std::get<bool>(is_visible));
+      }
+    }
+
+    return message;
+  }
+
+ private:
+  int64_t texture_id_ = 0;
+  bool is_visible_ = true;
+};
+
+#endif  // PACKAGES_VIDEO_PLAYER_VIDEO_PLAYER_ELINUX_MESSAGES_VISIBILITY_MESSAGE_H_
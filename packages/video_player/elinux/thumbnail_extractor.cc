@@ -0,0 +1,345 @@
+// Copyright 2023 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "thumbnail_extractor.h"
+
+#include <gst/gst.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+namespace {
+constexpr int kMaxDefaultWorkerCount = 4;
+// How long a worker keeps its pipeline open without a task. The paused
+// pipeline holds the file and the buffers of the decoder.
+constexpr auto kDecoderIdleTimeout = std::chrono::seconds(3);
+// The cache is trimmed to this size once per process, removing the oldest
+// thumbnails first.
+constexpr int64_t kMaxCacheSize = 128 * 1024 * 1024;
+// Changed with the format of the cached thumbnails, so that the ones of the
+// old format aren't found and are trimmed eventually.
+constexpr int kCacheVersion = 2;
+
+const char* GetExtension(ThumbnailFormat format) {
+  return format == ThumbnailFormat::kJpeg ? ".jpg" : ".rgba";
+}
+}  // namespace
+
+ThumbnailExtractor::ThumbnailExtractor(int worker_count,
+                                       const std::string& cache_directory)
+    : cache_directory_(cache_directory) {
+  if (!cache_directory_.empty() &&
+      g_mkdir_with_parents(cache_directory_.c_str(), 0755) != 0) {
+    std::cerr << "Failed to create " << cache_directory_
+              << ", thumbnails won't be cached" << std::endl;
+    cache_directory_.clear();
+  }
+
+  for (auto i = 0; i < std::max(worker_count, 1); i++) {
+    threads_.emplace_back(&ThumbnailExtractor::Run, this);
+  }
+}
+
+ThumbnailExtractor::~ThumbnailExtractor() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    terminated_ = true;
+    tasks_.clear();
+  }
+  cv_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+// static
+int ThumbnailExtractor::GetDefaultWorkerCount() {
+  // Leaves the other half of the cores to the players and the UI.
+  return std::clamp(static_cast<int>(std::thread::hardware_concurrency() / 2),
+                    1, kMaxDefaultWorkerCount);
+}
+
+// static
+std::string ThumbnailExtractor::GetDefaultCacheDirectory() {
+  // $XDG_CACHE_HOME, or ~/.cache.
+  return std::string(g_get_user_cache_dir()) +
+         "/flutter-elinux/video_player/thumbnails";
+}
+
+void ThumbnailExtractor::Extract(const Options& options,
+                                 OnExtracted on_extracted) {
+  auto job = std::make_shared<Job>();
+  job->options = options;
+  job->on_extracted = std::move(on_extracted);
+  // The file paths, e.g. of the assets, are converted to file URIs.
+  if (!gst_uri_is_valid(options.uri.c_str())) {
+    auto* uri = gst_filename_to_uri(options.uri.c_str(), nullptr);
+    if (uri) {
+      job->options.uri = uri;
+      g_free(uri);
+    }
+  }
+
+  if (!cache_directory_.empty()) {
+    auto* path =
+        g_filename_from_uri(job->options.uri.c_str(), nullptr, nullptr);
+    struct stat file_stat;
+    if (path && stat(path, &file_stat) == 0) {
+      std::ostringstream key;
+      key << file_stat.st_dev << ":" << file_stat.st_ino << ":"
+          << file_stat.st_size << ":" << file_stat.st_mtim.tv_sec << "."
+          << file_stat.st_mtim.tv_nsec;
+      job->cache_key = key.str();
+    }
+    g_free(path);
+  }
+
+  if (options.positions_ms.empty() && options.count <= 0) {
+    job->on_extracted({});
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (options.positions_ms.empty()) {
+      tasks_.push_back({job, -1});
+    } else {
+      job->thumbnails.resize(options.positions_ms.size());
+      job->remaining_count = options.positions_ms.size();
+      for (size_t i = 0; i < options.positions_ms.size(); i++) {
+        tasks_.push_back({job, static_cast<int>(i)});
+      }
+    }
+  }
+  cv_.notify_all();
+}
+
+void ThumbnailExtractor::Run() {
+  GstThumbnailDecoder decoder;
+  Task task;
+  while (PopTask(decoder, task)) {
+    if (task.index < 0) {
+      ResolvePositions(decoder, task.job);
+    } else {
+      ExtractThumbnail(decoder, task);
+    }
+    task = {};
+  }
+}
+
+bool ThumbnailExtractor::PopTask(GstThumbnailDecoder& decoder, Task& task) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto has_task = [this]() { return terminated_ || !tasks_.empty(); };
+  if (decoder.IsOpen() &&
+      !cv_.wait_for(lock, kDecoderIdleTimeout, has_task)) {
+    lock.unlock();
+    decoder.Close();
+    lock.lock();
+  }
+  cv_.wait(lock, has_task);
+  if (terminated_) {
+    return false;
+  }
+
+  // Prefers the video which the decoder has already opened, so that the
+  // pipelines aren't rebuilt when several videos are requested at once.
+  auto it = std::find_if(tasks_.begin(), tasks_.end(), [&](const Task& t) {
+    const auto& options = t.job->options;
+    return decoder.IsOpen(options.uri, options.width, options.height,
+                          options.format);
+  });
+  if (it == tasks_.end()) {
+    it = tasks_.begin();
+  }
+  task = std::move(*it);
+  tasks_.erase(it);
+  return true;
+}
+
+void ThumbnailExtractor::ResolvePositions(GstThumbnailDecoder& decoder,
+                                          const std::shared_ptr<Job>& job) {
+  const auto& options = job->options;
+  int64_t duration = -1;
+  if (decoder.Open(options.uri, options.width, options.height,
+                   options.format)) {
+    duration = decoder.GetDuration();
+  }
+  if (duration <= 0) {
+    std::cerr << "Failed to get the duration of " << options.uri << std::endl;
+    job->on_extracted({});
+    return;
+  }
+
+  // The centers of |count| equal sections, so that neither the first black
+  // frame nor the end of the stream is picked.
+  std::vector<int64_t> positions_ms;
+  for (auto i = 0; i < options.count; i++) {
+    positions_ms.push_back((2 * i + 1) * duration / (2 * options.count));
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    job->options.positions_ms = positions_ms;
+    job->thumbnails.resize(positions_ms.size());
+    job->remaining_count = positions_ms.size();
+    // To the front, so that the request completes before the later ones.
+    for (auto i = static_cast<int>(positions_ms.size()) - 1; i >= 0; i--) {
+      tasks_.push_front({job, i});
+    }
+  }
+  cv_.notify_all();
+}
+
+void ThumbnailExtractor::ExtractThumbnail(GstThumbnailDecoder& decoder,
+                                          const Task& task) {
+  const auto& job = *task.job;
+  const auto& options = job.options;
+  auto position_ms = options.positions_ms[task.index];
+
+  auto thumbnail = std::make_unique<Thumbnail>();
+  if (ReadCache(job, position_ms, *thumbnail)) {
+    // Decoded already.
+  } else if (decoder.Open(options.uri, options.width, options.height,
+                          options.format) &&
+             decoder.Decode(position_ms, options.accurate, *thumbnail)) {
+    WriteCache(job, position_ms, *thumbnail);
+  } else {
+    thumbnail.reset();
+  }
+
+  std::vector<Thumbnail> thumbnails;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task.job->thumbnails[task.index] = std::move(thumbnail);
+    if (--task.job->remaining_count > 0) {
+      return;
+    }
+    for (auto& extracted : task.job->thumbnails) {
+      if (extracted) {
+        thumbnails.push_back(std::move(*extracted));
+      }
+    }
+  }
+  task.job->on_extracted(std::move(thumbnails));
+}
+
+std::string ThumbnailExtractor::GetCachePath(const Job& job,
+                                             int64_t position_ms) const {
+  if (job.cache_key.empty()) {
+    return std::string();
+  }
+  return cache_directory_ + "/" +
+         std::to_string(std::hash<std::string>{}(
+             std::to_string(kCacheVersion) + ":" + job.cache_key + ":" +
+             job.options.uri + ":" + std::to_string(position_ms))) +
+         "_" + std::to_string(job.options.width) + "x" +
+         std::to_string(job.options.height) +
+         (job.options.accurate ? "_accurate" : "") +
+         GetExtension(job.options.format);
+}
+
+// A cached thumbnail is the key line with the requested position, the line of
+// the size and the position of the decoded frame, and the data. The key line
+// detects the collisions of the hash in the file name.
+bool ThumbnailExtractor::ReadCache(const Job& job, int64_t position_ms,
+                                   Thumbnail& thumbnail) const {
+  auto path = GetCachePath(job, position_ms);
+  if (path.empty()) {
+    return false;
+  }
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+
+  std::string key;
+  if (!std::getline(file, key) ||
+      key != job.cache_key + ":" + std::to_string(position_ms) ||
+      !(file >> thumbnail.width >> thumbnail.height >> thumbnail.position_ms) ||
+      file.get() != '\n') {
+    return false;
+  }
+  thumbnail.data.assign(std::istreambuf_iterator<char>(file),
+                        std::istreambuf_iterator<char>());
+  return !thumbnail.data.empty();
+}
+
+void ThumbnailExtractor::WriteCache(const Job& job, int64_t position_ms,
+                                    const Thumbnail& thumbnail) {
+  auto path = GetCachePath(job, position_ms);
+  if (path.empty()) {
+    return;
+  }
+  std::call_once(trim_cache_flag_, [this]() { TrimCache(); });
+
+  // Written to a temporary file and renamed, so that the other workers and
+  // processes never read a partial file.
+  std::ostringstream temp_path;
+  temp_path << path << ".tmp" << std::this_thread::get_id();
+  {
+    std::ofstream file(temp_path.str(), std::ios::binary | std::ios::trunc);
+    file << job.cache_key << ":" << position_ms << "\n"
+         << thumbnail.width << " " << thumbnail.height << " "
+         << thumbnail.position_ms << "\n";
+    file.write(reinterpret_cast<const char*>(thumbnail.data.data()),
+               thumbnail.data.size());
+    if (!file) {
+      std::cerr << "Failed to write " << temp_path.str() << std::endl;
+      file.close();
+      std::remove(temp_path.str().c_str());
+      return;
+    }
+  }
+  if (std::rename(temp_path.str().c_str(), path.c_str()) != 0) {
+    std::cerr << "Failed to rename " << temp_path.str() << std::endl;
+    std::remove(temp_path.str().c_str());
+  }
+}
+
+void ThumbnailExtractor::TrimCache() {
+  auto* dir = g_dir_open(cache_directory_.c_str(), 0, nullptr);
+  if (!dir) {
+    return;
+  }
+
+  struct CacheFile {
+    std::string path;
+    int64_t size;
+    time_t modified_time;
+  };
+  std::vector<CacheFile> files;
+  int64_t total_size = 0;
+  const gchar* name;
+  while ((name = g_dir_read_name(dir)) != nullptr) {
+    auto path = cache_directory_ + "/" + name;
+    struct stat file_stat;
+    if (stat(path.c_str(), &file_stat) == 0 && S_ISREG(file_stat.st_mode)) {
+      files.push_back({path, file_stat.st_size, file_stat.st_mtime});
+      total_size += file_stat.st_size;
+    }
+  }
+  g_dir_close(dir);
+
+  if (total_size <= kMaxCacheSize) {
+    return;
+  }
+  std::sort(files.begin(), files.end(),
+            [](const CacheFile& a, const CacheFile& b) {
+              return a.modified_time < b.modified_time;
+            });
+  for (const auto& file : files) {
+    if (total_size <= kMaxCacheSize) {
+      break;
+    }
+    if (std::remove(file.path.c_str()) == 0) {
+      total_size -= file.size;
+    }
+  }
+}
@@ -0,0 +1,104 @@
+// Copyright 2023 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PACKAGES_VIDEO_PLAYER_VIDEO_PLAYER_ELINUX_THUMBNAIL_EXTRACTOR_H_
+#define PACKAGES_VIDEO_PLAYER_VIDEO_PLAYER_ELINUX_THUMBNAIL_EXTRACTOR_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gst_thumbnail_decoder.h"
+
+// Extracts thumbnails of videos, e.g. for a preview strip of a seek bar, with
+// a pool of GstThumbnailDecoder on worker threads.
+//
+// The positions of a request are decoded in parallel, and each worker keeps
+// its pipeline open for the next position of the same video until it has been
+// idle for a while. The thumbnails
+// of local files are cached on disk, keyed by the identity of the file and
+// the parameters, so they aren't decoded again while the file is unchanged.
+class ThumbnailExtractor {
+ public:
+  struct Options {
+    std::string uri;
+    // The positions to extract. If empty, |count| positions evenly spaced
+    // over the duration are extracted.
+    std::vector<int64_t> positions_ms;
+    int32_t count = 0;
+    // If either of them is 0, it's derived from the other one with the aspect
+    // ratio of the video. If both are 0, the size of the video is used.
+    int32_t width = 0;
+    int32_t height = 0;
+    ThumbnailFormat format = ThumbnailFormat::kJpeg;
+    // Decodes the exact positions instead of the nearest keyframes.
+    bool accurate = false;
+  };
+
+  // Called on a worker thread with the thumbnails in the order of the
+  // positions. The ones which couldn't be decoded are omitted.
+  using OnExtracted = std::function<void(std::vector<Thumbnail> thumbnails)>;
+
+  // |cache_directory| is created if it doesn't exist. The cache is disabled if
+  // it's empty.
+  ThumbnailExtractor(int worker_count, const std::string& cache_directory);
+  ~ThumbnailExtractor();
+
+  // Prevent copying.
+  ThumbnailExtractor(ThumbnailExtractor const&) = delete;
+  ThumbnailExtractor& operator=(ThumbnailExtractor const&) = delete;
+
+  // Returns immediately, and |on_extracted| is called when all the positions
+  // are done.
+  void Extract(const Options& options, OnExtracted on_extracted);
+
+  static int GetDefaultWorkerCount();
+  static std::string GetDefaultCacheDirectory();
+
+ private:
+  struct Job {
+    Options options;
+    OnExtracted on_extracted;
+    std::vector<std::unique_ptr<Thumbnail>> thumbnails;
+    size_t remaining_count = 0;
+    // The identity of the local file. Empty if it isn't a local file.
+    std::string cache_key;
+  };
+
+  struct Task {
+    std::shared_ptr<Job> job;
+    // The index of the position, or -1 to resolve the positions.
+    int index;
+  };
+
+  void Run();
+  bool PopTask(GstThumbnailDecoder& decoder, Task& task);
+  void ResolvePositions(GstThumbnailDecoder& decoder,
+                        const std::shared_ptr<Job>& job);
+  void ExtractThumbnail(GstThumbnailDecoder& decoder, const Task& task);
+  void CompleteTask(const std::shared_ptr<Job>& job, size_t count);
+
+  std::string GetCachePath(const Job& job, int64_t position_ms) const;
+  bool ReadCache(const Job& job, int64_t position_ms,
+                 Thumbnail& thumbnail) const;
+  void WriteCache(const Job& job, int64_t position_ms,
+                  const Thumbnail& thumbnail);
+  void TrimCache();
+
+  std::string cache_directory_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Task> tasks_;
+  bool terminated_ = false;
+  std::once_flag trim_cache_flag_;
+  std::vector<std::thread> threads_;
+};
+
+#endif  // PACKAGES_VIDEO_PLAYER_VIDEO_PLAYER_ELINUX_THUMBNAIL_EXTRACTOR_H_
@@ -14,10 +14,17 @@
 #include <flutter/standard_method_codec.h>
 #include <unistd.h>
 
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <optional>
 #include <unordered_map>
+#include <vector>
 
+#include "dart_api_dl.h"
 #include "gst_video_player.h"
 #include "messages/messages.h"
+#include "thumbnail_extractor.h"
 #include "video_player_stream_handler_impl.h"
 
 namespace {
@@ -44,12 +51,34 @@ constexpr char kVideoPlayerApiChannelSetPlaybackSpeedName[] =
 constexpr char kVideoPlayerApiChannelSeekToName[] =
     "dev.flutter.pigeon.VideoPlayerApi.seekTo";
 
+// The APIs which only the eLinux implementation has. They are called with
+// VideoPlayerElinux in lib/video_player_elinux.dart.
+constexpr char kVideoPlayerElinuxApiChannelSetVisibleName[] =
+    "dev.flutter.pigeon.VideoPlayerElinuxApi.setVisible";
+constexpr char kVideoPlayerElinuxApiChannelSetAudioOnlyName[] =
+    "dev.flutter.pigeon.VideoPlayerElinuxApi.setAudioOnly";
+constexpr char kVideoPlayerElinuxApiChannelSetDefaultAudioOnlyName[] =
+    "dev.flutter.pigeon.VideoPlayerElinuxApi.setDefaultAudioOnly";
+constexpr char kVideoPlayerElinuxApiChannelSetSeekModeName[] =
+    "dev.flutter.pigeon.VideoPlayerElinuxApi.setSeekMode";
+constexpr char kVideoPlayerElinuxApiChannelGetSeekStatsName[] =
+    "dev.flutter.pigeon.VideoPlayerElinuxApi.getSeekStats";
+constexpr char kVideoPlayerElinuxApiChannelGetThumbnailsName[] =
+    "dev.flutter.pigeon.VideoPlayerElinuxApi.getThumbnails";
+constexpr char kVideoPlayerElinuxApiChannelRunPlatformThreadTasksName[] =
+    "dev.flutter.pigeon.VideoPlayerElinuxApi.runPlatformThreadTasks";
+
 constexpr char kVideoPlayerVideoEventsChannelName[] =
     "flutter.io/videoPlayer/videoEvents";
 
 constexpr char kEncodableMapkeyResult[] = "result";
 constexpr char kEncodableMapkeyError[] = "error";
 
+// The native port which VideoPlayerElinux in Dart listens to, to be woken up
+// when tasks are posted to the platform thread. Set by
+// video_player_elinux_set_wakeup_port().
+std::atomic<Dart_Port> platform_thread_wakeup_port(ILLEGAL_PORT);
+
 class VideoPlayerPlugin : public flutter::Plugin {
  public:
   static void RegisterWithRegistrar(flutter::PluginRegistrar* registrar);
@@ -86,6 +115,11 @@ class VideoPlayerPlugin : public flutter::Plugin {
     std::unique_ptr<GstVideoPlayer> player;
     std::unique_ptr<flutter::TextureVariant> texture;
     std::unique_ptr<FlutterDesktopPixelBuffer> buffer;
+    // The frames are copied to them in turn on the raster thread, so that the
+    // one handed to the engine last is neither written nor freed while the
+    // next frame is copied, even if the size of the frames changes.
+    std::vector<uint8_t> pixels[2];
+    int pixels_index = 0;
     std::unique_ptr<flutter::EventChannel<flutter::EncodableValue>>
         event_channel;
     std::unique_ptr<flutter::EventSink<flutter::EncodableValue>> event_sink;
@@ -124,10 +158,48 @@ class VideoPlayerPlugin : public flutter::Plugin {
   void HandlePositionMethodCall(
       const flutter::EncodableValue& message,
       flutter::MessageReply<flutter::EncodableValue> reply);
+  void HandleSetVisibleMethodCall(
+      const flutter::EncodableValue& message,
+      flutter::MessageReply<flutter::EncodableValue> reply);
+  void HandleSetAudioOnlyMethodCall(
+      const flutter::EncodableValue& message,
+      flutter::MessageReply<flutter::EncodableValue> reply);
+  void HandleSetDefaultAudioOnlyMethodCall(
+      const flutter::EncodableValue& message,
+      flutter::MessageReply<flutter::EncodableValue> reply);
+  void HandleSetSeekModeMethodCall(
+      const flutter::EncodableValue& message,
+      flutter::MessageReply<flutter::EncodableValue> reply);
+  void HandleGetSeekStatsMethodCall(
+      const flutter::EncodableValue& message,
+      flutter::MessageReply<flutter::EncodableValue> reply);
+  void HandleGetThumbnailsMethodCall(
+      const flutter::EncodableValue& message,
+      flutter::MessageReply<flutter::EncodableValue> reply);
+  void HandleRunPlatformThreadTasksMethodCall(
+      const flutter::EncodableValue& message,
+      flutter::MessageReply<flutter::EncodableValue> reply);
 
   void SendInitializedEventMessage(int64_t texture_id);
   void SendPlayCompletedEventMessage(int64_t texture_id);
 
+  // Queues |task| to run on the platform thread. It can be called from any
+  // thread.
+  //
+  // flutter-elinux doesn't let plugins post tasks to the platform thread, but
+  // the messages from Dart are handled there. So the first task queued wakes
+  // up VideoPlayerElinux in Dart through its native port, which sends a
+  // runPlatformThreadTasks message back, and the queued tasks run when it's
+  // handled, usually within a frame. Until Dart has set the port, the tasks
+  // run when the next message from Dart is handled.
+  //
+  // The replies and the events of this plugin are only sent on the platform
+  // thread, so the callbacks of the players and the thumbnail workers post
+  // them with this. Only MarkTextureFrameAvailable() is called from the
+  // other threads, which the texture registrar allows.
+  void PostPlatformThreadTask(std::function<void()> task);
+  void RunPlatformThreadTasks();
+
   flutter::EncodableValue WrapError(const std::string& message,
                                     const std::string& code = std::string(),
                                     const std::string& details = std::string());
@@ -137,6 +209,13 @@ class VideoPlayerPlugin : public flutter::Plugin {
   flutter::PluginRegistrar* plugin_registrar_;
   flutter::TextureRegistrar* texture_registrar_;
   std::unordered_map<int64_t, std::unique_ptr<FlutterVideoPlayer>> players_;
+  // Whether the players are created in audio only mode.
+  bool default_audio_only_ = false;
+  std::mutex mutex_platform_thread_tasks_;
+  std::vector<std::function<void()>> platform_thread_tasks_;
+  // Created when the thumbnails are requested for the first time. It's
+  // destroyed first, so that the workers are stopped before the others.
+  std::unique_ptr<ThumbnailExtractor> thumbnail_extractor_;
 };
 
 // static
@@ -152,6 +231,7 @@ void VideoPlayerPlugin::RegisterWithRegistrar(
             &flutter::StandardMessageCodec::GetInstance());
     channel->SetMessageHandler(
         [plugin_pointer = plugin.get()](const auto& message, auto reply) {
+          plugin_pointer->RunPlatformThreadTasks();
           plugin_pointer->HandleInitializeMethodCall(message, reply);
         });
   }
@@ -163,6 +243,7 @@ void VideoPlayerPlugin::RegisterWithRegistrar(
             &flutter::StandardMessageCodec::GetInstance());
     channel->SetMessageHandler(
         [plugin_pointer = plugin.get()](const auto& message, auto reply) {
+          plugin_pointer->RunPlatformThreadTasks();
           plugin_pointer->HandleCreateMethodCall(message, reply);
         });
   }
@@ -174,6 +255,7 @@ void VideoPlayerPlugin::RegisterWithRegistrar(
             &flutter::StandardMessageCodec::GetInstance());
     channel->SetMessageHandler(
         [plugin_pointer = plugin.get()](const auto& message, auto reply) {
+          plugin_pointer->RunPlatformThreadTasks();
           plugin_pointer->HandleDisposeMethodCall(message, reply);
         });
   }
@@ -185,6 +267,7 @@ void VideoPlayerPlugin::RegisterWithRegistrar(
             &flutter::StandardMessageCodec::GetInstance());
     channel->SetMessageHandler(
         [plugin_pointer = plugin.get()](const auto& message, auto reply) {
+          plugin_pointer->RunPlatformThreadTasks();
           plugin_pointer->HandlePauseMethodCall(message, reply);
         });
   }
@@ -196,6 +279,7 @@ void VideoPlayerPlugin::RegisterWithRegistrar(
             &flutter::StandardMessageCodec::GetInstance());
     channel->SetMessageHandler(
         [plugin_pointer = plugin.get()](const auto& message, auto reply) {
+          plugin_pointer->RunPlatformThreadTasks();
           plugin_pointer->HandlePlayMethodCall(message, reply);
         });
   }
@@ -207,6 +291,7 @@ void VideoPlayerPlugin::RegisterWithRegistrar(
             &flutter::StandardMessageCodec::GetInstance());
     channel->SetMessageHandler(
         [plugin_pointer = plugin.get()](const auto& message, auto reply) {
+          plugin_pointer->RunPlatformThreadTasks();
           plugin_pointer->HandleSetLoopingMethodCall(message, reply);
         });
   }
@@ -218,6 +303,7 @@ void VideoPlayerPlugin::RegisterWithRegistrar(
             &flutter::StandardMessageCodec::GetInstance());
     channel->SetMessageHandler(
         [plugin_pointer = plugin.get()](const auto& message, auto reply) {
+          plugin_pointer->RunPlatformThreadTasks();
           plugin_pointer->HandleSetVolumeMethodCall(message, reply);
         });
   }
@@ -229,6 +315,7 @@ void VideoPlayerPlugin::RegisterWithRegistrar(
             &flutter::StandardMessageCodec::GetInstance());
     channel->SetMessageHandler(
         [plugin_pointer = plugin.get()](const auto& message, auto reply) {
+          plugin_pointer->RunPlatformThreadTasks();
           plugin_pointer->HandleSetMixWithOthersMethodCall(message, reply);
         });
   }
@@ -240,6 +327,7 @@ void VideoPlayerPlugin::RegisterWithRegistrar(
             &flutter::StandardMessageCodec::GetInstance());
     channel->SetMessageHandler(
         [plugin_pointer = plugin.get()](const auto& message, auto reply) {
+          plugin_pointer->RunPlatformThreadTasks();
           plugin_pointer->HandleSetPlaybackSpeedMethodCall(message, reply);
         });
   }
@@ -251,6 +339,7 @@ void VideoPlayerPlugin::RegisterWithRegistrar(
             &flutter::StandardMessageCodec::GetInstance());
     channel->SetMessageHandler(
         [plugin_pointer = plugin.get()](const auto& message, auto reply) {
+          plugin_pointer->RunPlatformThreadTasks();
           plugin_pointer->HandleSeekToMethodCall(message, reply);
         });
   }
@@ -262,10 +351,101 @@ void VideoPlayerPlugin::RegisterWithRegistrar(
             &flutter::StandardMessageCodec::GetInstance());
     channel->SetMessageHandler(
         [plugin_pointer = plugin.get()](const auto& message, auto reply) {
+          plugin_pointer->RunPlatformThreadTasks();
           plugin_pointer->HandlePositionMethodCall(message, reply);
         });
   }
 
+  {
+    auto channel =
+        std::make_unique<flutter::BasicMessageChannel<flutter::EncodableValue>>(
+            registrar->messenger(), kVideoPlayerElinuxApiChannelSetVisibleName,
+            &flutter::StandardMessageCodec::GetInstance());
+    channel->SetMessageHandler(
+        [plugin_pointer = plugin.get()](const auto& message, auto reply) {
+          plugin_pointer->RunPlatformThreadTasks();
+          plugin_pointer->HandleSetVisibleMethodCall(message, reply);
+        });
+  }
+
+  {
+    auto channel =
+        std::make_unique<flutter::BasicMessageChannel<flutter::EncodableValue>>(
+            registrar->messenger(),
+            kVideoPlayerElinuxApiChannelSetAudioOnlyName,
+            &flutter::StandardMessageCodec::GetInstance());
+    channel->SetMessageHandler(
+        [plugin_pointer = plugin.get()](const auto& message, auto reply) {
+          plugin_pointer->RunPlatformThreadTasks();
+          plugin_pointer->HandleSetAudioOnlyMethodCall(message, reply);
+        });
+  }
+
+  {
+    auto channel =
+        std::make_unique<flutter::BasicMessageChannel<flutter::EncodableValue>>(
+            registrar->messenger(),
+            kVideoPlayerElinuxApiChannelSetDefaultAudioOnlyName,
+            &flutter::StandardMessageCodec::GetInstance());
+    channel->SetMessageHandler(
+        [plugin_pointer = plugin.get()](const auto& message, auto reply) {
+          plugin_pointer->RunPlatformThreadTasks();
+          plugin_pointer->HandleSetDefaultAudioOnlyMethodCall(message, reply);
+        });
+  }
+
+  {
+    auto channel =
+        std::make_unique<flutter::BasicMessageChannel<flutter::EncodableValue>>(
+            registrar->messenger(), kVideoPlayerElinuxApiChannelSetSeekModeName,
+            &flutter::StandardMessageCodec::GetInstance());
+    channel->SetMessageHandler(
+        [plugin_pointer = plugin.get()](const auto& message, auto reply) {
+          plugin_pointer->RunPlatformThreadTasks();
+          plugin_pointer->HandleSetSeekModeMethodCall(message, reply);
+        });
+  }
+
+  {
+    auto channel =
+        std::make_unique<flutter::BasicMessageChannel<flutter::EncodableValue>>(
+            registrar->messenger(),
+            kVideoPlayerElinuxApiChannelGetSeekStatsName,
+            &flutter::StandardMessageCodec::GetInstance());
+    channel->SetMessageHandler(
+        [plugin_pointer = plugin.get()](const auto& message, auto reply) {
+          plugin_pointer->RunPlatformThreadTasks();
+          plugin_pointer->HandleGetSeekStatsMethodCall(message, reply);
+        });
+  }
+
+  {
+    auto channel =
+        std::make_unique<flutter::BasicMessageChannel<flutter::EncodableValue>>(
+            registrar->messenger(),
+            kVideoPlayerElinuxApiChannelGetThumbnailsName,
+            &flutter::StandardMessageCodec::GetInstance());
+    channel->SetMessageHandler(
+        [plugin_pointer = plugin.get()](const auto& message, auto reply) {
+          plugin_pointer->RunPlatformThreadTasks();
+          plugin_pointer->HandleGetThumbnailsMethodCall(message, reply);
+        });
+  }
+
+  {
+    auto channel =
+        std::make_unique<flutter::BasicMessageChannel<flutter::EncodableValue>>(
+            registrar->messenger(),
+            kVideoPlayerElinuxApiChannelRunPlatformThreadTasksName,
+            &flutter::StandardMessageCodec::GetInstance());
+    channel->SetMessageHandler(
+        [plugin_pointer = plugin.get()](const auto& message, auto reply) {
+          plugin_pointer->RunPlatformThreadTasks();
+          plugin_pointer->HandleRunPlatformThreadTasksMethodCall(message,
+                                                                 reply);
+        });
+  }
+
   registrar->AddPlugin(std::move(plugin));
 }
 
@@ -302,9 +482,19 @@ void VideoPlayerPlugin::HandleCreateMethodCall(
                   return nullptr;
 
                 if (instance->player) {
-                  instance->buffer->width = instance->player->GetWidth();
-                  instance->buffer->height = instance->player->GetHeight();
-                  instance->buffer->buffer = instance->player->GetFrameBuffer();
+                  // The engine may still read the buffer which it got last,
+                  // so the frame is copied to the other one.
+                  instance->pixels_index ^= 1;
+                  auto& pixels = instance->pixels[instance->pixels_index];
+                  int32_t frame_width;
+                  int32_t frame_height;
+                  if (!instance->player->CopyFrame(pixels, frame_width,
+                                                   frame_height)) {
+                    return nullptr;
+                  }
+                  instance->buffer->width = frame_width;
+                  instance->buffer->height = frame_height;
+                  instance->buffer->buffer = pixels.data();
                 } else {
                   printf("%s\n","ERROR: player is nullptr!");
                 }
@@ -354,10 +544,12 @@ void VideoPlayerPlugin::HandleCreateMethodCall(
         },
         // OnNotifyCompleted
         [texture_id, host = this]() {
-          host->SendPlayCompletedEventMessage(texture_id);
+          host->PostPlatformThreadTask([texture_id, host]() {
+            host->SendPlayCompletedEventMessage(texture_id);
+          });
         });
-    instance->player =
-        std::make_unique<GstVideoPlayer>(uri, std::move(player_handler));
+    instance->player = std::make_unique<GstVideoPlayer>(
+        uri, std::move(player_handler), default_audio_only_);
     players_[texture_id] = std::move(instance);
   }
 
@@ -558,6 +750,217 @@ void VideoPlayerPlugin::HandleSeekToMethodCall(
   reply(flutter::EncodableValue(result));
 }
 
+void VideoPlayerPlugin::HandleSetVisibleMethodCall(
+    const flutter::EncodableValue& message,
+    flutter::MessageReply<flutter::EncodableValue> reply) {
+  auto parameter = VisibilityMessage::FromMap(message);
+  const auto texture_id = parameter.GetTextureId();
+  flutter::EncodableMap result;
+
+  if (players_.find(texture_id) != players_.end()) {
+    players_[texture_id]->player->SetVisible(parameter.GetIsVisible());
+    result.emplace(flutter::EncodableValue(kEncodableMapkeyResult),
+                   flutter::EncodableValue());
+  } else {
+    auto error_message = "Couldn't find the player with texture id: " +
+                         std::to_string(texture_id);
+    result.emplace(flutter::EncodableValue(kEncodableMapkeyError),
+                   flutter::EncodableValue(WrapError(error_message)));
+  }
+  reply(flutter::EncodableValue(result));
+}
+
+void VideoPlayerPlugin::HandleSetAudioOnlyMethodCall(
+    const flutter::EncodableValue& message,
+    flutter::MessageReply<flutter::EncodableValue> reply) {
+  auto parameter = AudioOnlyMessage::FromMap(message);
+  const auto texture_id = parameter.GetTextureId();
+  flutter::EncodableMap result;
+
+  if (players_.find(texture_id) != players_.end()) {
+    if (players_[texture_id]->player->SetAudioOnly(
+            parameter.GetIsAudioOnly())) {
+      result.emplace(flutter::EncodableValue(kEncodableMapkeyResult),
+                     flutter::EncodableValue());
+    } else {
+      auto error_message =
+          "Failed to change the audio only mode with texture id: " +
+          std::to_string(texture_id);
+      result.emplace(flutter::EncodableValue(kEncodableMapkeyError),
+                     flutter::EncodableValue(WrapError(error_message)));
+    }
+  } else {
+    auto error_message = "Couldn't find the player with texture id: " +
+                         std::to_string(texture_id);
+    result.emplace(flutter::EncodableValue(kEncodableMapkeyError),
+                   flutter::EncodableValue(WrapError(error_message)));
+  }
+  reply(flutter::EncodableValue(result));
+}
+
+void VideoPlayerPlugin::HandleSetDefaultAudioOnlyMethodCall(
+    const flutter::EncodableValue& message,
+    flutter::MessageReply<flutter::EncodableValue> reply) {
+  auto parameter = AudioOnlyMessage::FromMap(message);
+  default_audio_only_ = parameter.GetIsAudioOnly();
+
+  flutter::EncodableMap result;
+  result.emplace(flutter::EncodableValue(kEncodableMapkeyResult),
+                 flutter::EncodableValue());
+  reply(flutter::EncodableValue(result));
+}
+
+void VideoPlayerPlugin::HandleSetSeekModeMethodCall(
+    const flutter::EncodableValue& message,
+    flutter::MessageReply<flutter::EncodableValue> reply) {
+  auto parameter = SeekModeMessage::FromMap(message);
+  const auto texture_id = parameter.GetTextureId();
+  flutter::EncodableMap result;
+
+  // The values of VideoPlayerSeekMode in lib/video_player_elinux.dart.
+  std::optional<GstVideoPlayer::SeekMode> seek_mode;
+  switch (parameter.GetSeekMode()) {
+    case 0:
+      seek_mode = GstVideoPlayer::SeekMode::kKeyframe;
+      break;
+    case 1:
+      seek_mode = GstVideoPlayer::SeekMode::kAccurate;
+      break;
+    case 2:
+      seek_mode = GstVideoPlayer::SeekMode::kAuto;
+      break;
+  }
+
+  if (players_.find(texture_id) == players_.end()) {
+    auto error_message = "Couldn't find the player with texture id: " +
+                         std::to_string(texture_id);
+    result.emplace(flutter::EncodableValue(kEncodableMapkeyError),
+                   flutter::EncodableValue(WrapError(error_message)));
+  } else if (!seek_mode) {
+    auto error_message =
+        "Unknown seek mode: " + std::to_string(parameter.GetSeekMode());
+    result.emplace(flutter::EncodableValue(kEncodableMapkeyError),
+                   flutter::EncodableValue(WrapError(error_message)));
+  } else {
+    players_[texture_id]->player->SetSeekMode(*seek_mode);
+    result.emplace(flutter::EncodableValue(kEncodableMapkeyResult),
+                   flutter::EncodableValue());
+  }
+  reply(flutter::EncodableValue(result));
+}
+
+void VideoPlayerPlugin::HandleGetSeekStatsMethodCall(
+    const flutter::EncodableValue& message,
+    flutter::MessageReply<flutter::EncodableValue> reply) {
+  auto parameter = TextureMessage::FromMap(message);
+  const auto texture_id = parameter.GetTextureId();
+  flutter::EncodableMap result;
+
+  if (players_.find(texture_id) != players_.end()) {
+    auto stats = players_[texture_id]->player->GetSeekStats();
+    auto average_latency_ms =
+        stats.count > 0 ? stats.total_latency_ms / stats.count : 0;
+    flutter::EncodableMap value = {
+        {flutter::EncodableValue("count"),
+         flutter::EncodableValue(stats.count)},
+        {flutter::EncodableValue("coalescedCount"),
+         flutter::EncodableValue(stats.coalesced_count)},
+        {flutter::EncodableValue("lastLatencyMs"),
+         flutter::EncodableValue(stats.last_latency_ms)},
+        {flutter::EncodableValue("maxLatencyMs"),
+         flutter::EncodableValue(stats.max_latency_ms)},
+        {flutter::EncodableValue("averageLatencyMs"),
+         flutter::EncodableValue(average_latency_ms)}};
+    result.emplace(flutter::EncodableValue(kEncodableMapkeyResult),
+                   flutter::EncodableValue(value));
+  } else {
+    auto error_message = "Couldn't find the player with texture id: " +
+                         std::to_string(texture_id);
+    result.emplace(flutter::EncodableValue(kEncodableMapkeyError),
+                   flutter::EncodableValue(WrapError(error_message)));
+  }
+  reply(flutter::EncodableValue(result));
+}
+
+void VideoPlayerPlugin::HandleGetThumbnailsMethodCall(
+    const flutter::EncodableValue& message,
+    flutter::MessageReply<flutter::EncodableValue> reply) {
+  auto parameter = ThumbnailMessage::FromMap(message);
+  ThumbnailExtractor::Options options;
+  if (!parameter.GetAsset().empty()) {
+    options.uri = GetExecutableDirectory() + "/data/flutter_assets/" +
+                  parameter.GetAsset();
+  } else {
+    options.uri = parameter.GetUri();
+  }
+  options.positions_ms = parameter.GetPositionsMs();
+  options.count = parameter.GetCount();
+  options.width = parameter.GetWidth();
+  options.height = parameter.GetHeight();
+  options.format = parameter.GetFormat() == 0 ? ThumbnailFormat::kRgba
+                                              : ThumbnailFormat::kJpeg;
+  options.accurate = parameter.GetIsAccurate();
+
+  if (options.uri.empty() || options.width < 0 || options.height < 0 ||
+      (options.positions_ms.empty() && options.count <= 0)) {
+    flutter::EncodableMap result;
+    result.emplace(flutter::EncodableValue(kEncodableMapkeyError),
+                   flutter::EncodableValue(WrapError(
+                       "Invalid parameters to get thumbnails", "bad-args")));
+    reply(flutter::EncodableValue(result));
+    return;
+  }
+
+  if (!thumbnail_extractor_) {
+    thumbnail_extractor_ = std::make_unique<ThumbnailExtractor>(
+        ThumbnailExtractor::GetDefaultWorkerCount(),
+        ThumbnailExtractor::GetDefaultCacheDirectory());
+  }
+
+  thumbnail_extractor_->Extract(
+      options,
+      [this, reply, uri = options.uri](std::vector<Thumbnail> thumbnails) {
+        PostPlatformThreadTask([this, reply, uri,
+                                thumbnails = std::move(thumbnails)]() mutable {
+          flutter::EncodableMap result;
+          if (thumbnails.empty()) {
+            auto error_message = "Failed to get thumbnails of " + uri;
+            result.emplace(flutter::EncodableValue(kEncodableMapkeyError),
+                           flutter::EncodableValue(
+                               WrapError(error_message, "decode-error")));
+            reply(flutter::EncodableValue(result));
+            return;
+          }
+
+          flutter::EncodableList values;
+          for (auto& thumbnail : thumbnails) {
+            values.push_back(flutter::EncodableValue(flutter::EncodableMap{
+                {flutter::EncodableValue("positionMs"),
+                 flutter::EncodableValue(thumbnail.position_ms)},
+                {flutter::EncodableValue("width"),
+                 flutter::EncodableValue(thumbnail.width)},
+                {flutter::EncodableValue("height"),
+                 flutter::EncodableValue(thumbnail.height)},
+                {flutter::EncodableValue("bytes"),
+                 flutter::EncodableValue(std::move(thumbnail.data))}}));
+          }
+          result.emplace(flutter::EncodableValue(kEncodableMapkeyResult),
+                         flutter::EncodableValue(values));
+          reply(flutter::EncodableValue(result));
+        });
+      });
+}
+
+// The tasks have run before this is called.
+void VideoPlayerPlugin::HandleRunPlatformThreadTasksMethodCall(
+    const flutter::EncodableValue& message,
+    flutter::MessageReply<flutter::EncodableValue> reply) {
+  flutter::EncodableMap result;
+  result.emplace(flutter::EncodableValue(kEncodableMapkeyResult),
+                 flutter::EncodableValue());
+  reply(flutter::EncodableValue(result));
+}
+
 void VideoPlayerPlugin::SendInitializedEventMessage(int64_t texture_id) {
   if (players_.find(texture_id) == players_.end() ||
       !players_[texture_id]->event_sink) {
@@ -589,6 +992,35 @@ void VideoPlayerPlugin::SendPlayCompletedEventMessage(int64_t texture_id) {
   players_[texture_id]->event_sink->Success(event);
 }
 
+void VideoPlayerPlugin::PostPlatformThreadTask(std::function<void()> task) {
+  bool wakes_up;
+  {
+    std::lock_guard<std::mutex> lock(mutex_platform_thread_tasks_);
+    // The queue is drained as a whole, so only the first task needs to wake
+    // up the platform thread.
+    wakes_up = platform_thread_tasks_.empty();
+    platform_thread_tasks_.push_back(std::move(task));
+  }
+
+  auto port = platform_thread_wakeup_port.load();
+  if (wakes_up && port != ILLEGAL_PORT && Dart_PostCObject_DL) {
+    Dart_CObject message;
+    message.type = Dart_CObject_kNull;
+    Dart_PostCObject_DL(port, &message);
+  }
+}
+
+void VideoPlayerPlugin::RunPlatformThreadTasks() {
+  std::vector<std::function<void()>> tasks;
+  {
+    std::lock_guard<std::mutex> lock(mutex_platform_thread_tasks_);
+    tasks.swap(platform_thread_tasks_);
+  }
+  for (const auto& task : tasks) {
+    task();
+  }
+}
+
 flutter::EncodableValue VideoPlayerPlugin::WrapError(
     const std::string& message, const std::string& code,
     const std::string& details) {
@@ -610,6 +1042,20 @@ const std::string VideoPlayerPlugin::GetExecutableDirectory() {
 
 }  // namespace
 
+// Initializes the Dart API used to post to native ports. |data| is
+// NativeApi.initializeApiDLData.
+extern "C" __attribute__((visibility("default"))) intptr_t
+video_player_elinux_initialize_dart_api(void* data) {
+  return Dart_InitializeApiDL(data);
+}
+
+// Sets the native port which is posted a null when tasks are posted to the
+// platform thread, or ILLEGAL_PORT to stop posting.
+extern "C" __attribute__((visibility("default"))) void
+video_player_elinux_set_wakeup_port(int64_t port) {
+  platform_thread_wakeup_port = port;
+}
+
 void VideoPlayerElinuxPluginRegisterWithRegistrar(
     FlutterDesktopPluginRegistrarRef registrar) {
   VideoPlayerPlugin::RegisterWithRegistrar(
@@ -20,7 +20,8 @@ class VideoPlayerStreamHandler {
   // Notifies the completion of decoding a video frame.
   void OnNotifyFrameDecoded() { OnNotifyFrameDecodedInternal(); }
 
-  // Notifies the completion of playing a video.
+  // Notifies the completion of playing a video. It is called on the thread of
+  // GstBusThread, not on the platform thread.
   void OnNotifyCompleted() { OnNotifyCompletedInternal(); }
 
  protected:
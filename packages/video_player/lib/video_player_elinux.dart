@@ -0,0 +1,258 @@
+// Copyright 2023 Sony Group Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+import 'dart:ffi';
+import 'dart:isolate';
+import 'dart:typed_data';
+
+import 'package:flutter/services.dart';
+
+/// How [VideoPlayerElinux] seeks.
+enum VideoPlayerSeekMode {
+  /// Seeks to the keyframe before the position. It's fast, but can be seconds
+  /// off in videos with long intervals between keyframes.
+  keyframe,
+
+  /// Seeks to the exact position by decoding the frames from the keyframe
+  /// before it.
+  accurate,
+
+  /// Snaps to a keyframe when it's close to the position or too far before
+  /// it, and seeks accurately otherwise, with the keyframe index of the file.
+  /// The index is built in the background at the first seek, and the seeks
+  /// until then are the same as [keyframe]. This is the default.
+  auto,
+}
+
+/// The statistics of the seeks of a player.
+class VideoPlayerSeekStats {
+  VideoPlayerSeekStats._(Map<Object?, Object?> map)
+      : count = map['count']! as int,
+        coalescedCount = map['coalescedCount']! as int,
+        lastLatency = Duration(milliseconds: map['lastLatencyMs']! as int),
+        maxLatency = Duration(milliseconds: map['maxLatencyMs']! as int),
+        averageLatency =
+            Duration(milliseconds: map['averageLatencyMs']! as int);
+
+  /// The number of the seeks which have completed.
+  final int count;
+
+  /// The number of the seeks which were skipped because a later seek was
+  /// requested while another seek was in progress.
+  final int coalescedCount;
+
+  /// The time from starting the last seek until the first frame at the new
+  /// position was ready.
+  final Duration lastLatency;
+
+  /// The longest latency of the completed seeks.
+  final Duration maxLatency;
+
+  /// The average latency of the completed seeks.
+  final Duration averageLatency;
+}
+
+/// The format of [VideoThumbnail.bytes].
+enum VideoThumbnailFormat {
+  /// 4 bytes per pixel in the order of R, G, B and A, without padding between
+  /// the rows. It can be decoded with `ui.decodeImageFromPixels`.
+  rgba,
+
+  /// A JPEG image. It's much smaller than [rgba], e.g. for caching in Dart.
+  jpeg,
+}
+
+/// A frame of a video extracted by [VideoPlayerElinux.getThumbnails].
+class VideoThumbnail {
+  VideoThumbnail._(Map<Object?, Object?> map)
+      : position = Duration(milliseconds: map['positionMs']! as int),
+        width = map['width']! as int,
+        height = map['height']! as int,
+        bytes = map['bytes']! as Uint8List;
+
+  /// The position of the frame. It's the one of the nearest keyframe unless
+  /// the thumbnails are extracted accurately.
+  final Duration position;
+
+  final int width;
+
+  final int height;
+
+  /// The image in the requested [VideoThumbnailFormat].
+  final Uint8List bytes;
+}
+
+/// The APIs which only the eLinux implementation of `video_player` has.
+///
+/// [textureId] is the one of `VideoPlayerController.textureId`.
+class VideoPlayerElinux {
+  VideoPlayerElinux._();
+
+  static const String _channelPrefix =
+      'dev.flutter.pigeon.VideoPlayerElinuxApi';
+
+  static bool _isListeningToWakeups = false;
+
+  /// Called by the plugin registrant when the app starts.
+  static void registerWith() {
+    _listenToWakeups();
+  }
+
+  /// Lets the plugin wake up its platform thread, which only runs the native
+  /// tasks, e.g. sending the completed events and the thumbnails, when it
+  /// handles a message from Dart. The plugin posts to a native port when it
+  /// queues a task, and a runPlatformThreadTasks message is sent back.
+  static void _listenToWakeups() {
+    if (_isListeningToWakeups) {
+      return;
+    }
+    _isListeningToWakeups = true;
+    final DynamicLibrary dylib;
+    try {
+      dylib = DynamicLibrary.open('libvideo_player_elinux_plugin.so');
+    } on ArgumentError {
+      // The tasks run when the next message is handled.
+      return;
+    }
+    final int Function(Pointer<Void>) initializeDartApi = dylib
+        .lookup<NativeFunction<IntPtr Function(Pointer<Void>)>>(
+            'video_player_elinux_initialize_dart_api')
+        .asFunction();
+    final void Function(int) setWakeupPort = dylib
+        .lookup<NativeFunction<Void Function(Int64)>>(
+            'video_player_elinux_set_wakeup_port')
+        .asFunction();
+    if (initializeDartApi(NativeApi.initializeApiDLData) != 0) {
+      return;
+    }
+
+    final ReceivePort port = ReceivePort()
+      ..listen((_) => _runPlatformThreadTasks());
+    setWakeupPort(port.sendPort.nativePort);
+  }
+
+  static void _runPlatformThreadTasks() {
+    _send('runPlatformThreadTasks', <Object?, Object?>{})
+        .catchError((Object error) => null);
+  }
+
+  /// Stops decoding the video of the player while [visible] is false, e.g.
+  /// while it's scrolled out of the screen or on a hidden tab.
+  ///
+  /// The audio and the position keep going, and the video catches up with the
+  /// position when it becomes visible again.
+  static Future<void> setVisible(int textureId, bool visible) {
+    return _send('setVisible', <Object?, Object?>{
+      'textureId': textureId,
+      'isVisible': visible,
+    });
+  }
+
+  /// Disables the video of the player while [audioOnly] is true, so that the
+  /// video isn't decoded at all, e.g. while only its audio is played in the
+  /// background.
+  static Future<void> setAudioOnly(int textureId, bool audioOnly) {
+    return _send('setAudioOnly', <Object?, Object?>{
+      'textureId': textureId,
+      'isAudioOnly': audioOnly,
+    });
+  }
+
+  /// Whether the players created after this call start in audio only mode.
+  ///
+  /// The size of a player created in audio only mode is 0x0, because its
+  /// video is never decoded.
+  static Future<void> setDefaultAudioOnly(bool audioOnly) {
+    return _send('setDefaultAudioOnly', <Object?, Object?>{
+      'isAudioOnly': audioOnly,
+    });
+  }
+
+  /// Changes how the player seeks. See [VideoPlayerSeekMode].
+  ///
+  /// While a seek is in progress, the later seeks are coalesced and only the
+  /// latest position is sought, regardless of the mode.
+  static Future<void> setSeekMode(int textureId, VideoPlayerSeekMode mode) {
+    return _send('setSeekMode', <Object?, Object?>{
+      'textureId': textureId,
+      'seekMode': mode.index,
+    });
+  }
+
+  /// Returns the statistics of the seeks of the player.
+  static Future<VideoPlayerSeekStats> getSeekStats(int textureId) async {
+    final Object? result = await _send('getSeekStats', <Object?, Object?>{
+      'textureId': textureId,
+    });
+    return VideoPlayerSeekStats._(result! as Map<Object?, Object?>);
+  }
+
+  /// Extracts the frames of a video at [positions], or at [count] positions
+  /// evenly spaced over the duration if [positions] is null, e.g. for a
+  /// preview strip of a seek bar. It doesn't need a player.
+  ///
+  /// Either [uri] or [asset] must be given. The frames are scaled to [width]
+  /// x [height]. If either of them is omitted, it's derived from the other
+  /// one with the aspect ratio of the video. The nearest keyframes are decoded
+  /// unless [accurate] is true, which is much slower for videos with long
+  /// intervals between keyframes.
+  ///
+  /// The frames are decoded in parallel on worker threads, and the ones of
+  /// local files are cached on disk until the files are changed. The frames
+  /// which couldn't be decoded are omitted from the result.
+  static Future<List<VideoThumbnail>> getThumbnails({
+    String? uri,
+    String? asset,
+    List<Duration>? positions,
+    int count = 10,
+    int? width,
+    int? height,
+    VideoThumbnailFormat format = VideoThumbnailFormat.jpeg,
+    bool accurate = false,
+  }) async {
+    final Map<Object?, Object?> message = <Object?, Object?>{
+      'uri': uri,
+      'asset': asset,
+      'positionsMs': positions
+          ?.map((Duration position) => position.inMilliseconds)
+          .toList(),
+      'count': count,
+      'width': width ?? 0,
+      'height': height ?? 0,
+      'format': format.index,
+      'isAccurate': accurate,
+    };
+    final Object? result = await _send('getThumbnails', message);
+    return (result! as List<Object?>)
+        .map((Object? thumbnail) =>
+            VideoThumbnail._(thumbnail! as Map<Object?, Object?>))
+        .toList();
+  }
+
+  static Future<Object?> _send(
+      String name, Map<Object?, Object?> message) async {
+    // In case the plugin registrant hasn't called registerWith().
+    _listenToWakeups();
+    final BasicMessageChannel<Object?> channel = BasicMessageChannel<Object?>(
+        '$_channelPrefix.$name', const StandardMessageCodec());
+    final Map<Object?, Object?>? reply =
+        await channel.send(message) as Map<Object?, Object?>?;
+    if (reply == null) {
+      throw PlatformException(
+        code: 'channel-error',
+        message: 'Unable to establish connection on channel.',
+      );
+    }
+    if (reply['error'] != null) {
+      final Map<Object?, Object?> error =
+          reply['error']! as Map<Object?, Object?>;
+      throw PlatformException(
+        code: error['code']! as String,
+        message: error['message'] as String?,
+        details: error['details'],
+      );
+    }
+    return reply['result'];
+  }
+}